@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
 #include <imgui.h>
@@ -5,6 +6,8 @@
 #include <backends/imgui_impl_opengl3.h>
 #include "app.h"
 #include "apps/main/mainApp.h"
+#include "core/profiler.h"
+#include "gfx/gfxDevice.h"
 
 const int DEFAULT_WIDTH =1920;
 const int DEFAULT_HEIGHT = 1080;
@@ -35,8 +38,21 @@ static void APIENTRY debugGLCallbackProc(GLenum source, GLenum type, GLuint id,
    printf("OpenGL %s: Message: %s\n", type == GL_DEBUG_TYPE_ERROR ? "Error" : "Information", message);
 }
 
-void Application::init()
+void Application::init(int width, int height)
 {
+   if (playback.headless)
+   {
+      memset(&state, 0, sizeof(state));
+      playback.headlessWidth = width > 0 ? width : DEFAULT_WIDTH;
+      playback.headlessHeight = height > 0 ? height : DEFAULT_HEIGHT;
+      playback.headlessTime = 0.0;
+
+      Profiler::setThreadName("Main");
+
+      onInit();
+      return;
+   }
+
    glfwInit();
    
    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -55,7 +71,7 @@ void Application::init()
 #endif
    
    memset(&state, 0, sizeof(state));
-   state.window = glfwCreateWindow(DEFAULT_WIDTH, DEFAULT_HEIGHT, DEFAULT_TITLE, NULL, NULL);
+   state.window = glfwCreateWindow(width > 0 ? width : DEFAULT_WIDTH, height > 0 ? height : DEFAULT_HEIGHT, DEFAULT_TITLE, NULL, NULL);
    glfwMakeContextCurrent(state.window);
    glfwSwapInterval(0);
 
@@ -85,12 +101,20 @@ void Application::init()
    ImGui::StyleColorsDark();
    ImGui_ImplGlfw_InitForOpenGL(state.window, true); // true installs callbacks automatically
    ImGui_ImplOpenGL3_Init(SHADER_VERSION);
+
+   Profiler::setThreadName("Main");
    
    onInit();
 }
 
 void Application::destroy()
 {
+   if (playback.headless)
+   {
+      onDestroy();
+      return;
+   }
+
    ImGui_ImplOpenGL3_Shutdown();
    ImGui_ImplGlfw_Shutdown();
    ImGui::DestroyContext();
@@ -103,6 +127,23 @@ void Application::destroy()
 
 bool Application::update()
 {
+   if (playback.headless)
+   {
+      Profiler::newFrame();
+      PROFILE_SCOPE("Application::update");
+
+      const double currentTime = Profiler::now() / 1000000.0;
+      double deltaInMilliseconds = playback.headlessTime > 0.0 ? currentTime - playback.headlessTime : 0.0;
+      playback.headlessTime = currentTime;
+
+      if (playback.fixedTimeStep > 0.0)
+         deltaInMilliseconds = playback.fixedTimeStep;
+
+      PROFILE_SCOPE("onUpdate");
+      onUpdate(deltaInMilliseconds);
+      return true;
+   }
+
    if (glfwWindowShouldClose(state.window))
    {
       // If we're main we're done.
@@ -130,6 +171,9 @@ bool Application::update()
 
       return true;
    }
+
+   Profiler::newFrame();
+   PROFILE_SCOPE("Application::update");
  
    glfwPollEvents();
    
@@ -138,6 +182,9 @@ bool Application::update()
    double deltaInMilliseconds = (currentTime - state.lastTimeStamp) * 1000;
    state.lastTimeStamp = currentTime;
 
+   if (playback.fixedTimeStep > 0.0)
+      deltaInMilliseconds = playback.fixedTimeStep;
+
    // Update Mouse Movement
    double currentX, currentY;
    glfwGetCursorPos(state.window, &currentX, &currentY);
@@ -146,14 +193,23 @@ bool Application::update()
    state.lastMouseX = currentX;
    state.lastMouseY = currentY;
    
-   onUpdate(deltaInMilliseconds);
+   {
+      PROFILE_SCOPE("onUpdate");
+      onUpdate(deltaInMilliseconds);
+   }
    
-   ImGui_ImplOpenGL3_NewFrame();
-   ImGui_ImplGlfw_NewFrame();
-   onRenderImGUI(deltaInMilliseconds);
-   ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+   {
+      PROFILE_SCOPE("onRenderImGUI");
+      ImGui_ImplOpenGL3_NewFrame();
+      ImGui_ImplGlfw_NewFrame();
+      onRenderImGUI(deltaInMilliseconds);
+      ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+   }
    
-   glfwSwapBuffers(state.window);
+   {
+      PROFILE_SCOPE("glfwSwapBuffers");
+      glfwSwapBuffers(state.window);
+   }
    
    return true;
 }
@@ -163,28 +219,58 @@ bool Application::supportsComputeShaders()
 #ifdef __APPLE__
    return false;
 #else
-   return true;
+   return playback.deviceApi == GFXApi::OpenGL;
 #endif
 }
 
 glm::vec2 Application::getMouseDelta() const
 {
+    if (!playback.inputEnabled || playback.headless)
+       return glm::vec2(0.0f);
+
     return glm::vec2(state.currentMouseX, state.currentMouseY);
 }
 
 void Application::toggleCursorLock()
 {
+   if (playback.headless)
+      return;
+
    state.cursorIsLocked = !state.cursorIsLocked;
    glfwSetInputMode(state.window, GLFW_CURSOR, state.cursorIsLocked ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL);
 }
 
 void Application::setWindowTitle(const char* title)
 {
-   glfwSetWindowTitle(state.window, title);
+   if (!playback.headless)
+      glfwSetWindowTitle(state.window, title);
+}
+
+void Application::setFixedTimeStep(double milliseconds)
+{
+   playback.fixedTimeStep = milliseconds;
+}
+
+void Application::setInputEnabled(bool enabled)
+{
+   playback.inputEnabled = enabled;
+}
+
+void Application::setDeviceApi(GFXApi api)
+{
+   playback.deviceApi = api;
+}
+
+void Application::setHeadless(bool headless)
+{
+   playback.headless = headless;
 }
 
 bool Application::isKeyPressed(Key key) const
 {
+   if (!playback.inputEnabled || playback.headless)
+      return false;
+
    switch (key)
    {
       case Key::ESCAPE:
@@ -215,13 +301,21 @@ float Application::getAspectRatio() const
 
 void Application::getWindowSize(int& width, int& height) const
 {
+   if (playback.headless)
+   {
+      width = playback.headlessWidth;
+      height = playback.headlessHeight;
+      return;
+   }
+
    glfwGetWindowSize(state.window, &width, &height);
 }
 
 void Application::setVerticalSync(bool enabled)
 {
    state.vsyncEnabled = enabled;
-   glfwSwapInterval(enabled ? 1 : 0);
+   if (!playback.headless)
+      glfwSwapInterval(enabled ? 1 : 0);
 }
 
 void Application::queueAppSwitch(const std::string &app)
@@ -255,3 +349,179 @@ char* Application::readShaderFile(const char* fileName) const
    return buffer;
 }
 #pragma warning(pop)
+
+static void renderProfileNode(const std::vector<ProfileNode>& tree, uint32_t index)
+{
+   const ProfileNode& node = tree[index];
+
+   ImGui::TableNextRow();
+   ImGui::TableNextColumn();
+
+   bool open = false;
+   if (node.subtreeSize > 1)
+      open = ImGui::TreeNodeEx((const void*)(intptr_t)index, ImGuiTreeNodeFlags_SpanFullWidth | (node.depth == 0 ? ImGuiTreeNodeFlags_DefaultOpen : 0), "%s", node.name);
+   else
+      ImGui::TreeNodeEx((const void*)(intptr_t)index, ImGuiTreeNodeFlags_SpanFullWidth | ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen, "%s", node.name);
+
+   ImGui::TableNextColumn();
+   ImGui::Text("%.3f ms", node.totalMs);
+   ImGui::TableNextColumn();
+   if (node.depth > 0)
+      ImGui::Text("%u", node.calls);
+
+   if (open)
+   {
+      for (uint32_t child = index + 1; child < index + node.subtreeSize; child += tree[child].subtreeSize)
+         renderProfileNode(tree, child);
+
+      ImGui::TreePop();
+   }
+}
+
+void Application::renderProfilerStats() const
+{
+   static int exportFirstFrame = 0;
+   static int exportLastFrame = 59;
+
+   if (!ImGui::CollapsingHeader("CPU Profiler"))
+      return;
+
+   bool paused = Profiler::isPaused();
+   if (ImGui::Checkbox("Pause", &paused))
+      Profiler::setPaused(paused);
+
+   ImGui::SameLine();
+   ImGui::Text("Frame: %.2f ms, %llu events dropped", Profiler::getFrameMs(), (unsigned long long)Profiler::getDroppedEventCount());
+
+   const std::vector<ProfileNode>& tree = Profiler::getFrameTree();
+   if (ImGui::BeginTable("CPU Profiler", 3, ImGuiTableFlags_BordersV | ImGuiTableFlags_BordersOuterH | ImGuiTableFlags_RowBg))
+   {
+      ImGui::TableSetupColumn("Scope", ImGuiTableColumnFlags_NoHide);
+      ImGui::TableSetupColumn("Time", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+      ImGui::TableSetupColumn("Calls", ImGuiTableColumnFlags_WidthFixed, 50.0f);
+      ImGui::TableHeadersRow();
+
+      for (uint32_t i = 0; i < (uint32_t)tree.size(); i += tree[i].subtreeSize)
+         renderProfileNode(tree, i);
+
+      ImGui::EndTable();
+   }
+
+   // While running the range follows the newest frame, pause to pick frames out of the history.
+   const int historyFirstFrame = (int)Profiler::getFirstHistoryFrame();
+   const int historyLastFrame = (int)Profiler::getLastHistoryFrame();
+   if (!paused)
+   {
+      exportFirstFrame = historyLastFrame - (exportLastFrame - exportFirstFrame);
+      exportLastFrame = historyLastFrame;
+   }
+
+   ImGui::DragIntRange2("Frames", &exportFirstFrame, &exportLastFrame, 1.0f, historyFirstFrame, historyLastFrame);
+   ImGui::SameLine();
+   if (ImGui::Button("Export Chrome Trace"))
+   {
+      if (Profiler::exportChromeTrace("profile.json", (uint32_t)std::max(exportFirstFrame, 0), (uint32_t)std::max(exportLastFrame, 0)))
+         printf("Wrote frames %d to %d to profile.json\n", std::max(exportFirstFrame, historyFirstFrame), std::min(exportLastFrame, historyLastFrame));
+   }
+}
+
+void Application::renderGFXFrameStats(GFXDevice* device)
+{
+   renderGFXFrameStats(device->getApiString(), device->getFrameStats());
+}
+
+void Application::renderGFXFrameStats(const char* apiString, const GFXFrameStats& stats)
+{
+   const double KB = 1024.0;
+
+   ImGui::Checkbox("Frame Stats Overlay", &showFrameStatsOverlay);
+   if (!showFrameStatsOverlay)
+      return;
+
+   const ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings |
+      ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav | ImGuiWindowFlags_NoMove;
+
+   const ImVec2 displaySize = ImGui::GetIO().DisplaySize;
+   ImGui::SetNextWindowPos(ImVec2(displaySize.x - 10.0f, 10.0f), ImGuiCond_Always, ImVec2(1.0f, 0.0f));
+   ImGui::SetNextWindowBgAlpha(0.6f);
+
+   if (ImGui::Begin("Frame Stats", nullptr, flags))
+   {
+      ImGui::Text("%s", apiString);
+      ImGui::Separator();
+      ImGui::Text("Draw Calls: %u (%u indirect)", stats.drawCalls, stats.indirectDraws);
+      ImGui::Text("Dispatches: %u", stats.dispatches);
+      ImGui::Text("Instances: %llu", (unsigned long long)stats.instances);
+      ImGui::Text("Primitives: %llu", (unsigned long long)stats.primitives);
+      ImGui::Text("Render Passes: %u", stats.renderPassBinds);
+      ImGui::Text("Pipeline Binds: %u", stats.pipelineBinds);
+      ImGui::Text("State Block Changes: %u", stats.stateBlockChanges);
+      ImGui::Text("Buffer Binds: %u", stats.bufferBinds);
+      ImGui::Text("Texture Binds: %u", stats.textureBinds);
+      ImGui::Text("Sampler Binds: %u", stats.samplerBinds);
+      ImGui::Text("Mapped: %.1f KB", stats.bytesMapped / KB);
+      ImGui::Text("Uploaded: %.1f KB", stats.bytesUploaded / KB);
+
+      ImGui::Separator();
+      for (int i = 0; i <= (int)CommandType::End; i++)
+      {
+         if (stats.commandCounts[i] != 0)
+            ImGui::Text("%s: %u", GFXDevice::getCommandTypeString((CommandType)i), stats.commandCounts[i]);
+      }
+   }
+   ImGui::End();
+}
+
+void Application::renderGFXMemoryStats(GFXDevice* device) const
+{
+   const double MB = 1024.0 * 1024.0;
+   const GFXMemoryStats stats = device->getMemoryStats();
+
+   if (!ImGui::CollapsingHeader("GPU Memory"))
+      return;
+
+   if (ImGui::BeginTable("GPU Memory", 4, ImGuiTableFlags_Borders))
+   {
+      ImGui::TableSetupColumn("Category");
+      ImGui::TableSetupColumn("Allocated");
+      ImGui::TableSetupColumn("Peak");
+      ImGui::TableSetupColumn("Count");
+      ImGui::TableHeadersRow();
+
+      for (int i = 0; i < (int)GFXMemoryCategory::COUNT; i++)
+      {
+         const GFXMemoryCategoryStats& category = stats.categories[i];
+
+         ImGui::TableNextRow();
+         ImGui::TableNextColumn();
+         ImGui::Text("%s", GFXDevice::getMemoryCategoryString((GFXMemoryCategory)i));
+         ImGui::TableNextColumn();
+         ImGui::Text("%.2f MB", category.allocatedBytes / MB);
+         ImGui::TableNextColumn();
+         ImGui::Text("%.2f MB", category.peakBytes / MB);
+         ImGui::TableNextColumn();
+         ImGui::Text("%u", category.allocationCount);
+      }
+
+      ImGui::EndTable();
+   }
+
+   ImGui::Text("Total: %.2f MB (peak %.2f MB)", stats.totalBytes / MB, stats.peakBytes / MB);
+   ImGui::Text("Render Passes: %u", stats.renderPassCount);
+
+   if (stats.budgetBytes != 0)
+   {
+      if (device->isOverMemoryBudget())
+         ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Over Budget: %.2f / %.2f MB", stats.totalBytes / MB, stats.budgetBytes / MB);
+      else
+         ImGui::Text("Budget: %.2f / %.2f MB", stats.totalBytes / MB, stats.budgetBytes / MB);
+   }
+
+   if (stats.deviceTotalBytes != 0)
+      ImGui::Text("Driver: %.0f MB available of %.0f MB", stats.deviceAvailableBytes / MB, stats.deviceTotalBytes / MB);
+   else if (stats.deviceAvailableBytes != 0)
+      ImGui::Text("Driver: %.0f MB available", stats.deviceAvailableBytes / MB);
+
+   if (ImGui::Button("Reset Peaks"))
+      device->resetMemoryPeaks();
+}
@@ -4,8 +4,11 @@
 #include <glm/glm.hpp>
 #include <string>
 #include <vector>
+#include "gfx/gfxTypes.h"
 
 struct GLFWwindow;
+class GFXDevice;
+struct GFXFrameStats;
 
 class Application
 {
@@ -24,6 +27,22 @@ private:
       bool isQueued = false;
       bool vsyncEnabled = false;
    } state;
+
+   // Kept apart from state, which init() clears.
+   struct
+   {
+      double fixedTimeStep = 0.0;
+      bool inputEnabled = true;
+
+      // Headless runs have no window, GL context or ImGui, only a device that needs none of them.
+      bool headless = false;
+      GFXApi deviceApi = GFXApi::OpenGL;
+      int headlessWidth = 0;
+      int headlessHeight = 0;
+      double headlessTime = 0.0;
+   } playback;
+
+   bool showFrameStatsOverlay = false;
    
 public:
    virtual ~Application() {}
@@ -37,7 +56,8 @@ public:
       ESCAPE
    };
    
-   void init();
+   // A size of 0 uses the default window size.
+   void init(int width = 0, int height = 0);
    
    void destroy();
    
@@ -52,6 +72,22 @@ public:
    void setVerticalSync(bool enabled);
 
    void setWindowTitle(const char* title);
+
+   // Fixed milliseconds per update instead of the measured frame time, 0 turns it off.
+   void setFixedTimeStep(double milliseconds);
+
+   void setInputEnabled(bool enabled);
+
+   // Both must be set before init().
+   void setDeviceApi(GFXApi api);
+   GFXApi getDeviceApi() const { return playback.deviceApi; }
+   void setHeadless(bool headless);
+   bool isHeadless() const { return playback.headless; }
+
+   virtual bool supportsDeviceApi(GFXApi api) const { return api == GFXApi::OpenGL; }
+
+   // nullptr for apps that draw with GL directly
+   virtual GFXDevice* getGraphicsDevice() const { return nullptr; }
    
    bool isKeyPressed(Key key) const;
 
@@ -65,6 +101,13 @@ public:
 
    char* readShaderFile(const char* fileName) const;
 
+   // ImGui sections, call them between ImGui::Begin and ImGui::End.
+   void renderGFXMemoryStats(GFXDevice* device) const;
+   void renderProfilerStats() const;
+   void renderGFXFrameStats(GFXDevice* device);
+   // For apps calling GL directly, which count their own stats.
+   void renderGFXFrameStats(const char* apiString, const GFXFrameStats& stats);
+
 protected:
    virtual void onInit() = 0;
    virtual void onDestroy() = 0;
@@ -6,6 +6,7 @@
 #include "gl/shader.h"
 #include "gfx/gfxCmdBuffer.h"
 #include "gfx/OpenGL/gfxGLDevice.h"
+#include "gfx/Software/gfxSoftwareDevice.h"
 
 IMPLEMENT_APPLICATION(CubeApplication);
 
@@ -24,7 +25,8 @@ void CubeApplication::onInit()
    sunData.sunDir = glm::vec4(0.32f, 0.75f, 0.54f, 0.0f);
    sunData.sunColor = glm::vec4(1.4f, 1.2f, 0.4f, 0.0f);
    sunData.ambientColor = glm::vec4(0.3f, 0.3f, 0.4f, 0.0f);
-   
+
+   useSoftwareDevice = getDeviceApi() == GFXApi::Software;
    initGL();
 }
 
@@ -42,6 +44,11 @@ void CubeApplication::onUpdate(double dt)
    render(dt);
 }
 
+bool CubeApplication::supportsDeviceApi(GFXApi api) const
+{
+   return api == GFXApi::OpenGL || api == GFXApi::Software;
+}
+
 void CubeApplication::onWindowSizeUpdate(int width, int height)
 {
    windowWidth = width;
@@ -73,7 +80,16 @@ void CubeApplication::updatePerspectiveMatrix()
 
 void CubeApplication::initGL()
 {
-   graphicsDevice = new GFXGLDevice();
+   if (useSoftwareDevice)
+   {
+      softwareDevice = new GFXSoftwareDevice(0, !isHeadless());
+      graphicsDevice = softwareDevice;
+   }
+   else
+   {
+      softwareDevice = nullptr;
+      graphicsDevice = new GFXGLDevice();
+   }
    cmdBuffer = new GFXCmdBuffer();
 
    {
@@ -198,10 +214,41 @@ void CubeApplication::initGL()
 
    initUBOs();
 
+   if (softwareDevice)
+      initSoftwareShaders();
+
    cameraUboLocation = 0;
    sunUboLocation = 1;
 }
 
+void CubeApplication::initSoftwareShaders()
+{
+   // Mirrors shaders/cube.vert and shaders/cube.frag
+   GFXSoftwareShaderDesc shaders;
+   shaders.varyingCount = 3;
+
+   shaders.vertexShader = [](const GFXSoftwareVertexInput& in, GFXSoftwareVertexOutput& out)
+   {
+      const CameraUbo& camera = in.uniforms->constantBuffer<CameraUbo>(0);
+
+      out.position = camera.projMatrix * camera.viewMatrix * glm::vec4(glm::vec3(in.attributes[0]), 1.0f);
+      out.varyings[0] = in.attributes[1].x;
+      out.varyings[1] = in.attributes[1].y;
+      out.varyings[2] = in.attributes[1].z;
+   };
+
+   shaders.fragmentShader = [](const GFXSoftwareFragmentInput& in)
+   {
+      const SunUbo& light = in.uniforms->constantBuffer<SunUbo>(1);
+
+      glm::vec3 normal(in.varyings[0], in.varyings[1], in.varyings[2]);
+      float nL = glm::clamp(glm::dot(normal, glm::vec3(light.sunDir)), 0.0f, 1.0f);
+      return light.sunColor * nL + light.ambientColor;
+   };
+
+   softwareDevice->setPipelineShaders(cubePipelineHandle, shaders);
+}
+
 void CubeApplication::initUBOs()
 {
    {
@@ -281,7 +328,7 @@ void CubeApplication::onRenderImGUI(double dt)
 {
    ImGui::NewFrame();
    ImGui::Begin("Debug Information");
-   ImGui::SetWindowSize(ImVec2(400, 120));
+   ImGui::SetWindowSize(ImVec2(400, softwareDevice ? 250 : 180));
    ImGui::Text("Frame Rate: %.1f FPS", ImGui::GetIO().Framerate);
 
    ImGui::Separator();
@@ -290,6 +337,24 @@ void CubeApplication::onRenderImGUI(double dt)
    ImGui::Text("   Vendor: %s", graphicsDevice->getGFXDeviceVendorDesc());
    ImGui::Text("   Version: %s", graphicsDevice->getApiVersionString());
 
+   ImGui::Separator();
+   if (ImGui::Checkbox("Software Rasterizer", &useSoftwareDevice))
+   {
+      destroyGL();
+      initGL();
+   }
+
+   if (softwareDevice)
+   {
+      const GFXSoftwareStats& stats = softwareDevice->getStats();
+      ImGui::Text("   Raster Time: %.2f ms (%u threads)", stats.rasterTimeMs, stats.threadCount);
+      ImGui::Text("   Pixels/sec/core: %.2f M", stats.pixelsPerSecondPerCore / 1000000.0);
+      ImGui::Text("   Primitives/sec/core: %.2f M", stats.primitivesPerSecondPerCore / 1000000.0);
+   }
+
+   ImGui::Separator();
+   renderGFXFrameStats(graphicsDevice);
+
    ImGui::End();
    ImGui::Render();
 }
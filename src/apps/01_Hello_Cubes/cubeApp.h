@@ -4,6 +4,8 @@
 #include "core/camera.h"
 #include "gfx/gfxDevice.h"
 
+class GFXSoftwareDevice;
+
 struct CameraUbo
 {
    glm::mat4 projMatrix;
@@ -29,10 +31,14 @@ public:
    virtual void onUpdate(double dt) override;
    virtual void onRenderImGUI(double dt) override;
 
+   virtual bool supportsDeviceApi(GFXApi api) const override;
+   virtual GFXDevice* getGraphicsDevice() const override { return graphicsDevice; }
+
    void updateCamera(double dt);
    void updatePerspectiveMatrix();
    void initGL();
    void initUBOs();
+   void initSoftwareShaders();
    void destroyGL();
    void render(double dt);
 
@@ -42,7 +48,9 @@ private:
    SunUbo sunData;
 
    GFXDevice* graphicsDevice;
+   GFXSoftwareDevice* softwareDevice;
    GFXCmdBuffer* cmdBuffer;
+   bool useSoftwareDevice = false;
 
    int windowWidth;
    int windowHeight;
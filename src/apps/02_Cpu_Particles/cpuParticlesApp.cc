@@ -1,14 +1,38 @@
+#include <float.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <algorithm>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/random.hpp>
 #include <imgui.h>
 #include "apps/02_Cpu_Particles/cpuParticlesApp.h"
+#include "core/profiler.h"
 #include "gfx/gfxCmdBuffer.h"
 #include "gfx/OpenGL/gfxGLDevice.h"
 
 IMPLEMENT_APPLICATION(CpuParticlesApp);
 
 const float VIEW_DISTANCE = 500.0f;
+const float PARTICLE_RADIUS = 0.015f;
+const int PARTICLE_COUNT_MIN = 1000;
+const int PARTICLE_COUNT_MAX = 10000000;
+
+// 44 bytes each on the GPU path: the particle state and its compacted vertex.
+const int GPU_PARTICLE_COUNT_MAX = 30000000;
+const uint32_t GPU_PARTICLE_SIZE = 32;
+const uint32_t GPU_GROUP_SIZE = 256;
+// Beyond this many groups the dispatch goes 2D, only 65535 per dimension are guaranteed.
+const uint32_t GPU_DISPATCH_WIDTH = 4096;
+const char* GPU_SIMULATION_TIMER = "Simulate Particles";
+
+// EMITTER_GRID by EMITTER_GRID emitters, far enough apart that their bounds never overlap.
+const int EMITTER_GRID = 8;
+const float EMITTER_SPACING = 12.0f;
+const float EMITTER_SPAWN_RATE_MAX = 1000000.0f;
+
+// Multiples of ParticleSystem::CHUNK_SIZE fill whole cache lines in the particle arrays and
+// in the vertex buffer, so no two threads ever write to the same line.
+const uint32_t PARTICLE_GRAIN_SIZE = 16384;
+static_assert(PARTICLE_GRAIN_SIZE % ParticleSystem::CHUNK_SIZE == 0, "Particle jobs must start on a chunk");
 
 void CpuParticlesApp::onInit()
 {
@@ -21,8 +45,22 @@ void CpuParticlesApp::onInit()
 
    vsync = false;
    freeze = false;
+   particleCount = 10000;
+   particleCountSetting = particleCount;
+   simulationThreadCount = jobSystem.getThreadCount();
+   simulation = ParticleSimulation::CPU;
+   emitterSpawnRate = 2000.0f;
+   drawCount = 0;
+   gpuRespawnAll = false;
+   gpuFrame = 0;
+   depthSort = true;
+   sortMs = 0.0f;
+
+   memset(throughputHistory, 0, sizeof(throughputHistory));
+   throughputHistoryOffset = 0;
 
    initParticles();
+   initEmitters();
 
    initGL();
 }
@@ -36,8 +74,12 @@ void CpuParticlesApp::onUpdate(double dt)
 {
    updateCamera(dt);
 
-   simulateParticles(dt);
-   copyParticlesToGLBuffer();
+   if (simulation != ParticleSimulation::GPU_COMPUTE)
+   {
+      simulateParticles(dt);
+      if (depthSort)
+         sortParticles();
+   }
 
    render(dt);
 }
@@ -50,46 +92,190 @@ void CpuParticlesApp::onWindowSizeUpdate(int width, int height)
 
 void CpuParticlesApp::initParticles()
 {
-   for (int i = 0; i < PARTICLE_COUNT; ++i)
+   particles.resize((uint32_t)particleCount);
+}
+
+void CpuParticlesApp::resizeParticles(int count)
+{
+   destroyParticleBuffers();
+   createParticles(count);
+}
+
+void CpuParticlesApp::initEmitters()
+{
+   for (int x = 0; x < EMITTER_GRID; x++)
    {
-      resetParticle(particles[i]);
+      for (int z = 0; z < EMITTER_GRID; z++)
+      {
+         ParticleEmitterDesc desc;
+         desc.position = glm::vec3(x - (EMITTER_GRID - 1) * 0.5f, 0.0f, z - (EMITTER_GRID - 1) * 0.5f) * EMITTER_SPACING;
+         desc.spawnRate = emitterSpawnRate;
+         desc.color[0] = (uint8_t)(255 * x / (EMITTER_GRID - 1));
+         desc.color[1] = (uint8_t)(255 * z / (EMITTER_GRID - 1));
+         desc.color[2] = 255;
+         desc.color[3] = 255;
+         emitters.addEmitter(desc);
+      }
    }
 }
 
-void CpuParticlesApp::resetParticle(Particle& p)
+void CpuParticlesApp::setSimulation(ParticleSimulation mode)
+{
+   destroyParticleBuffers();
+   simulation = mode;
+   createParticles(simulation == ParticleSimulation::GPU_COMPUTE ? particleCount : std::min(particleCount, PARTICLE_COUNT_MAX));
+}
+
+void CpuParticlesApp::createParticles(int count)
 {
-   p.pos = glm::vec3(0);
-   p.velocity = glm::ballRand(3.0);
-   p.lifeTime = 0.0;
-   p.color = glm::vec4(0.0f, 1.0f, 1.0f, 1.0f);
-   p.lifeTimeMax = (PARTICLE_TIME_MAX_MS - 1000) - ((rand() % 10 + 1) * 100);
+   particleCount = count;
+   particleCountSetting = count;
+
+   // Only the path in use keeps its particles, millions of them take hundreds of MB.
+   particles.resize(simulation == ParticleSimulation::CPU ? (uint32_t)particleCount : 0);
+   emitters.setCapacity(simulation == ParticleSimulation::CPU_EMITTERS ? (uint32_t)particleCount : 0);
+   initParticleBuffer();
+}
+
+void CpuParticlesApp::getParticleBounds(glm::vec3& outCenter, glm::vec3& outExtents) const
+{
+   if (simulation == ParticleSimulation::CPU_EMITTERS)
+      emitters.getBounds(outCenter, outExtents);
+   else
+      particles.getBounds(outCenter, outExtents);
 }
 
 void CpuParticlesApp::simulateParticles(double dt)
 {
-   if (freeze)
-      return;
+   PROFILE_SCOPE("CpuParticlesApp::simulateParticles");
 
-   float deltaSeconds = (float)(dt / 1000.0f);
+   // A frozen simulation still has to fill the buffer after a resize.
+   const float dtMs = freeze ? 0.0f : (float)dt;
+   uint64_t elapsedNs = 0;
 
-   for (int i = 0; i < PARTICLE_COUNT; ++i)
+   if (simulation == ParticleSimulation::CPU_EMITTERS)
    {
-      Particle& p = particles[i];
-      p.pos += p.velocity * deltaSeconds;
-      p.lifeTime += (float)dt;
-
-      if (p.lifeTime >  p.lifeTimeMax)
-         resetParticle(p);
+      // Vertices are written once every emitter is done, only then is the count known.
+      const uint64_t startNs = Profiler::now();
+      emitters.simulate(jobSystem, dtMs, Frustum(cameraData.projMatrix * cameraData.viewMatrix));
+      drawCount = emitters.getDrawCount();
+
+      if (drawCount > 0)
+      {
+         ParticleVertex* vertices = (ParticleVertex*)graphicsDevice->mapBuffer(particleBufferHandle, 0, drawCount * sizeof(ParticleVertex));
+         jobSystem.parallelFor(drawCount, PARTICLE_GRAIN_SIZE, [&](uint32_t start, uint32_t end, uint32_t threadIndex)
+         {
+            emitters.writeVertices(start, end, vertices);
+         });
+         graphicsDevice->unmapBuffer(particleBufferHandle);
+      }
+      elapsedNs = Profiler::now() - startNs;
    }
+   else
+   {
+      drawCount = particles.getCount();
+
+      ParticleVertex* vertices = (ParticleVertex*)graphicsDevice->mapBuffer(particleBufferHandle, 0, drawCount * sizeof(ParticleVertex));
+
+      // Each job writes its particles into the mapped buffer while they are still in cache, the
+      // join at the end of parallelFor is the only synchronization needed before the upload.
+      const uint64_t startNs = Profiler::now();
+      jobSystem.parallelFor(drawCount, PARTICLE_GRAIN_SIZE, [&](uint32_t start, uint32_t end, uint32_t threadIndex)
+      {
+         particles.simulateRange(start, end, dtMs);
+         particles.writeVertices(start, end, vertices);
+      });
+      particles.nextFrame();
+      elapsedNs = Profiler::now() - startNs;
+
+      graphicsDevice->unmapBuffer(particleBufferHandle);
+   }
+
+   // Particles per nanosecond are million particles per millisecond.
+   throughputHistory[throughputHistoryOffset] = elapsedNs > 0 ? (float)drawCount / (float)elapsedNs : 0.0f;
+   throughputHistoryOffset = (throughputHistoryOffset + 1) % THROUGHPUT_HISTORY_SIZE;
 }
 
-void CpuParticlesApp::copyParticlesToGLBuffer()
+void CpuParticlesApp::sortParticles()
 {
-   for (int i = 0; i < PARTICLE_COUNT; ++i)
+   PROFILE_SCOPE("CpuParticlesApp::sortParticles");
+
+   const uint32_t count = drawCount;
+   if (count == 0)
+      return;
+
+   const glm::vec3 viewPos = camera.getPosition();
+   const glm::mat4& view = cameraData.viewMatrix;
+   const glm::vec3 viewDir = -glm::vec3(view[0][2], view[1][2], view[2][2]);
+
+   // Keys only have to tell apart depths within the bounds.
+   glm::vec3 boundsCenter, boundsExtents;
+   getParticleBounds(boundsCenter, boundsExtents);
+   const float centerDepth = glm::dot(boundsCenter - viewPos, viewDir);
+   const float radius = glm::length(boundsExtents);
+
+   const uint64_t startNs = Profiler::now();
+
+   sortKeys.resize(count);
+   uint32_t* keys = sortKeys.data();
+   jobSystem.parallelFor(count, PARTICLE_GRAIN_SIZE, [&](uint32_t start, uint32_t end, uint32_t threadIndex)
    {
-      glParticles[i].pos = particles[i].pos;
-      glParticles[i].color = particles[i].color;
-   }
+      if (simulation == ParticleSimulation::CPU_EMITTERS)
+         emitters.writeSortKeys(start, end, viewPos, viewDir, centerDepth - radius, centerDepth + radius, keys);
+      else
+         particles.writeSortKeys(start, end, viewPos, viewDir, centerDepth - radius, centerDepth + radius, keys);
+   });
+
+   uint32_t* indices = (uint32_t*)graphicsDevice->mapBuffer(sortedIndexBufferHandle, 0, count * sizeof(uint32_t));
+   sorter.sort(jobSystem, keys, count, indices);
+   graphicsDevice->unmapBuffer(sortedIndexBufferHandle);
+
+   sortMs = (float)((Profiler::now() - startNs) / 1000000.0);
+}
+
+void CpuParticlesApp::simulateParticlesGpu(double dt)
+{
+   PROFILE_SCOPE("CpuParticlesApp::simulateParticlesGpu");
+
+   GpuSimulationUbo simulation;
+   simulation.dtMs = freeze ? 0.0f : (float)dt;
+   simulation.frame = gpuFrame++;
+   simulation.count = (uint32_t)particleCount;
+   simulation.respawnAll = gpuRespawnAll ? 1 : 0;
+   gpuRespawnAll = false;
+
+   glm::vec3 boundsCenter, boundsExtents;
+   particles.getBounds(boundsCenter, boundsExtents);
+   simulation.boundsCenter = glm::vec4(boundsCenter, 0.0f);
+   simulation.boundsExtents = glm::vec4(boundsExtents, 0.0f);
+
+   void* pData = graphicsDevice->mapBuffer(gpuSimulationBufferHandle, 0, sizeof(GpuSimulationUbo));
+   memcpy(pData, &simulation, sizeof(GpuSimulationUbo));
+   graphicsDevice->unmapBuffer(gpuSimulationBufferHandle);
+
+   const uint32_t groupCount = (simulation.count + GPU_GROUP_SIZE - 1) / GPU_GROUP_SIZE;
+   const uint32_t groupCountX = std::min(groupCount, GPU_DISPATCH_WIDTH);
+   const uint32_t groupCountY = (groupCount + GPU_DISPATCH_WIDTH - 1) / GPU_DISPATCH_WIDTH;
+
+   cmdBuffer->beginTimer(GPU_SIMULATION_TIMER);
+   cmdBuffer->bindConstantBuffer(1, gpuSimulationBufferHandle, 0, sizeof(GpuSimulationUbo));
+   cmdBuffer->bindStorageBuffer(0, gpuParticleBufferHandle, 0, simulation.count * GPU_PARTICLE_SIZE);
+   cmdBuffer->bindStorageBuffer(1, particleBufferHandle, 0, simulation.count * sizeof(ParticleVertex));
+   cmdBuffer->bindStorageBuffer(2, drawArgumentsBufferHandle, 0, sizeof(GFXDrawPrimitivesIndirectArgs));
+
+   cmdBuffer->bindPipeline(clearArgumentsPipelineHandle);
+   cmdBuffer->dispatch(1, 1, 1);
+   cmdBuffer->memoryBarrier(SHADER_STORAGE_BARRIER_BIT);
+
+   cmdBuffer->bindPipeline(simulatePipelineHandle);
+   cmdBuffer->dispatch(groupCountX, groupCountY, 1);
+   cmdBuffer->memoryBarrier(VERTEX_BUFFER_BARRIER_BIT | INDIRECT_BUFFER_BARRIER_BIT);
+   cmdBuffer->endTimer();
+
+   // GPU timers resolve a few frames late, close enough for a throughput graph.
+   const double simulationMs = graphicsDevice->getGpuTimerMs(GPU_SIMULATION_TIMER);
+   throughputHistory[throughputHistoryOffset] = simulationMs > 0.0 ? (float)(simulation.count / (simulationMs * 1000000.0)) : 0.0f;
+   throughputHistoryOffset = (throughputHistoryOffset + 1) % THROUGHPUT_HISTORY_SIZE;
 }
 
 void CpuParticlesApp::updateCamera(double dt)
@@ -164,24 +350,91 @@ void CpuParticlesApp::initGL()
    {
       GFXDepthStencilStateDesc depthState;
       depthState.enableDepthTest = true;
-      depthState.enableDepthWrite = true;
+      depthState.enableDepthWrite = false;
       depthState.depthCompareFunc = GFXCompareFunc::LESS;
 
       depthStateHandle = graphicsDevice->createDepthStencilState(depthState);
    }
 
    {
-      GFXBufferDesc cubeBuffer;
-      cubeBuffer.type = GFXBufferType::VERTEX_BUFFER;
-      cubeBuffer.usage = GFXBufferUsageEnum::DYNAMIC_CPU_TO_GPU;
-      cubeBuffer.sizeInBytes = sizeof(glParticles);
-      cubeBuffer.data = nullptr;
-
-      particleBufferHandle = graphicsDevice->createBuffer(cubeBuffer);
+      GFXBlendStateDesc blendState;
+      blendState.enableBlending = true;
+      blendState.srcColorFactor = GFXBlendFactor::SRC_ALPHA;
+      blendState.dstColorFactor = GFXBlendFactor::ONE_MINUS_SRC_ALPHA;
+      blendState.srcAlphaFactor = GFXBlendFactor::ONE;
+      blendState.dstAlphaFactor = GFXBlendFactor::ONE_MINUS_SRC_ALPHA;
+
+      blendStateHandle = graphicsDevice->createBlendState(blendState);
    }
 
+   initParticleBuffer();
    initShader();
    initUBOs();
+
+   if (supportsComputeShaders())
+      initComputeShaders();
+}
+
+void CpuParticlesApp::initParticleBuffer()
+{
+   // The GPU path writes the vertices from a compute shader.
+   const bool gpuSimulation = simulation == ParticleSimulation::GPU_COMPUTE;
+   // The pool rounds its capacity up to whole blocks.
+   const size_t vertexCount = simulation == ParticleSimulation::CPU_EMITTERS ? emitters.getCapacity() : (size_t)particleCount;
+
+   GFXBufferDesc particleBuffer;
+   particleBuffer.type = gpuSimulation ? GFXBufferType::STORAGE_BUFFER : GFXBufferType::VERTEX_BUFFER;
+   particleBuffer.usage = gpuSimulation ? GFXBufferUsageEnum::STATIC_GPU_ONLY : GFXBufferUsageEnum::DYNAMIC_CPU_TO_GPU;
+   particleBuffer.sizeInBytes = vertexCount * sizeof(ParticleVertex);
+   particleBuffer.data = nullptr;
+
+   particleBufferHandle = graphicsDevice->createBuffer(particleBuffer);
+
+   if (!gpuSimulation)
+   {
+      GFXBufferDesc indexBuffer;
+      indexBuffer.type = GFXBufferType::INDEX_BUFFER;
+      indexBuffer.usage = GFXBufferUsageEnum::DYNAMIC_CPU_TO_GPU;
+      indexBuffer.sizeInBytes = vertexCount * sizeof(uint32_t);
+      indexBuffer.data = nullptr;
+
+      sortedIndexBufferHandle = graphicsDevice->createBuffer(indexBuffer);
+      return;
+   }
+
+   GFXBufferDesc stateBuffer;
+   stateBuffer.type = GFXBufferType::STORAGE_BUFFER;
+   stateBuffer.usage = GFXBufferUsageEnum::STATIC_GPU_ONLY;
+   stateBuffer.sizeInBytes = (size_t)particleCount * GPU_PARTICLE_SIZE;
+   stateBuffer.data = nullptr;
+
+   gpuParticleBufferHandle = graphicsDevice->createBuffer(stateBuffer);
+
+   GFXBufferDesc argumentsBuffer;
+   argumentsBuffer.type = GFXBufferType::INDIRECT_BUFFER;
+   argumentsBuffer.usage = GFXBufferUsageEnum::STATIC_GPU_ONLY;
+   argumentsBuffer.sizeInBytes = sizeof(GFXDrawPrimitivesIndirectArgs);
+   argumentsBuffer.data = nullptr;
+
+   drawArgumentsBufferHandle = graphicsDevice->createBuffer(argumentsBuffer);
+
+   // Nothing is uploaded, the first dispatch spawns every particle.
+   gpuRespawnAll = true;
+}
+
+void CpuParticlesApp::destroyParticleBuffers()
+{
+   graphicsDevice->deleteBuffer(particleBufferHandle);
+
+   if (simulation == ParticleSimulation::GPU_COMPUTE)
+   {
+      graphicsDevice->deleteBuffer(gpuParticleBufferHandle);
+      graphicsDevice->deleteBuffer(drawArgumentsBufferHandle);
+   }
+   else
+   {
+      graphicsDevice->deleteBuffer(sortedIndexBufferHandle);
+   }
 }
 
 void CpuParticlesApp::initUBOs()
@@ -193,27 +446,42 @@ void CpuParticlesApp::initUBOs()
    cameraBufferDesc.data = nullptr;
 
    cameraBufferHandle = graphicsDevice->createBuffer(cameraBufferDesc);
+
+   GFXBufferDesc simulationBufferDesc;
+   simulationBufferDesc.type = GFXBufferType::CONSTANT_BUFFER;
+   simulationBufferDesc.usage = GFXBufferUsageEnum::DYNAMIC_CPU_TO_GPU;
+   simulationBufferDesc.sizeInBytes = sizeof(GpuSimulationUbo);
+   simulationBufferDesc.data = nullptr;
+
+   gpuSimulationBufferHandle = graphicsDevice->createBuffer(simulationBufferDesc);
 }
 
 void CpuParticlesApp::initShader()
 {
-   GFXInputLayoutElementDesc inputLayoutDescs[2];
+   GFXInputLayoutElementDesc inputLayoutDescs[3];
    inputLayoutDescs[0].slot = 0;
    inputLayoutDescs[0].count = 3;
-   inputLayoutDescs[0].type = GFXInputLayoutFormat::FLOAT;
+   inputLayoutDescs[0].type = GFXInputLayoutFormat::SHORT_NORM;
    inputLayoutDescs[0].divisor = GFXInputLayoutDivisor::PER_VERTEX;
-   inputLayoutDescs[0].offset = 0;
+   inputLayoutDescs[0].offset = offsetof(ParticleVertex, pos);
    inputLayoutDescs[0].bufferBinding = 0;
 
    inputLayoutDescs[1].slot = 1;
    inputLayoutDescs[1].count = 4;
-   inputLayoutDescs[1].type = GFXInputLayoutFormat::FLOAT;
+   inputLayoutDescs[1].type = GFXInputLayoutFormat::UNSIGNED_BYTE_NORM;
    inputLayoutDescs[1].divisor = GFXInputLayoutDivisor::PER_VERTEX;
-   inputLayoutDescs[1].offset = 12;
+   inputLayoutDescs[1].offset = offsetof(ParticleVertex, color);
    inputLayoutDescs[1].bufferBinding = 0;
 
+   inputLayoutDescs[2].slot = 2;
+   inputLayoutDescs[2].count = 1;
+   inputLayoutDescs[2].type = GFXInputLayoutFormat::UNSIGNED_BYTE_NORM;
+   inputLayoutDescs[2].divisor = GFXInputLayoutDivisor::PER_VERTEX;
+   inputLayoutDescs[2].offset = offsetof(ParticleVertex, lifetime);
+   inputLayoutDescs[2].bufferBinding = 0;
+
    GFXInputLayoutDesc inputLayout;
-   inputLayout.count = 2;
+   inputLayout.count = 3;
    inputLayout.descs = inputLayoutDescs;
 
    char* vertShader = readShaderFile("apps/02_Cpu_Particles/shaders/particles.vert");
@@ -237,15 +505,44 @@ void CpuParticlesApp::initShader()
    pipelineHandle = graphicsDevice->createPipeline(pipelineDesc);
 }
 
+void CpuParticlesApp::initComputeShaders()
+{
+   char* clearShader = readShaderFile("apps/02_Cpu_Particles/shaders/particles_clear.comp");
+   char* simulateShader = readShaderFile("apps/02_Cpu_Particles/shaders/particles_simulate.comp");
+
+   GFXShaderDesc shader;
+   shader.type = GFXShaderType::COMPUTE;
+
+   GFXPipelineDesc pipelineDesc = {};
+   pipelineDesc.shadersStages = &shader;
+   pipelineDesc.shaderStageCount = 1;
+
+   shader.code = clearShader;
+   shader.codeLength = strlen(clearShader);
+   clearArgumentsPipelineHandle = graphicsDevice->createPipeline(pipelineDesc);
+
+   shader.code = simulateShader;
+   shader.codeLength = strlen(simulateShader);
+   simulatePipelineHandle = graphicsDevice->createPipeline(pipelineDesc);
+}
+
 void CpuParticlesApp::destroyGL()
 {
    graphicsDevice->deleteStateBlock(depthStateHandle);
    graphicsDevice->deleteStateBlock(rasterizerStateHandle);
+   graphicsDevice->deleteStateBlock(blendStateHandle);
 
-   graphicsDevice->deleteBuffer(particleBufferHandle);
+   destroyParticleBuffers();
    graphicsDevice->deleteBuffer(cameraBufferHandle);
+   graphicsDevice->deleteBuffer(gpuSimulationBufferHandle);
    graphicsDevice->deletePipeline(pipelineHandle);
 
+   if (supportsComputeShaders())
+   {
+      graphicsDevice->deletePipeline(clearArgumentsPipelineHandle);
+      graphicsDevice->deletePipeline(simulatePipelineHandle);
+   }
+
    graphicsDevice->deleteTexture(colorRenderPassAttachmentHandle);
    graphicsDevice->deleteTexture(depthRenderPassAttachmentHandle);
    graphicsDevice->deleteRenderPass(renderPassHandle);
@@ -260,24 +557,43 @@ void CpuParticlesApp::render(double dt)
    memcpy(pData, &cameraData, sizeof(CameraUbo));
    graphicsDevice->unmapBuffer(cameraBufferHandle);
 
-   pData = (char*)graphicsDevice->mapBuffer(particleBufferHandle, 0, sizeof(glParticles));
-   memcpy(pData, &glParticles[0], sizeof(glParticles));
-   graphicsDevice->unmapBuffer(particleBufferHandle);
-
    cmdBuffer->begin();
 
+   if (simulation == ParticleSimulation::GPU_COMPUTE)
+      simulateParticlesGpu(dt);
+
    cmdBuffer->bindRenderPass(renderPassHandle);
    cmdBuffer->setViewport(0, 0, windowWidth, windowHeight);
    cmdBuffer->setScissor(0, 0, windowWidth, windowHeight);
 
    cmdBuffer->setRasterizerState(rasterizerStateHandle);
    cmdBuffer->setDepthStencilState(depthStateHandle);
+   cmdBuffer->setBlendState(blendStateHandle);
+
+   glm::vec3 boundsCenter, boundsExtents;
+   getParticleBounds(boundsCenter, boundsExtents);
+   // Point sprites are sized like a sphere of PARTICLE_RADIUS, this over the clip w is the diameter in pixels.
+   const float pointScale = PARTICLE_RADIUS * windowHeight * cameraData.projMatrix[1][1];
+   const glm::vec4 pushConstants[3] = { glm::vec4(boundsCenter, 0.0f), glm::vec4(boundsExtents, 0.0f), glm::vec4(pointScale, 0.0f, 0.0f, 0.0f) };
 
    cmdBuffer->bindPipeline(pipelineHandle);
+   cmdBuffer->bindPushConstants(0, sizeof(pushConstants), GFXShaderStageBit::VERTEX_BIT, pushConstants);
    cmdBuffer->bindConstantBuffer(0, cameraBufferHandle, 0, sizeof(CameraUbo));
-   cmdBuffer->bindVertexBuffer(0, particleBufferHandle, sizeof(GLParticle), 0);
+   cmdBuffer->bindVertexBuffer(0, particleBufferHandle, sizeof(ParticleVertex), 0);
 
-   cmdBuffer->drawPrimitives(0, PARTICLE_COUNT);
+   if (simulation == ParticleSimulation::GPU_COMPUTE)
+   {
+      cmdBuffer->drawPrimitivesIndirect(drawArgumentsBufferHandle, 0);
+   }
+   else if (depthSort)
+   {
+      cmdBuffer->bindIndexBuffer(sortedIndexBufferHandle, GFXIndexBufferType::BITS_32, 0);
+      cmdBuffer->drawIndexedPrimitives(drawCount, 0);
+   }
+   else
+   {
+      cmdBuffer->drawPrimitives(0, drawCount);
+   }
 
    cmdBuffer->end();
 
@@ -294,7 +610,7 @@ void CpuParticlesApp::onRenderImGUI(double dt)
    ImGui::NewFrame();
    
    ImGui::Begin("Debug Information & Options");
-   ImGui::SetWindowSize(ImVec2(700, 180));
+   ImGui::SetWindowSize(ImVec2(700, 320));
    ImGui::Text("Frame Rate: %.1f FPS", ImGui::GetIO().Framerate);
 
    ImGui::Separator();
@@ -312,6 +628,73 @@ void CpuParticlesApp::onRenderImGUI(double dt)
 
    ImGui::Checkbox("Freeze Simulation", &freeze);
 
+   // GPU Compute is last, so it can be left out.
+   int mode = (int)simulation;
+   const char* simulationNames[] = { "CPU", "CPU Emitters", "GPU Compute" };
+   const int simulationNameCount = supportsComputeShaders() ? IM_ARRAYSIZE(simulationNames) : IM_ARRAYSIZE(simulationNames) - 1;
+   if (ImGui::Combo("Simulation", &mode, simulationNames, simulationNameCount))
+      setSimulation((ParticleSimulation)mode);
+
+   // Only resized once the slider is let go, every step would reallocate the vertex buffer.
+   const bool gpuSimulation = simulation == ParticleSimulation::GPU_COMPUTE;
+   const int particleCountMax = gpuSimulation ? GPU_PARTICLE_COUNT_MAX : PARTICLE_COUNT_MAX;
+   const char* particleCountLabel = simulation == ParticleSimulation::CPU_EMITTERS ? "Particle Capacity" : "Particle Count";
+   ImGui::SliderInt(particleCountLabel, &particleCountSetting, PARTICLE_COUNT_MIN, particleCountMax, "%d", ImGuiSliderFlags_Logarithmic);
+   if (ImGui::IsItemDeactivatedAfterEdit() && particleCountSetting != particleCount)
+      resizeParticles(particleCountSetting);
+
+   if (simulation == ParticleSimulation::CPU_EMITTERS)
+   {
+      if (ImGui::SliderFloat("Spawn Rate", &emitterSpawnRate, 0.0f, EMITTER_SPAWN_RATE_MAX, "%.0f / s", ImGuiSliderFlags_Logarithmic))
+      {
+         for (uint32_t i = 0; i < emitters.getEmitterCount(); i++)
+            emitters.setSpawnRate(i, emitterSpawnRate);
+      }
+
+      ImGui::Text("Emitters Simulated: %u / %u", emitters.getSimulatedEmitterCount(), emitters.getEmitterCount());
+      ImGui::Text("Live Particles: %u / %u (%u drawn)", emitters.getAliveCount(), emitters.getCapacity(), drawCount);
+   }
+   else if (simulation == ParticleSimulation::CPU)
+   {
+      int kernel = (int)particles.getKernel();
+      const char* kernelNames[] =
+      {
+         ParticleSystem::getKernelString(ParticleKernel::SCALAR),
+         ParticleSystem::getKernelString(ParticleKernel::SSE2),
+         ParticleSystem::getKernelString(ParticleKernel::AVX2)
+      };
+      if (ImGui::Combo("Simulation Kernel", &kernel, kernelNames, IM_ARRAYSIZE(kernelNames)))
+         particles.setKernel((ParticleKernel)kernel);
+   }
+
+   if (!gpuSimulation)
+   {
+      if (ImGui::SliderInt("Simulation Threads", &simulationThreadCount, 1, (int)JobSystem::getHardwareThreadCount()))
+         jobSystem.setThreadCount((uint32_t)simulationThreadCount);
+
+      ImGui::Checkbox("Sort Back to Front", &depthSort);
+      if (depthSort)
+      {
+         ImGui::SameLine();
+         ImGui::Text("%.2f ms", sortMs);
+      }
+   }
+
+   const int latest = (throughputHistoryOffset + THROUGHPUT_HISTORY_SIZE - 1) % THROUGHPUT_HISTORY_SIZE;
+   char throughputText[64];
+   if (gpuSimulation)
+      snprintf(throughputText, sizeof(throughputText), "%.2f M particles/ms", throughputHistory[latest]);
+   else
+      snprintf(throughputText, sizeof(throughputText), "%.2f M particles/ms (%.2f per thread)",
+         throughputHistory[latest], throughputHistory[latest] / jobSystem.getThreadCount());
+   ImGui::PlotLines("Throughput", throughputHistory, THROUGHPUT_HISTORY_SIZE, throughputHistoryOffset, throughputText,
+      0.0f, FLT_MAX, ImVec2(0, 60));
+
+   ImGui::Separator();
+   renderGFXFrameStats(graphicsDevice);
+   renderProfilerStats();
+   renderGFXMemoryStats(graphicsDevice);
+
    ImGui::End();
 
    ImGui::Render();
@@ -1,31 +1,37 @@
 #include "app.h"
 #include "core/camera.h"
+#include "core/jobSystem.h"
+#include "core/particlePool.h"
+#include "core/particleSystem.h"
+#include "core/radixSort.h"
 #include "gfx/gfxDevice.h"
 
+#define THROUGHPUT_HISTORY_SIZE 120
+
 struct CameraUbo
 {
    glm::mat4 projMatrix;
    glm::mat4 viewMatrix;
 };
 
-struct Particle
+// SimulationBuffer in particles_simulate.comp.
+struct GpuSimulationUbo
 {
-   glm::vec3 pos;
-   glm::vec3 velocity;
-   glm::vec4 color;
-   float lifeTime;
-   float lifeTimeMax;
+   float dtMs;
+   uint32_t frame;
+   uint32_t count;
+   uint32_t respawnAll;
+   glm::vec4 boundsCenter;
+   glm::vec4 boundsExtents;
 };
 
-struct GLParticle
+enum class ParticleSimulation
 {
-   glm::vec3 pos;
-   glm::vec4 color;
+   CPU,
+   CPU_EMITTERS,
+   GPU_COMPUTE
 };
 
-#define PARTICLE_COUNT (int)10000
-#define PARTICLE_TIME_MAX_MS (float)3000
-
 class CpuParticlesApp : public Application
 {
 public:
@@ -37,27 +43,63 @@ public:
    virtual void onDestroy() override;
    virtual void onUpdate(double dt) override;
    virtual void onRenderImGUI(double dt) override;
+   virtual GFXDevice* getGraphicsDevice() const override { return graphicsDevice; }
 
    void initParticles();
+   void resizeParticles(int count);
+   void initEmitters();
+   void setSimulation(ParticleSimulation mode);
+   void createParticles(int count);
+   void getParticleBounds(glm::vec3& outCenter, glm::vec3& outExtents) const;
 
    void updateCamera(double dt);
    void updatePerspectiveMatrix();
    void initGL();
+   void initParticleBuffer();
+   void destroyParticleBuffers();
    void initUBOs();
    void initShader();
+   void initComputeShaders();
    void destroyGL();
    void render(double dt);
 
-   void resetParticle(Particle& p);
    void simulateParticles(double dt);
-   void copyParticlesToGLBuffer();
+   void sortParticles();
+   void simulateParticlesGpu(double dt);
 
 private:
    Camera camera;
    CameraUbo cameraData;
 
-   GLParticle glParticles[PARTICLE_COUNT];
-   Particle particles[PARTICLE_COUNT];
+   ParticleSimulation simulation;
+
+   ParticleSystem particles;
+   int particleCount;
+   int particleCountSetting;
+
+   // A grid of emitters sharing particleCount of capacity, those out of view aren't simulated.
+   ParticlePool emitters;
+   float emitterSpawnRate;
+
+   // Particles in the vertex buffer this frame on the CPU paths.
+   uint32_t drawCount;
+
+   JobSystem jobSystem;
+   int simulationThreadCount;
+
+   // Back to front order of the particles, written to sortedIndexBufferHandle.
+   RadixSort sorter;
+   std::vector<uint32_t> sortKeys;
+   bool depthSort;
+   float sortMs;
+
+   // GPU_COMPUTE particles are simulated by compute shaders and drawn indirectly, the CPU never sees them.
+   bool gpuRespawnAll;
+   uint32_t gpuFrame;
+
+   // Million particles simulated and written per millisecond, one entry per frame.
+   float throughputHistory[THROUGHPUT_HISTORY_SIZE];
+   int throughputHistoryOffset;
 
    int windowWidth;
    int windowHeight;
@@ -67,15 +109,22 @@ private:
 
    StateBlockHandle depthStateHandle;
    StateBlockHandle rasterizerStateHandle;
+   StateBlockHandle blendStateHandle;
 
    RenderPassHandle renderPassHandle;
    TextureHandle colorRenderPassAttachmentHandle;
    TextureHandle depthRenderPassAttachmentHandle;
 
    PipelineHandle pipelineHandle;
+   PipelineHandle clearArgumentsPipelineHandle;
+   PipelineHandle simulatePipelineHandle;
 
    BufferHandle cameraBufferHandle;
    BufferHandle particleBufferHandle;
+   BufferHandle sortedIndexBufferHandle;
+   BufferHandle gpuSimulationBufferHandle;
+   BufferHandle gpuParticleBufferHandle;
+   BufferHandle drawArgumentsBufferHandle;
 
    bool vsync;
    bool freeze;
@@ -2,5 +2,11 @@ in vec4 fCOLOR;
 layout(location = 0) out vec4 color;
 
 void main() {
-   color = fCOLOR;
+   // Round sprite that fades out towards its edge.
+   vec2 offset = gl_PointCoord * 2.0 - 1.0;
+   float falloff = 1.0 - dot(offset, offset);
+   if (falloff <= 0.0)
+      discard;
+
+   color = vec4(fCOLOR.rgb, fCOLOR.a * falloff);
 }
\ No newline at end of file
@@ -1,15 +1,21 @@
 layout(location = 0) in vec3 pos;
 layout(location = 1) in vec4 color;
+layout(location = 2) in float lifetime;
 
 out vec4 fCOLOR;
 
+// Center and extents of the box quantized positions are relative to, then the point size scale.
+layout(location = 0) uniform vec4 pushConstants[3];
+
 layout(std140) uniform CameraBuffer {
    mat4 proj;
    mat4 view;
 } camera;
 
 void main() {
-   fCOLOR = color;
-   gl_PointSize = 2.0;
-   gl_Position = camera.proj * camera.view * mat4(1.0) * vec4(pos, 1.0);
+   vec3 worldPos = pushConstants[0].xyz + pos * pushConstants[1].xyz;
+
+   fCOLOR = vec4(color.rgb, color.a * lifetime);
+   gl_Position = camera.proj * camera.view * mat4(1.0) * vec4(worldPos, 1.0);
+   gl_PointSize = clamp(pushConstants[2].x / gl_Position.w, 1.0, 64.0);
 }
\ No newline at end of file
@@ -1,9 +1,11 @@
 #include <stdio.h>
+#include <string.h>
 #include <glad/glad.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include <imgui.h>
 #include "apps/03_Draw_Performance/03DrawPerformance.h"
 #include "core/cube.h"
+#include "core/profiler.h"
 #include "gl/shader.h"
 
 IMPLEMENT_APPLICATION(DrawPerformanceApplication);
@@ -24,6 +26,11 @@ void DrawPerformanceApplication::onInit()
    sunData.ambientColor = glm::vec4(0.3f, 0.3f, 0.4f, 0.0f);
 
    gridSize = 100;
+   cubeData = nullptr;
+   frustumCulling = true;
+   visibleCubeCount = 0;
+   cullMs = 0.0f;
+   memset(&frameStats, 0, sizeof(frameStats));
 
    createCubeData();
 
@@ -152,20 +159,40 @@ void DrawPerformanceApplication::render(double dt)
    glBindBufferBase(GL_UNIFORM_BUFFER, cameraUboLocation, cameraUbo);
    glBindBufferBase(GL_UNIFORM_BUFFER, sunUboLocation, sunUbo);
 
-   for (int i = 0; i < gridSize * gridSize; ++i)
+   if (frustumCulling)
    {
-      glUniformMatrix4fv(uniformModelMatLocation, 1, GL_FALSE, (const GLfloat*)&cubeData[i]);
+      const uint64_t startNs = Profiler::now();
+      visibleCubeCount = cubeCuller.cull(jobSystem, camera.getFrustum(), visibleCubes.data());
+      cullMs = (float)((Profiler::now() - startNs) / 1000000.0);
+   }
+   else
+   {
+      visibleCubeCount = (uint32_t)cubeCount;
+   }
+
+   for (uint32_t i = 0; i < visibleCubeCount; ++i)
+   {
+      const uint32_t cube = frustumCulling ? visibleCubes[i] : i;
+      glUniformMatrix4fv(uniformModelMatLocation, 1, GL_FALSE, (const GLfloat*)&cubeData[cube]);
       glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_SHORT, NULL);
    }
+
+   memset(&frameStats, 0, sizeof(frameStats));
+   frameStats.drawCalls = visibleCubeCount;
+   frameStats.instances = visibleCubeCount;
+   frameStats.primitives = (uint64_t)visibleCubeCount * 12;
+   frameStats.pipelineBinds = 1;
+   frameStats.bufferBinds = 5;
+   frameStats.bytesUploaded = sizeof(CameraUbo) + (uint64_t)visibleCubeCount * sizeof(CubeData);
 }
 
 void DrawPerformanceApplication::onRenderImGUI(double dt)
 {
    ImGui::NewFrame();
    ImGui::Begin("Debug Information & Options");
-   ImGui::SetWindowSize(ImVec2(700, 180));
+   ImGui::SetWindowSize(ImVec2(700, 220));
    ImGui::Text("Frame Rate: %.1f FPS", ImGui::GetIO().Framerate);
-   ImGui::Text("# of Cubes Rendering (# Drawcalls): %d", gridSize * gridSize);
+   ImGui::Text("# of Cubes Rendering (# Drawcalls): %u / %d", visibleCubeCount, cubeCount);
    ImGui::Separator();
 
    ImGui::Text("OpenGL Driver Information:");
@@ -180,6 +207,12 @@ void DrawPerformanceApplication::onRenderImGUI(double dt)
       createCubeData();
    }
 
+   ImGui::Checkbox("Frustum Culling", &frustumCulling);
+   if (frustumCulling)
+      ImGui::Text("Culling: %.3f ms (%s, %u threads)", cullMs, InstanceCuller::getKernelString(), jobSystem.getThreadCount());
+
+   renderGFXFrameStats("OpenGL", frameStats);
+
    ImGui::End();
    ImGui::Render();
 }
@@ -190,6 +223,8 @@ void DrawPerformanceApplication::createCubeData()
       delete[] cubeData;
 
    cubeData = new CubeData[gridSize * gridSize];
+   std::vector<glm::vec3> centers(gridSize * gridSize);
+   std::vector<glm::vec3> extents(gridSize * gridSize);
 
    int idx = 0;
    for (int x = -gridSize / 2; x < gridSize/2; x++)
@@ -198,7 +233,16 @@ void DrawPerformanceApplication::createCubeData()
       {
          glm::mat4 mat = glm::translate(glm::mat4(1.0), glm::vec3(x, 0, z));
          mat = glm::scale(mat, glm::vec3(0.8, 0.8, 0.8));
+
+         // The cube mesh spans [0, 1] on every axis.
+         centers[idx] = glm::vec3(mat * glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
+         extents[idx] = glm::vec3(0.4f);
          cubeData[idx++].matrix = mat;
       }
    }
+
+   // Odd grid sizes leave out a row and a column.
+   cubeCount = idx;
+   visibleCubes.resize(cubeCount);
+   cubeCuller.build(jobSystem, centers.data(), extents.data(), (uint32_t)cubeCount);
 }
\ No newline at end of file
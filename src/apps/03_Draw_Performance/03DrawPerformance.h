@@ -1,5 +1,9 @@
+#include <vector>
 #include "app.h"
 #include "core/camera.h"
+#include "core/instanceCuller.h"
+#include "core/jobSystem.h"
+#include "gfx/gfxDevice.h"
 
 struct CameraUbo
 {
@@ -65,6 +69,18 @@ private:
 
    // 1 drawcall per cube, gridSize*gridSize
    int gridSize;
+   int cubeCount;
 
    CubeData* cubeData;
+
+   // Only the cubes in view get a drawcall.
+   bool frustumCulling;
+   JobSystem jobSystem;
+   InstanceCuller cubeCuller;
+   std::vector<uint32_t> visibleCubes;
+   uint32_t visibleCubeCount;
+   float cullMs;
+
+   // Counted by render() for the frame stats overlay, there is no GFXDevice to do it.
+   GFXFrameStats frameStats;
 };
\ No newline at end of file
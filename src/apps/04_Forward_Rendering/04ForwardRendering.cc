@@ -1,9 +1,13 @@
+#include <math.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <algorithm>
+#include <string>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtx/color_space.hpp>
 #include <imgui.h>
 #include "apps/04_Forward_Rendering/04ForwardRendering.h"
 #include "core/cube.h"
+#include "core/profiler.h"
 #include "gfx/gfxCmdBuffer.h"
 #include "gfx/OpenGL/gfxGLDevice.h"
 
@@ -11,6 +15,35 @@ IMPLEMENT_APPLICATION(ForwardRenderingApplication);
 
 const float VIEW_DISTANCE = 500.0f;
 
+// The first cluster slice holds everything closer than this, the camera rarely gets that near.
+const float CLUSTER_NEAR_DISTANCE = 5.0f;
+const uint32_t CLUSTER_GROUP_SIZE = 64;
+const char* BIN_LIGHTS_TIMER = "Bin Lights";
+const char* DEPTH_PREPASS_NAME = "Depth Prepass";
+const char* FORWARD_PASS_NAME = "Forward";
+static_assert(GFXLightClusters::CLUSTER_COUNT % CLUSTER_GROUP_SIZE == 0, "Clusters must fill whole groups");
+
+const uint32_t CULL_GROUP_SIZE = 64;
+const uint32_t HIZ_GROUP_SIZE = 8;
+const char* CULL_CUBES_TIMER = "Cull Cubes";
+const char* HIZ_PASS_NAME = "Hi-Z";
+
+// readShaderFile() puts the #version line first, defines have to follow it.
+static std::string addShaderDefine(const char* code, const char* define)
+{
+   std::string result(code);
+   result.insert(result.find('\n') + 1, std::string("#define ") + define + "\n");
+   return result;
+}
+
+static int getMipLevelCount(int width, int height)
+{
+   int levels = 1;
+   for (int largest = std::max(width, height); largest > 1; largest >>= 1)
+      levels++;
+   return levels;
+}
+
 void ForwardRenderingApplication::onInit()
 {
    camera.setPosition(glm::vec3(9.0f, 25.0f, 9.0f));
@@ -20,7 +53,28 @@ void ForwardRenderingApplication::onInit()
    getWindowSize(windowWidth, windowHeight);
    setWindowTitle("Forward Rendering Application");
 
-   createCubeData();
+   dynamicResolution.setMaxSize(windowWidth, windowHeight);
+   dynamicResolution.setTargetFrameTime(1000.0f / 60.0f);
+   gpuFrameTimeMs = 0.0f;
+
+   depthPrepass = false;
+   lightCount = 0;
+   lightCulling = supportsComputeShaders() ? LightCulling::CLUSTERED_CPU : LightCulling::NONE;
+   binMs = 0.0f;
+   packMs = 0.0f;
+   cubeCulling = CubeCulling::FRUSTUM_CPU;
+   cubeBufferHoldsAll = false;
+   visibleCubeCount = 0;
+   cullMs = 0.0f;
+   occlusionCulling = true;
+   cullFrame = 0;
+   frustumCulledCubeCount = 0;
+   occludedCubeCount = 0;
+   hizValid = false;
+   hizWidth = 0;
+   hizHeight = 0;
+
+   createCubeData(CUBE_COUNT);
 
    initGL();
 }
@@ -40,6 +94,8 @@ void ForwardRenderingApplication::onWindowSizeUpdate(int width, int height)
 {
    windowWidth = width;
    windowHeight = height;
+
+   dynamicResolution.setMaxSize(width, height);
 }
 
 void ForwardRenderingApplication::updateCamera(double dt)
@@ -54,52 +110,14 @@ void ForwardRenderingApplication::updatePerspectiveMatrix()
    camera.setProjectionMatrix(glm::perspective((float)glm::radians(110.0), getAspectRatio(), 0.01f, VIEW_DISTANCE));
 
    camera.getMatrices(cameraData.projMatrix, cameraData.viewMatrix);
+   cameraData.viewProjMatrix = cameraData.projMatrix * cameraData.viewMatrix;
 }
 
 void ForwardRenderingApplication::initGL()
 {
    graphicsDevice = new GFXGLDevice();
    cmdBuffer = new GFXCmdBuffer();
-
-   {
-      GFXTextureStateDesc colorTexDesc = {};
-      colorTexDesc.height = windowHeight;
-      colorTexDesc.width = windowWidth;
-      colorTexDesc.type = GFXTextureType::TEXTURE_2D;
-      colorTexDesc.levels = 1;
-      colorTexDesc.internalFormat = GFXTextureInternalFormat::RGBA8;
-
-      GFXTextureStateDesc depthTexDesc = {};
-      depthTexDesc.height = windowHeight;
-      depthTexDesc.width = windowWidth;
-      depthTexDesc.type = GFXTextureType::TEXTURE_2D;
-      depthTexDesc.levels = 1;
-      depthTexDesc.internalFormat = GFXTextureInternalFormat::DEPTH_16;
-
-      colorRenderPassAttachmentHandle = graphicsDevice->createTexture(colorTexDesc);
-      depthRenderPassAttachmentHandle = graphicsDevice->createTexture(depthTexDesc);
-
-      GFXColorRenderPassAttachment colorAttach = {};
-      colorAttach.clearColor[0] = 0.0f;
-      colorAttach.clearColor[1] = 0.0f;
-      colorAttach.clearColor[2] = 0.0f;
-      colorAttach.clearColor[3] = 1.0f;
-      colorAttach.loadAction = GFXLoadAttachmentAction::CLEAR;
-      colorAttach.texture = colorRenderPassAttachmentHandle;
-
-      GFXDepthRenderPassAttachment depthAttach = {};
-      depthAttach.clearDepth = 1.0;
-      depthAttach.loadAction = GFXLoadAttachmentAction::CLEAR;
-      depthAttach.texture = depthRenderPassAttachmentHandle;
-
-      GFXRenderPassDesc renderPassState;
-      renderPassState.colorAttachmentCount = 1;
-      renderPassState.colorAttachments[0] = std::move(colorAttach);
-      renderPassState.depthAttachmentEnabled = true;
-      renderPassState.depthAttachment = std::move(depthAttach);
-
-      renderPassHandle = graphicsDevice->createRenderPass(renderPassState);
-   }
+   frameGraph = new GFXFrameGraph(graphicsDevice);
 
    {
       GFXRasterizerStateDesc rasterState;
@@ -120,6 +138,16 @@ void ForwardRenderingApplication::initGL()
       depthStateHandle = graphicsDevice->createDepthStencilState(depthState);
    }
 
+   {
+      // Shading after the depth prepass only passes the nearest surface.
+      GFXDepthStencilStateDesc depthState;
+      depthState.enableDepthTest = true;
+      depthState.enableDepthWrite = false;
+      depthState.depthCompareFunc = GFXCompareFunc::LEQUAL;
+
+      depthEqualStateHandle = graphicsDevice->createDepthStencilState(depthState);
+   }
+
    {
       GFXBufferDesc cubeBuffer;
       cubeBuffer.type = GFXBufferType::VERTEX_BUFFER;
@@ -130,6 +158,22 @@ void ForwardRenderingApplication::initGL()
       vertexBufferHandle = graphicsDevice->createBuffer(cubeBuffer);
    }
 
+   {
+      // The depth prepass only fetches positions, half the bytes per vertex.
+      const size_t vertexCount = sizeof(cubeVertsBuffer) / (sizeof(float) * 6);
+      std::vector<float> positions(vertexCount * 3);
+      for (size_t i = 0; i < vertexCount; i++)
+         memcpy(&positions[i * 3], &cubeVertsBuffer[i * 6], sizeof(float) * 3);
+
+      GFXBufferDesc positionBuffer;
+      positionBuffer.type = GFXBufferType::VERTEX_BUFFER;
+      positionBuffer.usage = GFXBufferUsageEnum::STATIC_GPU_ONLY;
+      positionBuffer.sizeInBytes = positions.size() * sizeof(float);
+      positionBuffer.data = positions.data();
+
+      positionBufferHandle = graphicsDevice->createBuffer(positionBuffer);
+   }
+
    {
       GFXBufferDesc cubeBuffer;
       cubeBuffer.type = GFXBufferType::INDEX_BUFFER;
@@ -141,7 +185,25 @@ void ForwardRenderingApplication::initGL()
    }
 
    initShader();
+   initDepthPrepassShader();
    initUBOs();
+
+   if (supportsComputeShaders())
+   {
+      initClusterShaders();
+      initCullShaders();
+      initHiZTexture();
+
+      GFXSamplerStateDesc samplerDesc;
+      samplerDesc.minFilterMode = GFXSamplerMinFilterMode::NEAREST;
+      samplerDesc.magFilterMode = GFXSamplerMagFilterMode::NEAREST;
+      samplerDesc.wrapS = GFXSamplerWrapMode::CLAMP_TO_EDGE;
+      samplerDesc.wrapT = GFXSamplerWrapMode::CLAMP_TO_EDGE;
+      samplerDesc.wrapR = GFXSamplerWrapMode::CLAMP_TO_EDGE;
+
+      pointSamplerHandle = graphicsDevice->createSampler(samplerDesc);
+   }
+
    createLights(LIGHT_COUNT);
 }
 
@@ -167,36 +229,166 @@ void ForwardRenderingApplication::initUBOs()
       lightBufferHandle = graphicsDevice->createBuffer(lightBufferDesc);
    }
 
+   initCubeBuffer();
+
+   // Lights, cube instances and clusters live in storage buffers where they are supported.
+   if (!supportsComputeShaders())
+      return;
+
+   initLightStorageBuffer();
+
+   {
+      GFXBufferDesc paramsBufferDesc;
+      paramsBufferDesc.type = GFXBufferType::CONSTANT_BUFFER;
+      paramsBufferDesc.usage = GFXBufferUsageEnum::DYNAMIC_CPU_TO_GPU;
+      paramsBufferDesc.sizeInBytes = sizeof(ClusterUbo);
+      paramsBufferDesc.data = nullptr;
+
+      clusterParamsBufferHandle = graphicsDevice->createBuffer(paramsBufferDesc);
+   }
+
    {
-      GFXBufferDesc cubeBufferDesc;
-      cubeBufferDesc.type = GFXBufferType::CONSTANT_BUFFER;
-      cubeBufferDesc.usage = GFXBufferUsageEnum::STATIC_GPU_ONLY;
-      cubeBufferDesc.sizeInBytes = sizeof(CubeUbo);
-      cubeBufferDesc.data = &cubeData;
+      GFXBufferDesc clusterBufferDesc;
+      clusterBufferDesc.type = GFXBufferType::STORAGE_BUFFER;
+      clusterBufferDesc.usage = GFXBufferUsageEnum::DYNAMIC_CPU_TO_GPU;
+      clusterBufferDesc.sizeInBytes = GFXLightClusters::CLUSTER_COUNT * sizeof(uint32_t) * 2;
+      clusterBufferDesc.data = nullptr;
 
-      cubeBufferHandle = graphicsDevice->createBuffer(cubeBufferDesc);
+      clusterBufferHandle = graphicsDevice->createBuffer(clusterBufferDesc);
    }
+
+   {
+      // The compute path gives every cluster room for its maximum, the CPU one packs them.
+      GFXBufferDesc indexBufferDesc;
+      indexBufferDesc.type = GFXBufferType::STORAGE_BUFFER;
+      indexBufferDesc.usage = GFXBufferUsageEnum::DYNAMIC_CPU_TO_GPU;
+      indexBufferDesc.sizeInBytes = GFXLightClusters::CLUSTER_COUNT * GFXLightClusters::MAX_LIGHTS_PER_CLUSTER * sizeof(uint32_t);
+      indexBufferDesc.data = nullptr;
+
+      lightIndexBufferHandle = graphicsDevice->createBuffer(indexBufferDesc);
+   }
+
+   initCullBuffers();
+}
+
+void ForwardRenderingApplication::initCubeBuffer()
+{
+   GFXBufferDesc cubeBufferDesc;
+   cubeBufferDesc.type = supportsComputeShaders() ? GFXBufferType::STORAGE_BUFFER : GFXBufferType::CONSTANT_BUFFER;
+   cubeBufferDesc.usage = GFXBufferUsageEnum::DYNAMIC_CPU_TO_GPU;
+   cubeBufferDesc.sizeInBytes = getCubeBufferSize();
+   cubeBufferDesc.data = nullptr;
+
+   cubeBufferHandle = graphicsDevice->createBuffer(cubeBufferDesc);
+   cubeBufferHoldsAll = false;
+
+   if (supportsComputeShaders())
+   {
+      GFXBufferDesc visibleBufferDesc;
+      visibleBufferDesc.type = GFXBufferType::STORAGE_BUFFER;
+      visibleBufferDesc.usage = GFXBufferUsageEnum::STATIC_GPU_ONLY;
+      visibleBufferDesc.sizeInBytes = cubeCount * sizeof(uint32_t);
+      visibleBufferDesc.data = nullptr;
+
+      visibleCubeBufferHandle = graphicsDevice->createBuffer(visibleBufferDesc);
+   }
+}
+
+void ForwardRenderingApplication::initCullBuffers()
+{
+   {
+      GFXBufferDesc paramsBufferDesc;
+      paramsBufferDesc.type = GFXBufferType::CONSTANT_BUFFER;
+      paramsBufferDesc.usage = GFXBufferUsageEnum::DYNAMIC_CPU_TO_GPU;
+      paramsBufferDesc.sizeInBytes = sizeof(CullUbo);
+      paramsBufferDesc.data = nullptr;
+
+      cullParamsBufferHandle = graphicsDevice->createBuffer(paramsBufferDesc);
+   }
+
+   // Zeroed, so reading one back before it was ever culled into finds nothing.
+   const CullOutput output = {};
+   for (int i = 0; i < CULL_OUTPUT_FRAMES; i++)
+   {
+      GFXBufferDesc outputBufferDesc;
+      outputBufferDesc.type = GFXBufferType::INDIRECT_BUFFER;
+      outputBufferDesc.usage = GFXBufferUsageEnum::STATIC_GPU_ONLY;
+      outputBufferDesc.sizeInBytes = sizeof(CullOutput);
+      outputBufferDesc.data = (void*)&output;
+
+      cullOutputBufferHandles[i] = graphicsDevice->createBuffer(outputBufferDesc);
+      cullOutputFences[i] = graphicsDevice->createFence();
+   }
+}
+
+void ForwardRenderingApplication::initHiZTexture()
+{
+   GFXTextureStateDesc textureDesc = {};
+   textureDesc.type = GFXTextureType::TEXTURE_2D;
+   textureDesc.internalFormat = GFXTextureInternalFormat::R32F;
+   textureDesc.levels = 0;
+   textureDesc.width = windowWidth;
+   textureDesc.height = windowHeight;
+
+   hizTextureHandle = graphicsDevice->createTexture(textureDesc);
+   hizWidth = windowWidth;
+   hizHeight = windowHeight;
+   hizValid = false;
+}
+
+void ForwardRenderingApplication::initLightStorageBuffer()
+{
+   GFXBufferDesc lightBufferDesc;
+   lightBufferDesc.type = GFXBufferType::STORAGE_BUFFER;
+   lightBufferDesc.usage = GFXBufferUsageEnum::STATIC_GPU_ONLY;
+   lightBufferDesc.sizeInBytes = getLightStorageSize();
+   lightBufferDesc.data = lightCount > 0 ? lights.data() : nullptr;
+
+   lightStorageBufferHandle = graphicsDevice->createBuffer(lightBufferDesc);
+}
+
+uint32_t ForwardRenderingApplication::getCubeBufferSize()
+{
+   return supportsComputeShaders() ? (uint32_t)(cubeCount * sizeof(PackedInstance)) : (uint32_t)sizeof(CubeUbo);
+}
+
+uint32_t ForwardRenderingApplication::getLightStorageSize() const
+{
+   // Never empty, so it can always be bound.
+   return (uint32_t)(std::max(lightCount, 1) * sizeof(LightUbo::Light));
 }
 
 void ForwardRenderingApplication::createLights(int count)
 {
-   if (count > LIGHT_COUNT)
-      count = LIGHT_COUNT;
-   if (count < 0)
-      count = 0;
+   const int countMax = supportsComputeShaders() ? SCENE_LIGHT_COUNT_MAX : LIGHT_COUNT;
+   count = std::min(std::max(count, 0), countMax);
+   lightCount = count;
+
+   std::vector<SceneLight> sceneLights(count);
+   createSceneLights(count, sceneLights.data());
+
+   lights.resize(count);
+   lightSpheres.resize(count);
+   for (int i = 0; i < count; i++)
+   {
+      lights[i].position = sceneLights[i].position;
+      lights[i].color = sceneLights[i].color;
+      lights[i].attenuation = glm::vec4(1.0f, 0.7f, 5.8f, 0.0f);
+      lightSpheres[i] = sceneLights[i].position;
+   }
 
    memset(&lightData, 0, sizeof(LightUbo));
    lightData.lightCount = count;
 
-   for (int i = 0; i < count; i++)
+   if (supportsComputeShaders())
+   {
+      // Recreated at the new size, the uniform block only passes the count.
+      graphicsDevice->deleteBuffer(lightStorageBufferHandle);
+      initLightStorageBuffer();
+   }
+   else
    {
-      const glm::mat4 &modelMatrix = cubeData.modelMatrix[i];
-      glm::vec4 pos = modelMatrix[3];
-      pos.y = 10.0f;
-      pos.w = 16.0f;
-      lightData.lights[i].position = pos;
-      lightData.lights[i].color = glm::vec4(glm::rgbColor(glm::vec3(((float)rand()/(float)RAND_MAX)*360.0f, 1.0f, 0.2f)), 1.0);
-      lightData.lights[i].attenuation = glm::vec4(1.0f, 0.7f, 5.8f, 0.0f);
+      memcpy(lightData.lights, lights.data(), count * sizeof(LightUbo::Light));
    }
 
    char* pData = (char*)graphicsDevice->mapBuffer(lightBufferHandle, 0, sizeof(LightUbo));
@@ -244,24 +436,157 @@ void ForwardRenderingApplication::initShader()
    pipelineDesc.shaderStageCount = 2;
 
    pipelineHandle = graphicsDevice->createPipeline(pipelineDesc);
+
+   if (supportsComputeShaders())
+   {
+      char* clusteredFragShader = readShaderFile("apps/04_Forward_Rendering/shaders/cube_clustered.frag");
+      shaders[1].code = clusteredFragShader;
+      shaders[1].codeLength = strlen(clusteredFragShader);
+
+      clusteredPipelineHandle = graphicsDevice->createPipeline(pipelineDesc);
+
+      // Both again, drawing the cubes GPU culling kept.
+      const std::string culledVertShader = addShaderDefine(vertShader, "GPU_CULLING");
+      shaders[0].code = culledVertShader.c_str();
+      shaders[0].codeLength = culledVertShader.size();
+
+      culledClusteredPipelineHandle = graphicsDevice->createPipeline(pipelineDesc);
+
+      shaders[1].code = fragShader;
+      shaders[1].codeLength = strlen(fragShader);
+
+      culledPipelineHandle = graphicsDevice->createPipeline(pipelineDesc);
+   }
+}
+
+void ForwardRenderingApplication::initDepthPrepassShader()
+{
+   GFXInputLayoutElementDesc inputLayoutDesc;
+   inputLayoutDesc.slot = 0;
+   inputLayoutDesc.count = 3;
+   inputLayoutDesc.type = GFXInputLayoutFormat::FLOAT;
+   inputLayoutDesc.divisor = GFXInputLayoutDivisor::PER_VERTEX;
+   inputLayoutDesc.offset = 0;
+   inputLayoutDesc.bufferBinding = 0;
+
+   GFXInputLayoutDesc inputLayout;
+   inputLayout.count = 1;
+   inputLayout.descs = &inputLayoutDesc;
+
+   char* vertShader = readShaderFile("apps/04_Forward_Rendering/shaders/cube_depth.vert");
+   char* fragShader = readShaderFile("apps/04_Forward_Rendering/shaders/cube_depth.frag");
+
+   GFXShaderDesc shaders[2];
+   shaders[0].type = GFXShaderType::VERTEX;
+   shaders[0].code = vertShader;
+   shaders[0].codeLength = strlen(vertShader);
+
+   shaders[1].type = GFXShaderType::FRAGMENT;
+   shaders[1].code = fragShader;
+   shaders[1].codeLength = strlen(fragShader);
+
+   GFXPipelineDesc pipelineDesc;
+   pipelineDesc.primitiveType = GFXPrimitiveType::TRIANGLE_LIST;
+   pipelineDesc.inputLayout = std::move(inputLayout);
+   pipelineDesc.shadersStages = shaders;
+   pipelineDesc.shaderStageCount = 2;
+
+   depthPrepassPipelineHandle = graphicsDevice->createPipeline(pipelineDesc);
+
+   if (supportsComputeShaders())
+   {
+      const std::string culledVertShader = addShaderDefine(vertShader, "GPU_CULLING");
+      shaders[0].code = culledVertShader.c_str();
+      shaders[0].codeLength = culledVertShader.size();
+
+      culledDepthPrepassPipelineHandle = graphicsDevice->createPipeline(pipelineDesc);
+   }
+}
+
+void ForwardRenderingApplication::initClusterShaders()
+{
+   char* binShader = readShaderFile("apps/04_Forward_Rendering/shaders/cluster_lights.comp");
+
+   GFXShaderDesc shader;
+   shader.type = GFXShaderType::COMPUTE;
+   shader.code = binShader;
+   shader.codeLength = strlen(binShader);
+
+   GFXPipelineDesc pipelineDesc = {};
+   pipelineDesc.shadersStages = &shader;
+   pipelineDesc.shaderStageCount = 1;
+
+   binLightsPipelineHandle = graphicsDevice->createPipeline(pipelineDesc);
+}
+
+void ForwardRenderingApplication::initCullShaders()
+{
+   const char* files[3] = {
+      "apps/04_Forward_Rendering/shaders/cull_reset.comp",
+      "apps/04_Forward_Rendering/shaders/cull_cubes.comp",
+      "apps/04_Forward_Rendering/shaders/hiz_build.comp"
+   };
+   PipelineHandle* pipelines[3] = { &cullResetPipelineHandle, &cullCubesPipelineHandle, &hizBuildPipelineHandle };
+
+   for (int i = 0; i < 3; i++)
+   {
+      char* code = readShaderFile(files[i]);
+
+      GFXShaderDesc shader;
+      shader.type = GFXShaderType::COMPUTE;
+      shader.code = code;
+      shader.codeLength = strlen(code);
+
+      GFXPipelineDesc pipelineDesc = {};
+      pipelineDesc.shadersStages = &shader;
+      pipelineDesc.shaderStageCount = 1;
+
+      *pipelines[i] = graphicsDevice->createPipeline(pipelineDesc);
+   }
 }
 
 void ForwardRenderingApplication::destroyGL()
 {
    graphicsDevice->deleteStateBlock(depthStateHandle);
+   graphicsDevice->deleteStateBlock(depthEqualStateHandle);
    graphicsDevice->deleteStateBlock(rasterizerStateHandle);
 
    graphicsDevice->deleteBuffer(cameraBufferHandle);
    graphicsDevice->deleteBuffer(lightBufferHandle);
    graphicsDevice->deleteBuffer(cubeBufferHandle);
    graphicsDevice->deleteBuffer(vertexBufferHandle);
+   graphicsDevice->deleteBuffer(positionBufferHandle);
    graphicsDevice->deleteBuffer(indexBufferHandle);
    graphicsDevice->deletePipeline(pipelineHandle);
+   graphicsDevice->deletePipeline(depthPrepassPipelineHandle);
 
-   graphicsDevice->deleteTexture(colorRenderPassAttachmentHandle);
-   graphicsDevice->deleteTexture(depthRenderPassAttachmentHandle);
-   graphicsDevice->deleteRenderPass(renderPassHandle);
+   if (supportsComputeShaders())
+   {
+      graphicsDevice->deleteBuffer(lightStorageBufferHandle);
+      graphicsDevice->deleteBuffer(clusterParamsBufferHandle);
+      graphicsDevice->deleteBuffer(clusterBufferHandle);
+      graphicsDevice->deleteBuffer(lightIndexBufferHandle);
+      graphicsDevice->deletePipeline(clusteredPipelineHandle);
+      graphicsDevice->deletePipeline(binLightsPipelineHandle);
+
+      graphicsDevice->deleteBuffer(visibleCubeBufferHandle);
+      graphicsDevice->deleteBuffer(cullParamsBufferHandle);
+      for (int i = 0; i < CULL_OUTPUT_FRAMES; i++)
+      {
+         graphicsDevice->deleteBuffer(cullOutputBufferHandles[i]);
+         graphicsDevice->deleteFence(cullOutputFences[i]);
+      }
+      graphicsDevice->deletePipeline(culledPipelineHandle);
+      graphicsDevice->deletePipeline(culledDepthPrepassPipelineHandle);
+      graphicsDevice->deletePipeline(culledClusteredPipelineHandle);
+      graphicsDevice->deletePipeline(cullResetPipelineHandle);
+      graphicsDevice->deletePipeline(cullCubesPipelineHandle);
+      graphicsDevice->deletePipeline(hizBuildPipelineHandle);
+      graphicsDevice->deleteSampler(pointSamplerHandle);
+      graphicsDevice->deleteTexture(hizTextureHandle);
+   }
 
+   delete frameGraph;
    delete cmdBuffer;
    delete graphicsDevice;
 }
@@ -272,33 +597,359 @@ void ForwardRenderingApplication::render(double dt)
    memcpy(pData, &cameraData, sizeof(CameraUbo));
    graphicsDevice->unmapBuffer(cameraBufferHandle);
 
+   // The pyramid is read by this frame's cull before it is rebuilt, so it can't be replaced
+   // once commands are recorded.
+   if (supportsComputeShaders() && (hizWidth != windowWidth || hizHeight != windowHeight))
+   {
+      graphicsDevice->deleteTexture(hizTextureHandle);
+      initHiZTexture();
+   }
+
+   cullCubes();
+   packCubes();
+
+   const bool gpuCulling = cubeCulling == CubeCulling::FRUSTUM_OCCLUSION_COMPUTE;
+
+   // Targets stay at the window size, only the rendered area follows the GPU time.
+   gpuFrameTimeMs = (float)graphicsDevice->getGpuTimerMs("Frame");
+   dynamicResolution.update(gpuFrameTimeMs);
+   const int renderWidth = dynamicResolution.getRenderWidth();
+   const int renderHeight = dynamicResolution.getRenderHeight();
+
    cmdBuffer->begin();
+   cmdBuffer->beginTimer("Frame");
 
-   cmdBuffer->bindRenderPass(renderPassHandle);
-   cmdBuffer->setViewport(0, 0, windowWidth, windowHeight);
-   cmdBuffer->setScissor(0, 0, windowWidth, windowHeight);
+   if (lightCulling != LightCulling::NONE)
+      binLights(renderWidth, renderHeight);
 
-   cmdBuffer->setRasterizerState(rasterizerStateHandle);
-   cmdBuffer->setDepthStencilState(depthStateHandle);
+   if (gpuCulling)
+      cullCubesCompute();
 
-   cmdBuffer->bindPipeline(pipelineHandle);
-   cmdBuffer->bindConstantBuffer(0, cameraBufferHandle, 0, sizeof(CameraUbo));
-   cmdBuffer->bindConstantBuffer(1, lightBufferHandle, 0, sizeof(LightUbo));
-   cmdBuffer->bindConstantBuffer(2, cubeBufferHandle, 0, sizeof(CubeUbo));
+   frameGraph->reset();
+
+   const FrameGraphTextureDesc depthDesc = { GFXTextureInternalFormat::DEPTH_16, windowWidth, windowHeight };
+   FrameGraphResource depth = INVALID_FRAME_GRAPH_RESOURCE;
+   if (depthPrepass)
+   {
+      frameGraph->addPass(DEPTH_PREPASS_NAME, [&](FrameGraphBuilder& builder)
+      {
+         depth = builder.writeDepth(builder.createTexture("Depth", depthDesc), GFXLoadAttachmentAction::CLEAR, 1.0f);
+         builder.setRenderArea(renderWidth, renderHeight);
+      },
+      [&](GFXCmdBuffer* cmd, const GFXFrameGraph& graph)
+      {
+         cmd->setRasterizerState(rasterizerStateHandle);
+         cmd->setDepthStencilState(depthStateHandle);
 
-   cmdBuffer->bindVertexBuffer(0, vertexBufferHandle, sizeof(float) * 6, 0);
-   cmdBuffer->bindIndexBuffer(indexBufferHandle, GFXIndexBufferType::BITS_16, 0);
-   
-   cmdBuffer->drawIndexedPrimitivesInstanced(36, 0, CUBE_COUNT);
+         cmd->bindPipeline(gpuCulling ? culledDepthPrepassPipelineHandle : depthPrepassPipelineHandle);
+         cmd->bindConstantBuffer(0, cameraBufferHandle, 0, sizeof(CameraUbo));
+         bindCubes(cmd);
 
+         cmd->bindVertexBuffer(0, positionBufferHandle, sizeof(float) * 3, 0);
+         cmd->bindIndexBuffer(indexBufferHandle, GFXIndexBufferType::BITS_16, 0);
+
+         drawCubes(cmd);
+      });
+   }
+
+   FrameGraphResource color;
+   frameGraph->addPass(FORWARD_PASS_NAME, [&](FrameGraphBuilder& builder)
+   {
+      const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+      FrameGraphTextureDesc colorDesc = { GFXTextureInternalFormat::RGBA8, windowWidth, windowHeight };
+
+      color = builder.writeColor(0, builder.createTexture("Color", colorDesc), GFXLoadAttachmentAction::CLEAR, clearColor);
+      if (depthPrepass)
+         depth = builder.writeDepth(depth, GFXLoadAttachmentAction::LOAD);
+      else
+         depth = builder.writeDepth(builder.createTexture("Depth", depthDesc), GFXLoadAttachmentAction::CLEAR, 1.0f);
+      builder.setRenderArea(renderWidth, renderHeight);
+   },
+   [&](GFXCmdBuffer* cmd, const GFXFrameGraph& graph)
+   {
+      cmd->setRasterizerState(rasterizerStateHandle);
+      cmd->setDepthStencilState(depthPrepass ? depthEqualStateHandle : depthStateHandle);
+
+      if (lightCulling == LightCulling::NONE)
+      {
+         cmd->bindPipeline(gpuCulling ? culledPipelineHandle : pipelineHandle);
+         cmd->bindConstantBuffer(1, lightBufferHandle, 0, sizeof(LightUbo));
+         if (supportsComputeShaders())
+            cmd->bindStorageBuffer(0, lightStorageBufferHandle, 0, getLightStorageSize());
+      }
+      else
+      {
+         cmd->bindPipeline(gpuCulling ? culledClusteredPipelineHandle : clusteredPipelineHandle);
+         cmd->bindConstantBuffer(3, clusterParamsBufferHandle, 0, sizeof(ClusterUbo));
+         cmd->bindStorageBuffer(0, lightStorageBufferHandle, 0, getLightStorageSize());
+         cmd->bindStorageBuffer(1, clusterBufferHandle, 0, GFXLightClusters::CLUSTER_COUNT * sizeof(uint32_t) * 2);
+         cmd->bindStorageBuffer(2, lightIndexBufferHandle, 0, GFXLightClusters::CLUSTER_COUNT * GFXLightClusters::MAX_LIGHTS_PER_CLUSTER * sizeof(uint32_t));
+      }
+
+      cmd->bindConstantBuffer(0, cameraBufferHandle, 0, sizeof(CameraUbo));
+      bindCubes(cmd);
+
+      cmd->bindVertexBuffer(0, vertexBufferHandle, sizeof(float) * 6, 0);
+      cmd->bindIndexBuffer(indexBufferHandle, GFXIndexBufferType::BITS_16, 0);
+
+      drawCubes(cmd);
+   });
+
+   // Built from this frame's depth for the next frame's cull.
+   if (gpuCulling && occlusionCulling)
+   {
+      frameGraph->addPass(HIZ_PASS_NAME, [&](FrameGraphBuilder& builder)
+      {
+         builder.read(depth);
+         builder.setSideEffect();
+      },
+      [&](GFXCmdBuffer* cmd, const GFXFrameGraph& graph)
+      {
+         buildHiZ(cmd, graph.getTexture(depth), renderWidth, renderHeight);
+      });
+
+      hizValid = true;
+      hizRenderWidth = renderWidth;
+      hizRenderHeight = renderHeight;
+      hizViewProjMatrix = cameraData.viewProjMatrix;
+   }
+   else
+   {
+      hizValid = false;
+   }
+
+   frameGraph->markOutput(color);
+   frameGraph->compile();
+
+   frameGraph->execute(cmdBuffer);
+   cmdBuffer->endTimer();
    cmdBuffer->end();
 
    const GFXCmdBuffer* buffer[1];
    buffer[0] = cmdBuffer;
+
    graphicsDevice->executeCmdBuffers(buffer, 1);
 
-   // and now we present our render pass
-   graphicsDevice->present(renderPassHandle, windowWidth, windowHeight);
+   if (gpuCulling)
+   {
+      const uint32_t slot = cullFrame % CULL_OUTPUT_FRAMES;
+      graphicsDevice->deleteFence(cullOutputFences[slot]);
+      cullOutputFences[slot] = graphicsDevice->createFence();
+   }
+
+   // and now we present our render pass, stretching the rendered area over the window
+   graphicsDevice->present(frameGraph->getRenderPass(color), windowWidth, windowHeight, renderWidth, renderHeight);
+}
+
+void ForwardRenderingApplication::binLights(int renderWidth, int renderHeight)
+{
+   PROFILE_SCOPE("ForwardRenderingApplication::binLights");
+
+   lightClusters.setProjection(cameraData.projMatrix, CLUSTER_NEAR_DISTANCE, VIEW_DISTANCE);
+
+   ClusterUbo clusterData = {};
+   clusterData.params = lightClusters.getParams(renderWidth, renderHeight);
+   clusterData.lightCount = (uint32_t)lightCount;
+
+   char* pData = (char*)graphicsDevice->mapBuffer(clusterParamsBufferHandle, 0, sizeof(ClusterUbo));
+   memcpy(pData, &clusterData, sizeof(ClusterUbo));
+   graphicsDevice->unmapBuffer(clusterParamsBufferHandle);
+
+   if (lightCulling == LightCulling::CLUSTERED_COMPUTE)
+   {
+      cmdBuffer->beginTimer(BIN_LIGHTS_TIMER);
+      cmdBuffer->bindConstantBuffer(0, cameraBufferHandle, 0, sizeof(CameraUbo));
+      cmdBuffer->bindConstantBuffer(3, clusterParamsBufferHandle, 0, sizeof(ClusterUbo));
+      cmdBuffer->bindStorageBuffer(0, lightStorageBufferHandle, 0, getLightStorageSize());
+      cmdBuffer->bindStorageBuffer(1, clusterBufferHandle, 0, GFXLightClusters::CLUSTER_COUNT * sizeof(uint32_t) * 2);
+      cmdBuffer->bindStorageBuffer(2, lightIndexBufferHandle, 0, GFXLightClusters::CLUSTER_COUNT * GFXLightClusters::MAX_LIGHTS_PER_CLUSTER * sizeof(uint32_t));
+
+      cmdBuffer->bindPipeline(binLightsPipelineHandle);
+      cmdBuffer->dispatch(GFXLightClusters::CLUSTER_COUNT / CLUSTER_GROUP_SIZE, 1, 1);
+      cmdBuffer->memoryBarrier(SHADER_STORAGE_BARRIER_BIT);
+      cmdBuffer->endTimer();
+
+      // GPU timers resolve a few frames late.
+      binMs = (float)graphicsDevice->getGpuTimerMs(BIN_LIGHTS_TIMER);
+      return;
+   }
+
+   const uint64_t startNs = Profiler::now();
+   lightClusters.build(jobSystem, cameraData.viewMatrix, lightSpheres.data(), (uint32_t)lightCount);
+
+   pData = (char*)graphicsDevice->mapBuffer(clusterBufferHandle, 0, GFXLightClusters::CLUSTER_COUNT * sizeof(uint32_t) * 2);
+   lightClusters.writeClusters((uint32_t*)pData);
+   graphicsDevice->unmapBuffer(clusterBufferHandle);
+
+   const uint32_t indexCount = lightClusters.getIndexCount();
+   if (indexCount > 0)
+   {
+      pData = (char*)graphicsDevice->mapBuffer(lightIndexBufferHandle, 0, indexCount * sizeof(uint32_t));
+      lightClusters.writeIndices((uint32_t*)pData);
+      graphicsDevice->unmapBuffer(lightIndexBufferHandle);
+   }
+
+   binMs = (float)((Profiler::now() - startNs) / 1000000.0);
+}
+
+void ForwardRenderingApplication::bindCubes(GFXCmdBuffer* cmd)
+{
+   if (supportsComputeShaders())
+   {
+      cmd->bindStorageBuffer(3, cubeBufferHandle, 0, getCubeBufferSize());
+      if (cubeCulling == CubeCulling::FRUSTUM_OCCLUSION_COMPUTE)
+         cmd->bindStorageBuffer(4, visibleCubeBufferHandle, 0, cubeCount * sizeof(uint32_t));
+   }
+   else
+   {
+      cmd->bindConstantBuffer(2, cubeBufferHandle, 0, getCubeBufferSize());
+   }
+}
+
+void ForwardRenderingApplication::drawCubes(GFXCmdBuffer* cmd)
+{
+   if (cubeCulling == CubeCulling::FRUSTUM_OCCLUSION_COMPUTE)
+   {
+      // At most one draw, none when every cube is culled.
+      const BufferHandle output = cullOutputBufferHandles[cullFrame % CULL_OUTPUT_FRAMES];
+      cmd->multiDrawIndexedPrimitivesIndirectCount(output, offsetof(CullOutput, draw), output, offsetof(CullOutput, drawCount), 1);
+   }
+   else
+   {
+      cmd->drawIndexedPrimitivesInstanced(36, 0, visibleCubeCount);
+   }
+}
+
+void ForwardRenderingApplication::cullCubes()
+{
+   if (cubeCulling == CubeCulling::NONE)
+   {
+      visibleCubeCount = (uint32_t)cubeCount;
+      cullMs = 0.0f;
+      return;
+   }
+
+   // GPU culling happens in cullCubesCompute().
+   if (cubeCulling != CubeCulling::FRUSTUM_CPU)
+      return;
+
+   const uint64_t startNs = Profiler::now();
+   visibleCubeCount = cubeCuller.cull(jobSystem, camera.getFrustum(), visibleCubes.data());
+   cullMs = (float)((Profiler::now() - startNs) / 1000000.0);
+}
+
+void ForwardRenderingApplication::cullCubesCompute()
+{
+   PROFILE_SCOPE("ForwardRenderingApplication::cullCubesCompute");
+
+   // The output about to be reused was culled into CULL_OUTPUT_FRAMES frames ago. Reading it
+   // back while the GPU is still on it would stall, so the counts shown just stay as they are.
+   cullFrame++;
+   const uint32_t slot = cullFrame % CULL_OUTPUT_FRAMES;
+   const BufferHandle output = cullOutputBufferHandles[slot];
+
+   if (graphicsDevice->isFenceSignaled(cullOutputFences[slot]))
+   {
+      CullOutput counts;
+      graphicsDevice->readBuffer(output, 0, sizeof(CullOutput), &counts);
+      visibleCubeCount = counts.draw.instanceCount;
+      frustumCulledCubeCount = counts.frustumCulledCount;
+      occludedCubeCount = counts.occludedCount;
+   }
+
+   const Frustum frustum = camera.getFrustum();
+   CullUbo cullData = {};
+   for (uint32_t i = 0; i < Frustum::PLANE_COUNT; i++)
+      cullData.frustumPlanes[i] = frustum.getPlane(i);
+   cullData.occlusionViewProj = hizViewProjMatrix;
+   if (occlusionCulling && hizValid)
+      cullData.occlusionSize = glm::vec4((float)hizRenderWidth, (float)hizRenderHeight, (float)getMipLevelCount(hizRenderWidth, hizRenderHeight), 1.0f);
+   cullData.cubeCount = (uint32_t)cubeCount;
+
+   char* pData = (char*)graphicsDevice->mapBuffer(cullParamsBufferHandle, 0, sizeof(CullUbo));
+   memcpy(pData, &cullData, sizeof(CullUbo));
+   graphicsDevice->unmapBuffer(cullParamsBufferHandle);
+
+   cmdBuffer->beginTimer(CULL_CUBES_TIMER);
+   cmdBuffer->bindStorageBuffer(5, output, 0, sizeof(CullOutput));
+   cmdBuffer->bindPipeline(cullResetPipelineHandle);
+   cmdBuffer->dispatch(1, 1, 1);
+   cmdBuffer->memoryBarrier(SHADER_STORAGE_BARRIER_BIT);
+
+   cmdBuffer->bindConstantBuffer(1, cullParamsBufferHandle, 0, sizeof(CullUbo));
+   bindCubes(cmdBuffer);
+   cmdBuffer->bindTexture(0, hizTextureHandle);
+   cmdBuffer->bindSampler(0, pointSamplerHandle);
+   cmdBuffer->bindPipeline(cullCubesPipelineHandle);
+   cmdBuffer->dispatch((cubeCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+   // The draws read the arguments and the vertex shaders the visible list.
+   cmdBuffer->memoryBarrier(SHADER_STORAGE_BARRIER_BIT | INDIRECT_BUFFER_BARRIER_BIT);
+   cmdBuffer->endTimer();
+
+   // GPU timers resolve a few frames late.
+   cullMs = (float)graphicsDevice->getGpuTimerMs(CULL_CUBES_TIMER);
+}
+
+void ForwardRenderingApplication::buildHiZ(GFXCmdBuffer* cmd, TextureHandle depthTexture, int renderWidth, int renderHeight)
+{
+   cmd->bindPipeline(hizBuildPipelineHandle);
+   cmd->bindTexture(0, depthTexture);
+   cmd->bindSampler(0, pointSamplerHandle);
+
+   int srcWidth = renderWidth;
+   int srcHeight = renderHeight;
+   const int levelCount = getMipLevelCount(renderWidth, renderHeight);
+   for (int level = 0; level < levelCount; level++)
+   {
+      const int dstWidth = std::max(renderWidth >> level, 1);
+      const int dstHeight = std::max(renderHeight >> level, 1);
+
+      cmd->bindImage(0, hizTextureHandle, level, GFXImageAccess::WRITE_ONLY);
+      if (level > 0)
+      {
+         cmd->bindImage(1, hizTextureHandle, level - 1, GFXImageAccess::READ_ONLY);
+         cmd->memoryBarrier(SHADER_IMAGE_ACCESS_BARRIER_BIT);
+      }
+
+      const glm::vec4 pushConstants[2] = { glm::vec4(srcWidth, srcHeight, dstWidth, dstHeight), glm::vec4((float)level, 0.0f, 0.0f, 0.0f) };
+      cmd->bindPushConstants(0, sizeof(pushConstants), GFXShaderStageBit::COMPUTE_BIT, pushConstants);
+      cmd->dispatch((dstWidth + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, (dstHeight + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+
+      srcWidth = dstWidth;
+      srcHeight = dstHeight;
+   }
+
+   // Next frame's cull fetches from it.
+   cmd->memoryBarrier(TEXTURE_FETCH_BARRIER_BIT);
+}
+
+void ForwardRenderingApplication::packCubes()
+{
+   PROFILE_SCOPE("ForwardRenderingApplication::packCubes");
+
+   // GPU culling draws every cube through indices, they only have to be packed once.
+   if (cubeCulling == CubeCulling::FRUSTUM_OCCLUSION_COMPUTE && cubeBufferHoldsAll)
+   {
+      packMs = 0.0f;
+      return;
+   }
+
+   const uint32_t packCount = cubeCulling == CubeCulling::FRUSTUM_CPU ? visibleCubeCount : (uint32_t)cubeCount;
+   if (packCount == 0)
+      return;
+
+   const uint64_t startNs = Profiler::now();
+
+   PackedInstance* instances = (PackedInstance*)graphicsDevice->mapBuffer(cubeBufferHandle, 0, packCount * sizeof(PackedInstance));
+   if (cubeCulling == CubeCulling::FRUSTUM_CPU)
+      packInstances(jobSystem, cubeMatrices.data(), visibleCubes.data(), packCount, instances);
+   else
+      packInstances(jobSystem, cubeMatrices.data(), packCount, instances);
+   graphicsDevice->unmapBuffer(cubeBufferHandle);
+
+   cubeBufferHoldsAll = cubeCulling != CubeCulling::FRUSTUM_CPU;
+   packMs = (float)((Profiler::now() - startNs) / 1000000.0);
 }
 
 void ForwardRenderingApplication::onRenderImGUI(double dt)
@@ -314,30 +965,119 @@ void ForwardRenderingApplication::onRenderImGUI(double dt)
    ImGui::Text("   Version: %s", graphicsDevice->getApiVersionString());
 
    ImGui::Separator();
-   if (ImGui::InputInt("Light Count", &lightData.lightCount))
+   const FrameGraphStats& stats = frameGraph->getStats();
+   ImGui::Text("Frame Graph:");
+   ImGui::Text("   Passes: %u (%u culled)", stats.passCount, stats.culledPassCount);
+   ImGui::Text("   Render Targets: %u transient, %u allocated", stats.transientTextureCount, stats.physicalTextureCount);
+   ImGui::Text("   Peak Render Target Memory: %.2f MB", stats.peakRenderTargetBytes / (1024.0 * 1024.0));
+
+   ImGui::Separator();
+   bool dynamicResolutionEnabled = dynamicResolution.isEnabled();
+   if (ImGui::Checkbox("Dynamic Resolution", &dynamicResolutionEnabled))
+      dynamicResolution.setEnabled(dynamicResolutionEnabled);
+
+   float targetFrameTime = dynamicResolution.getTargetFrameTime();
+   if (ImGui::SliderFloat("GPU Budget (ms)", &targetFrameTime, 2.0f, 33.3f))
+      dynamicResolution.setTargetFrameTime(targetFrameTime);
+
+   ImGui::Text("GPU Time: %.2f ms (smoothed %.2f ms)", gpuFrameTimeMs, dynamicResolution.getSmoothedFrameTime());
+   ImGui::Text("Render Scale: %.0f%% (%dx%d)", dynamicResolution.getScale() * 100.0f, dynamicResolution.getRenderWidth(), dynamicResolution.getRenderHeight());
+
+   ImGui::Separator();
+   ImGui::Checkbox("Depth Prepass", &depthPrepass);
+   if (depthPrepass)
+      ImGui::Text("Depth Prepass GPU Time: %.2f ms", graphicsDevice->getGpuTimerMs(DEPTH_PREPASS_NAME));
+   ImGui::Text("Forward Pass GPU Time: %.2f ms", graphicsDevice->getGpuTimerMs(FORWARD_PASS_NAME));
+
+   ImGui::Separator();
+   int cubes = cubeCount;
+   const int cubeCountMax = supportsComputeShaders() ? SCENE_CUBE_COUNT_MAX : CUBE_COUNT;
+   if (ImGui::SliderInt("Cube Count", &cubes, 1, cubeCountMax, "%d", ImGuiSliderFlags_Logarithmic))
+   {
+      graphicsDevice->deleteBuffer(cubeBufferHandle);
+      if (supportsComputeShaders())
+         graphicsDevice->deleteBuffer(visibleCubeBufferHandle);
+      createCubeData(cubes);
+      initCubeBuffer();
+   }
+
+   // GPU culling needs compute shaders.
+   int cubeCullingIndex = (int)cubeCulling;
+   const char* cubeCullingNames[] = { "None", "Frustum (CPU)", "Frustum + Hi-Z (Compute)" };
+   const int cubeCullingNameCount = supportsComputeShaders() ? IM_ARRAYSIZE(cubeCullingNames) : 2;
+   if (ImGui::Combo("Cube Culling", &cubeCullingIndex, cubeCullingNames, cubeCullingNameCount))
+      cubeCulling = (CubeCulling)cubeCullingIndex;
+
+   if (cubeCulling == CubeCulling::FRUSTUM_CPU)
+   {
+      ImGui::Text("Culling: %.3f ms (%s, %u threads)", cullMs, InstanceCuller::getKernelString(), jobSystem.getThreadCount());
+      ImGui::Text("Visible Cubes: %u / %d", visibleCubeCount, cubeCount);
+   }
+   else if (cubeCulling == CubeCulling::FRUSTUM_OCCLUSION_COMPUTE)
+   {
+      ImGui::Checkbox("Hi-Z Occlusion", &occlusionCulling);
+      ImGui::Text("Culling: %.3f ms GPU", cullMs);
+      if (occlusionCulling)
+         ImGui::Text("Hi-Z Build: %.3f ms GPU", graphicsDevice->getGpuTimerMs(HIZ_PASS_NAME));
+      ImGui::Text("Visible Cubes: %u / %d", visibleCubeCount, cubeCount);
+      ImGui::Text("   Outside Frustum: %u", frustumCulledCubeCount);
+      ImGui::Text("   Occluded: %u", occludedCubeCount);
+   }
+   else
+   {
+      ImGui::Text("Visible Cubes: %u / %d", visibleCubeCount, cubeCount);
+   }
+
+   ImGui::Text("Instance Packing: %.3f ms (%.1f MB)", packMs, visibleCubeCount * sizeof(PackedInstance) / (1024.0 * 1024.0));
+
+   ImGui::Separator();
+   // The clustered modes need storage buffers, which come with compute shaders.
+   int culling = (int)lightCulling;
+   const char* cullingNames[] = { "None", "Clustered (CPU)", "Clustered (Compute)" };
+   const int cullingNameCount = supportsComputeShaders() ? IM_ARRAYSIZE(cullingNames) : 1;
+   if (ImGui::Combo("Light Culling", &culling, cullingNames, cullingNameCount))
+      lightCulling = (LightCulling)culling;
+
+   int count = lightCount;
+   const int countMax = supportsComputeShaders() ? SCENE_LIGHT_COUNT_MAX : LIGHT_COUNT;
+   if (ImGui::SliderInt("Light Count", &count, 0, countMax, "%d", ImGuiSliderFlags_Logarithmic))
+      createLights(count);
+
+   if (lightCulling == LightCulling::CLUSTERED_CPU)
+   {
+      ImGui::Text("Light Binning: %.2f ms (%u threads)", binMs, jobSystem.getThreadCount());
+      ImGui::Text("Light Indices: %u (%.1f per cluster)", lightClusters.getIndexCount(),
+         (float)lightClusters.getIndexCount() / GFXLightClusters::CLUSTER_COUNT);
+   }
+   else if (lightCulling == LightCulling::CLUSTERED_COMPUTE)
    {
-      createLights(lightData.lightCount);
+      ImGui::Text("Light Binning: %.2f ms GPU", binMs);
    }
 
+   ImGui::Separator();
+   renderGFXFrameStats(graphicsDevice);
+   renderProfilerStats();
+   renderGFXMemoryStats(graphicsDevice);
+
    ImGui::End();
    ImGui::Render();
 }
 
-void ForwardRenderingApplication::createCubeData()
+void ForwardRenderingApplication::createCubeData(int count)
 {
-   int gridSize = (int)sqrt(CUBE_COUNT);
-
-   int idx = 0;
-   for (int x = -gridSize / 2; x < gridSize / 2; x++)
+   const int countMax = supportsComputeShaders() ? SCENE_CUBE_COUNT_MAX : CUBE_COUNT;
+   cubeCount = std::min(std::max(count, 1), countMax);
+   cubeMatrices.resize(cubeCount);
+   visibleCubes.resize(cubeCount);
+   std::vector<glm::vec3> centers(cubeCount);
+   std::vector<glm::vec3> extents(cubeCount);
+
+   createSceneCubes(cubeCount, cubeMatrices.data());
+   for (int i = 0; i < cubeCount; i++)
    {
-      for (int z = -gridSize / 2; z < gridSize / 2; z++)
-      {
-         glm::vec3 pos = glm::vec3((float)x * 4, 0, (float)z * 4);
-
-         glm::mat4 mat = glm::mat4(1);
-         mat = glm::translate(mat, pos);
-         mat = glm::scale(mat, glm::vec3(2));
-         cubeData.modelMatrix[idx++] = mat;
-      }
+      centers[i] = glm::vec3(cubeMatrices[i] * glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
+      extents[i] = glm::vec3(1.0f);
    }
+
+   cubeCuller.build(jobSystem, centers.data(), extents.data(), (uint32_t)cubeCount);
 }
\ No newline at end of file
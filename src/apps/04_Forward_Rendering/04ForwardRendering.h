@@ -1,21 +1,34 @@
 #pragma once
 
+#include <vector>
 #include "app.h"
 #include "core/camera.h"
+#include "core/cubeScene.h"
+#include "core/instanceCuller.h"
+#include "core/instancePacking.h"
+#include "core/jobSystem.h"
 #include "gfx/gfxDevice.h"
+#include "gfx/gfxDynamicResolution.h"
+#include "gfx/gfxFrameGraph.h"
+#include "gfx/gfxLightClusters.h"
 
 struct CameraUbo
 {
    glm::mat4 projMatrix;
    glm::mat4 viewMatrix;
+   glm::mat4 viewProjMatrix;
 };
 
+// Uniform block capacities, for GL versions without storage buffers.
 #define CUBE_COUNT 512
 #define LIGHT_COUNT 1024
 
+// Storage buffers are sized at runtime, SCENE_CUBE_COUNT_MAX and SCENE_LIGHT_COUNT_MAX only
+// bound the UI.
+
 struct CubeUbo
 {
-   glm::mat4 modelMatrix[CUBE_COUNT];
+   PackedInstance instances[CUBE_COUNT];
 };
 
 struct LightUbo
@@ -26,10 +39,55 @@ struct LightUbo
       glm::vec4 attenuation;
       glm::vec4 color;
    };
-   
-   Light lights[LIGHT_COUNT];
+
+   // First, so the storage buffer path can bind the count on its own.
    int lightCount;
    int pad[3];
+   Light lights[LIGHT_COUNT];
+};
+
+struct ClusterUbo
+{
+   GFXLightClusterParams params;
+   uint32_t lightCount;
+   uint32_t pad[3];
+};
+
+// Matches CullBuffer in cull_cubes.comp, std140.
+struct CullUbo
+{
+   glm::vec4 frustumPlanes[Frustum::PLANE_COUNT];
+   glm::mat4 occlusionViewProj; // of the frame the Hi-Z pyramid was built from
+   glm::vec4 occlusionSize; // Hi-Z level 0 width and height, level count, 0 without a pyramid
+   uint32_t cubeCount;
+   uint32_t pad[3];
+};
+
+// What cull_cubes.comp writes: the indirect draw, how many draws it holds and the cubes that
+// didn't make it.
+struct CullOutput
+{
+   GFXDrawIndexedPrimitivesIndirectArgs draw;
+   uint32_t drawCount;
+   uint32_t frustumCulledCount;
+   uint32_t occludedCount;
+};
+
+// Cull outputs in flight, read back once the GPU is this many frames past them.
+#define CULL_OUTPUT_FRAMES 3
+
+enum class CubeCulling
+{
+   NONE,
+   FRUSTUM_CPU,
+   FRUSTUM_OCCLUSION_COMPUTE // the frustum and the previous frame's Hi-Z pyramid, on the GPU
+};
+
+enum class LightCulling
+{
+   NONE, // every fragment visits every light
+   CLUSTERED_CPU,
+   CLUSTERED_COMPUTE
 };
 
 class ForwardRenderingApplication : public Application
@@ -43,42 +101,122 @@ public:
    virtual void onDestroy() override;
    virtual void onUpdate(double dt) override;
    virtual void onRenderImGUI(double dt) override;
+   virtual GFXDevice* getGraphicsDevice() const override { return graphicsDevice; }
 
    void updateCamera(double dt);
    void updatePerspectiveMatrix();
    void initGL();
    void initUBOs();
+   void initCubeBuffer();
+   void initLightStorageBuffer();
    void initShader();
+   void initDepthPrepassShader();
+   void initClusterShaders();
+   void initCullShaders();
+   void initCullBuffers();
+   void initHiZTexture();
    void destroyGL();
    void render(double dt);
-   void createCubeData();
+   void binLights(int renderWidth, int renderHeight);
+   void bindCubes(GFXCmdBuffer* cmd);
+   void drawCubes(GFXCmdBuffer* cmd);
+   void cullCubes();
+   void cullCubesCompute();
+   void packCubes();
+   void buildHiZ(GFXCmdBuffer* cmd, TextureHandle depthTexture, int renderWidth, int renderHeight);
+   void createCubeData(int count);
    void createLights(int count);
 
+   uint32_t getCubeBufferSize();
+   uint32_t getLightStorageSize() const;
+
 private:
    Camera camera;
 
    CameraUbo cameraData;
-   CubeUbo cubeData;
+   // Cube transforms are kept as matrices. Culled on the CPU, the visible ones are packed into
+   // the cube buffer every frame. Culled on the GPU, every cube is packed once and the cull
+   // keeps indices to them.
+   int cubeCount;
+   std::vector<glm::mat4> cubeMatrices;
+   InstanceCuller cubeCuller;
+   std::vector<uint32_t> visibleCubes;
+   uint32_t visibleCubeCount;
+   CubeCulling cubeCulling;
+   bool cubeBufferHoldsAll;
+   float cullMs;
+
+   // GPU culling. Counts come back CULL_OUTPUT_FRAMES frames late, or later when the GPU is behind.
+   bool occlusionCulling;
+   uint32_t cullFrame;
+   uint32_t frustumCulledCubeCount;
+   uint32_t occludedCubeCount;
+
+   // Hi-Z pyramid of the last frame's depth, the farthest depth under every texel. Allocated at
+   // the window size, built over the rendered area.
+   bool hizValid;
+   int hizWidth;
+   int hizHeight;
+   int hizRenderWidth;
+   int hizRenderHeight;
+   glm::mat4 hizViewProjMatrix;
    LightUbo lightData;
 
+   // Every light. With storage buffers every path reads them from one, lightData only holds
+   // the count.
+   int lightCount;
+   std::vector<LightUbo::Light> lights;
+   std::vector<glm::vec4> lightSpheres;
+
+   // Lays down depth first so the shading pass only runs once per pixel.
+   bool depthPrepass;
+
+   LightCulling lightCulling;
+   JobSystem jobSystem;
+   GFXLightClusters lightClusters;
+   float binMs;
+   float packMs;
+
    int windowWidth;
    int windowHeight;
 
+   GFXDynamicResolution dynamicResolution;
+   float gpuFrameTimeMs;
+
    GFXDevice* graphicsDevice;
    GFXCmdBuffer* cmdBuffer;
+   GFXFrameGraph* frameGraph;
 
    StateBlockHandle depthStateHandle;
+   StateBlockHandle depthEqualStateHandle;
    StateBlockHandle rasterizerStateHandle;
 
-   RenderPassHandle renderPassHandle;
-   TextureHandle colorRenderPassAttachmentHandle;
-   TextureHandle depthRenderPassAttachmentHandle;
-
    PipelineHandle pipelineHandle;
+   PipelineHandle depthPrepassPipelineHandle;
+   PipelineHandle clusteredPipelineHandle;
+   PipelineHandle binLightsPipelineHandle;
+   PipelineHandle culledPipelineHandle;
+   PipelineHandle culledDepthPrepassPipelineHandle;
+   PipelineHandle culledClusteredPipelineHandle;
+   PipelineHandle cullResetPipelineHandle;
+   PipelineHandle cullCubesPipelineHandle;
+   PipelineHandle hizBuildPipelineHandle;
+
+   SamplerHandle pointSamplerHandle;
+   TextureHandle hizTextureHandle;
 
    BufferHandle cameraBufferHandle;
    BufferHandle lightBufferHandle;
+   BufferHandle lightStorageBufferHandle;
+   BufferHandle clusterParamsBufferHandle;
+   BufferHandle clusterBufferHandle;
+   BufferHandle lightIndexBufferHandle;
    BufferHandle cubeBufferHandle;
+   BufferHandle visibleCubeBufferHandle;
+   BufferHandle cullParamsBufferHandle;
+   BufferHandle cullOutputBufferHandles[CULL_OUTPUT_FRAMES];
+   FenceHandle cullOutputFences[CULL_OUTPUT_FRAMES]; // signaled once the GPU is done culling into the output
    BufferHandle vertexBufferHandle;
+   BufferHandle positionBufferHandle;
    BufferHandle indexBufferHandle;
 };
\ No newline at end of file
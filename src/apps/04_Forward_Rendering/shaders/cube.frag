@@ -13,17 +13,26 @@ struct Light
    vec4 color;
 };
 
+// Lights come from a storage buffer sized at runtime where GLSL 4.30 has them, the uniform
+// block then only holds their count.
+#if __VERSION__ >= 430
 layout(std140, binding = 1) uniform LightBuffer 
 {
-   Light lights[LIGHT_COUNT];
    int lightCount;
-   int pad[3];
 };
 
-float calcAttenuationFactor(float constant, float linear, float quadratic, float lightLen) 
+layout(std430, binding = 0) readonly buffer Lights 
 {
-   return 1.0;// / (constant + linear * lightLen + quadratic * (lightLen * lightLen));
-}
+   Light lights[];
+};
+#else
+layout(std140, binding = 1) uniform LightBuffer 
+{
+   int lightCount;
+   int pad[3];
+   Light lights[LIGHT_COUNT];
+};
+#endif
 
 vec4 computePointLight(Light light, vec3 position, vec3 normal)
 {
@@ -37,7 +46,9 @@ vec4 computePointLight(Light light, vec3 position, vec3 normal)
       float angle = dot(normal, normalize(lightVec));
       angle = clamp(angle, 0.0, 1.0);
 
-      float attenuation = calcAttenuationFactor(light.attenuation.x, light.attenuation.y, light.attenuation.z, lightLen);
+      // Falls to exactly zero at the radius, like the clustered shader.
+      float falloff = 1.0 - (lightLen * lightLen) / (radius * radius);
+      float attenuation = falloff * falloff;
 
       result = attenuation * vec4(light.color * angle);
    }
@@ -6,26 +6,62 @@ layout(location = 1) in vec3 normal;
 out vec3 fPOSITION;
 out vec3 fNORMAL;
 
+// Matches cube_depth.vert exactly, so shading after the depth prepass passes LEQUAL.
+invariant gl_Position;
+
 layout(std140, binding = 0) uniform CameraBuffer 
 {
    mat4 proj;
    mat4 view;
+   mat4 viewProj;
+};
+
+// PackedInstance: translation and uniform scale, then a unit quaternion. For rotation and
+// uniform scale the rotation is also the normal matrix.
+struct CubeInstance
+{
+   vec4 positionScale;
+   vec4 rotation;
 };
 
+// GLSL 4.30 has storage buffers, sized for any number of cubes. Earlier versions fall back to a
+// uniform block of CUBE_COUNT.
+#if __VERSION__ >= 430
+layout(std430, binding = 3) readonly buffer CubeInstances 
+{
+   CubeInstance instances[];
+};
+#else
 layout(std140, binding = 2) uniform CubeInstanceBuffer 
 {
-    mat4 modelMatrix[CUBE_COUNT];
+   CubeInstance instances[CUBE_COUNT];
 };
+#endif
 
-void main() 
+// With GPU culling instances are drawn through the indices cull_cubes.comp keeps, otherwise
+// the cube buffer only holds visible cubes.
+#ifdef GPU_CULLING
+layout(std430, binding = 4) readonly buffer VisibleCubes 
+{
+   uint visibleCubes[];
+};
+#define INSTANCE_INDEX visibleCubes[gl_InstanceID]
+#else
+#define INSTANCE_INDEX gl_InstanceID
+#endif
+
+vec3 rotate(vec4 q, vec3 v)
 {
-   mat4 modelMat = modelMatrix[gl_InstanceID];
-   mat4 mvp = proj * view * modelMat;
+   return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
 
-   mat3 inverseModel = mat3(transpose(inverse(modelMat)));
+void main() 
+{
+   CubeInstance instance = instances[INSTANCE_INDEX];
+   vec3 worldPos = instance.positionScale.xyz + rotate(instance.rotation, pos * instance.positionScale.w);
 
-   fNORMAL = (inverseModel * normal);
-   fPOSITION = vec3(modelMat * vec4(pos, 1.0));
+   fNORMAL = rotate(instance.rotation, normal);
+   fPOSITION = worldPos;
 
-   gl_Position = mvp * vec4(pos, 1.0);
+   gl_Position = viewProj * vec4(worldPos, 1.0);
 }
\ No newline at end of file
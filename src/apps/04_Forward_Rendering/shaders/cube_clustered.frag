@@ -0,0 +1,96 @@
+// cube.frag with the lights of the fragment's cluster only, see GFXLightClusters.
+
+#define TILE_COUNT_X 16u
+#define TILE_COUNT_Y 9u
+#define SLICE_COUNT 24u
+
+in vec3 fPOSITION;
+in vec3 fNORMAL;
+layout(location = 0) out vec4 color;
+
+vec3 ambient_color = vec3(0.3, 0.3, 0.3);
+
+struct Light 
+{
+   vec4 position;
+   vec4 attenuation;
+   vec4 color;
+};
+
+layout(std140, binding = 0) uniform CameraBuffer 
+{
+   mat4 proj;
+   mat4 view;
+};
+
+layout(std140, binding = 3) uniform ClusterBuffer 
+{
+   vec4 tileSlice;
+   vec4 projection;
+   uint lightCount;
+} clusterParams;
+
+layout(std430, binding = 0) readonly buffer Lights 
+{
+   Light lights[];
+};
+
+layout(std430, binding = 1) readonly buffer Clusters 
+{
+   uvec2 clusters[]; // offset into lightIndices and light count
+};
+
+layout(std430, binding = 2) readonly buffer LightIndices 
+{
+   uint lightIndices[];
+};
+
+vec4 computePointLight(Light light, vec3 position, vec3 normal)
+{
+   vec3 lightVec = (light.position.xyz - position);
+   float lightLen = length(lightVec);
+   float radius = light.position.w;
+
+   vec4 result = vec4(0.0);
+   if (lightLen < radius)
+   {
+      float angle = dot(normal, normalize(lightVec));
+      angle = clamp(angle, 0.0, 1.0);
+
+      // Falls to exactly zero at the radius, so culling the light past it changes nothing.
+      float falloff = 1.0 - (lightLen * lightLen) / (radius * radius);
+      float attenuation = falloff * falloff;
+
+      result = attenuation * vec4(light.color * angle);
+   }
+
+   return result; 
+}
+
+uint getCluster(vec3 position)
+{
+   uvec2 tile = min(uvec2(gl_FragCoord.xy * clusterParams.tileSlice.xy), uvec2(TILE_COUNT_X - 1u, TILE_COUNT_Y - 1u));
+
+   float depth = -(view * vec4(position, 1.0)).z;
+   uint slice = 0u;
+   if (depth >= clusterParams.projection.z)
+      slice = min(uint(max(log(depth) * clusterParams.tileSlice.z + clusterParams.tileSlice.w, 0.0)) + 1u, SLICE_COUNT - 1u);
+
+   return (slice * TILE_COUNT_Y + tile.y) * TILE_COUNT_X + tile.x;
+}
+
+void main() 
+{
+   vec3 normal = normalize(fNORMAL);
+
+   vec4 lightColor = vec4(0.0);
+
+   uvec2 cluster = clusters[getCluster(fPOSITION)];
+   for (uint i = 0u; i < cluster.y; i++) 
+   {
+      Light light = lights[lightIndices[cluster.x + i]];
+      lightColor += computePointLight(light, fPOSITION, normal);
+   }
+
+   color = vec4(lightColor.xyz + ambient_color, 1.0);
+}
@@ -0,0 +1,5 @@
+// Depth only, the prepass has no color attachment.
+
+void main() 
+{
+}
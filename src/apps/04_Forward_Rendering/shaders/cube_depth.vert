@@ -0,0 +1,56 @@
+// cube.vert without the normal, for the depth prepass. Position math must stay identical to
+// cube.vert so both passes produce the same depth.
+
+#define CUBE_COUNT 512
+
+layout(location = 0) in vec3 pos;
+
+invariant gl_Position;
+
+layout(std140, binding = 0) uniform CameraBuffer 
+{
+   mat4 proj;
+   mat4 view;
+   mat4 viewProj;
+};
+
+struct CubeInstance
+{
+   vec4 positionScale;
+   vec4 rotation;
+};
+
+#if __VERSION__ >= 430
+layout(std430, binding = 3) readonly buffer CubeInstances 
+{
+   CubeInstance instances[];
+};
+#else
+layout(std140, binding = 2) uniform CubeInstanceBuffer 
+{
+   CubeInstance instances[CUBE_COUNT];
+};
+#endif
+
+#ifdef GPU_CULLING
+layout(std430, binding = 4) readonly buffer VisibleCubes 
+{
+   uint visibleCubes[];
+};
+#define INSTANCE_INDEX visibleCubes[gl_InstanceID]
+#else
+#define INSTANCE_INDEX gl_InstanceID
+#endif
+
+vec3 rotate(vec4 q, vec3 v)
+{
+   return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+void main() 
+{
+   CubeInstance instance = instances[INSTANCE_INDEX];
+   vec3 worldPos = instance.positionScale.xyz + rotate(instance.rotation, pos * instance.positionScale.w);
+
+   gl_Position = viewProj * vec4(worldPos, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,368 @@
+#include <math.h>
+#include <chrono>
+#include <imgui.h>
+#include "apps/05_Texture_Compression/05TextureCompression.h"
+#include "gfx/gfxCmdBuffer.h"
+#include "gfx/OpenGL/gfxGLDevice.h"
+
+IMPLEMENT_APPLICATION(TextureCompressionApplication);
+
+static const struct
+{
+   GFXTextureInternalFormat format;
+   const char* name;
+   int channels;
+} COMPRESSED_FORMATS[COMPRESSED_FORMAT_COUNT] =
+{
+   { GFXTextureInternalFormat::BC1_RGB, "BC1 RGB", 3 },
+   { GFXTextureInternalFormat::BC3_RGBA, "BC3 RGBA", 4 },
+   { GFXTextureInternalFormat::BC4_R, "BC4 R", 1 },
+   { GFXTextureInternalFormat::BC5_RG, "BC5 RG", 2 },
+   { GFXTextureInternalFormat::BC7_RGBA, "BC7 RGBA", 4 },
+   { GFXTextureInternalFormat::ETC2_RGB8, "ETC2 RGB8", 3 },
+   { GFXTextureInternalFormat::ETC2_RGBA8, "ETC2 RGBA8", 4 }
+};
+
+void TextureCompressionApplication::onInit()
+{
+   getWindowSize(windowWidth, windowHeight);
+   setWindowTitle("Texture Compression Application");
+
+   encoderThreadCount = encoder.getThreadCount();
+   selectedTexture = 5;
+   uvScale = 1.0f;
+
+   createSourceImage();
+
+   initGL();
+   encodeAll();
+}
+
+void TextureCompressionApplication::onDestroy()
+{
+   destroyGL();
+}
+
+void TextureCompressionApplication::onUpdate(double dt)
+{
+   render(dt);
+}
+
+void TextureCompressionApplication::onWindowSizeUpdate(int width, int height)
+{
+   windowWidth = width;
+   windowHeight = height;
+}
+
+void TextureCompressionApplication::createSourceImage()
+{
+   // Smooth gradients, hard edges and noise so every format has something to get wrong.
+   sourceImage.resize(TEXTURE_SIZE * TEXTURE_SIZE * 4);
+
+   uint32_t seed = 0x12345678;
+   for (int y = 0; y < TEXTURE_SIZE; y++)
+   {
+      for (int x = 0; x < TEXTURE_SIZE; x++)
+      {
+         float u = (float)x / TEXTURE_SIZE;
+         float v = (float)y / TEXTURE_SIZE;
+
+         seed = seed * 1664525 + 1013904223;
+         int noise = (int)(seed >> 28) - 8;
+
+         bool checker = ((x / 64) + (y / 64)) & 1;
+         float rings = 0.5f + 0.5f * sinf(sqrtf((u - 0.5f) * (u - 0.5f) + (v - 0.5f) * (v - 0.5f)) * 60.0f);
+
+         int r = (int)(u * 255.0f) + noise;
+         int g = (int)(rings * 255.0f);
+         int b = checker ? 220 : (int)(v * 128.0f) + noise;
+         int a = (int)((1.0f - v) * 255.0f);
+
+         uint8_t* texel = &sourceImage[((size_t)y * TEXTURE_SIZE + x) * 4];
+         texel[0] = (uint8_t)glm::clamp(r, 0, 255);
+         texel[1] = (uint8_t)glm::clamp(g, 0, 255);
+         texel[2] = (uint8_t)glm::clamp(b, 0, 255);
+         texel[3] = (uint8_t)glm::clamp(a, 0, 255);
+      }
+   }
+}
+
+void TextureCompressionApplication::initGL()
+{
+   graphicsDevice = new GFXGLDevice();
+   cmdBuffer = new GFXCmdBuffer();
+
+   {
+      GFXTextureStateDesc colorTexDesc = {};
+      colorTexDesc.height = windowHeight;
+      colorTexDesc.width = windowWidth;
+      colorTexDesc.type = GFXTextureType::TEXTURE_2D;
+      colorTexDesc.levels = 1;
+      colorTexDesc.internalFormat = GFXTextureInternalFormat::RGBA8;
+
+      colorRenderPassAttachmentHandle = graphicsDevice->createTexture(colorTexDesc);
+
+      GFXColorRenderPassAttachment colorAttach = {};
+      colorAttach.clearColor[0] = 0.1f;
+      colorAttach.clearColor[1] = 0.1f;
+      colorAttach.clearColor[2] = 0.1f;
+      colorAttach.clearColor[3] = 1.0f;
+      colorAttach.loadAction = GFXLoadAttachmentAction::CLEAR;
+      colorAttach.texture = colorRenderPassAttachmentHandle;
+
+      GFXRenderPassDesc renderPassState;
+      renderPassState.colorAttachmentCount = 1;
+      renderPassState.colorAttachments[0] = std::move(colorAttach);
+      renderPassState.depthAttachmentEnabled = false;
+
+      renderPassHandle = graphicsDevice->createRenderPass(renderPassState);
+   }
+
+   {
+      GFXRasterizerStateDesc rasterState;
+      rasterState.cullMode = GFXCullMode::CULL_NONE;
+      rasterState.windingMode = GFXWindingMode::COUNTER_CLOCKWISE;
+      rasterState.fillMode = GFXFillMode::SOLID;
+      rasterState.enableDynamicPointSize = false;
+
+      rasterizerStateHandle = graphicsDevice->createRasterizerState(rasterState);
+   }
+
+   {
+      GFXDepthStencilStateDesc depthState;
+      depthState.enableDepthTest = false;
+      depthState.enableDepthWrite = false;
+      depthState.depthCompareFunc = GFXCompareFunc::ALWAYS;
+
+      depthStateHandle = graphicsDevice->createDepthStencilState(depthState);
+   }
+
+   {
+      GFXSamplerStateDesc samplerDesc;
+      samplerDesc.minFilterMode = GFXSamplerMinFilterMode::LINEAR_MIP_WEIGHTED;
+      samplerDesc.magFilterMode = GFXSamplerMagFilterMode::LINEAR;
+
+      samplerHandle = graphicsDevice->createSampler(samplerDesc);
+   }
+
+   {
+      GFXTextureStateDesc sourceDesc = {};
+      sourceDesc.type = GFXTextureType::TEXTURE_2D;
+      sourceDesc.internalFormat = GFXTextureInternalFormat::RGBA8;
+      sourceDesc.levels = 0;
+      sourceDesc.width = TEXTURE_SIZE;
+      sourceDesc.height = TEXTURE_SIZE;
+      sourceDesc.data = sourceImage.data();
+      sourceDesc.generateMipmaps = true;
+
+      sourceTexture = graphicsDevice->createTexture(sourceDesc);
+   }
+
+   texturesCreated = false;
+
+   initShader();
+}
+
+void TextureCompressionApplication::initShader()
+{
+   GFXInputLayoutDesc inputLayout;
+   inputLayout.count = 0;
+   inputLayout.descs = nullptr;
+
+   char* vertShader = readShaderFile("apps/05_Texture_Compression/shaders/texture.vert");
+   char* fragShader = readShaderFile("apps/05_Texture_Compression/shaders/texture.frag");
+
+   GFXShaderDesc shaders[2];
+   shaders[0].type = GFXShaderType::VERTEX;
+   shaders[0].code = vertShader;
+   shaders[0].codeLength = strlen(vertShader);
+
+   shaders[1].type = GFXShaderType::FRAGMENT;
+   shaders[1].code = fragShader;
+   shaders[1].codeLength = strlen(fragShader);
+
+   GFXPipelineDesc pipelineDesc;
+   pipelineDesc.primitiveType = GFXPrimitiveType::TRIANGLE_LIST;
+   pipelineDesc.inputLayout = std::move(inputLayout);
+   pipelineDesc.shadersStages = shaders;
+   pipelineDesc.shaderStageCount = 2;
+
+   pipelineHandle = graphicsDevice->createPipeline(pipelineDesc);
+}
+
+void TextureCompressionApplication::encodeAll()
+{
+   deleteTextures();
+   encoder.setThreadCount(encoderThreadCount);
+
+   std::vector<uint8_t> decoded(sourceImage.size());
+
+   for (int i = 0; i < COMPRESSED_FORMAT_COUNT; i++)
+   {
+      EncodeResult& result = results[i];
+      result.format = COMPRESSED_FORMATS[i].format;
+      result.name = COMPRESSED_FORMATS[i].name;
+      result.channels = COMPRESSED_FORMATS[i].channels;
+
+      auto start = std::chrono::high_resolution_clock::now();
+      GFXEncodedTexture encoded = encoder.encodeMipChain(result.format, sourceImage.data(), TEXTURE_SIZE, TEXTURE_SIZE);
+      auto end = std::chrono::high_resolution_clock::now();
+
+      // Every level of the chain counts towards the throughput, not just the top one.
+      size_t pixelCount = 0;
+      for (int32_t level = 0; level < encoded.levels; level++)
+         pixelCount += (size_t)std::max(TEXTURE_SIZE >> level, 1) * std::max(TEXTURE_SIZE >> level, 1);
+
+      result.encodeSeconds = std::chrono::duration<double>(end - start).count();
+      result.megaPixelsPerSecondPerCore = pixelCount / result.encodeSeconds / 1000000.0 / encoder.getThreadCount();
+      result.sizeInBytes = encoded.data.size();
+
+      GFXTextureEncoder::decode(result.format, encoded.data.data(), TEXTURE_SIZE, TEXTURE_SIZE, decoded.data());
+      result.psnr = GFXTextureEncoder::computePSNR(result.format, sourceImage.data(), decoded.data(), TEXTURE_SIZE, TEXTURE_SIZE);
+
+      GFXTextureStateDesc textureDesc = {};
+      textureDesc.type = GFXTextureType::TEXTURE_2D;
+      textureDesc.internalFormat = result.format;
+      textureDesc.levels = encoded.levels;
+      textureDesc.width = encoded.width;
+      textureDesc.height = encoded.height;
+
+      result.texture = graphicsDevice->createTexture(textureDesc);
+
+      for (int32_t level = 0; level < encoded.levels; level++)
+      {
+         GFXTextureUpdateDesc updateDesc;
+         updateDesc.level = level;
+         updateDesc.width = std::max(encoded.width >> level, 1);
+         updateDesc.height = std::max(encoded.height >> level, 1);
+         updateDesc.data = encoded.data.data() + encoded.levelOffsets[level];
+
+         graphicsDevice->updateTexture(result.texture, updateDesc);
+      }
+   }
+
+   texturesCreated = true;
+}
+
+void TextureCompressionApplication::deleteTextures()
+{
+   if (!texturesCreated)
+      return;
+
+   for (int i = 0; i < COMPRESSED_FORMAT_COUNT; i++)
+      graphicsDevice->deleteTexture(results[i].texture);
+
+   texturesCreated = false;
+}
+
+void TextureCompressionApplication::destroyGL()
+{
+   deleteTextures();
+
+   graphicsDevice->deleteStateBlock(depthStateHandle);
+   graphicsDevice->deleteStateBlock(rasterizerStateHandle);
+
+   graphicsDevice->deleteSampler(samplerHandle);
+   graphicsDevice->deleteTexture(sourceTexture);
+   graphicsDevice->deletePipeline(pipelineHandle);
+
+   graphicsDevice->deleteTexture(colorRenderPassAttachmentHandle);
+   graphicsDevice->deleteRenderPass(renderPassHandle);
+
+   delete cmdBuffer;
+   delete graphicsDevice;
+}
+
+void TextureCompressionApplication::render(double dt)
+{
+   TextureHandle texture = sourceTexture;
+   glm::vec4 pushConstants(4.0f, uvScale, 0.0f, 0.0f);
+
+   if (selectedTexture > 0)
+   {
+      texture = results[selectedTexture - 1].texture;
+      pushConstants.x = (float)results[selectedTexture - 1].channels;
+   }
+
+   cmdBuffer->begin();
+
+   cmdBuffer->bindRenderPass(renderPassHandle);
+   cmdBuffer->setViewport(0, 0, windowWidth, windowHeight);
+   cmdBuffer->setScissor(0, 0, windowWidth, windowHeight);
+
+   cmdBuffer->setRasterizerState(rasterizerStateHandle);
+   cmdBuffer->setDepthStencilState(depthStateHandle);
+
+   cmdBuffer->bindPipeline(pipelineHandle);
+   cmdBuffer->bindPushConstants(0, sizeof(glm::vec4), GFXShaderStageBit::FRAGMENT_BIT, &pushConstants);
+   cmdBuffer->bindTexture(0, texture);
+   cmdBuffer->bindSampler(0, samplerHandle);
+
+   cmdBuffer->drawPrimitives(0, 3);
+
+   cmdBuffer->end();
+
+   const GFXCmdBuffer* buffer[1];
+   buffer[0] = cmdBuffer;
+   graphicsDevice->executeCmdBuffers(buffer, 1);
+
+   graphicsDevice->present(renderPassHandle, windowWidth, windowHeight);
+}
+
+void TextureCompressionApplication::onRenderImGUI(double dt)
+{
+   ImGui::NewFrame();
+   ImGui::Begin("Debug Information & Options");
+   ImGui::Text("Frame Rate: %.1f FPS", ImGui::GetIO().Framerate);
+
+   ImGui::Separator();
+   ImGui::Text("%s Driver Information:", graphicsDevice->getApiString());
+   ImGui::Text("   Renderer: %s", graphicsDevice->getGFXDeviceRendererDesc());
+   ImGui::Text("   Vendor: %s", graphicsDevice->getGFXDeviceVendorDesc());
+   ImGui::Text("   Version: %s", graphicsDevice->getApiVersionString());
+
+   ImGui::Separator();
+   ImGui::RadioButton("Uncompressed RGBA8", &selectedTexture, 0);
+   for (int i = 0; i < COMPRESSED_FORMAT_COUNT; i++)
+      ImGui::RadioButton(results[i].name, &selectedTexture, i + 1);
+   ImGui::SliderFloat("UV Scale", &uvScale, 0.1f, 8.0f);
+
+   ImGui::Separator();
+   ImGui::Text("%dx%d source, full mip chain:", TEXTURE_SIZE, TEXTURE_SIZE);
+   if (ImGui::BeginTable("Results", 4, ImGuiTableFlags_Borders))
+   {
+      ImGui::TableSetupColumn("Format");
+      ImGui::TableSetupColumn("PSNR");
+      ImGui::TableSetupColumn("MPix/s/core");
+      ImGui::TableSetupColumn("Size");
+      ImGui::TableHeadersRow();
+
+      for (int i = 0; i < COMPRESSED_FORMAT_COUNT; i++)
+      {
+         ImGui::TableNextRow();
+         ImGui::TableNextColumn();
+         ImGui::Text("%s", results[i].name);
+         ImGui::TableNextColumn();
+         ImGui::Text("%.2f dB", results[i].psnr);
+         ImGui::TableNextColumn();
+         ImGui::Text("%.1f", results[i].megaPixelsPerSecondPerCore);
+         ImGui::TableNextColumn();
+         ImGui::Text("%zu KB", results[i].sizeInBytes / 1024);
+      }
+
+      ImGui::EndTable();
+   }
+
+   ImGui::Separator();
+   ImGui::SliderInt("Encoder Threads", &encoderThreadCount, 1, (int)JobSystem::getHardwareThreadCount());
+   if (ImGui::Button("Re-encode"))
+      encodeAll();
+
+   ImGui::Separator();
+   renderGFXFrameStats(graphicsDevice);
+   renderProfilerStats();
+   renderGFXMemoryStats(graphicsDevice);
+
+   ImGui::End();
+   ImGui::Render();
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include "app.h"
+#include "gfx/gfxDevice.h"
+#include "gfx/gfxTextureEncoder.h"
+
+#define TEXTURE_SIZE 1024
+#define COMPRESSED_FORMAT_COUNT 7
+
+struct EncodeResult
+{
+   GFXTextureInternalFormat format;
+   const char* name;
+   int channels;
+
+   double encodeSeconds;
+   double megaPixelsPerSecondPerCore;
+   double psnr;
+   size_t sizeInBytes;
+
+   TextureHandle texture;
+};
+
+class TextureCompressionApplication : public Application
+{
+public:
+   DECLARE_APPLICATION(TextureCompressionApplication);
+
+   virtual void onWindowSizeUpdate(int width, int height) override;
+
+   virtual void onInit() override;
+   virtual void onDestroy() override;
+   virtual void onUpdate(double dt) override;
+   virtual void onRenderImGUI(double dt) override;
+   virtual GFXDevice* getGraphicsDevice() const override { return graphicsDevice; }
+
+   void initGL();
+   void initShader();
+   void destroyGL();
+   void render(double dt);
+   void createSourceImage();
+   void encodeAll();
+   void deleteTextures();
+
+private:
+   int windowWidth;
+   int windowHeight;
+
+   std::vector<uint8_t> sourceImage;
+   GFXTextureEncoder encoder;
+   int encoderThreadCount;
+
+   EncodeResult results[COMPRESSED_FORMAT_COUNT];
+   bool texturesCreated;
+   TextureHandle sourceTexture;
+
+   // 0 shows the uncompressed source, otherwise results[selectedTexture - 1]
+   int selectedTexture;
+   float uvScale;
+
+   GFXDevice* graphicsDevice;
+   GFXCmdBuffer* cmdBuffer;
+
+   StateBlockHandle depthStateHandle;
+   StateBlockHandle rasterizerStateHandle;
+
+   RenderPassHandle renderPassHandle;
+   TextureHandle colorRenderPassAttachmentHandle;
+
+   PipelineHandle pipelineHandle;
+   SamplerHandle samplerHandle;
+};
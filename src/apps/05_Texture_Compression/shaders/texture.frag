@@ -0,0 +1,21 @@
+in vec2 fUV;
+layout(location = 0) out vec4 color;
+
+layout(binding = 0) uniform sampler2D image;
+
+// x: channel count of the format, y: uv scale
+layout(location = 0) uniform vec4 pushConstants[1];
+
+void main()
+{
+   vec4 texel = texture(image, fUV * pushConstants[0].y);
+
+   if (pushConstants[0].x == 1.0)
+      texel = vec4(texel.rrr, 1.0);
+   else if (pushConstants[0].x == 2.0)
+      texel = vec4(texel.rg, 0.0, 1.0);
+   else if (pushConstants[0].x == 3.0)
+      texel.a = 1.0;
+
+   color = texel;
+}
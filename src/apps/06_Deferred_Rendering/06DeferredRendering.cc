@@ -0,0 +1,530 @@
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+#include <imgui.h>
+#include "apps/06_Deferred_Rendering/06DeferredRendering.h"
+#include "core/cube.h"
+#include "gfx/gfxCmdBuffer.h"
+#include "gfx/OpenGL/gfxGLDevice.h"
+
+IMPLEMENT_APPLICATION(DeferredRenderingApplication);
+
+const float VIEW_DISTANCE = 500.0f;
+const float AMBIENT = 0.3f;
+
+const char* GBUFFER_PASS_NAME = "GBuffer";
+const char* LIGHTING_PASS_NAME = "Lighting";
+
+void DeferredRenderingApplication::onInit()
+{
+   camera.setPosition(glm::vec3(9.0f, 25.0f, 9.0f));
+   camera.setYawPitch(-2.34f, -1.20f);
+   updatePerspectiveMatrix();
+
+   getWindowSize(windowWidth, windowHeight);
+   setWindowTitle("Deferred Rendering Application");
+
+   lightCount = 0;
+
+   createCubeData(CUBE_COUNT);
+
+   initGL();
+}
+
+void DeferredRenderingApplication::onDestroy()
+{
+   destroyGL();
+}
+
+void DeferredRenderingApplication::onUpdate(double dt)
+{
+   updateCamera(dt);
+   render(dt);
+}
+
+void DeferredRenderingApplication::onWindowSizeUpdate(int width, int height)
+{
+   windowWidth = width;
+   windowHeight = height;
+}
+
+void DeferredRenderingApplication::updateCamera(double dt)
+{
+   Move move = {};
+   camera.update(dt, move);
+   updatePerspectiveMatrix();
+}
+
+void DeferredRenderingApplication::updatePerspectiveMatrix()
+{
+   camera.setProjectionMatrix(glm::perspective((float)glm::radians(110.0), getAspectRatio(), 0.01f, VIEW_DISTANCE));
+
+   camera.getMatrices(cameraData.projMatrix, cameraData.viewMatrix);
+}
+
+void DeferredRenderingApplication::initGL()
+{
+   graphicsDevice = new GFXGLDevice();
+   cmdBuffer = new GFXCmdBuffer();
+   frameGraph = new GFXFrameGraph(graphicsDevice);
+
+   {
+      GFXRasterizerStateDesc rasterState;
+      rasterState.cullMode = GFXCullMode::CULL_FRONT;
+      rasterState.windingMode = GFXWindingMode::CLOCKWISE;
+      rasterState.fillMode = GFXFillMode::SOLID;
+      rasterState.enableDynamicPointSize = false;
+
+      rasterizerStateHandle = graphicsDevice->createRasterizerState(rasterState);
+   }
+
+   {
+      // The fullscreen ambient triangle is drawn without culling. Light volumes only draw their
+      // inside faces, so they still cover the screen with the camera inside them.
+      GFXRasterizerStateDesc rasterState;
+      rasterState.cullMode = GFXCullMode::CULL_NONE;
+      rasterState.windingMode = GFXWindingMode::CLOCKWISE;
+      rasterState.fillMode = GFXFillMode::SOLID;
+      rasterState.enableDynamicPointSize = false;
+
+      fullscreenRasterizerStateHandle = graphicsDevice->createRasterizerState(rasterState);
+
+      rasterState.cullMode = GFXCullMode::CULL_BACK;
+      lightVolumeRasterizerStateHandle = graphicsDevice->createRasterizerState(rasterState);
+   }
+
+   {
+      GFXDepthStencilStateDesc depthState;
+      depthState.enableDepthTest = true;
+      depthState.enableDepthWrite = true;
+      depthState.depthCompareFunc = GFXCompareFunc::LESS;
+
+      depthStateHandle = graphicsDevice->createDepthStencilState(depthState);
+   }
+
+   {
+      // The lighting pass has no depth attachment, it reads the G-buffer depth instead.
+      GFXDepthStencilStateDesc depthState;
+      depthState.enableDepthTest = false;
+      depthState.enableDepthWrite = false;
+      depthState.depthCompareFunc = GFXCompareFunc::ALWAYS;
+
+      noDepthStateHandle = graphicsDevice->createDepthStencilState(depthState);
+   }
+
+   {
+      GFXBlendStateDesc blendState;
+      opaqueBlendStateHandle = graphicsDevice->createBlendState(blendState);
+
+      blendState.enableBlending = true;
+      blendState.dstColorFactor = GFXBlendFactor::ONE;
+      blendState.dstAlphaFactor = GFXBlendFactor::ONE;
+      additiveBlendStateHandle = graphicsDevice->createBlendState(blendState);
+   }
+
+   {
+      GFXSamplerStateDesc samplerDesc;
+      samplerDesc.minFilterMode = GFXSamplerMinFilterMode::NEAREST;
+      samplerDesc.magFilterMode = GFXSamplerMagFilterMode::NEAREST;
+      samplerDesc.wrapS = GFXSamplerWrapMode::CLAMP_TO_EDGE;
+      samplerDesc.wrapT = GFXSamplerWrapMode::CLAMP_TO_EDGE;
+      samplerDesc.wrapR = GFXSamplerWrapMode::CLAMP_TO_EDGE;
+
+      pointSamplerHandle = graphicsDevice->createSampler(samplerDesc);
+   }
+
+   {
+      GFXBufferDesc cubeBuffer;
+      cubeBuffer.type = GFXBufferType::VERTEX_BUFFER;
+      cubeBuffer.usage = GFXBufferUsageEnum::STATIC_GPU_ONLY;
+      cubeBuffer.sizeInBytes = sizeof(cubeVertsBuffer);
+      cubeBuffer.data = (void*)cubeVertsBuffer;
+
+      vertexBufferHandle = graphicsDevice->createBuffer(cubeBuffer);
+   }
+
+   {
+      GFXBufferDesc cubeBuffer;
+      cubeBuffer.type = GFXBufferType::INDEX_BUFFER;
+      cubeBuffer.usage = GFXBufferUsageEnum::STATIC_GPU_ONLY;
+      cubeBuffer.sizeInBytes = sizeof(cubeIndices);
+      cubeBuffer.data = (void*)cubeIndices;
+
+      indexBufferHandle = graphicsDevice->createBuffer(cubeBuffer);
+   }
+
+   {
+      GFXBufferDesc lightBuffer;
+      lightBuffer.type = GFXBufferType::VERTEX_BUFFER;
+      lightBuffer.usage = GFXBufferUsageEnum::DYNAMIC_CPU_TO_GPU;
+      lightBuffer.sizeInBytes = SCENE_LIGHT_COUNT_MAX * sizeof(SceneLight);
+      lightBuffer.data = nullptr;
+
+      lightBufferHandle = graphicsDevice->createBuffer(lightBuffer);
+   }
+
+   initShaders();
+   initUBOs();
+   initCubeBuffer();
+   createLights(LIGHT_COUNT);
+}
+
+void DeferredRenderingApplication::initUBOs()
+{
+   {
+      GFXBufferDesc cameraBufferDesc;
+      cameraBufferDesc.type = GFXBufferType::CONSTANT_BUFFER;
+      cameraBufferDesc.usage = GFXBufferUsageEnum::DYNAMIC_CPU_TO_GPU;
+      cameraBufferDesc.sizeInBytes = sizeof(CameraUbo);
+      cameraBufferDesc.data = nullptr;
+
+      cameraBufferHandle = graphicsDevice->createBuffer(cameraBufferDesc);
+   }
+}
+
+void DeferredRenderingApplication::initCubeBuffer()
+{
+   // Never culled, every cube is packed once per count.
+   std::vector<PackedInstance> instances(cubeCount);
+   packInstances(cubeMatrices.data(), (uint32_t)cubeCount, instances.data());
+
+   GFXBufferDesc cubeBufferDesc;
+   cubeBufferDesc.type = GFXBufferType::VERTEX_BUFFER;
+   cubeBufferDesc.usage = GFXBufferUsageEnum::STATIC_GPU_ONLY;
+   cubeBufferDesc.sizeInBytes = cubeCount * sizeof(PackedInstance);
+   cubeBufferDesc.data = instances.data();
+
+   cubeBufferHandle = graphicsDevice->createBuffer(cubeBufferDesc);
+}
+
+void DeferredRenderingApplication::createLights(int count)
+{
+   count = std::min(std::max(count, 0), SCENE_LIGHT_COUNT_MAX);
+   lightCount = count;
+
+   lights.resize(count);
+   createSceneLights(count, lights.data());
+
+   if (count > 0)
+   {
+      char* pData = (char*)graphicsDevice->mapBuffer(lightBufferHandle, 0, count * sizeof(SceneLight));
+      memcpy(pData, lights.data(), count * sizeof(SceneLight));
+      graphicsDevice->unmapBuffer(lightBufferHandle);
+   }
+}
+
+void DeferredRenderingApplication::initShaders()
+{
+   {
+      // Cube vertices, then the packed instance transform per instance.
+      GFXInputLayoutElementDesc inputLayoutDescs[4];
+      inputLayoutDescs[0].slot = 0;
+      inputLayoutDescs[0].count = 3;
+      inputLayoutDescs[0].type = GFXInputLayoutFormat::FLOAT;
+      inputLayoutDescs[0].divisor = GFXInputLayoutDivisor::PER_VERTEX;
+      inputLayoutDescs[0].offset = 0;
+      inputLayoutDescs[0].bufferBinding = 0;
+
+      inputLayoutDescs[1].slot = 1;
+      inputLayoutDescs[1].count = 3;
+      inputLayoutDescs[1].type = GFXInputLayoutFormat::FLOAT;
+      inputLayoutDescs[1].divisor = GFXInputLayoutDivisor::PER_VERTEX;
+      inputLayoutDescs[1].offset = 12;
+      inputLayoutDescs[1].bufferBinding = 0;
+
+      inputLayoutDescs[2].slot = 2;
+      inputLayoutDescs[2].count = 4;
+      inputLayoutDescs[2].type = GFXInputLayoutFormat::FLOAT;
+      inputLayoutDescs[2].divisor = GFXInputLayoutDivisor::PER_INSTANCE;
+      inputLayoutDescs[2].offset = offsetof(PackedInstance, positionScale);
+      inputLayoutDescs[2].bufferBinding = 1;
+
+      inputLayoutDescs[3].slot = 3;
+      inputLayoutDescs[3].count = 4;
+      inputLayoutDescs[3].type = GFXInputLayoutFormat::FLOAT;
+      inputLayoutDescs[3].divisor = GFXInputLayoutDivisor::PER_INSTANCE;
+      inputLayoutDescs[3].offset = offsetof(PackedInstance, rotation);
+      inputLayoutDescs[3].bufferBinding = 1;
+
+      GFXInputLayoutDesc inputLayout;
+      inputLayout.count = 4;
+      inputLayout.descs = inputLayoutDescs;
+
+      char* vertShader = readShaderFile("apps/06_Deferred_Rendering/shaders/gbuffer.vert");
+      char* fragShader = readShaderFile("apps/06_Deferred_Rendering/shaders/gbuffer.frag");
+
+      GFXShaderDesc shaders[2];
+      shaders[0].type = GFXShaderType::VERTEX;
+      shaders[0].code = vertShader;
+      shaders[0].codeLength = strlen(vertShader);
+
+      shaders[1].type = GFXShaderType::FRAGMENT;
+      shaders[1].code = fragShader;
+      shaders[1].codeLength = strlen(fragShader);
+
+      GFXPipelineDesc pipelineDesc;
+      pipelineDesc.primitiveType = GFXPrimitiveType::TRIANGLE_LIST;
+      pipelineDesc.inputLayout = std::move(inputLayout);
+      pipelineDesc.shadersStages = shaders;
+      pipelineDesc.shaderStageCount = 2;
+
+      gbufferPipelineHandle = graphicsDevice->createPipeline(pipelineDesc);
+   }
+
+   {
+      GFXInputLayoutDesc inputLayout;
+      inputLayout.count = 0;
+      inputLayout.descs = nullptr;
+
+      char* vertShader = readShaderFile("apps/06_Deferred_Rendering/shaders/fullscreen.vert");
+      char* fragShader = readShaderFile("apps/06_Deferred_Rendering/shaders/ambient.frag");
+
+      GFXShaderDesc shaders[2];
+      shaders[0].type = GFXShaderType::VERTEX;
+      shaders[0].code = vertShader;
+      shaders[0].codeLength = strlen(vertShader);
+
+      shaders[1].type = GFXShaderType::FRAGMENT;
+      shaders[1].code = fragShader;
+      shaders[1].codeLength = strlen(fragShader);
+
+      GFXPipelineDesc pipelineDesc;
+      pipelineDesc.primitiveType = GFXPrimitiveType::TRIANGLE_LIST;
+      pipelineDesc.inputLayout = std::move(inputLayout);
+      pipelineDesc.shadersStages = shaders;
+      pipelineDesc.shaderStageCount = 2;
+
+      ambientPipelineHandle = graphicsDevice->createPipeline(pipelineDesc);
+   }
+
+   {
+      // Cube corners from the cube vertex buffer, light position and color per instance.
+      GFXInputLayoutElementDesc inputLayoutDescs[3];
+      inputLayoutDescs[0].slot = 0;
+      inputLayoutDescs[0].count = 3;
+      inputLayoutDescs[0].type = GFXInputLayoutFormat::FLOAT;
+      inputLayoutDescs[0].divisor = GFXInputLayoutDivisor::PER_VERTEX;
+      inputLayoutDescs[0].offset = 0;
+      inputLayoutDescs[0].bufferBinding = 0;
+
+      inputLayoutDescs[1].slot = 1;
+      inputLayoutDescs[1].count = 4;
+      inputLayoutDescs[1].type = GFXInputLayoutFormat::FLOAT;
+      inputLayoutDescs[1].divisor = GFXInputLayoutDivisor::PER_INSTANCE;
+      inputLayoutDescs[1].offset = 0;
+      inputLayoutDescs[1].bufferBinding = 1;
+
+      inputLayoutDescs[2].slot = 2;
+      inputLayoutDescs[2].count = 4;
+      inputLayoutDescs[2].type = GFXInputLayoutFormat::FLOAT;
+      inputLayoutDescs[2].divisor = GFXInputLayoutDivisor::PER_INSTANCE;
+      inputLayoutDescs[2].offset = 16;
+      inputLayoutDescs[2].bufferBinding = 1;
+
+      GFXInputLayoutDesc inputLayout;
+      inputLayout.count = 3;
+      inputLayout.descs = inputLayoutDescs;
+
+      char* vertShader = readShaderFile("apps/06_Deferred_Rendering/shaders/light_volume.vert");
+      char* fragShader = readShaderFile("apps/06_Deferred_Rendering/shaders/light_volume.frag");
+
+      GFXShaderDesc shaders[2];
+      shaders[0].type = GFXShaderType::VERTEX;
+      shaders[0].code = vertShader;
+      shaders[0].codeLength = strlen(vertShader);
+
+      shaders[1].type = GFXShaderType::FRAGMENT;
+      shaders[1].code = fragShader;
+      shaders[1].codeLength = strlen(fragShader);
+
+      GFXPipelineDesc pipelineDesc;
+      pipelineDesc.primitiveType = GFXPrimitiveType::TRIANGLE_LIST;
+      pipelineDesc.inputLayout = std::move(inputLayout);
+      pipelineDesc.shadersStages = shaders;
+      pipelineDesc.shaderStageCount = 2;
+
+      lightVolumePipelineHandle = graphicsDevice->createPipeline(pipelineDesc);
+   }
+}
+
+void DeferredRenderingApplication::destroyGL()
+{
+   graphicsDevice->deleteStateBlock(depthStateHandle);
+   graphicsDevice->deleteStateBlock(noDepthStateHandle);
+   graphicsDevice->deleteStateBlock(rasterizerStateHandle);
+   graphicsDevice->deleteStateBlock(fullscreenRasterizerStateHandle);
+   graphicsDevice->deleteStateBlock(lightVolumeRasterizerStateHandle);
+   graphicsDevice->deleteStateBlock(opaqueBlendStateHandle);
+   graphicsDevice->deleteStateBlock(additiveBlendStateHandle);
+   graphicsDevice->deleteSampler(pointSamplerHandle);
+
+   graphicsDevice->deleteBuffer(cameraBufferHandle);
+   graphicsDevice->deleteBuffer(cubeBufferHandle);
+   graphicsDevice->deleteBuffer(lightBufferHandle);
+   graphicsDevice->deleteBuffer(vertexBufferHandle);
+   graphicsDevice->deleteBuffer(indexBufferHandle);
+   graphicsDevice->deletePipeline(gbufferPipelineHandle);
+   graphicsDevice->deletePipeline(ambientPipelineHandle);
+   graphicsDevice->deletePipeline(lightVolumePipelineHandle);
+
+   delete frameGraph;
+   delete cmdBuffer;
+   delete graphicsDevice;
+}
+
+void DeferredRenderingApplication::render(double dt)
+{
+   char* pData = (char*)graphicsDevice->mapBuffer(cameraBufferHandle, 0, sizeof(CameraUbo));
+   memcpy(pData, &cameraData, sizeof(CameraUbo));
+   graphicsDevice->unmapBuffer(cameraBufferHandle);
+
+   frameGraph->reset();
+
+   // 12 bytes per pixel: albedo, octahedral normal and depth, positions come from the depth.
+   FrameGraphResource albedo;
+   FrameGraphResource normal;
+   FrameGraphResource depth;
+   frameGraph->addPass(GBUFFER_PASS_NAME, [&](FrameGraphBuilder& builder)
+   {
+      const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+      FrameGraphTextureDesc albedoDesc = { GFXTextureInternalFormat::RGBA8, windowWidth, windowHeight };
+      FrameGraphTextureDesc normalDesc = { GFXTextureInternalFormat::RG16, windowWidth, windowHeight };
+      FrameGraphTextureDesc depthDesc = { GFXTextureInternalFormat::DEPTH_32F, windowWidth, windowHeight };
+
+      albedo = builder.writeColor(0, builder.createTexture("Albedo", albedoDesc), GFXLoadAttachmentAction::CLEAR, clearColor);
+      normal = builder.writeColor(1, builder.createTexture("Normal", normalDesc), GFXLoadAttachmentAction::CLEAR, clearColor);
+      depth = builder.writeDepth(builder.createTexture("Depth", depthDesc), GFXLoadAttachmentAction::CLEAR, 1.0f);
+   },
+   [&](GFXCmdBuffer* cmd, const GFXFrameGraph& graph)
+   {
+      cmd->setRasterizerState(rasterizerStateHandle);
+      cmd->setDepthStencilState(depthStateHandle);
+      cmd->setBlendState(opaqueBlendStateHandle);
+
+      const BufferHandle buffers[2] = { vertexBufferHandle, cubeBufferHandle };
+      const uint32_t strides[2] = { sizeof(float) * 6, sizeof(PackedInstance) };
+      const uint32_t offsets[2] = { 0, 0 };
+
+      cmd->bindPipeline(gbufferPipelineHandle);
+      cmd->bindConstantBuffer(0, cameraBufferHandle, 0, sizeof(CameraUbo));
+
+      cmd->bindVertexBuffers(0, 2, buffers, strides, offsets);
+      cmd->bindIndexBuffer(indexBufferHandle, GFXIndexBufferType::BITS_16, 0);
+
+      cmd->drawIndexedPrimitivesInstanced(36, 0, cubeCount);
+   });
+
+   FrameGraphResource color;
+   frameGraph->addPass(LIGHTING_PASS_NAME, [&](FrameGraphBuilder& builder)
+   {
+      const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+      FrameGraphTextureDesc colorDesc = { GFXTextureInternalFormat::RGBA8, windowWidth, windowHeight };
+
+      builder.read(albedo);
+      builder.read(normal);
+      builder.read(depth);
+      color = builder.writeColor(0, builder.createTexture("Color", colorDesc), GFXLoadAttachmentAction::CLEAR, clearColor);
+   },
+   [&](GFXCmdBuffer* cmd, const GFXFrameGraph& graph)
+   {
+      TextureHandle gbuffer[3] = { graph.getTexture(albedo), graph.getTexture(normal), graph.getTexture(depth) };
+      SamplerHandle samplers[3] = { pointSamplerHandle, pointSamplerHandle, pointSamplerHandle };
+      const glm::vec4 pushConstants(1.0f / windowWidth, 1.0f / windowHeight, AMBIENT, 0.0f);
+
+      cmd->setDepthStencilState(noDepthStateHandle);
+      cmd->setBlendState(additiveBlendStateHandle);
+      cmd->bindTextures(0, 3, gbuffer);
+      cmd->bindSamplers(0, 3, samplers);
+      cmd->bindConstantBuffer(0, cameraBufferHandle, 0, sizeof(CameraUbo));
+
+      cmd->setRasterizerState(fullscreenRasterizerStateHandle);
+      cmd->bindPipeline(ambientPipelineHandle);
+      cmd->bindPushConstants(0, sizeof(glm::vec4), GFXShaderStageBit::FRAGMENT_BIT, &pushConstants);
+      cmd->drawPrimitives(0, 3);
+
+      if (lightCount == 0)
+         return;
+
+      // One box per light, each pixel it covers adds that light if the surface is in range.
+      const BufferHandle buffers[2] = { vertexBufferHandle, lightBufferHandle };
+      const uint32_t strides[2] = { sizeof(float) * 6, sizeof(SceneLight) };
+      const uint32_t offsets[2] = { 0, 0 };
+
+      cmd->setRasterizerState(lightVolumeRasterizerStateHandle);
+      cmd->bindPipeline(lightVolumePipelineHandle);
+      cmd->bindPushConstants(0, sizeof(glm::vec4), GFXShaderStageBit::FRAGMENT_BIT, &pushConstants);
+      cmd->bindVertexBuffers(0, 2, buffers, strides, offsets);
+      cmd->bindIndexBuffer(indexBufferHandle, GFXIndexBufferType::BITS_16, 0);
+      cmd->drawIndexedPrimitivesInstanced(36, 0, lightCount);
+   });
+
+   frameGraph->markOutput(color);
+   frameGraph->compile();
+
+   cmdBuffer->begin();
+   cmdBuffer->beginTimer("Frame");
+   frameGraph->execute(cmdBuffer);
+   cmdBuffer->endTimer();
+   cmdBuffer->end();
+
+   const GFXCmdBuffer* buffer[1];
+   buffer[0] = cmdBuffer;
+
+   graphicsDevice->executeCmdBuffers(buffer, 1);
+
+   graphicsDevice->present(frameGraph->getRenderPass(color), windowWidth, windowHeight);
+}
+
+void DeferredRenderingApplication::onRenderImGUI(double dt)
+{
+   ImGui::NewFrame();
+   ImGui::Begin("Debug Information & Options");
+   ImGui::Text("Frame Rate: %.1f FPS", ImGui::GetIO().Framerate);
+
+   ImGui::Separator();
+   ImGui::Text("%s Driver Information:", graphicsDevice->getApiString());
+   ImGui::Text("   Renderer: %s", graphicsDevice->getGFXDeviceRendererDesc());
+   ImGui::Text("   Vendor: %s", graphicsDevice->getGFXDeviceVendorDesc());
+   ImGui::Text("   Version: %s", graphicsDevice->getApiVersionString());
+
+   ImGui::Separator();
+   const FrameGraphStats& stats = frameGraph->getStats();
+   ImGui::Text("Frame Graph:");
+   ImGui::Text("   Passes: %u (%u culled)", stats.passCount, stats.culledPassCount);
+   ImGui::Text("   Render Targets: %u transient, %u allocated", stats.transientTextureCount, stats.physicalTextureCount);
+   ImGui::Text("   Peak Render Target Memory: %.2f MB", stats.peakRenderTargetBytes / (1024.0 * 1024.0));
+
+   ImGui::Separator();
+   ImGui::Text("G-Buffer: RGBA8 albedo, RG16 octahedral normal, 32 bit float depth");
+   ImGui::Text("G-Buffer Pass GPU Time: %.2f ms", graphicsDevice->getGpuTimerMs(GBUFFER_PASS_NAME));
+   ImGui::Text("Lighting Pass GPU Time: %.2f ms", graphicsDevice->getGpuTimerMs(LIGHTING_PASS_NAME));
+
+   int cubes = cubeCount;
+   if (ImGui::SliderInt("Cube Count", &cubes, 1, SCENE_CUBE_COUNT_MAX, "%d", ImGuiSliderFlags_Logarithmic))
+   {
+      graphicsDevice->deleteBuffer(cubeBufferHandle);
+      createCubeData(cubes);
+      initCubeBuffer();
+   }
+
+   int count = lightCount;
+   if (ImGui::SliderInt("Light Count", &count, 0, SCENE_LIGHT_COUNT_MAX, "%d", ImGuiSliderFlags_Logarithmic))
+      createLights(count);
+
+   ImGui::Separator();
+   renderGFXFrameStats(graphicsDevice);
+   renderProfilerStats();
+   renderGFXMemoryStats(graphicsDevice);
+
+   ImGui::End();
+   ImGui::Render();
+}
+
+void DeferredRenderingApplication::createCubeData(int count)
+{
+   cubeCount = std::min(std::max(count, 1), SCENE_CUBE_COUNT_MAX);
+   cubeMatrices.resize(cubeCount);
+   createSceneCubes(cubeCount, cubeMatrices.data());
+}
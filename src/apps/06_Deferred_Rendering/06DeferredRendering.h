@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+#include "app.h"
+#include "core/camera.h"
+#include "core/cubeScene.h"
+#include "core/instancePacking.h"
+#include "gfx/gfxDevice.h"
+#include "gfx/gfxFrameGraph.h"
+
+struct CameraUbo
+{
+   glm::mat4 projMatrix;
+   glm::mat4 viewMatrix;
+};
+
+// Starting counts, the same as ForwardRenderingApplication. Cubes and lights are per instance
+// vertex data, any count up to SCENE_CUBE_COUNT_MAX and SCENE_LIGHT_COUNT_MAX fits.
+#define CUBE_COUNT 512
+#define LIGHT_COUNT 1024
+
+class DeferredRenderingApplication : public Application
+{
+public:
+   DECLARE_APPLICATION(DeferredRenderingApplication);
+
+   virtual void onWindowSizeUpdate(int width, int height) override;
+
+   virtual void onInit() override;
+   virtual void onDestroy() override;
+   virtual void onUpdate(double dt) override;
+   virtual void onRenderImGUI(double dt) override;
+   virtual GFXDevice* getGraphicsDevice() const override { return graphicsDevice; }
+
+   void updateCamera(double dt);
+   void updatePerspectiveMatrix();
+   void initGL();
+   void initUBOs();
+   void initCubeBuffer();
+   void initShaders();
+   void destroyGL();
+   void render(double dt);
+   void createCubeData(int count);
+   void createLights(int count);
+
+private:
+   Camera camera;
+
+   CameraUbo cameraData;
+
+   int cubeCount;
+   std::vector<glm::mat4> cubeMatrices;
+
+   int lightCount;
+   std::vector<SceneLight> lights;
+
+   int windowWidth;
+   int windowHeight;
+
+   GFXDevice* graphicsDevice;
+   GFXCmdBuffer* cmdBuffer;
+   GFXFrameGraph* frameGraph;
+
+   StateBlockHandle depthStateHandle;
+   StateBlockHandle noDepthStateHandle;
+   StateBlockHandle rasterizerStateHandle;
+   StateBlockHandle fullscreenRasterizerStateHandle;
+   StateBlockHandle lightVolumeRasterizerStateHandle;
+   StateBlockHandle opaqueBlendStateHandle;
+   StateBlockHandle additiveBlendStateHandle;
+   SamplerHandle pointSamplerHandle;
+
+   PipelineHandle gbufferPipelineHandle;
+   PipelineHandle ambientPipelineHandle;
+   PipelineHandle lightVolumePipelineHandle;
+
+   BufferHandle cameraBufferHandle;
+   BufferHandle cubeBufferHandle;
+   BufferHandle lightBufferHandle;
+   BufferHandle vertexBufferHandle;
+   BufferHandle indexBufferHandle;
+};
@@ -0,0 +1,16 @@
+layout(location = 0) out vec4 color;
+
+layout(binding = 0) uniform sampler2D albedoTexture;
+layout(binding = 2) uniform sampler2D depthTexture;
+
+// x, y: one over the target size, z: ambient light
+layout(location = 0) uniform vec4 pushConstants[1];
+
+void main()
+{
+   ivec2 coord = ivec2(gl_FragCoord.xy);
+   if (texelFetch(depthTexture, coord, 0).r == 1.0)
+      discard;
+
+   color = vec4(texelFetch(albedoTexture, coord, 0).rgb * pushConstants[0].z, 1.0);
+}
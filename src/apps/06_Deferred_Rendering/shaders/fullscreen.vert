@@ -0,0 +1,6 @@
+void main()
+{
+   // Fullscreen triangle generated from the vertex id, no vertex buffer needed.
+   vec2 uv = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+   gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,24 @@
+in vec3 fNORMAL;
+
+layout(location = 0) out vec4 albedo;
+layout(location = 1) out vec2 normal;
+
+// Octahedral mapping: the unit sphere folded onto a square, two 16 bit channels keep normals
+// within a fraction of a degree.
+vec2 signNotZero(vec2 v)
+{
+   return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 encodeOctahedral(vec3 n)
+{
+   n /= abs(n.x) + abs(n.y) + abs(n.z);
+   vec2 e = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signNotZero(n.xy);
+   return e * 0.5 + 0.5;
+}
+
+void main() 
+{
+   albedo = vec4(1.0);
+   normal = encodeOctahedral(normalize(fNORMAL));
+}
@@ -0,0 +1,31 @@
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 normal;
+
+// PackedInstance: translation and uniform scale, then a unit quaternion. For rotation and
+// uniform scale the rotation is also the normal matrix.
+layout(location = 2) in vec4 instancePositionScale;
+layout(location = 3) in vec4 instanceRotation;
+
+out vec3 fNORMAL;
+
+layout(std140, binding = 0) uniform CameraBuffer 
+{
+   mat4 proj;
+   mat4 view;
+};
+
+vec3 rotate(vec4 q, vec3 v)
+{
+   return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+void main() 
+{
+   vec3 worldPos = instancePositionScale.xyz + rotate(instanceRotation, pos * instancePositionScale.w);
+
+   // Lighting happens in view space, positions come back from depth in the same space. The view
+   // matrix is rigid, so it transforms normals as is.
+   fNORMAL = mat3(view) * rotate(instanceRotation, normal);
+
+   gl_Position = proj * view * vec4(worldPos, 1.0);
+}
@@ -0,0 +1,63 @@
+flat in vec4 fLIGHT_POSITION;
+flat in vec3 fLIGHT_COLOR;
+
+layout(location = 0) out vec4 color;
+
+layout(binding = 0) uniform sampler2D albedoTexture;
+layout(binding = 1) uniform sampler2D normalTexture;
+layout(binding = 2) uniform sampler2D depthTexture;
+
+layout(std140, binding = 0) uniform CameraBuffer 
+{
+   mat4 proj;
+   mat4 view;
+};
+
+// x, y: one over the target size, z: ambient light
+layout(location = 0) uniform vec4 pushConstants[1];
+
+vec2 signNotZero(vec2 v)
+{
+   return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec3 decodeOctahedral(vec2 e)
+{
+   e = e * 2.0 - 1.0;
+   vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+   if (n.z < 0.0)
+      n.xy = (1.0 - abs(n.yx)) * signNotZero(n.xy);
+   return normalize(n);
+}
+
+// View space position from the depth buffer, using only the perspective terms of proj.
+vec3 getViewPosition(float depth)
+{
+   vec2 ndc = gl_FragCoord.xy * pushConstants[0].xy * 2.0 - 1.0;
+   float viewZ = -proj[3][2] / (depth * 2.0 - 1.0 + proj[2][2]);
+   return vec3(ndc.x * -viewZ / proj[0][0], ndc.y * -viewZ / proj[1][1], viewZ);
+}
+
+void main() 
+{
+   ivec2 coord = ivec2(gl_FragCoord.xy);
+   float depth = texelFetch(depthTexture, coord, 0).r;
+   if (depth == 1.0)
+      discard;
+
+   vec3 lightVec = fLIGHT_POSITION.xyz - getViewPosition(depth);
+   float lightLen = length(lightVec);
+   float radius = fLIGHT_POSITION.w;
+   if (lightLen >= radius)
+      discard;
+
+   vec3 normal = decodeOctahedral(texelFetch(normalTexture, coord, 0).rg);
+   float angle = clamp(dot(normal, lightVec / lightLen), 0.0, 1.0);
+
+   // Same falloff as the forward app.
+   float falloff = 1.0 - (lightLen * lightLen) / (radius * radius);
+   float attenuation = falloff * falloff;
+
+   vec3 albedo = texelFetch(albedoTexture, coord, 0).rgb;
+   color = vec4(albedo * fLIGHT_COLOR * angle * attenuation, 0.0);
+}
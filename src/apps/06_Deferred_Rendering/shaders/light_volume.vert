@@ -0,0 +1,24 @@
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec4 lightPosition; // w is the radius
+layout(location = 2) in vec4 lightColor;
+
+flat out vec4 fLIGHT_POSITION; // view space, w is the radius
+flat out vec3 fLIGHT_COLOR;
+
+layout(std140, binding = 0) uniform CameraBuffer 
+{
+   mat4 proj;
+   mat4 view;
+};
+
+void main() 
+{
+   // The unit cube stretched around the light's sphere.
+   float radius = lightPosition.w;
+   vec3 worldPos = lightPosition.xyz + (pos * 2.0 - 1.0) * radius;
+
+   fLIGHT_POSITION = vec4((view * vec4(lightPosition.xyz, 1.0)).xyz, radius);
+   fLIGHT_COLOR = lightColor.rgb;
+
+   gl_Position = proj * view * vec4(worldPos, 1.0);
+}
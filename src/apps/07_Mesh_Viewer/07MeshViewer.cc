@@ -0,0 +1,507 @@
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <imgui.h>
+#include "apps/07_Mesh_Viewer/07MeshViewer.h"
+#include "core/meshOptimizer.h"
+#include "core/profiler.h"
+#include "gfx/gfxCmdBuffer.h"
+#include "gfx/OpenGL/gfxGLDevice.h"
+
+IMPLEMENT_APPLICATION(MeshViewerApplication);
+
+const float FIELD_OF_VIEW = 60.0f;
+const float ROTATION_SPEED = 0.5f;
+
+// Auto LOD picks the coarsest level whose error stays under this many pixels on screen.
+const float LOD_PIXEL_ERROR = 1.0f;
+const uint32_t LOD_COUNT = 6;
+
+// A (2, 3) torus knot tube, TEST_MESH_SEGMENTS * TEST_MESH_SIDES * 2 triangles.
+const uint32_t TEST_MESH_SEGMENTS = 1536;
+const uint32_t TEST_MESH_SIDES = 48;
+const float TEST_MESH_TUBE_RADIUS = 0.4f;
+
+const char* MESH_PASS_NAME = "Mesh";
+
+void MeshViewerApplication::onInit()
+{
+   getWindowSize(windowWidth, windowHeight);
+   setWindowTitle("Mesh Viewer Application");
+
+   strcpy(objPath, "model.obj");
+   strcpy(meshPath, "model.mesh");
+
+   meshCreated = false;
+   lodCount = 0;
+   indexSize = 0;
+   gpuBytes = 0;
+
+   autoLod = true;
+   selectedLod = 0;
+   drawnLod = 0;
+   viewDistance = 3.0f;
+   rotation = 0.0f;
+   rotate = true;
+   wireframe = false;
+
+   initGL();
+
+   MeshData mesh;
+   createTestMesh(mesh);
+   inputAcmr = analyzeVertexCache(mesh.indices.data(), (uint32_t)mesh.indices.size(), (uint32_t)mesh.vertices.size()).acmr;
+   importMs = 0.0;
+
+   uint64_t start = Profiler::now();
+   processMesh(mesh, LOD_COUNT);
+   processMs = (Profiler::now() - start) / 1000000.0;
+
+   meshName = "Torus knot (generated)";
+   showMesh(mesh);
+}
+
+void MeshViewerApplication::onDestroy()
+{
+   destroyGL();
+}
+
+void MeshViewerApplication::onUpdate(double dt)
+{
+   render(dt);
+}
+
+void MeshViewerApplication::onWindowSizeUpdate(int width, int height)
+{
+   windowWidth = width;
+   windowHeight = height;
+}
+
+void MeshViewerApplication::createTestMesh(MeshData& outMesh)
+{
+   // Rows follow the knot and wrap around, like the triangle strips an exporter would write.
+   auto knot = [](float t)
+   {
+      const float r = 2.0f + cosf(3.0f * t);
+      return glm::vec3(r * cosf(2.0f * t), -sinf(3.0f * t), r * sinf(2.0f * t));
+   };
+
+   outMesh.vertices.resize(TEST_MESH_SEGMENTS * TEST_MESH_SIDES);
+   for (uint32_t i = 0; i < TEST_MESH_SEGMENTS; i++)
+   {
+      const float t = glm::two_pi<float>() * i / TEST_MESH_SEGMENTS;
+      const float step = glm::two_pi<float>() / TEST_MESH_SEGMENTS;
+
+      const glm::vec3 center = knot(t);
+      const glm::vec3 tangent = glm::normalize(knot(t + step) - knot(t - step));
+      const glm::vec3 normal = glm::normalize(knot(t + step) - 2.0f * center + knot(t - step));
+      const glm::vec3 binormal = glm::cross(tangent, normal);
+
+      for (uint32_t j = 0; j < TEST_MESH_SIDES; j++)
+      {
+         const float angle = glm::two_pi<float>() * j / TEST_MESH_SIDES;
+         const glm::vec3 direction = cosf(angle) * normal + sinf(angle) * binormal;
+
+         MeshVertex& vertex = outMesh.vertices[i * TEST_MESH_SIDES + j];
+         vertex.position = center + direction * TEST_MESH_TUBE_RADIUS;
+         vertex.normal = direction;
+      }
+   }
+
+   outMesh.indices.clear();
+   outMesh.indices.reserve(TEST_MESH_SEGMENTS * TEST_MESH_SIDES * 6);
+   for (uint32_t i = 0; i < TEST_MESH_SEGMENTS; i++)
+   {
+      for (uint32_t j = 0; j < TEST_MESH_SIDES; j++)
+      {
+         const uint32_t a = i * TEST_MESH_SIDES + j;
+         const uint32_t b = ((i + 1) % TEST_MESH_SEGMENTS) * TEST_MESH_SIDES + j;
+         const uint32_t c = ((i + 1) % TEST_MESH_SEGMENTS) * TEST_MESH_SIDES + (j + 1) % TEST_MESH_SIDES;
+         const uint32_t d = i * TEST_MESH_SIDES + (j + 1) % TEST_MESH_SIDES;
+
+         const uint32_t corners[6] = { a, c, b, a, d, c };
+         outMesh.indices.insert(outMesh.indices.end(), corners, corners + 6);
+      }
+   }
+
+   MeshLod lod = {};
+   lod.indexCount = (uint32_t)outMesh.indices.size();
+   lod.vertexCount = (uint32_t)outMesh.vertices.size();
+   outMesh.lods.assign(1, lod);
+   computeMeshBounds(outMesh);
+}
+
+void MeshViewerApplication::showMesh(const MeshData& mesh)
+{
+   meshFile.close();
+
+   lodCount = std::min((uint32_t)mesh.lods.size(), (uint32_t)MESH_FILE_MAX_LODS);
+   std::copy(mesh.lods.begin(), mesh.lods.begin() + lodCount, lods);
+   boundsMin = mesh.boundsMin;
+   boundsMax = mesh.boundsMax;
+
+   uint64_t start = Profiler::now();
+   uploadMesh(mesh.vertices.data(), mesh.vertices.size() * sizeof(MeshVertex), mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t), sizeof(uint32_t));
+   loadMs = (Profiler::now() - start) / 1000000.0;
+}
+
+void MeshViewerApplication::importObjFile()
+{
+   MeshData mesh;
+
+   uint64_t start = Profiler::now();
+   if (!importObj(objPath, mesh, status))
+      return;
+   importMs = (Profiler::now() - start) / 1000000.0;
+
+   inputAcmr = analyzeVertexCache(mesh.indices.data(), (uint32_t)mesh.indices.size(), (uint32_t)mesh.vertices.size()).acmr;
+
+   start = Profiler::now();
+   processMesh(mesh, LOD_COUNT);
+   processMs = (Profiler::now() - start) / 1000000.0;
+
+   if (!writeMeshFile(meshPath, mesh, status))
+      return;
+
+   loadMeshFile(meshPath);
+}
+
+bool MeshViewerApplication::loadMeshFile(const char* fileName)
+{
+   // Map and upload, the page faults of the mapping included. A file just written is likely
+   // still in the page cache, so this is a warm load.
+   uint64_t start = Profiler::now();
+   if (!meshFile.open(fileName, status))
+      return false;
+
+   const MeshFileHeader& header = meshFile.getHeader();
+   uploadMesh(meshFile.getVertexData(), meshFile.getVertexDataSize(), meshFile.getIndexData(), meshFile.getIndexDataSize(), header.indexSize);
+   loadMs = (Profiler::now() - start) / 1000000.0;
+
+   lodCount = header.lodCount;
+   std::copy(header.lods, header.lods + lodCount, lods);
+   boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+   boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+
+   meshName = fileName;
+   status.clear();
+   return true;
+}
+
+void MeshViewerApplication::uploadMesh(const void* vertexData, size_t vertexDataSize, const void* indexData, size_t indexDataSize, uint32_t meshIndexSize)
+{
+   deleteMesh();
+
+   // Straight from the source memory, for a .mesh file the mapping itself, no staging copy.
+   {
+      GFXBufferDesc vertexBuffer;
+      vertexBuffer.type = GFXBufferType::VERTEX_BUFFER;
+      vertexBuffer.usage = GFXBufferUsageEnum::STATIC_GPU_ONLY;
+      vertexBuffer.sizeInBytes = vertexDataSize;
+      vertexBuffer.data = (void*)vertexData;
+
+      vertexBufferHandle = graphicsDevice->createBuffer(vertexBuffer);
+   }
+
+   {
+      GFXBufferDesc indexBuffer;
+      indexBuffer.type = GFXBufferType::INDEX_BUFFER;
+      indexBuffer.usage = GFXBufferUsageEnum::STATIC_GPU_ONLY;
+      indexBuffer.sizeInBytes = indexDataSize;
+      indexBuffer.data = (void*)indexData;
+
+      indexBufferHandle = graphicsDevice->createBuffer(indexBuffer);
+   }
+
+   indexSize = meshIndexSize;
+   gpuBytes = vertexDataSize + indexDataSize;
+   meshCreated = true;
+}
+
+void MeshViewerApplication::deleteMesh()
+{
+   if (!meshCreated)
+      return;
+
+   graphicsDevice->deleteBuffer(vertexBufferHandle);
+   graphicsDevice->deleteBuffer(indexBufferHandle);
+   meshCreated = false;
+}
+
+uint32_t MeshViewerApplication::selectLod(float distance) const
+{
+   if (lodCount == 0)
+      return 0;
+   if (!autoLod)
+      return std::min((uint32_t)selectedLod, lodCount - 1);
+
+   // Projected at the front of the bounding sphere, the closest any of the mesh gets.
+   const float radius = glm::length(boundsMax - boundsMin) * 0.5f;
+   const float nearest = std::max(distance - radius, radius * 0.01f);
+   const float pixelsPerUnit = windowHeight / (2.0f * tanf(glm::radians(FIELD_OF_VIEW) * 0.5f) * nearest);
+
+   uint32_t lod = 0;
+   for (uint32_t i = 1; i < lodCount; i++)
+   {
+      if (lods[i].error * pixelsPerUnit <= LOD_PIXEL_ERROR)
+         lod = i;
+   }
+   return lod;
+}
+
+void MeshViewerApplication::initGL()
+{
+   graphicsDevice = new GFXGLDevice();
+   cmdBuffer = new GFXCmdBuffer();
+   frameGraph = new GFXFrameGraph(graphicsDevice);
+
+   {
+      GFXRasterizerStateDesc rasterState;
+      rasterState.cullMode = GFXCullMode::CULL_BACK;
+      rasterState.windingMode = GFXWindingMode::COUNTER_CLOCKWISE;
+      rasterState.fillMode = GFXFillMode::SOLID;
+      rasterState.enableDynamicPointSize = false;
+
+      rasterizerStateHandle = graphicsDevice->createRasterizerState(rasterState);
+
+      rasterState.fillMode = GFXFillMode::WIREFRAME;
+      wireframeRasterizerStateHandle = graphicsDevice->createRasterizerState(rasterState);
+   }
+
+   {
+      GFXDepthStencilStateDesc depthState;
+      depthState.enableDepthTest = true;
+      depthState.enableDepthWrite = true;
+      depthState.depthCompareFunc = GFXCompareFunc::LESS;
+
+      depthStateHandle = graphicsDevice->createDepthStencilState(depthState);
+   }
+
+   {
+      GFXBufferDesc viewBufferDesc;
+      viewBufferDesc.type = GFXBufferType::CONSTANT_BUFFER;
+      viewBufferDesc.usage = GFXBufferUsageEnum::DYNAMIC_CPU_TO_GPU;
+      viewBufferDesc.sizeInBytes = sizeof(MeshViewUbo);
+      viewBufferDesc.data = nullptr;
+
+      viewBufferHandle = graphicsDevice->createBuffer(viewBufferDesc);
+   }
+
+   initShader();
+}
+
+void MeshViewerApplication::initShader()
+{
+   GFXInputLayoutElementDesc inputLayoutDescs[2];
+   inputLayoutDescs[0].slot = 0;
+   inputLayoutDescs[0].count = 3;
+   inputLayoutDescs[0].type = GFXInputLayoutFormat::FLOAT;
+   inputLayoutDescs[0].divisor = GFXInputLayoutDivisor::PER_VERTEX;
+   inputLayoutDescs[0].offset = offsetof(MeshVertex, position);
+   inputLayoutDescs[0].bufferBinding = 0;
+
+   inputLayoutDescs[1].slot = 1;
+   inputLayoutDescs[1].count = 3;
+   inputLayoutDescs[1].type = GFXInputLayoutFormat::FLOAT;
+   inputLayoutDescs[1].divisor = GFXInputLayoutDivisor::PER_VERTEX;
+   inputLayoutDescs[1].offset = offsetof(MeshVertex, normal);
+   inputLayoutDescs[1].bufferBinding = 0;
+
+   GFXInputLayoutDesc inputLayout;
+   inputLayout.count = 2;
+   inputLayout.descs = inputLayoutDescs;
+
+   char* vertShader = readShaderFile("apps/07_Mesh_Viewer/shaders/mesh.vert");
+   char* fragShader = readShaderFile("apps/07_Mesh_Viewer/shaders/mesh.frag");
+
+   GFXShaderDesc shaders[2];
+   shaders[0].type = GFXShaderType::VERTEX;
+   shaders[0].code = vertShader;
+   shaders[0].codeLength = strlen(vertShader);
+
+   shaders[1].type = GFXShaderType::FRAGMENT;
+   shaders[1].code = fragShader;
+   shaders[1].codeLength = strlen(fragShader);
+
+   GFXPipelineDesc pipelineDesc;
+   pipelineDesc.primitiveType = GFXPrimitiveType::TRIANGLE_LIST;
+   pipelineDesc.inputLayout = std::move(inputLayout);
+   pipelineDesc.shadersStages = shaders;
+   pipelineDesc.shaderStageCount = 2;
+
+   pipelineHandle = graphicsDevice->createPipeline(pipelineDesc);
+}
+
+void MeshViewerApplication::destroyGL()
+{
+   deleteMesh();
+   meshFile.close();
+
+   graphicsDevice->deleteStateBlock(depthStateHandle);
+   graphicsDevice->deleteStateBlock(rasterizerStateHandle);
+   graphicsDevice->deleteStateBlock(wireframeRasterizerStateHandle);
+
+   graphicsDevice->deleteBuffer(viewBufferHandle);
+   graphicsDevice->deletePipeline(pipelineHandle);
+
+   delete frameGraph;
+   delete cmdBuffer;
+   delete graphicsDevice;
+}
+
+void MeshViewerApplication::render(double dt)
+{
+   if (rotate)
+      rotation += (float)dt * ROTATION_SPEED;
+
+   const glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+   const float radius = std::max(glm::length(boundsMax - boundsMin) * 0.5f, 0.0001f);
+   const float distance = viewDistance * radius;
+   const glm::vec3 eye = center + glm::normalize(glm::vec3(0.0f, 0.35f, 1.0f)) * distance;
+
+   MeshViewUbo viewData;
+   viewData.viewProjMatrix = glm::perspective(glm::radians(FIELD_OF_VIEW), getAspectRatio(), radius * 0.01f, distance + radius * 2.0f) * glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f));
+   viewData.modelMatrix = glm::translate(glm::mat4(1.0f), center) * glm::rotate(glm::mat4(1.0f), rotation, glm::vec3(0.0f, 1.0f, 0.0f)) * glm::translate(glm::mat4(1.0f), -center);
+   viewData.sunDirection = glm::vec4(glm::normalize(glm::vec3(0.4f, 0.8f, 0.45f)), 0.0f);
+
+   char* pData = (char*)graphicsDevice->mapBuffer(viewBufferHandle, 0, sizeof(MeshViewUbo));
+   memcpy(pData, &viewData, sizeof(MeshViewUbo));
+   graphicsDevice->unmapBuffer(viewBufferHandle);
+
+   drawnLod = selectLod(distance);
+
+   frameGraph->reset();
+
+   FrameGraphResource color;
+   frameGraph->addPass(MESH_PASS_NAME, [&](FrameGraphBuilder& builder)
+   {
+      const float clearColor[4] = { 0.1f, 0.1f, 0.1f, 1.0f };
+      FrameGraphTextureDesc colorDesc = { GFXTextureInternalFormat::RGBA8, windowWidth, windowHeight };
+      FrameGraphTextureDesc depthDesc = { GFXTextureInternalFormat::DEPTH_32F, windowWidth, windowHeight };
+
+      color = builder.writeColor(0, builder.createTexture("Color", colorDesc), GFXLoadAttachmentAction::CLEAR, clearColor);
+      builder.writeDepth(builder.createTexture("Depth", depthDesc), GFXLoadAttachmentAction::CLEAR, 1.0f);
+   },
+   [&](GFXCmdBuffer* cmd, const GFXFrameGraph& graph)
+   {
+      if (!meshCreated || lodCount == 0)
+         return;
+
+      const MeshLod& lod = lods[drawnLod];
+
+      cmd->setRasterizerState(wireframe ? wireframeRasterizerStateHandle : rasterizerStateHandle);
+      cmd->setDepthStencilState(depthStateHandle);
+
+      cmd->bindPipeline(pipelineHandle);
+      cmd->bindConstantBuffer(0, viewBufferHandle, 0, sizeof(MeshViewUbo));
+
+      cmd->bindVertexBuffer(0, vertexBufferHandle, sizeof(MeshVertex), 0);
+      cmd->bindIndexBuffer(indexBufferHandle, indexSize == sizeof(uint16_t) ? GFXIndexBufferType::BITS_16 : GFXIndexBufferType::BITS_32, 0);
+      cmd->drawIndexedPrimitives(lod.indexCount, lod.indexOffset * indexSize);
+   });
+
+   frameGraph->markOutput(color);
+   frameGraph->compile();
+
+   cmdBuffer->begin();
+   cmdBuffer->beginTimer("Frame");
+   frameGraph->execute(cmdBuffer);
+   cmdBuffer->endTimer();
+   cmdBuffer->end();
+
+   const GFXCmdBuffer* buffer[1];
+   buffer[0] = cmdBuffer;
+
+   graphicsDevice->executeCmdBuffers(buffer, 1);
+
+   graphicsDevice->present(frameGraph->getRenderPass(color), windowWidth, windowHeight);
+}
+
+void MeshViewerApplication::onRenderImGUI(double dt)
+{
+   ImGui::NewFrame();
+   ImGui::Begin("Debug Information & Options");
+   ImGui::Text("Frame Rate: %.1f FPS", ImGui::GetIO().Framerate);
+
+   ImGui::Separator();
+   ImGui::Text("%s Driver Information:", graphicsDevice->getApiString());
+   ImGui::Text("   Renderer: %s", graphicsDevice->getGFXDeviceRendererDesc());
+   ImGui::Text("   Vendor: %s", graphicsDevice->getGFXDeviceVendorDesc());
+   ImGui::Text("   Version: %s", graphicsDevice->getApiVersionString());
+
+   ImGui::Separator();
+   ImGui::InputText("OBJ File", objPath, MESH_PATH_LENGTH);
+   if (ImGui::Button("Import OBJ"))
+      importObjFile();
+   ImGui::InputText("Mesh File", meshPath, MESH_PATH_LENGTH);
+   if (ImGui::Button("Load Mesh"))
+      loadMeshFile(meshPath);
+   if (!status.empty())
+      ImGui::TextWrapped("%s", status.c_str());
+
+   ImGui::Separator();
+   ImGui::Text("Mesh: %s", meshName.c_str());
+   if (importMs > 0.0)
+      ImGui::Text("OBJ Import: %.1f ms", importMs);
+   ImGui::Text("Optimize and LODs: %.1f ms", processMs);
+   ImGui::Text("Load: %.2f ms (%s)", loadMs, meshFile.isOpen() ? "map and upload" : "upload from memory");
+   if (meshFile.isOpen())
+   {
+      const size_t residentSize = meshFile.getResidentSize();
+      ImGui::Text("File Size: %.2f MB, Resident: %.2f MB", meshFile.getFileSize() / (1024.0 * 1024.0), residentSize / (1024.0 * 1024.0));
+   }
+   ImGui::Text("GPU Buffers: %.2f MB, %u bit indices", gpuBytes / (1024.0 * 1024.0), indexSize * 8);
+   ImGui::Text("Input Order ACMR: %.3f (FIFO cache of %u)", inputAcmr, MESH_STATS_CACHE_SIZE);
+
+   if (ImGui::BeginTable("LODs", 6, ImGuiTableFlags_Borders))
+   {
+      ImGui::TableSetupColumn("LOD");
+      ImGui::TableSetupColumn("Triangles");
+      ImGui::TableSetupColumn("Vertices");
+      ImGui::TableSetupColumn("ACMR");
+      ImGui::TableSetupColumn("ATVR");
+      ImGui::TableSetupColumn("Error");
+      ImGui::TableHeadersRow();
+
+      for (uint32_t i = 0; i < lodCount; i++)
+      {
+         const uint32_t triangleCount = lods[i].indexCount / 3;
+
+         ImGui::TableNextRow();
+         ImGui::TableNextColumn();
+         ImGui::Text("%u%s", i, i == drawnLod ? " *" : "");
+         ImGui::TableNextColumn();
+         ImGui::Text("%u", triangleCount);
+         ImGui::TableNextColumn();
+         ImGui::Text("%u", lods[i].vertexCount);
+         ImGui::TableNextColumn();
+         ImGui::Text("%.3f", lods[i].acmr);
+         ImGui::TableNextColumn();
+         ImGui::Text("%.3f", lods[i].vertexCount > 0 ? lods[i].acmr * triangleCount / lods[i].vertexCount : 0.0f);
+         ImGui::TableNextColumn();
+         ImGui::Text("%.4f", lods[i].error);
+      }
+
+      ImGui::EndTable();
+   }
+
+   ImGui::Separator();
+   ImGui::Checkbox("Auto LOD", &autoLod);
+   if (!autoLod)
+      ImGui::SliderInt("LOD", &selectedLod, 0, std::max((int)lodCount - 1, 0));
+   ImGui::SliderFloat("View Distance", &viewDistance, 1.2f, 200.0f, "%.1f radii", ImGuiSliderFlags_Logarithmic);
+   ImGui::Checkbox("Rotate", &rotate);
+   ImGui::Checkbox("Wireframe", &wireframe);
+   ImGui::Text("Mesh Pass GPU Time: %.2f ms", graphicsDevice->getGpuTimerMs(MESH_PASS_NAME));
+
+   ImGui::Separator();
+   renderGFXFrameStats(graphicsDevice);
+   renderProfilerStats();
+   renderGFXMemoryStats(graphicsDevice);
+
+   ImGui::End();
+   ImGui::Render();
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+#include "app.h"
+#include "core/mesh.h"
+#include "core/meshFile.h"
+#include "gfx/gfxDevice.h"
+#include "gfx/gfxFrameGraph.h"
+
+#define MESH_PATH_LENGTH 512
+
+struct MeshViewUbo
+{
+   glm::mat4 viewProjMatrix;
+   glm::mat4 modelMatrix;
+   glm::vec4 sunDirection;
+};
+
+class MeshViewerApplication : public Application
+{
+public:
+   DECLARE_APPLICATION(MeshViewerApplication);
+
+   virtual void onWindowSizeUpdate(int width, int height) override;
+
+   virtual void onInit() override;
+   virtual void onDestroy() override;
+   virtual void onUpdate(double dt) override;
+   virtual void onRenderImGUI(double dt) override;
+   virtual GFXDevice* getGraphicsDevice() const override { return graphicsDevice; }
+
+   void initGL();
+   void initShader();
+   void destroyGL();
+   void render(double dt);
+   void createTestMesh(MeshData& outMesh);
+   void showMesh(const MeshData& mesh);
+   void importObjFile();
+   bool loadMeshFile(const char* fileName);
+   void uploadMesh(const void* vertexData, size_t vertexDataSize, const void* indexData, size_t indexDataSize, uint32_t meshIndexSize);
+   void deleteMesh();
+   uint32_t selectLod(float distance) const;
+
+private:
+   int windowWidth;
+   int windowHeight;
+
+   char objPath[MESH_PATH_LENGTH];
+   char meshPath[MESH_PATH_LENGTH];
+   std::string meshName;
+   std::string status;
+
+   // Only open while a .mesh file is shown, meshes built in memory upload from MeshData.
+   MeshFile meshFile;
+
+   bool meshCreated;
+   MeshLod lods[MESH_FILE_MAX_LODS];
+   uint32_t lodCount;
+   glm::vec3 boundsMin;
+   glm::vec3 boundsMax;
+   uint32_t indexSize;
+   size_t gpuBytes;
+
+   float inputAcmr;
+   double importMs;
+   double processMs;
+   double loadMs;
+
+   bool autoLod;
+   int selectedLod;
+   uint32_t drawnLod;
+   float viewDistance; // in bounding sphere radii
+   float rotation;
+   bool rotate;
+   bool wireframe;
+
+   GFXDevice* graphicsDevice;
+   GFXCmdBuffer* cmdBuffer;
+   GFXFrameGraph* frameGraph;
+
+   StateBlockHandle depthStateHandle;
+   StateBlockHandle rasterizerStateHandle;
+   StateBlockHandle wireframeRasterizerStateHandle;
+
+   PipelineHandle pipelineHandle;
+
+   BufferHandle viewBufferHandle;
+   BufferHandle vertexBufferHandle;
+   BufferHandle indexBufferHandle;
+};
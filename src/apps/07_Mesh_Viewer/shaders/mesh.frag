@@ -0,0 +1,15 @@
+in vec3 fNORMAL;
+layout(location = 0) out vec4 color;
+
+layout(std140, binding = 0) uniform ViewBuffer 
+{
+   mat4 viewProj;
+   mat4 model;
+   vec4 sunDirection;
+} view;
+
+void main() 
+{
+   float nL = clamp(dot(normalize(fNORMAL), view.sunDirection.xyz), 0.0, 1.0);
+   color = vec4(vec3(0.8, 0.75, 0.7) * (nL * 0.8 + 0.2), 1.0);
+}
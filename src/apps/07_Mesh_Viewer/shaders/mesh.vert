@@ -0,0 +1,18 @@
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 normal;
+
+out vec3 fNORMAL;
+
+layout(std140, binding = 0) uniform ViewBuffer 
+{
+   mat4 viewProj;
+   mat4 model;
+   vec4 sunDirection;
+} view;
+
+void main() 
+{
+   // Rotation only, the model matrix doubles as the normal matrix.
+   fNORMAL = mat3(view.model) * normal;
+   gl_Position = view.viewProj * view.model * vec4(pos, 1.0);
+}
@@ -0,0 +1,11 @@
+#include "bench/microBench.h"
+
+int main(int argc, char *argv[])
+{
+   MicroBenchOptions options;
+   if (!MicroBenchRunner::parseArgs(argc, argv, options))
+      return 1;
+
+   MicroBenchRunner runner(options);
+   return runner.run();
+}
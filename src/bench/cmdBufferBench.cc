@@ -0,0 +1,256 @@
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "bench/microBench.h"
+#include "gfx/gfxCmdBuffer.h"
+#include "gfx/Null/gfxNullDevice.h"
+
+enum
+{
+   COMMANDS_PER_BUFFER = 256,
+   LOOKUPS_PER_ITERATION = 1024
+};
+
+static void encodeCommand(GFXCmdBuffer* cmd, CommandType type, uint32_t i)
+{
+   static BufferHandle buffers[4] = { 0, 1, 2, 3 };
+   static uint32_t strides[4] = { 12, 12, 16, 64 };
+   static uint32_t offsets[4] = { 0, 0, 0, 0 };
+   static TextureHandle textures[4] = { 0, 1, 2, 3 };
+   static SamplerHandle samplers[4] = { 0, 1, 2, 3 };
+   static float pushConstants[16] = {};
+
+   switch (type)
+   {
+   case CommandType::Viewport:
+      cmd->setViewport(0, 0, 1920, 1080);
+      break;
+   case CommandType::Scissor:
+      cmd->setScissor(0, 0, 1920, 1080);
+      break;
+   case CommandType::RasterizerState:
+      cmd->setRasterizerState(i & 3);
+      break;
+   case CommandType::DepthStencilState:
+      cmd->setDepthStencilState(i & 3);
+      break;
+   case CommandType::BlendState:
+      cmd->setBlendState(i & 3);
+      break;
+   case CommandType::BindRenderPass:
+      cmd->bindRenderPass(i & 3);
+      break;
+   case CommandType::BindPipeline:
+      cmd->bindPipeline(i & 3);
+      break;
+   case CommandType::BindPushConstants:
+      cmd->bindPushConstants(0, sizeof(pushConstants), VERTEX_BIT, pushConstants);
+      break;
+   case CommandType::BindVertexBuffer:
+      cmd->bindVertexBuffer(0, i & 3, 12, 0);
+      break;
+   case CommandType::BindVertexBuffers:
+      cmd->bindVertexBuffers(0, 4, buffers, strides, offsets);
+      break;
+   case CommandType::BindIndexBuffer:
+      cmd->bindIndexBuffer(i & 3, GFXIndexBufferType::BITS_16, 0);
+      break;
+   case CommandType::BindConstantBuffer:
+      cmd->bindConstantBuffer(0, i & 3, 0, 256);
+      break;
+   case CommandType::BindStorageBuffer:
+      cmd->bindStorageBuffer(0, i & 3, 0, 256);
+      break;
+   case CommandType::BindTexture:
+      cmd->bindTexture(0, i & 3);
+      break;
+   case CommandType::BindTextures:
+      cmd->bindTextures(0, 4, textures);
+      break;
+   case CommandType::BindSampler:
+      cmd->bindSampler(0, i & 3);
+      break;
+   case CommandType::BindSamplers:
+      cmd->bindSamplers(0, 4, samplers);
+      break;
+   case CommandType::BindImage:
+      cmd->bindImage(0, i & 3, 0, GFXImageAccess::WRITE_ONLY);
+      break;
+   case CommandType::DrawPrimitives:
+      cmd->drawPrimitives(0, 36);
+      break;
+   case CommandType::DrawPrimitivesInstanced:
+      cmd->drawPrimitivesInstanced(0, 36, 64);
+      break;
+   case CommandType::DrawIndexedPrimitives:
+      cmd->drawIndexedPrimitives(36, 0);
+      break;
+   case CommandType::DrawIndexedPrimitivesInstanced:
+      cmd->drawIndexedPrimitivesInstanced(36, 0, 64);
+      break;
+   case CommandType::DrawPrimitivesIndirect:
+      cmd->drawPrimitivesIndirect(i & 3, 0);
+      break;
+   case CommandType::MultiDrawIndexedPrimitivesIndirectCount:
+      cmd->multiDrawIndexedPrimitivesIndirectCount(i & 3, 0, i & 3, 0, 1);
+      break;
+   case CommandType::Dispatch:
+      cmd->dispatch(64, 1, 1);
+      break;
+   case CommandType::MemoryBarrier:
+      cmd->memoryBarrier(VERTEX_BUFFER_BARRIER_BIT);
+      break;
+   case CommandType::BeginTimer:
+      cmd->beginTimer("Bench");
+      break;
+   case CommandType::EndTimer:
+      cmd->endTimer();
+      break;
+   case CommandType::End:
+      cmd->end();
+      break;
+   }
+}
+
+static void encodeCommands(MicroBenchState& state, CommandType type)
+{
+   std::unique_ptr<GFXCmdBuffer> cmd(new GFXCmdBuffer());
+   state.setItemsPerIteration(COMMANDS_PER_BUFFER);
+
+   while (state.keepRunning())
+   {
+      cmd->begin();
+      for (uint32_t i = 0; i < COMMANDS_PER_BUFFER; i++)
+         encodeCommand(cmd.get(), type, i);
+      cmd->end();
+
+      doNotOptimize(*cmd);
+   }
+}
+
+// One benchmark per command type, named after it.
+static struct EncodeBenchmarks
+{
+   std::vector<std::unique_ptr<MicroBenchRep>> reps;
+
+   EncodeBenchmarks()
+   {
+      for (int i = 0; i < (int)CommandType::End; i++)
+      {
+         const CommandType type = (CommandType)i;
+         const std::string name = std::string("GFXCmdBuffer::encode/") + GFXDevice::getCommandTypeString(type);
+         reps.emplace_back(new MicroBenchRep(name, [type](MicroBenchState& state) { encodeCommands(state, type); }));
+      }
+   }
+} sEncodeBenchmarks;
+
+// Shaped like a forward renderer frame: global state, then buffers, a texture and a draw per object.
+static void executeCmdBuffers(MicroBenchState& state)
+{
+   const uint32_t drawCount = (uint32_t)state.getArg();
+   GFXNullDevice device;
+
+   GFXTextureStateDesc textureDesc = {};
+   textureDesc.type = GFXTextureType::TEXTURE_2D;
+   textureDesc.internalFormat = GFXTextureInternalFormat::RGBA8;
+   textureDesc.levels = 1;
+   textureDesc.width = 64;
+   textureDesc.height = 64;
+
+   GFXRenderPassDesc renderPassDesc;
+   renderPassDesc.colorAttachmentCount = 1;
+   renderPassDesc.colorAttachments[0].texture = device.createTexture(textureDesc);
+   const RenderPassHandle renderPass = device.createRenderPass(renderPassDesc);
+
+   GFXPipelineDesc pipelineDesc = {};
+   pipelineDesc.primitiveType = GFXPrimitiveType::TRIANGLE_LIST;
+   const PipelineHandle pipeline = device.createPipeline(pipelineDesc);
+
+   const StateBlockHandle rasterizerState = device.createRasterizerState(GFXRasterizerStateDesc());
+   const StateBlockHandle depthStencilState = device.createDepthStencilState(GFXDepthStencilStateDesc());
+
+   GFXBufferDesc bufferDesc = {};
+   bufferDesc.type = GFXBufferType::CONSTANT_BUFFER;
+   bufferDesc.usage = GFXBufferUsageEnum::DYNAMIC_CPU_TO_GPU;
+   bufferDesc.sizeInBytes = 256;
+   const BufferHandle cameraBuffer = device.createBuffer(bufferDesc);
+
+   std::vector<BufferHandle> vertexBuffers;
+   std::vector<BufferHandle> indexBuffers;
+   std::vector<TextureHandle> textures;
+   for (uint32_t i = 0; i < 64; i++)
+   {
+      bufferDesc.type = GFXBufferType::VERTEX_BUFFER;
+      vertexBuffers.push_back(device.createBuffer(bufferDesc));
+      bufferDesc.type = GFXBufferType::INDEX_BUFFER;
+      indexBuffers.push_back(device.createBuffer(bufferDesc));
+      textures.push_back(device.createTexture(textureDesc));
+   }
+
+   const glm::mat4 modelMatrix(1.0f);
+
+   std::unique_ptr<GFXCmdBuffer> cmd(new GFXCmdBuffer());
+   cmd->begin();
+   cmd->bindRenderPass(renderPass);
+   cmd->setViewport(0, 0, 1920, 1080);
+   cmd->setScissor(0, 0, 1920, 1080);
+   cmd->setRasterizerState(rasterizerState);
+   cmd->setDepthStencilState(depthStencilState);
+   cmd->bindPipeline(pipeline);
+   cmd->bindConstantBuffer(0, cameraBuffer, 0, 256);
+   for (uint32_t i = 0; i < drawCount; i++)
+   {
+      cmd->bindVertexBuffer(0, vertexBuffers[i % 64], 24, 0);
+      cmd->bindIndexBuffer(indexBuffers[i % 64], GFXIndexBufferType::BITS_16, 0);
+      cmd->bindTexture(0, textures[(i * 7) % 64]);
+      cmd->bindPushConstants(0, sizeof(modelMatrix), VERTEX_BIT, &modelMatrix);
+      cmd->drawIndexedPrimitives(36, 0);
+   }
+   cmd->end();
+
+   const GFXCmdBuffer* buffers[1] = { cmd.get() };
+   state.setItemsPerIteration(drawCount);
+
+   while (state.keepRunning())
+   {
+      device.executeCmdBuffers(buffers, 1);
+      device.present(renderPass, 1920, 1080);
+   }
+
+   doNotOptimize(device.getFrameStats());
+}
+MICRO_BENCHMARK_ARGS(executeCmdBuffers, 16, 128, 512);
+
+struct LookupEntry
+{
+   uint32_t buffer;
+   uint32_t type;
+   size_t sizeInBytes;
+};
+
+static void handleTableLookup(MicroBenchState& state)
+{
+   const uint32_t tableSize = (uint32_t)state.getArg();
+
+   std::unordered_map<BufferHandle, LookupEntry> table;
+   for (uint32_t i = 0; i < tableSize; i++)
+      table[i] = { i, 0, 256 };
+
+   std::mt19937 random(0);
+   std::vector<BufferHandle> handles(LOOKUPS_PER_ITERATION);
+   for (BufferHandle& handle : handles)
+      handle = random() % tableSize;
+
+   state.setItemsPerIteration(LOOKUPS_PER_ITERATION);
+
+   while (state.keepRunning())
+   {
+      uint32_t sum = 0;
+      for (BufferHandle handle : handles)
+         sum += table[handle].buffer;
+
+      doNotOptimize(sum);
+   }
+}
+MICRO_BENCHMARK_ARGS(handleTableLookup, 64, 4096, 262144);
@@ -0,0 +1,111 @@
+#include <math.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "bench/microBench.h"
+#include "core/mesh.h"
+#include "core/meshOptimizer.h"
+
+// Shuffled, the worst order an exporter can leave a mesh in.
+static void createGridMesh(uint32_t triangleCount, MeshData& outMesh)
+{
+   const uint32_t quads = (uint32_t)sqrt(triangleCount / 2.0);
+   const uint32_t size = quads + 1;
+
+   outMesh.vertices.resize(size * size);
+   for (uint32_t y = 0; y < size; y++)
+   {
+      for (uint32_t x = 0; x < size; x++)
+      {
+         MeshVertex& vertex = outMesh.vertices[y * size + x];
+         vertex.position = glm::vec3((float)x, sinf(x * 0.1f) * cosf(y * 0.1f) * 4.0f, (float)y);
+         vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+      }
+   }
+
+   std::vector<uint32_t> quadOrder(quads * quads);
+   for (uint32_t i = 0; i < quadOrder.size(); i++)
+      quadOrder[i] = i;
+   std::shuffle(quadOrder.begin(), quadOrder.end(), std::mt19937(1234));
+
+   outMesh.indices.clear();
+   for (uint32_t quad : quadOrder)
+   {
+      const uint32_t v = (quad / quads) * size + quad % quads;
+      const uint32_t corners[6] = { v, v + size, v + size + 1, v, v + size + 1, v + 1 };
+      outMesh.indices.insert(outMesh.indices.end(), corners, corners + 6);
+   }
+
+   MeshLod lod = {};
+   lod.indexCount = (uint32_t)outMesh.indices.size();
+   lod.vertexCount = (uint32_t)outMesh.vertices.size();
+   outMesh.lods.assign(1, lod);
+   computeMeshBounds(outMesh);
+}
+
+static void vertexCacheOptimize(MicroBenchState& state)
+{
+   MeshData mesh;
+   createGridMesh((uint32_t)state.getArg(), mesh);
+   std::vector<uint32_t> indices(mesh.indices.size());
+
+   state.setItemsPerIteration(mesh.indices.size() / 3);
+
+   while (state.keepRunning())
+   {
+      std::copy(mesh.indices.begin(), mesh.indices.end(), indices.begin());
+      optimizeVertexCache(indices.data(), (uint32_t)indices.size(), (uint32_t)mesh.vertices.size());
+      doNotOptimize(indices[0]);
+   }
+}
+MICRO_BENCHMARK_ARGS(vertexCacheOptimize, 10000, 100000, 1000000);
+
+static void overdrawOptimize(MicroBenchState& state)
+{
+   MeshData mesh;
+   createGridMesh((uint32_t)state.getArg(), mesh);
+   optimizeVertexCache(mesh.indices.data(), (uint32_t)mesh.indices.size(), (uint32_t)mesh.vertices.size());
+   std::vector<uint32_t> indices(mesh.indices.size());
+
+   state.setItemsPerIteration(mesh.indices.size() / 3);
+
+   while (state.keepRunning())
+   {
+      std::copy(mesh.indices.begin(), mesh.indices.end(), indices.begin());
+      optimizeOverdraw(indices.data(), (uint32_t)indices.size(), mesh.vertices.data());
+      doNotOptimize(indices[0]);
+   }
+}
+MICRO_BENCHMARK_ARGS(overdrawOptimize, 10000, 100000, 1000000);
+
+static void simplifyQuarter(MicroBenchState& state)
+{
+   MeshData mesh;
+   createGridMesh((uint32_t)state.getArg(), mesh);
+   std::vector<MeshVertex> vertices;
+   std::vector<uint32_t> indices;
+
+   state.setItemsPerIteration(mesh.indices.size() / 3);
+
+   while (state.keepRunning())
+   {
+      simplifyMesh(mesh.vertices.data(), (uint32_t)mesh.vertices.size(), mesh.indices.data(), (uint32_t)mesh.indices.size(), (uint32_t)(mesh.indices.size() / 12), vertices, indices);
+      doNotOptimize(indices.data());
+   }
+}
+MICRO_BENCHMARK_ARGS(simplifyQuarter, 10000, 100000, 1000000);
+
+static void analyzeCache(MicroBenchState& state)
+{
+   MeshData mesh;
+   createGridMesh((uint32_t)state.getArg(), mesh);
+
+   state.setItemsPerIteration(mesh.indices.size() / 3);
+
+   while (state.keepRunning())
+   {
+      MeshCacheStats stats = analyzeVertexCache(mesh.indices.data(), (uint32_t)mesh.indices.size(), (uint32_t)mesh.vertices.size());
+      doNotOptimize(stats);
+   }
+}
+MICRO_BENCHMARK_ARGS(analyzeCache, 10000, 100000, 1000000);
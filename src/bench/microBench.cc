@@ -0,0 +1,276 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "bench/microBench.h"
+
+MicroBenchRep* MicroBenchRep::sLast = nullptr;
+
+static const uint64_t MAX_ITERATIONS = 1ull << 32;
+
+static void printUsage()
+{
+   printf("usage: sandbox_bench [--filter name] [--samples N] [--min-sample-ms ms] [--output path] [--list]\n");
+}
+
+static void writeJsonString(FILE* file, const char* str)
+{
+   fputc('"', file);
+   for (; *str; str++)
+   {
+      if (*str == '"' || *str == '\\')
+         fputc('\\', file);
+      fputc(*str, file);
+   }
+   fputc('"', file);
+}
+
+static double median(std::vector<double> values)
+{
+   std::sort(values.begin(), values.end());
+
+   const size_t middle = values.size() / 2;
+   return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) * 0.5;
+}
+
+static std::string getBenchmarkName(const MicroBenchRep* rep, int64_t arg)
+{
+   if (rep->mArgs.empty())
+      return rep->mName;
+
+   return rep->mName + "/" + std::to_string(arg);
+}
+
+bool MicroBenchRunner::parseArgs(int argc, char* argv[], MicroBenchOptions& outOptions)
+{
+   for (int i = 1; i < argc; i++)
+   {
+      const char* arg = argv[i];
+      if (strcmp(arg, "--list") == 0)
+      {
+         outOptions.list = true;
+         continue;
+      }
+
+      const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+      if (!value)
+      {
+         printUsage();
+         return false;
+      }
+
+      if (strcmp(arg, "--filter") == 0)
+      {
+         outOptions.filter = value;
+      }
+      else if (strcmp(arg, "--samples") == 0)
+      {
+         outOptions.samples = (uint32_t)atoi(value);
+      }
+      else if (strcmp(arg, "--min-sample-ms") == 0)
+      {
+         outOptions.minSampleMs = atof(value);
+      }
+      else if (strcmp(arg, "--output") == 0)
+      {
+         outOptions.outputPath = value;
+      }
+      else
+      {
+         printUsage();
+         return false;
+      }
+
+      i++;
+   }
+
+   if (outOptions.samples < 3 || outOptions.minSampleMs <= 0.0)
+   {
+      printUsage();
+      return false;
+   }
+
+   return true;
+}
+
+int MicroBenchRunner::run()
+{
+   const std::vector<MicroBenchRep*> benchmarks = MicroBenchRep::getListOfBenchmarks();
+
+   if (mOptions.list)
+   {
+      for (const MicroBenchRep* rep : benchmarks)
+      {
+         if (rep->mArgs.empty())
+            printf("%s\n", rep->mName.c_str());
+         for (int64_t arg : rep->mArgs)
+            printf("%s\n", getBenchmarkName(rep, arg).c_str());
+      }
+      return 0;
+   }
+
+   printf("%-56s %14s %10s %14s %12s\n", "Benchmark", "Median", "Spread", "Per Item", "Iterations");
+
+   for (const MicroBenchRep* rep : benchmarks)
+   {
+      std::vector<int64_t> args = rep->mArgs;
+      if (args.empty())
+         args.push_back(0);
+
+      for (int64_t arg : args)
+      {
+         const std::string name = getBenchmarkName(rep, arg);
+         if (!mOptions.filter.empty() && name.find(mOptions.filter) == std::string::npos)
+            continue;
+
+         const MicroBenchResult result = _runBenchmark(name, rep->mFunction, arg);
+         mResults.push_back(result);
+
+         printf("%-56s %11.1f ns %9.2f%% %11.3f ns %12llu\n", result.name.c_str(), result.medianNs,
+            result.medianNs > 0.0 ? result.madNs / result.medianNs * 100.0 : 0.0,
+            result.medianNs / result.itemsPerIteration, (unsigned long long)result.iterationsPerSample);
+         for (const MicroBenchCounter& counter : result.counters)
+            printf("   %s: %.3f\n", counter.name.c_str(), counter.value);
+         fflush(stdout);
+      }
+   }
+
+   if (mResults.empty())
+   {
+      printf("No benchmark matches '%s'\n", mOptions.filter.c_str());
+      return 1;
+   }
+
+   const std::string jsonFile = mOptions.outputPath + ".json";
+   const std::string csvFile = mOptions.outputPath + ".csv";
+   if (!_writeJson(jsonFile) || !_writeCsv(csvFile))
+   {
+      printf("Failed to write %s or %s\n", jsonFile.c_str(), csvFile.c_str());
+      return 1;
+   }
+
+   printf("Wrote %s and %s\n", jsonFile.c_str(), csvFile.c_str());
+   return 0;
+}
+
+MicroBenchResult MicroBenchRunner::_runBenchmark(const std::string& name, const MicroBenchFunction& function, int64_t arg) const
+{
+   const uint64_t minSampleNs = (uint64_t)(mOptions.minSampleMs * 1000000.0);
+
+   uint64_t iterations = 1;
+   uint64_t itemsPerIteration = 1;
+   for (;;)
+   {
+      MicroBenchState state(iterations, arg);
+      function(state);
+      itemsPerIteration = state.getItemsPerIteration();
+
+      // The cap catches benchmarks that never run their loop.
+      const uint64_t elapsedNs = state.getElapsedNs();
+      if (elapsedNs >= minSampleNs || iterations >= MAX_ITERATIONS)
+         break;
+
+      // Jump most of the way once the run is long enough for the clock to be trusted.
+      if (elapsedNs > minSampleNs / 10)
+         iterations = std::max(iterations + 1, (uint64_t)ceil(iterations * 1.2 * minSampleNs / elapsedNs));
+      else
+         iterations *= 2;
+   }
+
+   std::vector<double> samples;
+   std::vector<MicroBenchCounter> counters;
+   samples.reserve(mOptions.samples);
+   for (uint32_t i = 0; i < mOptions.samples; i++)
+   {
+      MicroBenchState state(iterations, arg);
+      function(state);
+      samples.push_back((double)state.getElapsedNs() / iterations);
+      counters = state.getCounters();
+   }
+
+   MicroBenchResult result;
+   result.name = name;
+   result.iterationsPerSample = iterations;
+   result.itemsPerIteration = itemsPerIteration > 0 ? itemsPerIteration : 1;
+   result.samples = (uint32_t)samples.size();
+   result.medianNs = median(samples);
+
+   std::vector<double> deviations;
+   double sum = 0.0;
+   for (double sample : samples)
+   {
+      deviations.push_back(fabs(sample - result.medianNs));
+      sum += sample;
+   }
+
+   result.madNs = median(deviations) * 1.4826;
+   result.meanNs = sum / samples.size();
+   result.minNs = *std::min_element(samples.begin(), samples.end());
+   result.maxNs = *std::max_element(samples.begin(), samples.end());
+
+   result.counters = counters;
+   for (MicroBenchCounter& counter : result.counters)
+   {
+      if (counter.isRate)
+         counter.value = result.medianNs > 0.0 ? counter.value * 1000000000.0 / result.medianNs : 0.0;
+   }
+   return result;
+}
+
+bool MicroBenchRunner::_writeJson(const std::string& fileName) const
+{
+   FILE* file = fopen(fileName.c_str(), "w");
+   if (!file)
+      return false;
+
+   fprintf(file, "{\n\"samples\":%u,\n\"minSampleMs\":%.3f,\n\"benchmarks\":[\n", mOptions.samples, mOptions.minSampleMs);
+   for (size_t i = 0; i < mResults.size(); i++)
+   {
+      const MicroBenchResult& result = mResults[i];
+
+      fprintf(file, "{\"name\":");
+      writeJsonString(file, result.name.c_str());
+      fprintf(file, ",\"iterations\":%llu,\"itemsPerIteration\":%llu,\"medianNs\":%.4f,\"madNs\":%.4f,\"meanNs\":%.4f,\"minNs\":%.4f,\"maxNs\":%.4f,\"nsPerItem\":%.6f",
+         (unsigned long long)result.iterationsPerSample, (unsigned long long)result.itemsPerIteration,
+         result.medianNs, result.madNs, result.meanNs, result.minNs, result.maxNs, result.medianNs / result.itemsPerIteration);
+      if (!result.counters.empty())
+      {
+         fprintf(file, ",\"counters\":{");
+         for (size_t c = 0; c < result.counters.size(); c++)
+         {
+            writeJsonString(file, result.counters[c].name.c_str());
+            fprintf(file, c + 1 < result.counters.size() ? ":%.6f," : ":%.6f", result.counters[c].value);
+         }
+         fprintf(file, "}");
+      }
+      fprintf(file, "}");
+      fprintf(file, i + 1 < mResults.size() ? ",\n" : "\n");
+   }
+   fprintf(file, "]\n}\n");
+
+   fclose(file);
+   return true;
+}
+
+bool MicroBenchRunner::_writeCsv(const std::string& fileName) const
+{
+   FILE* file = fopen(fileName.c_str(), "w");
+   if (!file)
+      return false;
+
+   // Counters go in the last column as name=value pairs, benchmarks report different ones.
+   fprintf(file, "benchmark,iterations,items_per_iteration,median_ns,mad_ns,mean_ns,min_ns,max_ns,ns_per_item,counters\n");
+   for (const MicroBenchResult& result : mResults)
+   {
+      fprintf(file, "\"%s\",%llu,%llu,%.4f,%.4f,%.4f,%.4f,%.4f,%.6f,\"", result.name.c_str(),
+         (unsigned long long)result.iterationsPerSample, (unsigned long long)result.itemsPerIteration,
+         result.medianNs, result.madNs, result.meanNs, result.minNs, result.maxNs, result.medianNs / result.itemsPerIteration);
+      for (size_t c = 0; c < result.counters.size(); c++)
+         fprintf(file, c > 0 ? ";%s=%.6f" : "%s=%.6f", result.counters[c].name.c_str(), result.counters[c].value);
+      fprintf(file, "\"\n");
+   }
+
+   fclose(file);
+   return true;
+}
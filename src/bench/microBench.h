@@ -0,0 +1,150 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include "core/profiler.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define MICRO_BENCHMARK(function) \
+   static MicroBenchRep PROFILE_CONCAT(sMicroBenchRep, __LINE__)(#function, function)
+
+#define MICRO_BENCHMARK_ARGS(function, ...) \
+   static MicroBenchRep PROFILE_CONCAT(sMicroBenchRep, __LINE__)(#function, function, { __VA_ARGS__ })
+
+template<typename T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(_MSC_VER)
+   const volatile char* byte = reinterpret_cast<const volatile char*>(&value);
+   (void)*byte;
+   _ReadWriteBarrier();
+#else
+   asm volatile("" : : "g"(&value) : "memory");
+#endif
+}
+
+// Reported next to the timings. A rate is an amount per iteration, reported per second.
+struct MicroBenchCounter
+{
+   std::string name;
+   double value;
+   bool isRate;
+};
+
+// Only the while (state.keepRunning()) loop is timed.
+class MicroBenchState
+{
+public:
+   MicroBenchState(uint64_t iterations, int64_t arg) : mIterations(iterations), mRemaining(iterations), mArg(arg) {}
+
+   inline bool keepRunning()
+   {
+      if (mRemaining > 0)
+      {
+         if (mRemaining-- == mIterations)
+            mStartNs = Profiler::now();
+         return true;
+      }
+
+      mEndNs = Profiler::now();
+      return false;
+   }
+
+   inline int64_t getArg() const { return mArg; }
+
+   inline void setItemsPerIteration(uint64_t items) { mItemsPerIteration = items; }
+   inline uint64_t getItemsPerIteration() const { return mItemsPerIteration; }
+
+   inline void setCounter(const char* name, double value, bool isRate = false) { mCounters.push_back({ name, value, isRate }); }
+   inline const std::vector<MicroBenchCounter>& getCounters() const { return mCounters; }
+
+   inline uint64_t getIterations() const { return mIterations; }
+   inline uint64_t getElapsedNs() const { return mEndNs - mStartNs; }
+
+private:
+   uint64_t mIterations;
+   uint64_t mRemaining;
+   int64_t mArg;
+   uint64_t mItemsPerIteration = 1;
+   std::vector<MicroBenchCounter> mCounters;
+   uint64_t mStartNs = 0;
+   uint64_t mEndNs = 0;
+};
+
+typedef std::function<void(MicroBenchState& state)> MicroBenchFunction;
+
+class MicroBenchRep
+{
+public:
+   static MicroBenchRep* sLast;
+   MicroBenchRep* mNext;
+   std::string mName;
+   MicroBenchFunction mFunction;
+   std::vector<int64_t> mArgs;
+
+   MicroBenchRep(const std::string& name, MicroBenchFunction function, std::vector<int64_t> args = {}) :
+      mName(name), mFunction(function), mArgs(args)
+   {
+      mNext = sLast;
+      sLast = this;
+   }
+
+   static std::vector<MicroBenchRep*> getListOfBenchmarks()
+   {
+      std::vector<MicroBenchRep*> benchmarks;
+
+      for (MicroBenchRep* rep = sLast; rep != nullptr; rep = rep->mNext)
+         benchmarks.insert(benchmarks.begin(), rep);
+
+      return benchmarks;
+   }
+};
+
+struct MicroBenchOptions
+{
+   std::string filter; // only runs benchmarks whose name contains this
+   std::string outputPath = "bench_micro"; // written as <outputPath>.json and <outputPath>.csv
+   uint32_t samples = 30;
+   double minSampleMs = 10.0;
+   bool list = false;
+};
+
+// Nanoseconds per iteration. The spread is the scaled median absolute deviation.
+struct MicroBenchResult
+{
+   std::string name;
+   uint64_t iterationsPerSample;
+   uint64_t itemsPerIteration;
+   uint32_t samples;
+   double medianNs;
+   double madNs;
+   double meanNs;
+   double minNs;
+   double maxNs;
+   std::vector<MicroBenchCounter> counters; // rates already per second
+};
+
+// The iteration count doubles until one run takes minSampleMs, every sample then runs that many.
+class MicroBenchRunner
+{
+public:
+   explicit MicroBenchRunner(const MicroBenchOptions& options) : mOptions(options) {}
+
+   // Returns false and prints the usage on bad arguments.
+   static bool parseArgs(int argc, char* argv[], MicroBenchOptions& outOptions);
+
+   int run();
+
+private:
+   MicroBenchResult _runBenchmark(const std::string& name, const MicroBenchFunction& function, int64_t arg) const;
+   bool _writeJson(const std::string& fileName) const;
+   bool _writeCsv(const std::string& fileName) const;
+
+   MicroBenchOptions mOptions;
+   std::vector<MicroBenchResult> mResults;
+};
@@ -0,0 +1,218 @@
+#include <stdlib.h>
+#include <memory>
+#include <vector>
+#include <glm/gtc/random.hpp>
+#include "bench/microBench.h"
+#include "core/jobSystem.h"
+#include "core/particlePool.h"
+#include "core/particleSystem.h"
+#include "core/radixSort.h"
+
+// 10M particles take about 280MB in a ParticleSystem and 760MB in the AoS reference.
+
+static const float FRAME_TIME_MS = 1000.0f / 60.0f;
+
+// CpuParticlesApp before ParticleSystem, the baseline for the kernels.
+struct AosParticle
+{
+   glm::vec3 pos;
+   glm::vec3 velocity;
+   glm::vec4 color;
+   float lifeTime;
+   float lifeTimeMax;
+};
+
+static void resetAosParticle(AosParticle& p)
+{
+   p.pos = glm::vec3(0);
+   p.velocity = glm::ballRand(3.0);
+   p.lifeTime = 0.0;
+   p.color = glm::vec4(0.0f, 1.0f, 1.0f, 1.0f);
+   p.lifeTimeMax = 2000.0f - ((rand() % 10 + 1) * 100);
+}
+
+static void simulateParticlesAoS(MicroBenchState& state)
+{
+   static std::vector<AosParticle> particles;
+   if (particles.size() != (size_t)state.getArg())
+   {
+      std::vector<AosParticle>().swap(particles);
+      particles.resize((size_t)state.getArg());
+
+      srand(0);
+      for (AosParticle& p : particles)
+      {
+         resetAosParticle(p);
+         p.lifeTime = (float)(rand() % (int)p.lifeTimeMax);
+      }
+   }
+
+   const size_t count = particles.size();
+   const float deltaSeconds = FRAME_TIME_MS / 1000.0f;
+
+   state.setItemsPerIteration(count);
+
+   while (state.keepRunning())
+   {
+      for (size_t i = 0; i < count; ++i)
+      {
+         AosParticle& p = particles[i];
+         p.pos += p.velocity * deltaSeconds;
+         p.lifeTime += FRAME_TIME_MS;
+
+         if (p.lifeTime > p.lifeTimeMax)
+            resetAosParticle(p);
+      }
+
+      doNotOptimize(particles[0]);
+   }
+}
+MICRO_BENCHMARK_ARGS(simulateParticlesAoS, 10000, 100000, 1000000, 10000000);
+
+static ParticleSystem& getParticleSystem(uint32_t count)
+{
+   static ParticleSystem system;
+   if (system.getCount() != count)
+   {
+      system.resize(0);
+      system.resize(count);
+   }
+
+   return system;
+}
+
+static void simulateParticles(MicroBenchState& state, ParticleKernel kernel)
+{
+   ParticleSystem& system = getParticleSystem((uint32_t)state.getArg());
+   system.setKernel(kernel);
+
+   state.setItemsPerIteration(system.getCount());
+
+   while (state.keepRunning())
+      system.simulate(FRAME_TIME_MS);
+
+   doNotOptimize(system);
+}
+
+// One benchmark per kernel the CPU supports, named after it.
+static struct SimulateBenchmarks
+{
+   std::vector<std::unique_ptr<MicroBenchRep>> reps;
+
+   SimulateBenchmarks()
+   {
+      const ParticleKernel kernels[3] = { ParticleKernel::SCALAR, ParticleKernel::SSE2, ParticleKernel::AVX2 };
+      for (ParticleKernel kernel : kernels)
+      {
+         if (!ParticleSystem::isKernelSupported(kernel))
+            continue;
+
+         const std::string name = std::string("ParticleSystem::simulate/") + ParticleSystem::getKernelString(kernel);
+         reps.emplace_back(new MicroBenchRep(name, [kernel](MicroBenchState& state) { simulateParticles(state, kernel); },
+            { 10000, 100000, 1000000, 10000000 }));
+      }
+   }
+} sSimulateBenchmarks;
+
+static void writeVertices(MicroBenchState& state)
+{
+   const ParticleSystem& system = getParticleSystem((uint32_t)state.getArg());
+   const uint32_t count = system.getCount();
+
+   std::vector<ParticleVertex> vertices(count);
+   state.setItemsPerIteration(count);
+
+   while (state.keepRunning())
+   {
+      system.writeVertices(0, count, vertices.data());
+      doNotOptimize(vertices[0]);
+   }
+}
+MICRO_BENCHMARK_ARGS(writeVertices, 10000, 100000, 1000000, 10000000);
+
+// The per frame work of CpuParticlesApp on every hardware thread.
+static void simulateAndWriteParallel(MicroBenchState& state)
+{
+   static JobSystem jobSystem;
+   ParticleSystem& system = getParticleSystem((uint32_t)state.getArg());
+   system.setKernel(ParticleSystem::getBestKernel());
+   const uint32_t count = system.getCount();
+
+   std::vector<ParticleVertex> vertices(count);
+   ParticleVertex* outVertices = vertices.data();
+   state.setItemsPerIteration(count);
+
+   while (state.keepRunning())
+   {
+      jobSystem.parallelFor(count, 16384, [&](uint32_t start, uint32_t end, uint32_t threadIndex)
+      {
+         system.simulateRange(start, end, FRAME_TIME_MS);
+         system.writeVertices(start, end, outVertices);
+      });
+      system.nextFrame();
+   }
+
+   doNotOptimize(vertices[0]);
+}
+MICRO_BENCHMARK_ARGS(simulateAndWriteParallel, 100000, 1000000, 10000000);
+
+static void sortParticles(MicroBenchState& state)
+{
+   static JobSystem jobSystem;
+   static RadixSort sorter;
+   const ParticleSystem& system = getParticleSystem((uint32_t)state.getArg());
+   const uint32_t count = system.getCount();
+
+   glm::vec3 boundsCenter, boundsExtents;
+   system.getBounds(boundsCenter, boundsExtents);
+   const glm::vec3 viewPos(0.0f, 2.0f, 8.0f);
+   const glm::vec3 viewDir = glm::normalize(boundsCenter - viewPos);
+   const float centerDepth = glm::dot(boundsCenter - viewPos, viewDir);
+   const float radius = glm::length(boundsExtents);
+
+   std::vector<uint32_t> keys(count);
+   std::vector<uint32_t> indices(count);
+   uint32_t* outKeys = keys.data();
+   state.setItemsPerIteration(count);
+
+   while (state.keepRunning())
+   {
+      jobSystem.parallelFor(count, 16384, [&](uint32_t start, uint32_t end, uint32_t threadIndex)
+      {
+         system.writeSortKeys(start, end, viewPos, viewDir, centerDepth - radius, centerDepth + radius, outKeys);
+      });
+      sorter.sort(jobSystem, outKeys, count, indices.data());
+      doNotOptimize(indices[0]);
+   }
+}
+MICRO_BENCHMARK_ARGS(sortParticles, 100000, 1000000);
+
+// 64 emitters keeping a pool of arg particles full, all in view.
+static void simulateEmitters(MicroBenchState& state)
+{
+   static JobSystem jobSystem;
+   const uint32_t capacity = (uint32_t)state.getArg();
+
+   ParticlePool pool;
+   pool.setCapacity(capacity);
+   for (int i = 0; i < 64; i++)
+   {
+      ParticleEmitterDesc desc;
+      desc.position = glm::vec3((float)(i % 8), 0.0f, (float)(i / 8)) * 12.0f;
+      desc.spawnRate = capacity / 64.0f;
+      pool.addEmitter(desc);
+   }
+
+   // Long enough for the first particles to expire.
+   const Frustum frustum;
+   for (int i = 0; i < 150; i++)
+      pool.simulate(jobSystem, FRAME_TIME_MS, frustum);
+
+   state.setItemsPerIteration(pool.getDrawCount());
+
+   while (state.keepRunning())
+      pool.simulate(jobSystem, FRAME_TIME_MS, frustum);
+
+   doNotOptimize(pool.getDrawCount());
+}
+MICRO_BENCHMARK_ARGS(simulateEmitters, 100000, 1000000);
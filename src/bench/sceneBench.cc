@@ -0,0 +1,196 @@
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "bench/microBench.h"
+#include "core/camera.h"
+#include "core/instanceCuller.h"
+#include "core/instancePacking.h"
+#include "core/jobSystem.h"
+#include "gfx/gfxLightClusters.h"
+
+static void createCubeData(MicroBenchState& state)
+{
+   const int gridSize = (int)sqrt((double)state.getArg());
+   std::vector<glm::mat4> modelMatrices(gridSize * gridSize);
+
+   state.setItemsPerIteration(modelMatrices.size());
+
+   while (state.keepRunning())
+   {
+      int idx = 0;
+      for (int x = -gridSize / 2; x < gridSize - gridSize / 2; x++)
+      {
+         for (int z = -gridSize / 2; z < gridSize - gridSize / 2; z++)
+         {
+            glm::vec3 pos = glm::vec3((float)x * 4, 0, (float)z * 4);
+
+            glm::mat4 mat = glm::mat4(1);
+            mat = glm::translate(mat, pos);
+            mat = glm::scale(mat, glm::vec3(2));
+            modelMatrices[idx++] = mat;
+         }
+      }
+
+      doNotOptimize(modelMatrices[0]);
+   }
+}
+MICRO_BENCHMARK_ARGS(createCubeData, 512, 10000, 100000);
+
+// Largest element difference between the matrices and what their packed instances unpack to.
+static float packRoundTripError(const glm::mat4* matrices, const PackedInstance* instances, uint32_t count)
+{
+   float maxError = 0.0f;
+   for (uint32_t i = 0; i < count; i++)
+   {
+      const glm::vec4& r = instances[i].rotation;
+      const glm::vec4& ps = instances[i].positionScale;
+      glm::mat4 unpacked = glm::mat4_cast(glm::quat(r.w, r.x, r.y, r.z)) * ps.w;
+      unpacked[3] = glm::vec4(ps.x, ps.y, ps.z, 1.0f);
+
+      for (int c = 0; c < 4; c++)
+      {
+         const glm::vec4 diff = glm::abs(unpacked[c] - matrices[i][c]);
+         maxError = std::max(maxError, std::max(std::max(diff.x, diff.y), std::max(diff.z, diff.w)));
+      }
+   }
+   return maxError;
+}
+
+static void packCubes(MicroBenchState& state)
+{
+   const uint32_t count = (uint32_t)state.getArg();
+   std::vector<glm::mat4> modelMatrices(count);
+   for (uint32_t i = 0; i < count; i++)
+   {
+      // Every 8th cube is a half turn, the case where w and the off diagonal differences vanish.
+      const float angle = (i % 8) == 0 ? glm::pi<float>() : (float)i * 0.37f;
+      const glm::vec3 axis = glm::normalize(glm::vec3(1.0f, (i & 16) ? -(float)(i % 7) : (float)(i % 7), (i & 32) ? -2.0f : 2.0f));
+
+      glm::mat4 mat = glm::translate(glm::mat4(1), glm::vec3((float)(i % 256) * 4, 0, (float)(i / 256) * 4));
+      mat = glm::rotate(mat, angle, axis);
+      modelMatrices[i] = glm::scale(mat, glm::vec3(2));
+   }
+
+   JobSystem jobSystem;
+   std::vector<PackedInstance> instances(count);
+
+   state.setItemsPerIteration(count);
+
+   while (state.keepRunning())
+   {
+      packInstances(jobSystem, modelMatrices.data(), count, instances.data());
+      doNotOptimize(instances[0]);
+   }
+
+   // The SSE2 path packs four at a time, fewer than four go through the scalar one.
+   PackedInstance tail[3];
+   packInstances(modelMatrices.data(), 3, tail);
+   const float error = std::max(packRoundTripError(modelMatrices.data(), instances.data(), count), packRoundTripError(modelMatrices.data(), tail, 3));
+   if (error > 1e-4f)
+      printf("packCubes: packed instances are off by %g\n", error);
+   state.setCounter("max error", error);
+}
+MICRO_BENCHMARK_ARGS(packCubes, 512, 10000, 100000);
+
+// Seen from above one corner, so most leaves are either out of view or straddle a plane.
+static void cullInstances(MicroBenchState& state)
+{
+   const uint32_t count = (uint32_t)state.getArg();
+   const int gridSize = (int)ceil(sqrt((double)count));
+   std::vector<glm::vec3> centers(count);
+   std::vector<glm::vec3> extents(count, glm::vec3(1.0f));
+   for (uint32_t i = 0; i < count; i++)
+      centers[i] = glm::vec3((float)((int)i % gridSize - gridSize / 2) * 4 + 1, 1.0f, (float)((int)i / gridSize - gridSize / 2) * 4 + 1);
+
+   Camera camera;
+   camera.setPosition(glm::vec3(gridSize * -2.0f, 25.0f, gridSize * -2.0f));
+   camera.setYawPitch(0.785f, -0.1f);
+   camera.update(0.0, Move());
+   camera.setProjectionMatrix(glm::perspective(glm::radians(110.0f), 16.0f / 9.0f, 0.01f, 500.0f));
+
+   JobSystem jobSystem;
+   InstanceCuller culler;
+   culler.build(jobSystem, centers.data(), extents.data(), count);
+   const Frustum frustum = camera.getFrustum();
+
+   std::vector<uint32_t> visible(count);
+   state.setItemsPerIteration(count);
+
+   while (state.keepRunning())
+   {
+      const uint32_t visibleCount = culler.cull(jobSystem, frustum, visible.data());
+      doNotOptimize(visibleCount);
+   }
+}
+MICRO_BENCHMARK_ARGS(cullInstances, 10000, 100000, 1000000);
+
+static void binLights(MicroBenchState& state)
+{
+   const uint32_t count = (uint32_t)state.getArg();
+   const float extent = 44.0f;
+   const float radius = glm::clamp(sqrtf(24.0f * 4.0f * extent * extent / (glm::pi<float>() * count)), 2.5f, 16.0f);
+
+   std::vector<glm::vec4> spheres(count);
+   uint32_t seed = 1;
+   for (glm::vec4& sphere : spheres)
+   {
+      seed = seed * 1664525 + 1013904223;
+      const float x = ((seed >> 8) * (1.0f / 16777216.0f) * 2.0f - 1.0f) * extent;
+      seed = seed * 1664525 + 1013904223;
+      const float z = ((seed >> 8) * (1.0f / 16777216.0f) * 2.0f - 1.0f) * extent;
+      sphere = glm::vec4(x, 2.0f + radius * 0.5f, z, radius);
+   }
+
+   Camera camera;
+   camera.setPosition(glm::vec3(9.0f, 25.0f, 9.0f));
+   camera.setYawPitch(-2.34f, -1.20f);
+   camera.update(0.0, Move());
+   camera.setProjectionMatrix(glm::perspective(glm::radians(110.0f), 16.0f / 9.0f, 0.01f, 500.0f));
+
+   glm::mat4 projMatrix, viewMatrix;
+   camera.getMatrices(projMatrix, viewMatrix);
+
+   JobSystem jobSystem;
+   GFXLightClusters clusters;
+   clusters.setProjection(projMatrix, 5.0f, 500.0f);
+
+   std::vector<uint32_t> clusterData(GFXLightClusters::CLUSTER_COUNT * 2);
+   std::vector<uint32_t> indices(GFXLightClusters::CLUSTER_COUNT * GFXLightClusters::MAX_LIGHTS_PER_CLUSTER);
+
+   state.setItemsPerIteration(count);
+
+   while (state.keepRunning())
+   {
+      clusters.build(jobSystem, viewMatrix, spheres.data(), count);
+      clusters.writeClusters(clusterData.data());
+      clusters.writeIndices(indices.data());
+      doNotOptimize(indices[0]);
+   }
+}
+MICRO_BENCHMARK_ARGS(binLights, 1024, 16384);
+
+static void cameraUpdate(MicroBenchState& state)
+{
+   Camera camera;
+   camera.setPosition(glm::vec3(1.8f, 2.0f, 1.85f));
+
+   Move move;
+   move.x = 1.0f;
+   move.y = 1.0f;
+   move.yaw = 2.0f;
+   move.pitch = 1.0f;
+
+   while (state.keepRunning())
+   {
+      camera.update(1000.0 / 60.0, move);
+
+      glm::mat4 projMatrix, viewMatrix;
+      camera.getMatrices(projMatrix, viewMatrix);
+      doNotOptimize(viewMatrix);
+   }
+}
+MICRO_BENCHMARK(cameraUpdate);
@@ -0,0 +1,80 @@
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "bench/microBench.h"
+#include "gfx/gfxDevice.h"
+#include "gfx/gfxTextureEncoder.h"
+
+// Same as TextureCompressionApplication's.
+static std::vector<uint8_t> createSourceImage(int32_t size)
+{
+   std::vector<uint8_t> image((size_t)size * size * 4);
+
+   uint32_t seed = 0x12345678;
+   for (int32_t y = 0; y < size; y++)
+   {
+      for (int32_t x = 0; x < size; x++)
+      {
+         float u = (float)x / size;
+         float v = (float)y / size;
+
+         seed = seed * 1664525 + 1013904223;
+         int noise = (int)(seed >> 28) - 8;
+
+         bool checker = ((x / 64) + (y / 64)) & 1;
+         float rings = 0.5f + 0.5f * sinf(sqrtf((u - 0.5f) * (u - 0.5f) + (v - 0.5f) * (v - 0.5f)) * 60.0f);
+
+         int r = (int)(u * 255.0f) + noise;
+         int g = (int)(rings * 255.0f);
+         int b = checker ? 220 : (int)(v * 128.0f) + noise;
+         int a = (int)((1.0f - v) * 255.0f);
+
+         uint8_t* texel = &image[((size_t)y * size + x) * 4];
+         texel[0] = (uint8_t)std::min(std::max(r, 0), 255);
+         texel[1] = (uint8_t)std::min(std::max(g, 0), 255);
+         texel[2] = (uint8_t)std::min(std::max(b, 0), 255);
+         texel[3] = (uint8_t)std::min(std::max(a, 0), 255);
+      }
+   }
+
+   return image;
+}
+
+static void encodeTexture(MicroBenchState& state, GFXTextureInternalFormat format)
+{
+   const int32_t size = (int32_t)state.getArg();
+   const std::vector<uint8_t> image = createSourceImage(size);
+
+   GFXTextureEncoder encoder;
+   std::vector<uint8_t> blocks(GFXDevice::getTextureRegionSize(format, size, size, 1));
+
+   state.setItemsPerIteration((uint64_t)size * size);
+
+   while (state.keepRunning())
+   {
+      encoder.encode(format, image.data(), size, size, blocks.data());
+      doNotOptimize(blocks[0]);
+   }
+
+   std::vector<uint8_t> decoded(image.size());
+   GFXTextureEncoder::decode(format, blocks.data(), size, size, decoded.data());
+
+   state.setCounter("MPix/s", (double)size * size / 1000000.0, true);
+   state.setCounter("PSNR dB", GFXTextureEncoder::computePSNR(format, image.data(), decoded.data(), size, size));
+}
+
+static void encodeBC1(MicroBenchState& state) { encodeTexture(state, GFXTextureInternalFormat::BC1_RGB); }
+static void encodeBC3(MicroBenchState& state) { encodeTexture(state, GFXTextureInternalFormat::BC3_RGBA); }
+static void encodeBC4(MicroBenchState& state) { encodeTexture(state, GFXTextureInternalFormat::BC4_R); }
+static void encodeBC5(MicroBenchState& state) { encodeTexture(state, GFXTextureInternalFormat::BC5_RG); }
+static void encodeBC7(MicroBenchState& state) { encodeTexture(state, GFXTextureInternalFormat::BC7_RGBA); }
+static void encodeETC2RGB(MicroBenchState& state) { encodeTexture(state, GFXTextureInternalFormat::ETC2_RGB8); }
+static void encodeETC2RGBA(MicroBenchState& state) { encodeTexture(state, GFXTextureInternalFormat::ETC2_RGBA8); }
+
+MICRO_BENCHMARK_ARGS(encodeBC1, 256, 1024);
+MICRO_BENCHMARK_ARGS(encodeBC3, 256, 1024);
+MICRO_BENCHMARK_ARGS(encodeBC4, 256, 1024);
+MICRO_BENCHMARK_ARGS(encodeBC5, 256, 1024);
+MICRO_BENCHMARK_ARGS(encodeBC7, 256, 1024);
+MICRO_BENCHMARK_ARGS(encodeETC2RGB, 256, 1024);
+MICRO_BENCHMARK_ARGS(encodeETC2RGBA, 256, 1024);
@@ -0,0 +1,453 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <glad/glad.h>
+#include "app.h"
+#include "benchmark.h"
+#include "core/profiler.h"
+#include "gfx/gfxDevice.h"
+
+extern Application* gApplication;
+
+static const double FIXED_TIME_STEP_MS = 1000.0 / 60.0;
+
+static void printUsage()
+{
+   printf("usage: sandbox --bench <AppName> [--frames N] [--warmup M] [--resolution WxH] [--vsync on|off] [--device gl|software] [--reference image.ppm] [--output path]\n");
+}
+
+// Binary PPM, top row first. pixels are RGBA8 rows bottom row first, as devices read them back.
+static bool writePpm(const char* fileName, const std::vector<uint8_t>& pixels, int width, int height)
+{
+   FILE* file = fopen(fileName, "wb");
+   if (!file)
+      return false;
+
+   fprintf(file, "P6\n%d %d\n255\n", width, height);
+
+   std::vector<uint8_t> row((size_t)width * 3);
+   for (int y = height - 1; y >= 0; y--)
+   {
+      const uint8_t* src = &pixels[(size_t)y * width * 4];
+      for (int x = 0; x < width; x++)
+      {
+         row[x * 3 + 0] = src[x * 4 + 0];
+         row[x * 3 + 1] = src[x * 4 + 1];
+         row[x * 3 + 2] = src[x * 4 + 2];
+      }
+      fwrite(row.data(), 1, row.size(), file);
+   }
+
+   return fclose(file) == 0;
+}
+
+static bool readPpm(const char* fileName, std::vector<uint8_t>& outRgb, int& outWidth, int& outHeight)
+{
+   FILE* file = fopen(fileName, "rb");
+   if (!file)
+      return false;
+
+   int maxValue = 0;
+   bool valid = fscanf(file, "P6 %d %d %d", &outWidth, &outHeight, &maxValue) == 3 && maxValue == 255 && outWidth > 0 && outHeight > 0;
+   valid = valid && fgetc(file) != EOF; // the single whitespace before the pixels
+
+   if (valid)
+   {
+      outRgb.resize((size_t)outWidth * outHeight * 3);
+      valid = fread(outRgb.data(), 1, outRgb.size(), file) == outRgb.size();
+   }
+
+   fclose(file);
+   return valid;
+}
+
+static void writeJsonString(FILE* file, const char* str)
+{
+   fputc('"', file);
+   for (; *str; str++)
+   {
+      if (*str == '"' || *str == '\\')
+         fputc('\\', file);
+      fputc(*str, file);
+   }
+   fputc('"', file);
+}
+
+static void writeJsonStats(FILE* file, const BenchmarkStats& stats)
+{
+   fprintf(file, "{\"samples\":%u,\"mean\":%.4f,\"p50\":%.4f,\"p95\":%.4f,\"p99\":%.4f,\"max\":%.4f}",
+      stats.samples, stats.mean, stats.p50, stats.p95, stats.p99, stats.max);
+}
+
+static void writeCsvStats(FILE* file, const char* name, const BenchmarkStats& stats)
+{
+   fprintf(file, "\"%s\",%u,%.4f,%.4f,%.4f,%.4f,%.4f\n", name, stats.samples, stats.mean, stats.p50, stats.p95, stats.p99, stats.max);
+}
+
+bool BenchmarkRunner::parseArgs(int argc, char* argv[], BenchmarkOptions& outOptions)
+{
+   for (int i = 1; i < argc; i++)
+   {
+      const char* arg = argv[i];
+      const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+      if (!value)
+      {
+         printUsage();
+         return false;
+      }
+
+      if (strcmp(arg, "--bench") == 0)
+      {
+         outOptions.appName = value;
+      }
+      else if (strcmp(arg, "--frames") == 0)
+      {
+         outOptions.frames = (uint32_t)atoi(value);
+      }
+      else if (strcmp(arg, "--warmup") == 0)
+      {
+         outOptions.warmupFrames = (uint32_t)atoi(value);
+      }
+      else if (strcmp(arg, "--resolution") == 0)
+      {
+         if (sscanf(value, "%dx%d", &outOptions.width, &outOptions.height) != 2 || outOptions.width <= 0 || outOptions.height <= 0)
+         {
+            printUsage();
+            return false;
+         }
+      }
+      else if (strcmp(arg, "--vsync") == 0)
+      {
+         outOptions.vsync = strcmp(value, "on") == 0;
+      }
+      else if (strcmp(arg, "--device") == 0)
+      {
+         if (strcmp(value, "gl") == 0)
+            outOptions.deviceApi = GFXApi::OpenGL;
+         else if (strcmp(value, "software") == 0)
+            outOptions.deviceApi = GFXApi::Software;
+         else
+         {
+            printUsage();
+            return false;
+         }
+      }
+      else if (strcmp(arg, "--reference") == 0)
+      {
+         outOptions.referencePath = value;
+      }
+      else if (strcmp(arg, "--output") == 0)
+      {
+         outOptions.outputPath = value;
+      }
+      else
+      {
+         printUsage();
+         return false;
+      }
+
+      i++;
+   }
+
+   if (outOptions.appName.empty() || outOptions.frames == 0)
+   {
+      printUsage();
+      return false;
+   }
+
+   if (outOptions.outputPath.empty())
+      outOptions.outputPath = "bench_" + outOptions.appName;
+
+   return true;
+}
+
+int BenchmarkRunner::run()
+{
+   Application* app = ApplicationRep::create(mOptions.appName);
+   if (!app)
+   {
+      printf("Unknown application '%s', available applications:\n", mOptions.appName.c_str());
+      for (const ApplicationRep* rep : ApplicationRep::getListOfApplications())
+         printf("   %s\n", rep->mName.c_str());
+      return 1;
+   }
+
+   if (!app->supportsDeviceApi(mOptions.deviceApi))
+   {
+      printf("%s can't render with the requested device\n", mOptions.appName.c_str());
+      delete app;
+      return 1;
+   }
+
+   // Anything seeded from rand() starts out the same every run.
+   srand(0);
+
+   gApplication = app;
+   app->setDeviceApi(mOptions.deviceApi);
+   app->setHeadless(mOptions.deviceApi == GFXApi::Software);
+   app->init(mOptions.width, mOptions.height);
+   app->setVerticalSync(mOptions.vsync);
+   app->setFixedTimeStep(FIXED_TIME_STEP_MS);
+   app->setInputEnabled(false);
+
+   char renderer[256];
+   if (app->getGraphicsDevice())
+      snprintf(renderer, sizeof(renderer), "%s", app->getGraphicsDevice()->getGFXDeviceRendererDesc());
+   else
+      snprintf(renderer, sizeof(renderer), "%s", glGetString(GL_RENDERER));
+
+   printf("Benchmarking %s: %u frames after %u warmup frames at %dx%d\n", mOptions.appName.c_str(), mOptions.frames, mOptions.warmupFrames, mOptions.width, mOptions.height);
+
+   // Every update closes the profiler frame of the update before it, so one more update is
+   // needed to see the last frame.
+   const uint32_t updates = mOptions.warmupFrames + mOptions.frames + 1;
+   for (uint32_t i = 0; i < updates; i++)
+   {
+      if (!app->update() || gApplication != app)
+      {
+         printf("Benchmark aborted, the window was closed\n");
+         return 1;
+      }
+
+      if (i > mOptions.warmupFrames)
+         _recordFrame();
+   }
+
+   const std::string imageFile = mOptions.outputPath + ".ppm";
+   if (!_captureImage(app, imageFile))
+      printf("No image of the last frame, the app doesn't render through a device that can read it back\n");
+
+   app->destroy();
+   delete app;
+   gApplication = nullptr;
+
+   const std::string jsonFile = mOptions.outputPath + ".json";
+   const std::string csvFile = mOptions.outputPath + ".csv";
+   if (!_writeJson(jsonFile, renderer) || !_writeCsv(csvFile))
+   {
+      printf("Failed to write %s or %s\n", jsonFile.c_str(), csvFile.c_str());
+      return 1;
+   }
+
+   const BenchmarkStats cpu = computeStats(mCpuFrameMs);
+   const BenchmarkStats gpu = computeStats(mGpuFrameMs);
+   printf("CPU frame: mean %.3f ms, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms\n", cpu.mean, cpu.p50, cpu.p95, cpu.p99, cpu.max);
+   if (gpu.samples > 0)
+      printf("GPU frame: mean %.3f ms, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms\n", gpu.mean, gpu.p50, gpu.p95, gpu.p99, gpu.max);
+   else
+      printf("GPU frame: no samples, the device doesn't time its frames\n");
+   if (!mImageFile.empty())
+      printf("Wrote %s and %s, last frame in %s\n", jsonFile.c_str(), csvFile.c_str(), mImageFile.c_str());
+   else
+      printf("Wrote %s and %s\n", jsonFile.c_str(), csvFile.c_str());
+
+   if (!mOptions.referencePath.empty() && mImagePsnr >= 0.0)
+   {
+      if (mImageMaxError == 0)
+         printf("Last frame matches %s\n", mOptions.referencePath.c_str());
+      else
+         printf("Last frame against %s: PSNR %.2f dB, max channel error %u\n", mOptions.referencePath.c_str(), mImagePsnr, mImageMaxError);
+   }
+
+   return 0;
+}
+
+BenchmarkStats BenchmarkRunner::computeStats(std::vector<double> samples)
+{
+   BenchmarkStats stats = {};
+   if (samples.empty())
+      return stats;
+
+   std::sort(samples.begin(), samples.end());
+
+   // Nearest rank, so every percentile is a frame time that actually happened.
+   auto percentile = [&samples](double p)
+   {
+      size_t rank = (size_t)ceil(p / 100.0 * samples.size());
+      return samples[rank > 0 ? rank - 1 : 0];
+   };
+
+   double sum = 0.0;
+   for (double sample : samples)
+      sum += sample;
+
+   stats.samples = (uint32_t)samples.size();
+   stats.mean = sum / samples.size();
+   stats.p50 = percentile(50.0);
+   stats.p95 = percentile(95.0);
+   stats.p99 = percentile(99.0);
+   stats.max = samples.back();
+   return stats;
+}
+
+bool BenchmarkRunner::_captureImage(Application* app, const std::string& fileName)
+{
+   GFXDevice* device = app->getGraphicsDevice();
+
+   std::vector<uint8_t> pixels;
+   int width, height;
+   if (!device || !device->readPresentedImage(pixels, width, height) || !writePpm(fileName.c_str(), pixels, width, height))
+      return false;
+
+   mImageFile = fileName;
+   if (mOptions.referencePath.empty())
+      return true;
+
+   std::vector<uint8_t> reference;
+   int referenceWidth, referenceHeight;
+   if (!readPpm(mOptions.referencePath.c_str(), reference, referenceWidth, referenceHeight) || referenceWidth != width || referenceHeight != height)
+   {
+      printf("%s can't be compared, it is missing or not a %dx%d PPM image\n", mOptions.referencePath.c_str(), width, height);
+      return true;
+   }
+
+   // The reference is stored top row first.
+   double squaredError = 0.0;
+   for (int y = 0; y < height; y++)
+   {
+      const uint8_t* row = &pixels[(size_t)y * width * 4];
+      const uint8_t* referenceRow = &reference[(size_t)(height - 1 - y) * width * 3];
+      for (int x = 0; x < width; x++)
+      {
+         for (int c = 0; c < 3; c++)
+         {
+            const int error = abs((int)row[x * 4 + c] - (int)referenceRow[x * 3 + c]);
+            mImageMaxError = std::max(mImageMaxError, (uint32_t)error);
+            squaredError += error * error;
+         }
+      }
+   }
+
+   const double mse = squaredError / ((double)width * height * 3);
+   mImagePsnr = mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : INFINITY;
+   return true;
+}
+
+void BenchmarkRunner::_recordFrame()
+{
+   mCpuFrameMs.push_back(Profiler::getFrameMs());
+
+   // GPU frames land a few frames late and sometimes several at once, a frame without any adds
+   // no GPU samples rather than a 0. Their timers are sampled once per GPU frame, the GPU track
+   // in the CPU frame tree would merge every GPU frame that landed into one sample.
+   for (const ProfileGpuFrame& gpuFrame : Profiler::getGpuFrames())
+   {
+      mGpuFrameMs.push_back(gpuFrame.frameMs);
+      _addTreeSamples(gpuFrame.tree, false);
+   }
+
+   _addTreeSamples(Profiler::getFrameTree(), true);
+}
+
+void BenchmarkRunner::_addTreeSamples(const std::vector<ProfileNode>& tree, bool skipGpuTrack)
+{
+   std::vector<const char*> path;
+   std::string name;
+   for (size_t i = 0; i < tree.size(); i++)
+   {
+      const ProfileNode& node = tree[i];
+      if (skipGpuTrack && node.depth == 0 && strcmp(node.name, "GPU") == 0)
+      {
+         i += node.subtreeSize - 1;
+         continue;
+      }
+
+      path.resize(node.depth);
+      path.push_back(node.name);
+
+      name.clear();
+      for (const char* part : path)
+      {
+         if (!name.empty())
+            name += '/';
+         name += part;
+      }
+
+      _addSample(name, node.totalMs);
+   }
+}
+
+void BenchmarkRunner::_addSample(const std::string& name, double ms)
+{
+   const auto& found = mScopeIndices.find(name);
+   if (found != mScopeIndices.end())
+   {
+      mScopes[found->second].second.push_back(ms);
+      return;
+   }
+
+   mScopeIndices[name] = mScopes.size();
+   mScopes.emplace_back(name, std::vector<double>(1, ms));
+}
+
+bool BenchmarkRunner::_writeJson(const std::string& fileName, const char* renderer) const
+{
+   FILE* file = fopen(fileName.c_str(), "w");
+   if (!file)
+      return false;
+
+   fprintf(file, "{\n\"app\":");
+   writeJsonString(file, mOptions.appName.c_str());
+   fprintf(file, ",\n\"renderer\":");
+   writeJsonString(file, renderer);
+   fprintf(file, ",\n\"device\":\"%s\"", mOptions.deviceApi == GFXApi::Software ? "software" : "gl");
+   if (!mImageFile.empty())
+   {
+      fprintf(file, ",\n\"image\":");
+      writeJsonString(file, mImageFile.c_str());
+   }
+   if (mImagePsnr >= 0.0)
+   {
+      // An identical image has no finite PSNR, JSON has no infinity.
+      fprintf(file, ",\n\"reference\":");
+      writeJsonString(file, mOptions.referencePath.c_str());
+      if (mImageMaxError == 0)
+         fprintf(file, ",\n\"imagePsnr\":null,\n\"imageMaxError\":0");
+      else
+         fprintf(file, ",\n\"imagePsnr\":%.4f,\n\"imageMaxError\":%u", mImagePsnr, mImageMaxError);
+   }
+   fprintf(file, ",\n\"frames\":%u,\n\"warmupFrames\":%u,\n\"width\":%d,\n\"height\":%d,\n\"vsync\":%s,\n",
+      mOptions.frames, mOptions.warmupFrames, mOptions.width, mOptions.height, mOptions.vsync ? "true" : "false");
+
+   // Devices that don't time their frames leave gpuFrameMs out instead of reporting zeros.
+   fprintf(file, "\"cpuFrameMs\":");
+   writeJsonStats(file, computeStats(mCpuFrameMs));
+   if (!mGpuFrameMs.empty())
+   {
+      fprintf(file, ",\n\"gpuFrameMs\":");
+      writeJsonStats(file, computeStats(mGpuFrameMs));
+   }
+
+   fprintf(file, ",\n\"scopes\":{\n");
+   for (size_t i = 0; i < mScopes.size(); i++)
+   {
+      writeJsonString(file, mScopes[i].first.c_str());
+      fputc(':', file);
+      writeJsonStats(file, computeStats(mScopes[i].second));
+      fprintf(file, i + 1 < mScopes.size() ? ",\n" : "\n");
+   }
+   fprintf(file, "}\n}\n");
+
+   fclose(file);
+   return true;
+}
+
+bool BenchmarkRunner::_writeCsv(const std::string& fileName) const
+{
+   FILE* file = fopen(fileName.c_str(), "w");
+   if (!file)
+      return false;
+
+   fprintf(file, "metric,samples,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n");
+   writeCsvStats(file, "cpuFrame", computeStats(mCpuFrameMs));
+   if (!mGpuFrameMs.empty())
+      writeCsvStats(file, "gpuFrame", computeStats(mGpuFrameMs));
+   for (const auto& scope : mScopes)
+      writeCsvStats(file, scope.first.c_str(), computeStats(scope.second));
+
+   fclose(file);
+   return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "gfx/gfxTypes.h"
+
+class Application;
+struct ProfileNode;
+
+struct BenchmarkOptions
+{
+   std::string appName;
+   std::string outputPath; // written as <outputPath>.json, <outputPath>.csv and <outputPath>.ppm
+   std::string referencePath; // image of an earlier run to compare the last frame with
+   GFXApi deviceApi = GFXApi::OpenGL; // the software device runs without a window
+   uint32_t frames = 1000;
+   uint32_t warmupFrames = 100;
+   int width = 1920;
+   int height = 1080;
+   bool vsync = false;
+};
+
+struct BenchmarkStats
+{
+   uint32_t samples;
+   double mean;
+   double p50;
+   double p95;
+   double p99;
+   double max;
+};
+
+// Runs an application for a fixed number of frames with a fixed time step and no input, then
+// writes frame time statistics per profiler scope, named by path, eg. "GPU/Frame/Forward".
+class BenchmarkRunner
+{
+public:
+   explicit BenchmarkRunner(const BenchmarkOptions& options) : mOptions(options) {}
+
+   // Returns false and prints the usage on bad arguments.
+   static bool parseArgs(int argc, char* argv[], BenchmarkOptions& outOptions);
+
+   int run();
+
+   static BenchmarkStats computeStats(std::vector<double> samples);
+
+private:
+   void _recordFrame();
+   void _addSample(const std::string& name, double ms);
+   void _addTreeSamples(const std::vector<ProfileNode>& tree, bool skipGpuTrack);
+   bool _captureImage(Application* app, const std::string& fileName);
+   bool _writeJson(const std::string& fileName, const char* renderer) const;
+   bool _writeCsv(const std::string& fileName) const;
+
+   BenchmarkOptions mOptions;
+
+   // Comparison of the last frame with the reference image, negative without one
+   double mImagePsnr = -1.0;
+   uint32_t mImageMaxError = 0;
+   std::string mImageFile;
+
+   std::vector<double> mCpuFrameMs;
+   std::vector<double> mGpuFrameMs;
+
+   // Samples per scope path, in the order the paths were first seen.
+   std::vector<std::pair<std::string, std::vector<double>>> mScopes;
+   std::unordered_map<std::string, size_t> mScopeIndices;
+};
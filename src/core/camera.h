@@ -1,4 +1,5 @@
 #include <glm/glm.hpp>
+#include "core/frustum.h"
 
 struct Move
 {
@@ -42,6 +43,12 @@ public:
       viewMatrix = mViewMatrix;
    }
 
+   // As of the last update().
+   inline Frustum getFrustum() const
+   {
+      return Frustum(mProjMatrix * mViewMatrix);
+   }
+
 private:
    glm::vec3 mPosition;
    float mPitch;
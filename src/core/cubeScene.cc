@@ -0,0 +1,43 @@
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/color_space.hpp>
+#include "core/cubeScene.h"
+
+const float LIGHT_AREA_EXTENT = 44.0f;
+const float LIGHT_OVERLAP = 24.0f;
+const float LIGHT_RADIUS_MIN = 2.5f;
+const float LIGHT_RADIUS_MAX = 16.0f;
+
+void createSceneCubes(int count, glm::mat4* outMatrices)
+{
+   const int gridSize = (int)ceil(sqrt((double)count));
+   for (int i = 0; i < count; i++)
+   {
+      const int x = i % gridSize - gridSize / 2;
+      const int z = i / gridSize - gridSize / 2;
+      glm::vec3 pos = glm::vec3((float)x * 4, 0, (float)z * 4);
+
+      glm::mat4 mat = glm::mat4(1);
+      mat = glm::translate(mat, pos);
+      mat = glm::scale(mat, glm::vec3(2));
+      outMatrices[i] = mat;
+   }
+}
+
+void createSceneLights(int count, SceneLight* outLights)
+{
+   const float area = 4.0f * LIGHT_AREA_EXTENT * LIGHT_AREA_EXTENT;
+   const float radius = glm::clamp(sqrtf(LIGHT_OVERLAP * area / (glm::pi<float>() * std::max(count, 1))), LIGHT_RADIUS_MIN, LIGHT_RADIUS_MAX);
+
+   for (int i = 0; i < count; i++)
+   {
+      const float x = ((float)rand() / (float)RAND_MAX * 2.0f - 1.0f) * LIGHT_AREA_EXTENT;
+      const float z = ((float)rand() / (float)RAND_MAX * 2.0f - 1.0f) * LIGHT_AREA_EXTENT;
+
+      outLights[i].position = glm::vec4(x, 2.0f + radius * 0.5f, z, radius);
+      outLights[i].color = glm::vec4(glm::rgbColor(glm::vec3(((float)rand()/(float)RAND_MAX)*360.0f, 1.0f, 0.2f)), 1.0);
+   }
+}
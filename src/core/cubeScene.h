@@ -0,0 +1,22 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// The cube grid and lights the forward and deferred rendering apps both draw, so their timings
+// compare the same scene.
+#define SCENE_CUBE_COUNT_MAX (1024 * 1024)
+#define SCENE_LIGHT_COUNT_MAX (256 * 1024)
+
+struct SceneLight
+{
+   glm::vec4 position; // w is the radius
+   glm::vec4 color;
+};
+
+// Rows of ceil(sqrt(count)) cubes around the origin, the last one possibly partial. The cube
+// mesh spans [0, 1] on every axis, twice that once scaled.
+void createSceneCubes(int count, glm::mat4* outMatrices);
+
+// Random lights over the cube grid, sized so any spot is within about LIGHT_OVERLAP of them.
+// Drawn from rand(), seed it for a repeatable scene.
+void createSceneLights(int count, SceneLight* outLights);
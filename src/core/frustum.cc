@@ -0,0 +1,63 @@
+#include "core/frustum.h"
+
+Frustum::Frustum()
+{
+   for (glm::vec4& plane : mPlanes)
+      plane = glm::vec4(0.0f);
+}
+
+Frustum::Frustum(const glm::mat4& viewProjMatrix)
+{
+   setMatrix(viewProjMatrix);
+}
+
+void Frustum::setMatrix(const glm::mat4& viewProjMatrix)
+{
+   // Gribb and Hartmann: each plane is the w row plus or minus the x, y or z row. The near
+   // plane is -w <= z, which is also safe for a [0, 1] depth range, just a bit loose.
+   const glm::mat4 rows = glm::transpose(viewProjMatrix);
+
+   mPlanes[0] = rows[3] + rows[0];
+   mPlanes[1] = rows[3] - rows[0];
+   mPlanes[2] = rows[3] + rows[1];
+   mPlanes[3] = rows[3] - rows[1];
+   mPlanes[4] = rows[3] + rows[2];
+   mPlanes[5] = rows[3] - rows[2];
+
+   for (glm::vec4& plane : mPlanes)
+   {
+      const float length = glm::length(glm::vec3(plane));
+      if (length > 0.0f)
+         plane /= length;
+   }
+}
+
+bool Frustum::intersectsBox(const glm::vec3& center, const glm::vec3& extents) const
+{
+   for (const glm::vec4& plane : mPlanes)
+   {
+      const glm::vec3 normal(plane);
+      const float radius = glm::dot(glm::abs(normal), extents);
+      if (glm::dot(normal, center) + plane.w + radius < 0.0f)
+         return false;
+   }
+
+   return true;
+}
+
+FrustumTest Frustum::classifyBox(const glm::vec3& center, const glm::vec3& extents) const
+{
+   FrustumTest result = FrustumTest::INSIDE;
+   for (const glm::vec4& plane : mPlanes)
+   {
+      const glm::vec3 normal(plane);
+      const float radius = glm::dot(glm::abs(normal), extents);
+      const float distance = glm::dot(normal, center) + plane.w;
+      if (distance + radius < 0.0f)
+         return FrustumTest::OUTSIDE;
+      if (distance - radius < 0.0f)
+         result = FrustumTest::INTERSECTS;
+   }
+
+   return result;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+#include <glm/glm.hpp>
+
+enum class FrustumTest
+{
+   OUTSIDE,
+   INTERSECTS,
+   INSIDE
+};
+
+// Planes of a view projection matrix, facing inwards. Default constructed it culls nothing.
+class Frustum
+{
+public:
+   static const uint32_t PLANE_COUNT = 6;
+
+   Frustum();
+   explicit Frustum(const glm::mat4& viewProjMatrix);
+
+   void setMatrix(const glm::mat4& viewProjMatrix);
+
+   // Boxes near a corner can pass without touching the frustum.
+   bool intersectsBox(const glm::vec3& center, const glm::vec3& extents) const;
+
+   FrustumTest classifyBox(const glm::vec3& center, const glm::vec3& extents) const;
+
+   // Inside when dot(xyz, p) + w >= 0.
+   inline const glm::vec4& getPlane(uint32_t index) const { return mPlanes[index]; }
+
+private:
+   glm::vec4 mPlanes[PLANE_COUNT];
+};
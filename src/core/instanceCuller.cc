@@ -0,0 +1,334 @@
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "core/instanceCuller.h"
+#include "core/profiler.h"
+#include "core/simd.h"
+
+static const uint32_t STREAM_COUNT = 6;
+
+// Spreads the low 10 bits of x to every third bit.
+static uint32_t spreadBits(uint32_t x)
+{
+   x &= 0x3ff;
+   x = (x | (x << 16)) & 0x030000ff;
+   x = (x | (x << 8)) & 0x0300f00f;
+   x = (x | (x << 4)) & 0x030c30c3;
+   x = (x | (x << 2)) & 0x09249249;
+   return x;
+}
+
+InstanceCuller::InstanceCuller() :
+   mCount(0),
+   mUseAvx2(simdSupportsAvx2()),
+   mLeafCount(0)
+{
+}
+
+void InstanceCuller::build(JobSystem& jobSystem, const glm::vec3* centers, const glm::vec3* extents, uint32_t count)
+{
+   PROFILE_SCOPE("InstanceCuller::build");
+
+   mCount = count;
+
+   // Morton keys of the centers, 10 bits per axis across their bounds.
+   glm::vec3 boundsMin(FLT_MAX);
+   glm::vec3 boundsMax(-FLT_MAX);
+   for (uint32_t i = 0; i < count; i++)
+   {
+      boundsMin = glm::min(boundsMin, centers[i]);
+      boundsMax = glm::max(boundsMax, centers[i]);
+   }
+
+   const glm::vec3 scale = 1023.0f / glm::max(boundsMax - boundsMin, glm::vec3(FLT_MIN));
+   std::vector<uint32_t> keys(count);
+   for (uint32_t i = 0; i < count; i++)
+   {
+      const glm::uvec3 cell = glm::uvec3(glm::clamp((centers[i] - boundsMin) * scale, glm::vec3(0.0f), glm::vec3(1023.0f)));
+      keys[i] = spreadBits(cell.x) | (spreadBits(cell.y) << 1) | (spreadBits(cell.z) << 2);
+   }
+
+   const uint32_t usedLeafCount = (count + LEAF_SIZE - 1) / LEAF_SIZE;
+   const uint32_t capacity = usedLeafCount * LEAF_SIZE;
+
+   // Padding slots keep index 0, their boxes never pass.
+   mIndices.assign(capacity, 0);
+   if (count > 0)
+      mSort.sort(jobSystem, keys.data(), count, mIndices.data());
+
+   // One extra cache line of slack to align the start of the first array.
+   std::vector<float> storage(capacity * STREAM_COUNT + SIMD_CACHE_LINE_SIZE / sizeof(float), 0.0f);
+   const uintptr_t alignMask = SIMD_CACHE_LINE_SIZE - 1;
+   float* base = (float*)(((uintptr_t)storage.data() + alignMask) & ~alignMask);
+
+   mCenterX = base;
+   mCenterY = base + capacity;
+   mCenterZ = base + capacity * 2;
+   mExtentX = base + capacity * 3;
+   mExtentY = base + capacity * 4;
+   mExtentZ = base + capacity * 5;
+   mStorage.swap(storage);
+
+   for (uint32_t i = 0; i < capacity; i++)
+   {
+      if (i < count)
+      {
+         const uint32_t index = mIndices[i];
+         mCenterX[i] = centers[index].x;
+         mCenterY[i] = centers[index].y;
+         mCenterZ[i] = centers[index].z;
+         mExtentX[i] = extents[index].x;
+         mExtentY[i] = extents[index].y;
+         mExtentZ[i] = extents[index].z;
+      }
+      else
+      {
+         mCenterX[i] = mCenterY[i] = mCenterZ[i] = NAN;
+      }
+   }
+
+   mLeafCount = 1;
+   while (mLeafCount < usedLeafCount)
+      mLeafCount *= 2;
+
+   // Leaf bounds, then every parent from its children. Empty subtrees keep inverted bounds,
+   // which leave their parent untouched and are never visited.
+   std::vector<glm::vec3> nodeMin(mLeafCount * 2, glm::vec3(FLT_MAX));
+   std::vector<glm::vec3> nodeMax(mLeafCount * 2, glm::vec3(-FLT_MAX));
+   for (uint32_t i = 0; i < count; i++)
+   {
+      const uint32_t node = mLeafCount + i / LEAF_SIZE;
+      const glm::vec3 center(mCenterX[i], mCenterY[i], mCenterZ[i]);
+      const glm::vec3 extent(mExtentX[i], mExtentY[i], mExtentZ[i]);
+      nodeMin[node] = glm::min(nodeMin[node], center - extent);
+      nodeMax[node] = glm::max(nodeMax[node], center + extent);
+   }
+
+   for (uint32_t node = mLeafCount - 1; node > 0; node--)
+   {
+      nodeMin[node] = glm::min(nodeMin[node * 2], nodeMin[node * 2 + 1]);
+      nodeMax[node] = glm::max(nodeMax[node * 2], nodeMax[node * 2 + 1]);
+   }
+
+   mNodes.resize(mLeafCount * 2);
+   for (uint32_t node = 1; node < mLeafCount * 2; node++)
+   {
+      mNodes[node].center = (nodeMin[node] + nodeMax[node]) * 0.5f;
+      mNodes[node].extents = (nodeMax[node] - nodeMin[node]) * 0.5f;
+   }
+
+   const uint32_t jobLeafCount = std::min(JOB_LEAF_COUNT, mLeafCount);
+   const uint32_t jobCount = (usedLeafCount + jobLeafCount - 1) / jobLeafCount;
+   mJobIndices.resize(jobCount * jobLeafCount * LEAF_SIZE);
+   mJobOffsets.resize(jobCount + 1);
+}
+
+uint32_t InstanceCuller::cull(JobSystem& jobSystem, const Frustum& frustum, uint32_t* outIndices)
+{
+   PROFILE_SCOPE("InstanceCuller::cull");
+
+   if (mCount == 0)
+      return 0;
+
+   // Job j walks the j-th subtree at the level with jobCount nodes, writing to its own range.
+   const uint32_t jobLeafCount = std::min(JOB_LEAF_COUNT, mLeafCount);
+   const uint32_t jobCount = (uint32_t)mJobOffsets.size() - 1;
+   const uint32_t firstJobNode = mLeafCount / jobLeafCount;
+
+   jobSystem.parallelFor(jobCount, 1, [&](uint32_t start, uint32_t end, uint32_t threadIndex)
+   {
+      for (uint32_t job = start; job < end; job++)
+      {
+         const uint32_t firstLeaf = job * jobLeafCount;
+         uint32_t* out = mJobIndices.data() + firstLeaf * LEAF_SIZE;
+         mJobOffsets[job + 1] = _cullNode(frustum, firstJobNode + job, firstLeaf, jobLeafCount, out);
+      }
+   });
+
+   mJobOffsets[0] = 0;
+   for (uint32_t job = 0; job < jobCount; job++)
+      mJobOffsets[job + 1] += mJobOffsets[job];
+
+   jobSystem.parallelFor(jobCount, 1, [&](uint32_t start, uint32_t end, uint32_t threadIndex)
+   {
+      for (uint32_t job = start; job < end; job++)
+      {
+         const uint32_t visibleCount = mJobOffsets[job + 1] - mJobOffsets[job];
+         memcpy(outIndices + mJobOffsets[job], mJobIndices.data() + job * jobLeafCount * LEAF_SIZE, visibleCount * sizeof(uint32_t));
+      }
+   });
+
+   return mJobOffsets[jobCount];
+}
+
+const char* InstanceCuller::getKernelString()
+{
+   static const bool avx2 = simdSupportsAvx2();
+   if (avx2)
+      return "AVX2";
+   return SIMD_SSE2 ? "SSE2" : "Scalar";
+}
+
+uint32_t InstanceCuller::_cullNode(const Frustum& frustum, uint32_t node, uint32_t firstLeaf, uint32_t leafCount, uint32_t* out) const
+{
+   const uint32_t start = firstLeaf * LEAF_SIZE;
+   if (start >= mCount)
+      return 0;
+
+   const uint32_t end = std::min((firstLeaf + leafCount) * LEAF_SIZE, mCount);
+   switch (frustum.classifyBox(mNodes[node].center, mNodes[node].extents))
+   {
+   case FrustumTest::OUTSIDE:
+      return 0;
+
+   case FrustumTest::INSIDE:
+      memcpy(out, mIndices.data() + start, (end - start) * sizeof(uint32_t));
+      return end - start;
+
+   case FrustumTest::INTERSECTS:
+      break;
+   }
+
+   if (leafCount == 1)
+   {
+      if (mUseAvx2)
+         return _cullLeafAVX2(frustum, start, end, out);
+      return _cullLeafSSE2(frustum, start, end, out);
+   }
+
+   const uint32_t half = leafCount / 2;
+   const uint32_t visibleCount = _cullNode(frustum, node * 2, firstLeaf, half, out);
+   return visibleCount + _cullNode(frustum, node * 2 + 1, firstLeaf + half, half, out + visibleCount);
+}
+
+uint32_t InstanceCuller::_cullLeafScalar(const Frustum& frustum, uint32_t start, uint32_t end, uint32_t* out) const
+{
+   uint32_t visibleCount = 0;
+   for (uint32_t i = start; i < end; i++)
+   {
+      const glm::vec3 center(mCenterX[i], mCenterY[i], mCenterZ[i]);
+      const glm::vec3 extents(mExtentX[i], mExtentY[i], mExtentZ[i]);
+      if (frustum.intersectsBox(center, extents))
+         out[visibleCount++] = mIndices[i];
+   }
+
+   return visibleCount;
+}
+
+// The SIMD kernels run whole batches past end, into the NaN padding or the next leaf, and
+// store every index of a batch before advancing by the visible ones. Neither writes past the
+// slots of the boxes tested so far.
+uint32_t InstanceCuller::_cullLeafSSE2(const Frustum& frustum, uint32_t start, uint32_t end, uint32_t* out) const
+{
+#if SIMD_SSE2
+   __m128 normalX[Frustum::PLANE_COUNT];
+   __m128 normalY[Frustum::PLANE_COUNT];
+   __m128 normalZ[Frustum::PLANE_COUNT];
+   __m128 absX[Frustum::PLANE_COUNT];
+   __m128 absY[Frustum::PLANE_COUNT];
+   __m128 absZ[Frustum::PLANE_COUNT];
+   __m128 distance[Frustum::PLANE_COUNT];
+   for (uint32_t p = 0; p < Frustum::PLANE_COUNT; p++)
+   {
+      const glm::vec4& plane = frustum.getPlane(p);
+      normalX[p] = _mm_set1_ps(plane.x);
+      normalY[p] = _mm_set1_ps(plane.y);
+      normalZ[p] = _mm_set1_ps(plane.z);
+      absX[p] = _mm_set1_ps(fabsf(plane.x));
+      absY[p] = _mm_set1_ps(fabsf(plane.y));
+      absZ[p] = _mm_set1_ps(fabsf(plane.z));
+      distance[p] = _mm_set1_ps(plane.w);
+   }
+
+   const __m128 zero = _mm_setzero_ps();
+   uint32_t visibleCount = 0;
+   for (uint32_t i = start; i < end; i += 4)
+   {
+      const __m128 centerX = _mm_load_ps(mCenterX + i);
+      const __m128 centerY = _mm_load_ps(mCenterY + i);
+      const __m128 centerZ = _mm_load_ps(mCenterZ + i);
+      const __m128 extentX = _mm_load_ps(mExtentX + i);
+      const __m128 extentY = _mm_load_ps(mExtentY + i);
+      const __m128 extentZ = _mm_load_ps(mExtentZ + i);
+
+      __m128 visible = _mm_cmpeq_ps(zero, zero);
+      for (uint32_t p = 0; p < Frustum::PLANE_COUNT; p++)
+      {
+         const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX[p], centerX), _mm_mul_ps(normalY[p], centerY)),
+            _mm_add_ps(_mm_mul_ps(normalZ[p], centerZ), distance[p]));
+         const __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], extentX), _mm_mul_ps(absY[p], extentY)), _mm_mul_ps(absZ[p], extentZ));
+         visible = _mm_and_ps(visible, _mm_cmpge_ps(_mm_add_ps(d, r), zero));
+      }
+
+      const int mask = _mm_movemask_ps(visible);
+      for (uint32_t lane = 0; lane < 4; lane++)
+      {
+         out[visibleCount] = mIndices[i + lane];
+         visibleCount += (mask >> lane) & 1;
+      }
+   }
+
+   return visibleCount;
+#else
+   return _cullLeafScalar(frustum, start, end, out);
+#endif
+}
+
+SIMD_TARGET_AVX2 uint32_t InstanceCuller::_cullLeafAVX2(const Frustum& frustum, uint32_t start, uint32_t end, uint32_t* out) const
+{
+#if SIMD_AVX2
+   __m256 normalX[Frustum::PLANE_COUNT];
+   __m256 normalY[Frustum::PLANE_COUNT];
+   __m256 normalZ[Frustum::PLANE_COUNT];
+   __m256 absX[Frustum::PLANE_COUNT];
+   __m256 absY[Frustum::PLANE_COUNT];
+   __m256 absZ[Frustum::PLANE_COUNT];
+   __m256 distance[Frustum::PLANE_COUNT];
+   for (uint32_t p = 0; p < Frustum::PLANE_COUNT; p++)
+   {
+      const glm::vec4& plane = frustum.getPlane(p);
+      normalX[p] = _mm256_set1_ps(plane.x);
+      normalY[p] = _mm256_set1_ps(plane.y);
+      normalZ[p] = _mm256_set1_ps(plane.z);
+      absX[p] = _mm256_set1_ps(fabsf(plane.x));
+      absY[p] = _mm256_set1_ps(fabsf(plane.y));
+      absZ[p] = _mm256_set1_ps(fabsf(plane.z));
+      distance[p] = _mm256_set1_ps(plane.w);
+   }
+
+   const __m256 zero = _mm256_setzero_ps();
+   uint32_t visibleCount = 0;
+   for (uint32_t i = start; i < end; i += 8)
+   {
+      const __m256 centerX = _mm256_load_ps(mCenterX + i);
+      const __m256 centerY = _mm256_load_ps(mCenterY + i);
+      const __m256 centerZ = _mm256_load_ps(mCenterZ + i);
+      const __m256 extentX = _mm256_load_ps(mExtentX + i);
+      const __m256 extentY = _mm256_load_ps(mExtentY + i);
+      const __m256 extentZ = _mm256_load_ps(mExtentZ + i);
+
+      __m256 visible = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+      for (uint32_t p = 0; p < Frustum::PLANE_COUNT; p++)
+      {
+         const __m256 d = _mm256_fmadd_ps(normalX[p], centerX, _mm256_fmadd_ps(normalY[p], centerY, _mm256_fmadd_ps(normalZ[p], centerZ, distance[p])));
+         const __m256 r = _mm256_fmadd_ps(absX[p], extentX, _mm256_fmadd_ps(absY[p], extentY, _mm256_mul_ps(absZ[p], extentZ)));
+         visible = _mm256_and_ps(visible, _mm256_cmp_ps(_mm256_add_ps(d, r), zero, _CMP_GE_OQ));
+      }
+
+      const int mask = _mm256_movemask_ps(visible);
+      if (mask == 0)
+         continue;
+
+      for (uint32_t lane = 0; lane < 8; lane++)
+      {
+         out[visibleCount] = mIndices[i + lane];
+         visibleCount += (mask >> lane) & 1;
+      }
+   }
+
+   return visibleCount;
+#else
+   return _cullLeafScalar(frustum, start, end, out);
+#endif
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include "core/frustum.h"
+#include "core/jobSystem.h"
+#include "core/radixSort.h"
+
+// Frustum culls a fixed set of boxes, sorted along a Morton curve into leaves under a binary
+// tree of leaf bounds. Only leaves crossing a plane test their boxes, with SSE2 or AVX2.
+class InstanceCuller
+{
+public:
+   static const uint32_t LEAF_SIZE = 64;
+
+   // Power of two, so every job owns one subtree.
+   static const uint32_t JOB_LEAF_COUNT = 64;
+
+   InstanceCuller();
+
+   // Slow, meant for instances that rarely move.
+   void build(JobSystem& jobSystem, const glm::vec3* centers, const glm::vec3* extents, uint32_t count);
+   inline uint32_t getCount() const { return mCount; }
+
+   // outIndices needs room for getCount(), returns how many were written.
+   uint32_t cull(JobSystem& jobSystem, const Frustum& frustum, uint32_t* outIndices);
+
+   static const char* getKernelString();
+
+private:
+   struct Node
+   {
+      glm::vec3 center;
+      glm::vec3 extents;
+   };
+
+   uint32_t _cullNode(const Frustum& frustum, uint32_t node, uint32_t firstLeaf, uint32_t leafCount, uint32_t* out) const;
+   uint32_t _cullLeafScalar(const Frustum& frustum, uint32_t start, uint32_t end, uint32_t* out) const;
+   uint32_t _cullLeafSSE2(const Frustum& frustum, uint32_t start, uint32_t end, uint32_t* out) const;
+   uint32_t _cullLeafAVX2(const Frustum& frustum, uint32_t start, uint32_t end, uint32_t* out) const;
+
+   uint32_t mCount;
+   bool mUseAvx2;
+
+   // Leaves padded to a power of two. Node 1 is the root, the children of node n are 2n and
+   // 2n + 1, and leaf i is node mLeafCount + i.
+   uint32_t mLeafCount;
+   std::vector<Node> mNodes;
+
+   // Bounds in Morton order, each a cache line aligned array in mStorage padded to whole
+   // leaves with NaN centers, which fail every plane test.
+   std::vector<float> mStorage;
+   float* mCenterX = nullptr;
+   float* mCenterY = nullptr;
+   float* mCenterZ = nullptr;
+   float* mExtentX = nullptr;
+   float* mExtentY = nullptr;
+   float* mExtentZ = nullptr;
+
+   // build() index of every sorted instance.
+   std::vector<uint32_t> mIndices;
+
+   // Visible indices of every job at the start of its subtree's range, then where they go in
+   // the output, with the total at the end.
+   std::vector<uint32_t> mJobIndices;
+   std::vector<uint32_t> mJobOffsets;
+
+   RadixSort mSort;
+};
@@ -0,0 +1,163 @@
+#include <math.h>
+#include <algorithm>
+#include "core/instancePacking.h"
+#include "core/simd.h"
+
+// Scale below which a matrix is treated as degenerate instead of dividing by zero.
+static const float MIN_SCALE = 1e-20f;
+
+// Rotation from the upper 3x3 of a matrix scaled by 1 / scale. The quaternion is built around
+// its largest component, picked from the diagonal, and the others are derived from it so a half
+// turn, where w and the off diagonal differences are zero, keeps the relative signs.
+static void packInstance(const glm::mat4& m, PackedInstance& out)
+{
+   const float scale = sqrtf(m[0][0] * m[0][0] + m[0][1] * m[0][1] + m[0][2] * m[0][2]);
+   const float invScale = 1.0f / std::max(scale, MIN_SCALE);
+   const float r00 = m[0][0] * invScale;
+   const float r11 = m[1][1] * invScale;
+   const float r22 = m[2][2] * invScale;
+   const float dx = (m[1][2] - m[2][1]) * invScale;
+   const float dy = (m[2][0] - m[0][2]) * invScale;
+   const float dz = (m[0][1] - m[1][0]) * invScale;
+   const float sxy = (m[0][1] + m[1][0]) * invScale;
+   const float sxz = (m[2][0] + m[0][2]) * invScale;
+   const float syz = (m[1][2] + m[2][1]) * invScale;
+
+   // 4 * component^2 - 1 for w, x, y and z.
+   const float fourW = r00 + r11 + r22;
+   const float fourX = r00 - r11 - r22;
+   const float fourY = r11 - r00 - r22;
+   const float fourZ = r22 - r00 - r11;
+   const float big = std::max(std::max(fourW, fourX), std::max(fourY, fourZ));
+   const float bigValue = 0.5f * sqrtf(1.0f + big);
+   const float mult = 0.25f / bigValue;
+
+   glm::vec4 q;
+   if (fourW == big)
+      q = glm::vec4(dx * mult, dy * mult, dz * mult, bigValue);
+   else if (fourX == big)
+      q = glm::vec4(bigValue, sxy * mult, sxz * mult, dx * mult);
+   else if (fourY == big)
+      q = glm::vec4(sxy * mult, bigValue, syz * mult, dy * mult);
+   else
+      q = glm::vec4(sxz * mult, syz * mult, bigValue, dz * mult);
+
+   out.positionScale = glm::vec4(m[3][0], m[3][1], m[3][2], scale);
+   out.rotation = q / std::max(glm::length(q), MIN_SCALE);
+}
+
+// getMatrix(i) returns the matrix of instance i.
+template<typename GetMatrix>
+static void packRange(const GetMatrix& getMatrix, uint32_t count, PackedInstance* outInstances)
+{
+   uint32_t i = 0;
+
+#if SIMD_SSE2
+   const __m128 one = _mm_set1_ps(1.0f);
+   const __m128 half = _mm_set1_ps(0.5f);
+   const __m128 quarter = _mm_set1_ps(0.25f);
+   const __m128 minScale = _mm_set1_ps(MIN_SCALE);
+
+   // Same branches as packInstance, all four are computed and picked per lane.
+   auto select = [](__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); };
+
+   for (; i + 4 <= count; i += 4)
+   {
+      // m[c][r] holds element r of column c for all four matrices.
+      __m128 m[4][4];
+      for (int c = 0; c < 4; c++)
+      {
+         m[c][0] = _mm_loadu_ps(&getMatrix(i)[c][0]);
+         m[c][1] = _mm_loadu_ps(&getMatrix(i + 1)[c][0]);
+         m[c][2] = _mm_loadu_ps(&getMatrix(i + 2)[c][0]);
+         m[c][3] = _mm_loadu_ps(&getMatrix(i + 3)[c][0]);
+         _MM_TRANSPOSE4_PS(m[c][0], m[c][1], m[c][2], m[c][3]);
+      }
+
+      const __m128 scale = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0][0], m[0][0]), _mm_mul_ps(m[0][1], m[0][1])),
+         _mm_mul_ps(m[0][2], m[0][2])));
+      const __m128 invScale = _mm_div_ps(one, _mm_max_ps(scale, minScale));
+      const __m128 r00 = _mm_mul_ps(m[0][0], invScale);
+      const __m128 r11 = _mm_mul_ps(m[1][1], invScale);
+      const __m128 r22 = _mm_mul_ps(m[2][2], invScale);
+
+      const __m128 dx = _mm_mul_ps(_mm_sub_ps(m[1][2], m[2][1]), invScale);
+      const __m128 dy = _mm_mul_ps(_mm_sub_ps(m[2][0], m[0][2]), invScale);
+      const __m128 dz = _mm_mul_ps(_mm_sub_ps(m[0][1], m[1][0]), invScale);
+      const __m128 sxy = _mm_mul_ps(_mm_add_ps(m[0][1], m[1][0]), invScale);
+      const __m128 sxz = _mm_mul_ps(_mm_add_ps(m[2][0], m[0][2]), invScale);
+      const __m128 syz = _mm_mul_ps(_mm_add_ps(m[1][2], m[2][1]), invScale);
+
+      const __m128 fourW = _mm_add_ps(_mm_add_ps(r00, r11), r22);
+      const __m128 fourX = _mm_sub_ps(_mm_sub_ps(r00, r11), r22);
+      const __m128 fourY = _mm_sub_ps(_mm_sub_ps(r11, r00), r22);
+      const __m128 fourZ = _mm_sub_ps(_mm_sub_ps(r22, r00), r11);
+      const __m128 big = _mm_max_ps(_mm_max_ps(fourW, fourX), _mm_max_ps(fourY, fourZ));
+      const __m128 bigValue = _mm_mul_ps(half, _mm_sqrt_ps(_mm_add_ps(one, big)));
+      const __m128 mult = _mm_div_ps(quarter, bigValue);
+
+      const __m128 isW = _mm_cmpeq_ps(fourW, big);
+      const __m128 isX = _mm_andnot_ps(isW, _mm_cmpeq_ps(fourX, big));
+      const __m128 isY = _mm_andnot_ps(_mm_or_ps(isW, isX), _mm_cmpeq_ps(fourY, big));
+
+      __m128 qx = select(isW, _mm_mul_ps(dx, mult), select(isX, bigValue, select(isY, _mm_mul_ps(sxy, mult), _mm_mul_ps(sxz, mult))));
+      __m128 qy = select(isW, _mm_mul_ps(dy, mult), select(isX, _mm_mul_ps(sxy, mult), select(isY, bigValue, _mm_mul_ps(syz, mult))));
+      __m128 qz = select(isW, _mm_mul_ps(dz, mult), select(isX, _mm_mul_ps(sxz, mult), select(isY, _mm_mul_ps(syz, mult), bigValue)));
+      __m128 qw = select(isW, bigValue, select(isX, _mm_mul_ps(dx, mult), select(isY, _mm_mul_ps(dy, mult), _mm_mul_ps(dz, mult))));
+
+      const __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy)), _mm_add_ps(_mm_mul_ps(qz, qz), _mm_mul_ps(qw, qw)));
+      const __m128 invLength = _mm_div_ps(one, _mm_max_ps(_mm_sqrt_ps(lengthSq), minScale));
+      qx = _mm_mul_ps(qx, invLength);
+      qy = _mm_mul_ps(qy, invLength);
+      qz = _mm_mul_ps(qz, invLength);
+      qw = _mm_mul_ps(qw, invLength);
+
+      // Back to one instance per register.
+      __m128 px = m[3][0];
+      __m128 py = m[3][1];
+      __m128 pz = m[3][2];
+      __m128 s = scale;
+      _MM_TRANSPOSE4_PS(px, py, pz, s);
+      _MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+
+      float* out = (float*)(outInstances + i);
+      _mm_storeu_ps(out, px);
+      _mm_storeu_ps(out + 4, qx);
+      _mm_storeu_ps(out + 8, py);
+      _mm_storeu_ps(out + 12, qy);
+      _mm_storeu_ps(out + 16, pz);
+      _mm_storeu_ps(out + 20, qz);
+      _mm_storeu_ps(out + 24, s);
+      _mm_storeu_ps(out + 28, qw);
+   }
+#endif
+
+   for (; i < count; i++)
+      packInstance(getMatrix(i), outInstances[i]);
+}
+
+void packInstances(const glm::mat4* matrices, uint32_t count, PackedInstance* outInstances)
+{
+   packRange([matrices](uint32_t i) -> const glm::mat4& { return matrices[i]; }, count, outInstances);
+}
+
+void packInstances(const glm::mat4* matrices, const uint32_t* indices, uint32_t count, PackedInstance* outInstances)
+{
+   packRange([matrices, indices](uint32_t i) -> const glm::mat4& { return matrices[indices[i]]; }, count, outInstances);
+}
+
+void packInstances(JobSystem& jobSystem, const glm::mat4* matrices, uint32_t count, PackedInstance* outInstances)
+{
+   jobSystem.parallelFor(count, INSTANCE_PACK_GRAIN, [&](uint32_t start, uint32_t end, uint32_t threadIndex)
+   {
+      packInstances(matrices + start, end - start, outInstances + start);
+   });
+}
+
+void packInstances(JobSystem& jobSystem, const glm::mat4* matrices, const uint32_t* indices, uint32_t count, PackedInstance* outInstances)
+{
+   jobSystem.parallelFor(count, INSTANCE_PACK_GRAIN, [&](uint32_t start, uint32_t end, uint32_t threadIndex)
+   {
+      packInstances(matrices, indices + start, end - start, outInstances + start);
+   });
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+#include <glm/glm.hpp>
+#include "core/jobSystem.h"
+
+// 32 bytes instead of a 64 byte matrix. The rotation doubles as the normal matrix.
+struct PackedInstance
+{
+   glm::vec4 positionScale; // translation in xyz, uniform scale in w
+   glm::vec4 rotation; // unit quaternion, vector part in xyz
+};
+
+static const uint32_t INSTANCE_PACK_GRAIN = 4096;
+
+// Shear and non uniform scale are lost. outInstances is written front to back, so it can be a
+// mapped buffer.
+void packInstances(const glm::mat4* matrices, uint32_t count, PackedInstance* outInstances);
+void packInstances(JobSystem& jobSystem, const glm::mat4* matrices, uint32_t count, PackedInstance* outInstances);
+
+// Packs matrices[indices[i]] to outInstances[i].
+void packInstances(const glm::mat4* matrices, const uint32_t* indices, uint32_t count, PackedInstance* outInstances);
+void packInstances(JobSystem& jobSystem, const glm::mat4* matrices, const uint32_t* indices, uint32_t count, PackedInstance* outInstances);
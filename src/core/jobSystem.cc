@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include "core/jobSystem.h"
+#include "core/profiler.h"
+
+JobSystem::JobSystem(uint32_t threadCount)
+{
+   mNextIndex = 0;
+   setThreadCount(threadCount);
+}
+
+JobSystem::~JobSystem()
+{
+   _stopWorkers();
+}
+
+uint32_t JobSystem::getHardwareThreadCount()
+{
+   uint32_t count = std::thread::hardware_concurrency();
+   return count > 0 ? count : 1;
+}
+
+void JobSystem::setThreadCount(uint32_t threadCount)
+{
+   if (threadCount == 0)
+      threadCount = getHardwareThreadCount();
+
+   if (threadCount == getThreadCount() && !mShutdown)
+      return;
+
+   _stopWorkers();
+   _startWorkers(threadCount - 1);
+}
+
+void JobSystem::_startWorkers(uint32_t workerCount)
+{
+   mShutdown = false;
+   for (uint32_t i = 0; i < workerCount; i++)
+   {
+      mWorkers.emplace_back(&JobSystem::_workerLoop, this, i + 1, mGeneration);
+   }
+}
+
+void JobSystem::_stopWorkers()
+{
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mShutdown = true;
+   }
+   mWakeCondition.notify_all();
+
+   for (std::thread& worker : mWorkers)
+      worker.join();
+
+   mWorkers.clear();
+}
+
+void JobSystem::parallelFor(uint32_t count, uint32_t grainSize, const RangeFunc& func)
+{
+   if (count == 0)
+      return;
+
+   if (grainSize == 0)
+      grainSize = 1;
+
+   // Not worth waking anybody up for a single range.
+   if (mWorkers.empty() || count <= grainSize)
+   {
+      for (uint32_t start = 0; start < count; start += grainSize)
+         func(start, start + grainSize < count ? start + grainSize : count, 0);
+      return;
+   }
+
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mFunc = &func;
+      mCount = count;
+      mGrainSize = grainSize;
+      mNextIndex = 0;
+      mBusyWorkers = (uint32_t)mWorkers.size();
+      mGeneration++;
+   }
+   mWakeCondition.notify_all();
+
+   _runRanges(0);
+
+   std::unique_lock<std::mutex> lock(mMutex);
+   mDoneCondition.wait(lock, [this]() { return mBusyWorkers == 0; });
+   mFunc = nullptr;
+}
+
+void JobSystem::_runRanges(uint32_t threadIndex)
+{
+   PROFILE_SCOPE("JobSystem::runRanges");
+
+   for (;;)
+   {
+      uint32_t start = mNextIndex.fetch_add(mGrainSize);
+      if (start >= mCount)
+         break;
+
+      uint32_t end = start + mGrainSize < mCount ? start + mGrainSize : mCount;
+      (*mFunc)(start, end, threadIndex);
+   }
+}
+
+void JobSystem::_workerLoop(uint32_t threadIndex, uint64_t lastGeneration)
+{
+   // lastGeneration is captured when the worker is spawned, not when the thread
+   // starts running, so a job issued in between isn't missed.
+   char threadName[Profiler::MAX_THREAD_NAME];
+   snprintf(threadName, sizeof(threadName), "Worker %u", threadIndex);
+   Profiler::setThreadName(threadName);
+
+   for (;;)
+   {
+      {
+         std::unique_lock<std::mutex> lock(mMutex);
+         mWakeCondition.wait(lock, [&]() { return mShutdown || mGeneration != lastGeneration; });
+
+         if (mShutdown)
+            return;
+
+         lastGeneration = mGeneration;
+      }
+
+      _runRanges(threadIndex);
+
+      {
+         std::lock_guard<std::mutex> lock(mMutex);
+         if (--mBusyWorkers == 0)
+            mDoneCondition.notify_one();
+      }
+   }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fork/join worker pool, the calling thread takes part in the work.
+class JobSystem
+{
+public:
+   typedef std::function<void(uint32_t start, uint32_t end, uint32_t threadIndex)> RangeFunc;
+
+   // 0 uses every hardware thread.
+   explicit JobSystem(uint32_t threadCount = 0);
+   ~JobSystem();
+
+   void setThreadCount(uint32_t threadCount);
+
+   inline uint32_t getThreadCount() const
+   {
+      return (uint32_t)mWorkers.size() + 1;
+   }
+
+   static uint32_t getHardwareThreadCount();
+
+   // Blocks until every range ran. threadIndex is 0 for the calling thread. Not reentrant.
+   void parallelFor(uint32_t count, uint32_t grainSize, const RangeFunc& func);
+
+private:
+   void _startWorkers(uint32_t workerCount);
+   void _stopWorkers();
+   void _workerLoop(uint32_t threadIndex, uint64_t lastGeneration);
+   void _runRanges(uint32_t threadIndex);
+
+   std::vector<std::thread> mWorkers;
+   std::mutex mMutex;
+   std::condition_variable mWakeCondition;
+   std::condition_variable mDoneCondition;
+
+   const RangeFunc* mFunc = nullptr;
+   uint32_t mCount = 0;
+   uint32_t mGrainSize = 1;
+   std::atomic<uint32_t> mNextIndex;
+   uint64_t mGeneration = 0;
+   uint32_t mBusyWorkers = 0;
+   bool mShutdown = false;
+};
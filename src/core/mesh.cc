@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unordered_map>
+#include "core/mesh.h"
+
+static bool readTextFile(const char* fileName, std::vector<char>& outText)
+{
+   FILE* file = fopen(fileName, "rb");
+   if (file == nullptr)
+      return false;
+
+   fseek(file, 0, SEEK_END);
+   long size = ftell(file);
+   fseek(file, 0, SEEK_SET);
+
+   outText.resize(size > 0 ? size + 1 : 1);
+   size_t read = size > 0 ? fread(outText.data(), 1, size, file) : 0;
+   outText[read] = '\0';
+
+   fclose(file);
+   return true;
+}
+
+static inline bool isBlank(char c)
+{
+   return c == ' ' || c == '\t';
+}
+
+static inline bool isLineEnd(char c)
+{
+   return c == '\0' || c == '\n' || c == '\r' || c == '#';
+}
+
+static const char* skipBlanks(const char* p)
+{
+   while (isBlank(*p))
+      p++;
+   return p;
+}
+
+static const char* nextLine(const char* p)
+{
+   while (*p != '\0' && *p != '\n')
+      p++;
+   return *p == '\n' ? p + 1 : p;
+}
+
+static const char* parseVec3(const char* p, glm::vec3& outValue)
+{
+   char* end;
+   outValue.x = strtof(p, &end);
+   outValue.y = strtof(end, &end);
+   outValue.z = strtof(end, &end);
+   return end;
+}
+
+// OBJ indices start at 1, negative ones count back from the last element read so far.
+static bool resolveObjIndex(long index, size_t count, int32_t& outIndex)
+{
+   if (index > 0 && (size_t)index <= count)
+   {
+      outIndex = (int32_t)(index - 1);
+      return true;
+   }
+   if (index < 0 && (size_t)-index <= count)
+   {
+      outIndex = (int32_t)(count + index);
+      return true;
+   }
+   return false;
+}
+
+static bool objError(std::string& outError, const char* fileName, int line, const char* message)
+{
+   char buffer[512];
+   snprintf(buffer, sizeof(buffer), "%s:%d: %s", fileName, line, message);
+   outError = buffer;
+   return false;
+}
+
+bool importObj(const char* fileName, MeshData& outMesh, std::string& outError)
+{
+   std::vector<char> text;
+   if (!readTextFile(fileName, text))
+   {
+      outError = std::string("Could not open ") + fileName;
+      return false;
+   }
+
+   outMesh.vertices.clear();
+   outMesh.indices.clear();
+   outMesh.lods.clear();
+
+   std::vector<glm::vec3> positions;
+   std::vector<glm::vec3> normals;
+
+   // Position and normal index pair of every vertex so far, the normal offset by one so faces
+   // without normals use 0.
+   std::unordered_map<uint64_t, uint32_t> vertexMap;
+   std::vector<uint32_t> vertexPositions;
+   std::vector<uint32_t> polygon;
+   bool missingNormals = false;
+
+   int line = 1;
+   for (const char* p = text.data(); *p != '\0'; p = nextLine(p), line++)
+   {
+      p = skipBlanks(p);
+
+      if (p[0] == 'v' && isBlank(p[1]))
+      {
+         glm::vec3 position;
+         parseVec3(p + 2, position);
+         positions.push_back(position);
+      }
+      else if (p[0] == 'v' && p[1] == 'n' && isBlank(p[2]))
+      {
+         glm::vec3 normal;
+         parseVec3(p + 3, normal);
+         normals.push_back(normal);
+      }
+      else if (p[0] == 'f' && isBlank(p[1]))
+      {
+         polygon.clear();
+
+         // Corners are v, v/t, v//n or v/t/n.
+         const char* c = skipBlanks(p + 2);
+         while (!isLineEnd(*c))
+         {
+            char* end;
+            long positionIndex = strtol(c, &end, 10);
+            if (end == c)
+               return objError(outError, fileName, line, "Malformed face");
+            c = end;
+
+            long normalIndex = 0;
+            if (*c == '/')
+            {
+               c++;
+               if (*c != '/')
+               {
+                  strtol(c, &end, 10);
+                  c = end;
+               }
+               if (*c == '/')
+               {
+                  c++;
+                  normalIndex = strtol(c, &end, 10);
+                  if (end == c)
+                     return objError(outError, fileName, line, "Malformed face");
+                  c = end;
+               }
+            }
+
+            if (!isBlank(*c) && !isLineEnd(*c))
+               return objError(outError, fileName, line, "Malformed face");
+
+            int32_t position;
+            int32_t normal = -1;
+            if (!resolveObjIndex(positionIndex, positions.size(), position) || (normalIndex != 0 && !resolveObjIndex(normalIndex, normals.size(), normal)))
+               return objError(outError, fileName, line, "Face index out of range");
+
+            const uint64_t key = ((uint64_t)position << 32) | (uint32_t)(normal + 1);
+            auto inserted = vertexMap.emplace(key, (uint32_t)outMesh.vertices.size());
+            if (inserted.second)
+            {
+               MeshVertex vertex;
+               vertex.position = positions[position];
+               vertex.normal = normal >= 0 ? normals[normal] : glm::vec3(0.0f);
+               outMesh.vertices.push_back(vertex);
+               vertexPositions.push_back(position);
+               missingNormals |= normal < 0;
+            }
+            polygon.push_back(inserted.first->second);
+
+            c = skipBlanks(c);
+         }
+
+         if (polygon.size() < 3)
+            return objError(outError, fileName, line, "Face with less than 3 corners");
+
+         for (size_t i = 2; i < polygon.size(); i++)
+         {
+            outMesh.indices.push_back(polygon[0]);
+            outMesh.indices.push_back(polygon[i - 1]);
+            outMesh.indices.push_back(polygon[i]);
+         }
+      }
+   }
+
+   if (outMesh.indices.empty())
+   {
+      outError = std::string("No faces in ") + fileName;
+      return false;
+   }
+
+   if (missingNormals)
+   {
+      // Area weighted, the cross product is twice the triangle area.
+      std::vector<glm::vec3> smoothNormals(positions.size(), glm::vec3(0.0f));
+      for (size_t i = 0; i < outMesh.indices.size(); i += 3)
+      {
+         const uint32_t a = outMesh.indices[i + 0];
+         const uint32_t b = outMesh.indices[i + 1];
+         const uint32_t c = outMesh.indices[i + 2];
+         const glm::vec3 normal = glm::cross(outMesh.vertices[b].position - outMesh.vertices[a].position, outMesh.vertices[c].position - outMesh.vertices[a].position);
+
+         smoothNormals[vertexPositions[a]] += normal;
+         smoothNormals[vertexPositions[b]] += normal;
+         smoothNormals[vertexPositions[c]] += normal;
+      }
+
+      for (size_t i = 0; i < outMesh.vertices.size(); i++)
+      {
+         if (outMesh.vertices[i].normal != glm::vec3(0.0f))
+            continue;
+
+         const glm::vec3 normal = smoothNormals[vertexPositions[i]];
+         const float length = glm::length(normal);
+         outMesh.vertices[i].normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+      }
+   }
+
+   MeshLod lod = {};
+   lod.indexCount = (uint32_t)outMesh.indices.size();
+   lod.vertexCount = (uint32_t)outMesh.vertices.size();
+   outMesh.lods.push_back(lod);
+
+   computeMeshBounds(outMesh);
+   return true;
+}
+
+void computeMeshBounds(MeshData& mesh)
+{
+   if (mesh.vertices.empty())
+   {
+      mesh.boundsMin = glm::vec3(0.0f);
+      mesh.boundsMax = glm::vec3(0.0f);
+      return;
+   }
+
+   mesh.boundsMin = mesh.vertices[0].position;
+   mesh.boundsMax = mesh.vertices[0].position;
+   for (const MeshVertex& vertex : mesh.vertices)
+   {
+      mesh.boundsMin = glm::min(mesh.boundsMin, vertex.position);
+      mesh.boundsMax = glm::max(mesh.boundsMax, vertex.position);
+   }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Same layout as core/cube.h.
+struct MeshVertex
+{
+   glm::vec3 position;
+   glm::vec3 normal;
+};
+
+struct MeshLod
+{
+   uint32_t indexOffset;
+   uint32_t indexCount;
+   uint32_t vertexOffset;
+   uint32_t vertexCount;
+   float error; // how far the surface can be from the full one, in mesh units
+   float acmr; // vertex shader invocations per triangle, see analyzeVertexCache
+};
+
+// Every level of detail shares the vertex and index buffers, the finest first.
+struct MeshData
+{
+   std::vector<MeshVertex> vertices;
+   std::vector<uint32_t> indices;
+   std::vector<MeshLod> lods;
+   glm::vec3 boundsMin;
+   glm::vec3 boundsMax;
+};
+
+// Positions, normals and faces only. Faces without normals get smooth ones.
+bool importObj(const char* fileName, MeshData& outMesh, std::string& outError);
+
+void computeMeshBounds(MeshData& mesh);
@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "core/meshFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static inline uint64_t alignMeshFileOffset(uint64_t offset)
+{
+   return (offset + MESH_FILE_ALIGNMENT - 1) & ~(uint64_t)(MESH_FILE_ALIGNMENT - 1);
+}
+
+static bool writePadding(FILE* file, uint64_t from, uint64_t to)
+{
+   static const uint8_t zeros[MESH_FILE_ALIGNMENT] = {};
+   return fwrite(zeros, 1, (size_t)(to - from), file) == to - from;
+}
+
+bool writeMeshFile(const char* fileName, const MeshData& mesh, std::string& outError)
+{
+   if (mesh.lods.empty() || mesh.indices.empty())
+   {
+      outError = "Mesh has no levels of detail";
+      return false;
+   }
+
+   MeshFileHeader header = {};
+   header.magic = MESH_FILE_MAGIC;
+   header.version = MESH_FILE_VERSION;
+   header.vertexStride = sizeof(MeshVertex);
+   header.lodCount = std::min((uint32_t)mesh.lods.size(), (uint32_t)MESH_FILE_MAX_LODS);
+
+   // Levels are stored one after the other, so dropped ones are always the tail of the buffers.
+   for (uint32_t i = 0; i < header.lodCount; i++)
+   {
+      header.lods[i] = mesh.lods[i];
+      header.indexCount = std::max(header.indexCount, mesh.lods[i].indexOffset + mesh.lods[i].indexCount);
+      header.vertexCount = std::max(header.vertexCount, mesh.lods[i].vertexOffset + mesh.lods[i].vertexCount);
+   }
+
+   header.indexSize = header.vertexCount <= 65536 ? sizeof(uint16_t) : sizeof(uint32_t);
+   memcpy(header.boundsMin, &mesh.boundsMin, sizeof(header.boundsMin));
+   memcpy(header.boundsMax, &mesh.boundsMax, sizeof(header.boundsMax));
+
+   const uint64_t vertexBytes = (uint64_t)header.vertexCount * header.vertexStride;
+   const uint64_t indexBytes = (uint64_t)header.indexCount * header.indexSize;
+   header.vertexDataOffset = alignMeshFileOffset(sizeof(MeshFileHeader));
+   header.indexDataOffset = alignMeshFileOffset(header.vertexDataOffset + vertexBytes);
+
+   FILE* file = fopen(fileName, "wb");
+   if (file == nullptr)
+   {
+      outError = std::string("Could not create ") + fileName;
+      return false;
+   }
+
+   bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+   written = written && writePadding(file, sizeof(header), header.vertexDataOffset);
+   written = written && fwrite(mesh.vertices.data(), 1, (size_t)vertexBytes, file) == vertexBytes;
+   written = written && writePadding(file, header.vertexDataOffset + vertexBytes, header.indexDataOffset);
+
+   if (header.indexSize == sizeof(uint16_t))
+   {
+      std::vector<uint16_t> shortIndices(mesh.indices.begin(), mesh.indices.begin() + header.indexCount);
+      written = written && fwrite(shortIndices.data(), 1, (size_t)indexBytes, file) == indexBytes;
+   }
+   else
+   {
+      written = written && fwrite(mesh.indices.data(), 1, (size_t)indexBytes, file) == indexBytes;
+   }
+
+   written = fclose(file) == 0 && written;
+   if (!written)
+      outError = std::string("Could not write ") + fileName;
+   return written;
+}
+
+MeshFile::MeshFile()
+{
+   mData = nullptr;
+   mSize = 0;
+#ifdef _WIN32
+   mFile = INVALID_HANDLE_VALUE;
+   mMapping = nullptr;
+#else
+   mFile = -1;
+#endif
+}
+
+MeshFile::~MeshFile()
+{
+   close();
+}
+
+static bool isMeshSectionInside(uint64_t offset, uint64_t size, uint64_t fileSize)
+{
+   return offset % MESH_FILE_ALIGNMENT == 0 && offset <= fileSize && size <= fileSize - offset;
+}
+
+template<typename T>
+static bool areMeshIndicesInside(const T* indices, uint32_t count, uint32_t firstVertex, uint32_t vertexCount)
+{
+   // One pass over the mapped indices, unsigned wrap around folds both bounds into one compare.
+   for (uint32_t i = 0; i < count; i++)
+   {
+      if ((uint32_t)indices[i] - firstVertex >= vertexCount)
+         return false;
+   }
+
+   return true;
+}
+
+bool MeshFile::open(const char* fileName, std::string& outError)
+{
+   close();
+
+#ifdef _WIN32
+   mFile = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+   LARGE_INTEGER fileSize;
+   if (mFile == INVALID_HANDLE_VALUE || !GetFileSizeEx(mFile, &fileSize))
+   {
+      close();
+      outError = std::string("Could not open ") + fileName;
+      return false;
+   }
+   mSize = (size_t)fileSize.QuadPart;
+
+   if (mSize >= sizeof(MeshFileHeader))
+   {
+      mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if (mMapping != nullptr)
+         mData = (const uint8_t*)MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+   }
+#else
+   mFile = ::open(fileName, O_RDONLY);
+   struct stat fileStat;
+   if (mFile < 0 || fstat(mFile, &fileStat) != 0)
+   {
+      close();
+      outError = std::string("Could not open ") + fileName;
+      return false;
+   }
+   mSize = (size_t)fileStat.st_size;
+
+   if (mSize >= sizeof(MeshFileHeader))
+   {
+      void* data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, mFile, 0);
+      if (data != MAP_FAILED)
+         mData = (const uint8_t*)data;
+   }
+#endif
+
+   if (mData == nullptr)
+   {
+      close();
+      outError = std::string("Could not map ") + fileName;
+      return false;
+   }
+
+   const MeshFileHeader& header = getHeader();
+   bool valid = header.magic == MESH_FILE_MAGIC && header.version == MESH_FILE_VERSION;
+   valid = valid && header.vertexStride == sizeof(MeshVertex);
+   valid = valid && (header.indexSize == sizeof(uint16_t) || header.indexSize == sizeof(uint32_t));
+   valid = valid && header.lodCount > 0 && header.lodCount <= MESH_FILE_MAX_LODS;
+   valid = valid && isMeshSectionInside(header.vertexDataOffset, getVertexDataSize(), mSize);
+   valid = valid && isMeshSectionInside(header.indexDataOffset, getIndexDataSize(), mSize);
+
+   for (uint32_t i = 0; valid && i < header.lodCount; i++)
+   {
+      const MeshLod& lod = header.lods[i];
+      valid = (uint64_t)lod.indexOffset + lod.indexCount <= header.indexCount;
+      valid = valid && (uint64_t)lod.vertexOffset + lod.vertexCount <= header.vertexCount;
+
+      // Indices straight from the file would otherwise reach past the vertex buffer on the GPU.
+      if (valid && header.indexSize == sizeof(uint16_t))
+         valid = areMeshIndicesInside((const uint16_t*)getIndexData() + lod.indexOffset, lod.indexCount, lod.vertexOffset, lod.vertexCount);
+      else if (valid)
+         valid = areMeshIndicesInside((const uint32_t*)getIndexData() + lod.indexOffset, lod.indexCount, lod.vertexOffset, lod.vertexCount);
+   }
+
+   if (!valid)
+   {
+      close();
+      outError = std::string(fileName) + " is not a valid version " + std::to_string(MESH_FILE_VERSION) + " mesh file";
+      return false;
+   }
+
+   return true;
+}
+
+void MeshFile::close()
+{
+#ifdef _WIN32
+   if (mData != nullptr)
+      UnmapViewOfFile(mData);
+   if (mMapping != nullptr)
+      CloseHandle(mMapping);
+   if (mFile != INVALID_HANDLE_VALUE)
+      CloseHandle(mFile);
+
+   mMapping = nullptr;
+   mFile = INVALID_HANDLE_VALUE;
+#else
+   if (mData != nullptr)
+      munmap((void*)mData, mSize);
+   if (mFile >= 0)
+      ::close(mFile);
+
+   mFile = -1;
+#endif
+
+   mData = nullptr;
+   mSize = 0;
+}
+
+size_t MeshFile::getResidentSize() const
+{
+#ifdef _WIN32
+   return 0;
+#else
+   if (mData == nullptr)
+      return 0;
+
+   const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+   const size_t pageCount = (mSize + pageSize - 1) / pageSize;
+
+#ifdef __APPLE__
+   std::vector<char> residency(pageCount);
+#else
+   std::vector<unsigned char> residency(pageCount);
+#endif
+   if (mincore((void*)mData, mSize, residency.data()) != 0)
+      return 0;
+
+   size_t residentPages = 0;
+   for (size_t i = 0; i < pageCount; i++)
+      residentPages += residency[i] & 1;
+
+   return std::min(residentPages * pageSize, mSize);
+#endif
+}
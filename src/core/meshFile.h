@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include "core/mesh.h"
+
+#define MESH_FILE_MAGIC 0x534D4253 // "SBMS"
+#define MESH_FILE_VERSION 1
+#define MESH_FILE_MAX_LODS 8
+
+#define MESH_FILE_ALIGNMENT 64
+
+// Followed by the vertices and indices at their offsets. Indices are 16 bit when every vertex
+// fits.
+struct MeshFileHeader
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t vertexCount;
+   uint32_t vertexStride;
+   uint32_t indexCount;
+   uint32_t indexSize;
+   uint32_t lodCount;
+   uint32_t reserved;
+   float boundsMin[3];
+   float boundsMax[3];
+   uint64_t vertexDataOffset;
+   uint64_t indexDataOffset;
+   MeshLod lods[MESH_FILE_MAX_LODS];
+};
+
+bool writeMeshFile(const char* fileName, const MeshData& mesh, std::string& outError);
+
+// Mapped read only, the data can be handed straight to buffer creation without a heap copy.
+class MeshFile
+{
+public:
+   MeshFile();
+   ~MeshFile();
+
+   // Checks every section lies inside the file and every index inside its level's vertices.
+   bool open(const char* fileName, std::string& outError);
+   void close();
+
+   inline bool isOpen() const { return mData != nullptr; }
+   inline const MeshFileHeader& getHeader() const { return *(const MeshFileHeader*)mData; }
+   inline size_t getFileSize() const { return mSize; }
+
+   inline const void* getVertexData() const { return mData + getHeader().vertexDataOffset; }
+   inline size_t getVertexDataSize() const { return (size_t)getHeader().vertexCount * getHeader().vertexStride; }
+   inline const void* getIndexData() const { return mData + getHeader().indexDataOffset; }
+   inline size_t getIndexDataSize() const { return (size_t)getHeader().indexCount * getHeader().indexSize; }
+
+   // Bytes in physical memory, 0 where the platform can't tell.
+   size_t getResidentSize() const;
+
+private:
+   const uint8_t* mData;
+   size_t mSize;
+
+#ifdef _WIN32
+   void* mFile;
+   void* mMapping;
+#else
+   int mFile;
+#endif
+};
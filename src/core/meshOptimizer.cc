@@ -0,0 +1,664 @@
+#include <math.h>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include "core/meshOptimizer.h"
+
+// Tom Forsyth, Linear-Speed Vertex Cache Optimisation, with his constants.
+static const uint32_t FORSYTH_CACHE_SIZE = 32;
+static const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+static const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+static const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+static const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+static const uint32_t FORSYTH_VALENCE_TABLE_SIZE = 32;
+
+static const uint32_t SIMPLIFY_MAX_GRID_RESOLUTION = 1024;
+
+static const float LOD_TRIANGLE_RATIO = 0.5f;
+static const uint32_t LOD_MIN_TRIANGLES = 64;
+
+struct ForsythScores
+{
+   float cache[FORSYTH_CACHE_SIZE];
+   float valence[FORSYTH_VALENCE_TABLE_SIZE];
+
+   ForsythScores()
+   {
+      // The last triangle's vertices score the same whatever their order, so it isn't favored
+      // over its neighbours just for having been drawn.
+      for (uint32_t i = 0; i < FORSYTH_CACHE_SIZE; i++)
+         cache[i] = i < 3 ? FORSYTH_LAST_TRIANGLE_SCORE : powf(1.0f - (float)(i - 3) / (FORSYTH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY_POWER);
+
+      valence[0] = 0.0f;
+      for (uint32_t i = 1; i < FORSYTH_VALENCE_TABLE_SIZE; i++)
+         valence[i] = FORSYTH_VALENCE_BOOST_SCALE * powf((float)i, -FORSYTH_VALENCE_BOOST_POWER);
+   }
+
+   inline float getVertexScore(int32_t cachePosition, uint32_t remainingTriangles) const
+   {
+      if (remainingTriangles == 0)
+         return -1.0f;
+
+      float score = cachePosition >= 0 ? cache[cachePosition] : 0.0f;
+      if (remainingTriangles < FORSYTH_VALENCE_TABLE_SIZE)
+         score += valence[remainingTriangles];
+      else
+         score += FORSYTH_VALENCE_BOOST_SCALE * powf((float)remainingTriangles, -FORSYTH_VALENCE_BOOST_POWER);
+      return score;
+   }
+};
+
+MeshCacheStats analyzeVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+{
+   MeshCacheStats stats = {};
+   if (indexCount < 3 || vertexCount == 0)
+      return stats;
+
+   // A vertex stays in the FIFO until cacheSize other vertices were loaded after it. Load times
+   // start past cacheSize so 0 means never loaded.
+   std::vector<uint32_t> loadTimes(vertexCount, 0);
+   uint32_t time = cacheSize + 1;
+   uint32_t misses = 0;
+   uint32_t usedVertexCount = 0;
+
+   for (uint32_t i = 0; i < indexCount; i++)
+   {
+      const uint32_t vertex = indices[i];
+      if (time - loadTimes[vertex] > cacheSize)
+      {
+         usedVertexCount += loadTimes[vertex] == 0;
+         loadTimes[vertex] = time++;
+         misses++;
+      }
+   }
+
+   stats.acmr = (float)misses / (indexCount / 3);
+   stats.atvr = (float)misses / usedVertexCount;
+   return stats;
+}
+
+void optimizeVertexCache(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount)
+{
+   const uint32_t triangleCount = indexCount / 3;
+   if (triangleCount == 0)
+      return;
+
+   static const ForsythScores scores;
+
+   // Triangles not emitted yet around every vertex, vertexTriangles[triangleOffsets[v]] on,
+   // liveCounts[v] of them.
+   std::vector<uint32_t> liveCounts(vertexCount, 0);
+   for (uint32_t i = 0; i < triangleCount * 3; i++)
+      liveCounts[indices[i]]++;
+
+   std::vector<uint32_t> triangleOffsets(vertexCount);
+   uint32_t offset = 0;
+   for (uint32_t v = 0; v < vertexCount; v++)
+   {
+      triangleOffsets[v] = offset;
+      offset += liveCounts[v];
+   }
+
+   std::vector<uint32_t> vertexTriangles(triangleCount * 3);
+   std::vector<uint32_t> fillCounts(vertexCount, 0);
+   for (uint32_t t = 0; t < triangleCount; t++)
+   {
+      for (uint32_t k = 0; k < 3; k++)
+      {
+         const uint32_t v = indices[t * 3 + k];
+         vertexTriangles[triangleOffsets[v] + fillCounts[v]++] = t;
+      }
+   }
+
+   std::vector<float> vertexScores(vertexCount);
+   for (uint32_t v = 0; v < vertexCount; v++)
+      vertexScores[v] = scores.getVertexScore(-1, liveCounts[v]);
+
+   std::vector<float> triangleScores(triangleCount);
+   uint32_t bestTriangle = 0;
+   for (uint32_t t = 0; t < triangleCount; t++)
+   {
+      triangleScores[t] = vertexScores[indices[t * 3 + 0]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+      if (triangleScores[t] > triangleScores[bestTriangle])
+         bestTriangle = t;
+   }
+
+   std::vector<uint8_t> emitted(triangleCount, 0);
+   std::vector<uint32_t> output(triangleCount * 3);
+   std::vector<int32_t> cachePositions(vertexCount, -1);
+
+   uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+   uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+   uint32_t cacheCount = 0;
+   uint32_t nextTriangle = 0;
+
+   for (uint32_t outputTriangle = 0; outputTriangle < triangleCount; outputTriangle++)
+   {
+      // No triangle left around the cache, carry on with the next one in input order rather
+      // than searching every triangle for the best score.
+      if (bestTriangle == UINT32_MAX)
+      {
+         while (emitted[nextTriangle])
+            nextTriangle++;
+         bestTriangle = nextTriangle;
+      }
+
+      const uint32_t* triangle = &indices[bestTriangle * 3];
+      output[outputTriangle * 3 + 0] = triangle[0];
+      output[outputTriangle * 3 + 1] = triangle[1];
+      output[outputTriangle * 3 + 2] = triangle[2];
+      emitted[bestTriangle] = 1;
+
+      for (uint32_t k = 0; k < 3; k++)
+      {
+         uint32_t* triangles = &vertexTriangles[triangleOffsets[triangle[k]]];
+         uint32_t& count = liveCounts[triangle[k]];
+         for (uint32_t j = 0; j < count; j++)
+         {
+            if (triangles[j] == bestTriangle)
+            {
+               triangles[j] = triangles[--count];
+               break;
+            }
+         }
+      }
+
+      // The triangle moves to the front of the LRU cache, pushing the oldest entries out.
+      uint32_t newCount = 0;
+      for (uint32_t k = 0; k < 3; k++)
+      {
+         if (std::find(newCache, newCache + newCount, triangle[k]) == newCache + newCount)
+            newCache[newCount++] = triangle[k];
+      }
+      for (uint32_t i = 0; i < cacheCount; i++)
+      {
+         if (cache[i] != triangle[0] && cache[i] != triangle[1] && cache[i] != triangle[2])
+            newCache[newCount++] = cache[i];
+      }
+
+      cacheCount = std::min(newCount, FORSYTH_CACHE_SIZE);
+      for (uint32_t i = 0; i < newCount; i++)
+         cachePositions[newCache[i]] = i < cacheCount ? (int32_t)i : -1;
+      std::copy(newCache, newCache + cacheCount, cache);
+
+      // Rescore the vertices that moved, evicted ones included, and the triangles around them.
+      for (uint32_t i = 0; i < newCount; i++)
+      {
+         const uint32_t v = newCache[i];
+         const float score = scores.getVertexScore(cachePositions[v], liveCounts[v]);
+         const float delta = score - vertexScores[v];
+         vertexScores[v] = score;
+
+         const uint32_t* triangles = &vertexTriangles[triangleOffsets[v]];
+         for (uint32_t j = 0; j < liveCounts[v]; j++)
+            triangleScores[triangles[j]] += delta;
+      }
+
+      bestTriangle = UINT32_MAX;
+      float bestScore = 0.0f;
+      for (uint32_t i = 0; i < cacheCount; i++)
+      {
+         const uint32_t v = cache[i];
+         const uint32_t* triangles = &vertexTriangles[triangleOffsets[v]];
+         for (uint32_t j = 0; j < liveCounts[v]; j++)
+         {
+            if (bestTriangle == UINT32_MAX || triangleScores[triangles[j]] > bestScore)
+            {
+               bestTriangle = triangles[j];
+               bestScore = triangleScores[triangles[j]];
+            }
+         }
+      }
+   }
+
+   std::copy(output.begin(), output.end(), indices);
+}
+
+void optimizeOverdraw(uint32_t* indices, uint32_t indexCount, const MeshVertex* vertices)
+{
+   const uint32_t triangleCount = indexCount / 3;
+   if (triangleCount < 2)
+      return;
+
+   uint32_t vertexCount = 0;
+   for (uint32_t i = 0; i < triangleCount * 3; i++)
+      vertexCount = std::max(vertexCount, indices[i] + 1);
+
+   // Same FIFO as analyzeVertexCache, a cluster starts at every triangle missing it three times.
+   std::vector<uint32_t> clusterStarts;
+   std::vector<uint32_t> loadTimes(vertexCount, 0);
+   uint32_t time = MESH_STATS_CACHE_SIZE + 1;
+   for (uint32_t t = 0; t < triangleCount; t++)
+   {
+      uint32_t misses = 0;
+      for (uint32_t k = 0; k < 3; k++)
+      {
+         const uint32_t v = indices[t * 3 + k];
+         if (time - loadTimes[v] > MESH_STATS_CACHE_SIZE)
+         {
+            loadTimes[v] = time++;
+            misses++;
+         }
+      }
+
+      if (t == 0 || misses == 3)
+         clusterStarts.push_back(t);
+   }
+   clusterStarts.push_back(triangleCount);
+
+   const uint32_t clusterCount = (uint32_t)clusterStarts.size() - 1;
+   if (clusterCount < 2)
+      return;
+
+   // Area weighted centroid and normal of every cluster and of the whole mesh. The cross
+   // product length is twice the area, the factor cancels out.
+   std::vector<glm::vec3> clusterCentroids(clusterCount);
+   std::vector<glm::vec3> clusterNormals(clusterCount);
+   std::vector<float> clusterAreas(clusterCount);
+   glm::vec3 meshCentroid(0.0f);
+   float meshArea = 0.0f;
+
+   for (uint32_t cluster = 0; cluster < clusterCount; cluster++)
+   {
+      glm::vec3 centroid(0.0f);
+      glm::vec3 normal(0.0f);
+      float area = 0.0f;
+
+      for (uint32_t t = clusterStarts[cluster]; t < clusterStarts[cluster + 1]; t++)
+      {
+         const glm::vec3& a = vertices[indices[t * 3 + 0]].position;
+         const glm::vec3& b = vertices[indices[t * 3 + 1]].position;
+         const glm::vec3& c = vertices[indices[t * 3 + 2]].position;
+
+         const glm::vec3 cross = glm::cross(b - a, c - a);
+         const float triangleArea = glm::length(cross);
+
+         centroid += (a + b + c) * (triangleArea / 3.0f);
+         normal += cross;
+         area += triangleArea;
+      }
+
+      meshCentroid += centroid;
+      meshArea += area;
+
+      clusterCentroids[cluster] = area > 0.0f ? centroid / area : centroid;
+      clusterNormals[cluster] = normal;
+      clusterAreas[cluster] = area;
+   }
+
+   if (meshArea <= 0.0f)
+      return;
+   meshCentroid /= meshArea;
+
+   struct ClusterKey
+   {
+      float key;
+      uint32_t cluster;
+   };
+
+   std::vector<ClusterKey> sortKeys(clusterCount);
+   for (uint32_t cluster = 0; cluster < clusterCount; cluster++)
+   {
+      const float normalLength = glm::length(clusterNormals[cluster]);
+
+      sortKeys[cluster].cluster = cluster;
+      sortKeys[cluster].key = clusterAreas[cluster] > 0.0f && normalLength > 0.0f ? glm::dot(clusterCentroids[cluster] - meshCentroid, clusterNormals[cluster] / normalLength) : 0.0f;
+   }
+
+   std::stable_sort(sortKeys.begin(), sortKeys.end(), [](const ClusterKey& a, const ClusterKey& b) { return a.key > b.key; });
+
+   std::vector<uint32_t> output;
+   output.reserve(triangleCount * 3);
+   for (const ClusterKey& sortKey : sortKeys)
+      output.insert(output.end(), indices + clusterStarts[sortKey.cluster] * 3, indices + clusterStarts[sortKey.cluster + 1] * 3);
+
+   std::copy(output.begin(), output.end(), indices);
+}
+
+uint32_t optimizeVertexFetch(MeshVertex* vertices, uint32_t vertexCount, uint32_t* indices, uint32_t indexCount)
+{
+   std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+   std::vector<MeshVertex> ordered;
+   ordered.reserve(vertexCount);
+
+   for (uint32_t i = 0; i < indexCount; i++)
+   {
+      uint32_t& newIndex = remap[indices[i]];
+      if (newIndex == UINT32_MAX)
+      {
+         newIndex = (uint32_t)ordered.size();
+         ordered.push_back(vertices[indices[i]]);
+      }
+      indices[i] = newIndex;
+   }
+
+   std::copy(ordered.begin(), ordered.end(), vertices);
+   return (uint32_t)ordered.size();
+}
+
+struct ClusterGrid
+{
+   glm::vec3 origin;
+   float cellSize;
+   uint32_t resolution;
+};
+
+struct ClusterTriangle
+{
+   uint32_t cells[3];
+
+   inline bool operator==(const ClusterTriangle& other) const
+   {
+      return cells[0] == other.cells[0] && cells[1] == other.cells[1] && cells[2] == other.cells[2];
+   }
+};
+
+struct ClusterTriangleHash
+{
+   inline size_t operator()(const ClusterTriangle& triangle) const
+   {
+      uint64_t hash = triangle.cells[0] * 0x9E3779B97F4A7C15ull;
+      hash ^= triangle.cells[1] * 0xC2B2AE3D27D4EB4Full;
+      hash ^= triangle.cells[2] * 0x165667B19E3779F9ull;
+      return (size_t)(hash ^ (hash >> 32));
+   }
+};
+
+typedef std::unordered_set<ClusterTriangle, ClusterTriangleHash> ClusterTriangleSet;
+
+// Smallest cell first, keeping the winding, so every rotation of a triangle is the same key.
+static ClusterTriangle makeClusterTriangle(uint32_t a, uint32_t b, uint32_t c)
+{
+   ClusterTriangle triangle;
+   if (a < b && a < c)
+      triangle = { { a, b, c } };
+   else if (b < c)
+      triangle = { { b, c, a } };
+   else
+      triangle = { { c, a, b } };
+   return triangle;
+}
+
+static ClusterGrid makeClusterGrid(const glm::vec3& boundsMin, const glm::vec3& boundsMax, uint32_t resolution)
+{
+   const glm::vec3 extent = boundsMax - boundsMin;
+   const float maxExtent = std::max(extent.x, std::max(extent.y, extent.z));
+
+   ClusterGrid grid;
+   grid.origin = boundsMin;
+   grid.cellSize = maxExtent > 0.0f ? maxExtent / resolution : 1.0f;
+   grid.resolution = resolution;
+   return grid;
+}
+
+static glm::uvec3 getClusterCell(const ClusterGrid& grid, const glm::vec3& position)
+{
+   const glm::vec3 cell = (position - grid.origin) / grid.cellSize;
+   return glm::min(glm::uvec3(glm::max(cell, glm::vec3(0.0f))), glm::uvec3(grid.resolution - 1));
+}
+
+// Writes the cell of every vertex, numbered in order of first appearance, and the grid
+// coordinates of every cell.
+static void clusterVertices(const ClusterGrid& grid, const MeshVertex* vertices, uint32_t vertexCount, std::vector<uint32_t>& outVertexCells, std::vector<glm::uvec3>& outCellCoords)
+{
+   std::unordered_map<uint64_t, uint32_t> cellMap;
+   cellMap.reserve(vertexCount);
+
+   outVertexCells.resize(vertexCount);
+   outCellCoords.clear();
+
+   for (uint32_t v = 0; v < vertexCount; v++)
+   {
+      const glm::uvec3 coords = getClusterCell(grid, vertices[v].position);
+      const uint64_t key = (uint64_t)coords.x | ((uint64_t)coords.y << 21) | ((uint64_t)coords.z << 42);
+
+      auto inserted = cellMap.emplace(key, (uint32_t)outCellCoords.size());
+      if (inserted.second)
+         outCellCoords.push_back(coords);
+      outVertexCells[v] = inserted.first->second;
+   }
+}
+
+static uint32_t countClusteredTriangles(const uint32_t* indices, uint32_t indexCount, const std::vector<uint32_t>& vertexCells, ClusterTriangleSet& triangles)
+{
+   triangles.clear();
+   for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+   {
+      const uint32_t a = vertexCells[indices[i + 0]];
+      const uint32_t b = vertexCells[indices[i + 1]];
+      const uint32_t c = vertexCells[indices[i + 2]];
+      if (a != b && b != c && a != c)
+         triangles.insert(makeClusterTriangle(a, b, c));
+   }
+   return (uint32_t)triangles.size();
+}
+
+struct Quadric
+{
+   double a00, a01, a02, a11, a12, a22;
+   double b0, b1, b2;
+
+   void addPlane(const glm::vec3& normal, float distance, float weight)
+   {
+      const double x = normal.x, y = normal.y, z = normal.z;
+      a00 += weight * x * x;
+      a01 += weight * x * y;
+      a02 += weight * x * z;
+      a11 += weight * y * y;
+      a12 += weight * y * z;
+      a22 += weight * z * z;
+      b0 += weight * distance * x;
+      b1 += weight * distance * y;
+      b2 += weight * distance * z;
+   }
+
+   // The point closest to every plane, when the planes pin one down: flat and creased
+   // regions leave the system singular and keep fallback.
+   glm::vec3 solve(const glm::vec3& fallback) const
+   {
+      const double c00 = a11 * a22 - a12 * a12;
+      const double c01 = a02 * a12 - a01 * a22;
+      const double c02 = a01 * a12 - a02 * a11;
+      const double det = a00 * c00 + a01 * c01 + a02 * c02;
+
+      const double trace = (a00 + a11 + a22) / 3.0;
+      if (fabs(det) <= 1e-3 * trace * trace * trace)
+         return fallback;
+
+      const double c11 = a00 * a22 - a02 * a02;
+      const double c12 = a01 * a02 - a00 * a12;
+      const double c22 = a00 * a11 - a01 * a01;
+
+      const double invDet = 1.0 / det;
+      return glm::vec3(
+         -(c00 * b0 + c01 * b1 + c02 * b2) * invDet,
+         -(c01 * b0 + c11 * b1 + c12 * b2) * invDet,
+         -(c02 * b0 + c12 * b1 + c22 * b2) * invDet);
+   }
+};
+
+static inline uint32_t getNormalOctant(const glm::vec3& normal)
+{
+   return (normal.x < 0.0f ? 1 : 0) | (normal.y < 0.0f ? 2 : 0) | (normal.z < 0.0f ? 4 : 0);
+}
+
+float simplifyMesh(const MeshVertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, uint32_t targetTriangleCount, std::vector<MeshVertex>& outVertices, std::vector<uint32_t>& outIndices)
+{
+   outVertices.clear();
+   outIndices.clear();
+   if (vertexCount == 0 || indexCount < 3)
+      return 0.0f;
+
+   glm::vec3 boundsMin = vertices[0].position;
+   glm::vec3 boundsMax = vertices[0].position;
+   for (uint32_t v = 1; v < vertexCount; v++)
+   {
+      boundsMin = glm::min(boundsMin, vertices[v].position);
+      boundsMax = glm::max(boundsMax, vertices[v].position);
+   }
+
+   std::vector<uint32_t> vertexCells;
+   std::vector<glm::uvec3> cellCoords;
+   ClusterTriangleSet triangles;
+   triangles.reserve(indexCount / 3);
+
+   // Finest grid that stays within the target. Triangle counts grow with the resolution,
+   // if not strictly.
+   uint32_t low = 1;
+   uint32_t high = SIMPLIFY_MAX_GRID_RESOLUTION;
+   while (low < high)
+   {
+      const uint32_t resolution = (low + high + 1) / 2;
+      clusterVertices(makeClusterGrid(boundsMin, boundsMax, resolution), vertices, vertexCount, vertexCells, cellCoords);
+
+      if (countClusteredTriangles(indices, indexCount, vertexCells, triangles) <= targetTriangleCount)
+         low = resolution;
+      else
+         high = resolution - 1;
+   }
+
+   const ClusterGrid grid = makeClusterGrid(boundsMin, boundsMax, low);
+   clusterVertices(grid, vertices, vertexCount, vertexCells, cellCoords);
+   const uint32_t cellCount = (uint32_t)cellCoords.size();
+
+   // Every source triangle adds its plane to the cells of its corners, collapsed ones included,
+   // they still describe the surface.
+   std::vector<Quadric> quadrics(cellCount, Quadric());
+   for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+   {
+      const glm::vec3& a = vertices[indices[i + 0]].position;
+      const glm::vec3& b = vertices[indices[i + 1]].position;
+      const glm::vec3& c = vertices[indices[i + 2]].position;
+
+      const glm::vec3 cross = glm::cross(b - a, c - a);
+      const float length = glm::length(cross);
+      if (length <= 0.0f)
+         continue;
+
+      const glm::vec3 normal = cross / length;
+      const float distance = -glm::dot(normal, a);
+      for (uint32_t k = 0; k < 3; k++)
+         quadrics[vertexCells[indices[i + k]]].addPlane(normal, distance, length * 0.5f);
+   }
+
+   std::vector<glm::vec3> cellPositions(cellCount, glm::vec3(0.0f));
+   std::vector<uint32_t> cellVertexCounts(cellCount, 0);
+   for (uint32_t v = 0; v < vertexCount; v++)
+   {
+      cellPositions[vertexCells[v]] += vertices[v].position;
+      cellVertexCounts[vertexCells[v]]++;
+   }
+
+   for (uint32_t cell = 0; cell < cellCount; cell++)
+   {
+      const glm::vec3 average = cellPositions[cell] / (float)cellVertexCounts[cell];
+      const glm::vec3 cellMin = grid.origin + glm::vec3(cellCoords[cell]) * grid.cellSize;
+      cellPositions[cell] = glm::clamp(quadrics[cell].solve(average), cellMin, cellMin + grid.cellSize);
+   }
+
+   // One output vertex per cell and normal octant, with the average normal of its vertices.
+   std::vector<glm::vec3> octantNormals(cellCount * 8, glm::vec3(0.0f));
+   std::vector<uint32_t> octantVertices(cellCount * 8, UINT32_MAX);
+   for (uint32_t v = 0; v < vertexCount; v++)
+      octantNormals[vertexCells[v] * 8 + getNormalOctant(vertices[v].normal)] += vertices[v].normal;
+
+   triangles.clear();
+   for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+   {
+      const uint32_t a = vertexCells[indices[i + 0]];
+      const uint32_t b = vertexCells[indices[i + 1]];
+      const uint32_t c = vertexCells[indices[i + 2]];
+      if (a == b || b == c || a == c || !triangles.insert(makeClusterTriangle(a, b, c)).second)
+         continue;
+
+      for (uint32_t k = 0; k < 3; k++)
+      {
+         const MeshVertex& vertex = vertices[indices[i + k]];
+         const uint32_t cell = vertexCells[indices[i + k]];
+         const uint32_t octant = cell * 8 + getNormalOctant(vertex.normal);
+
+         if (octantVertices[octant] == UINT32_MAX)
+         {
+            const float length = glm::length(octantNormals[octant]);
+
+            MeshVertex clustered;
+            clustered.position = cellPositions[cell];
+            clustered.normal = length > 0.0f ? octantNormals[octant] / length : vertex.normal;
+
+            octantVertices[octant] = (uint32_t)outVertices.size();
+            outVertices.push_back(clustered);
+         }
+         outIndices.push_back(octantVertices[octant]);
+      }
+   }
+
+   return grid.cellSize * sqrtf(3.0f);
+}
+
+void processMesh(MeshData& mesh, uint32_t maxLodCount)
+{
+   const uint32_t baseVertexCount = (uint32_t)mesh.vertices.size();
+   const uint32_t baseIndexCount = (uint32_t)mesh.indices.size() / 3 * 3;
+   mesh.indices.resize(baseIndexCount);
+
+   optimizeVertexCache(mesh.indices.data(), baseIndexCount, baseVertexCount);
+   optimizeOverdraw(mesh.indices.data(), baseIndexCount, mesh.vertices.data());
+
+   MeshLod baseLod = {};
+   baseLod.indexCount = baseIndexCount;
+   mesh.lods.clear();
+   mesh.lods.push_back(baseLod);
+
+   std::vector<MeshVertex> lodVertices;
+   std::vector<uint32_t> lodIndices;
+   uint32_t previousTriangleCount = baseIndexCount / 3;
+
+   while (mesh.lods.size() < maxLodCount)
+   {
+      const uint32_t targetTriangleCount = (uint32_t)(previousTriangleCount * LOD_TRIANGLE_RATIO);
+      if (targetTriangleCount < LOD_MIN_TRIANGLES)
+         break;
+
+      // Always from the full mesh, so errors don't pile up level after level.
+      const float error = simplifyMesh(mesh.vertices.data(), baseVertexCount, mesh.indices.data(), baseIndexCount, targetTriangleCount, lodVertices, lodIndices);
+      const uint32_t triangleCount = (uint32_t)lodIndices.size() / 3;
+      if (triangleCount < LOD_MIN_TRIANGLES)
+         break;
+
+      optimizeVertexCache(lodIndices.data(), (uint32_t)lodIndices.size(), (uint32_t)lodVertices.size());
+      optimizeOverdraw(lodIndices.data(), (uint32_t)lodIndices.size(), lodVertices.data());
+
+      MeshLod lod = {};
+      lod.indexOffset = (uint32_t)mesh.indices.size();
+      lod.indexCount = (uint32_t)lodIndices.size();
+      lod.error = error;
+
+      const uint32_t vertexOffset = (uint32_t)mesh.vertices.size();
+      for (uint32_t index : lodIndices)
+         mesh.indices.push_back(index + vertexOffset);
+      mesh.vertices.insert(mesh.vertices.end(), lodVertices.begin(), lodVertices.end());
+
+      mesh.lods.push_back(lod);
+      previousTriangleCount = triangleCount;
+   }
+
+   // Levels only share the buffers, never vertices, so each one's vertices end up in one
+   // contiguous range after the first use reorder.
+   const uint32_t vertexCount = optimizeVertexFetch(mesh.vertices.data(), (uint32_t)mesh.vertices.size(), mesh.indices.data(), (uint32_t)mesh.indices.size());
+   mesh.vertices.resize(vertexCount);
+
+   for (MeshLod& lod : mesh.lods)
+   {
+      if (lod.indexCount == 0)
+         continue;
+
+      const uint32_t* first = mesh.indices.data() + lod.indexOffset;
+      const auto range = std::minmax_element(first, first + lod.indexCount);
+
+      lod.vertexOffset = *range.first;
+      lod.vertexCount = *range.second - *range.first + 1;
+      lod.acmr = analyzeVertexCache(first, lod.indexCount, vertexCount).acmr;
+   }
+
+   computeMeshBounds(mesh);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "core/mesh.h"
+
+// FIFO size analyzeVertexCache simulates.
+static const uint32_t MESH_STATS_CACHE_SIZE = 16;
+
+struct MeshCacheStats
+{
+   float acmr; // vertex shader invocations per triangle, 0.5 at best for large meshes, 3 at worst
+   float atvr; // vertex shader invocations per vertex indices use, 1 at best
+};
+
+MeshCacheStats analyzeVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize = MESH_STATS_CACHE_SIZE);
+
+// Tom Forsyth's linear-speed vertex cache optimization, in place.
+void optimizeVertexCache(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount);
+
+// Sorts clusters of an optimizeVertexCache order so outward facing ones draw first.
+void optimizeOverdraw(uint32_t* indices, uint32_t indexCount, const MeshVertex* vertices);
+
+// Unused vertices are dropped, returns how many are left.
+uint32_t optimizeVertexFetch(MeshVertex* vertices, uint32_t vertexCount, uint32_t* indices, uint32_t indexCount);
+
+// Vertex clustering on a grid with quadric error positions. Returns the error bound, the
+// diagonal of a cell.
+float simplifyMesh(const MeshVertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, uint32_t targetTriangleCount, std::vector<MeshVertex>& outVertices, std::vector<uint32_t>& outIndices);
+
+// Adds up to maxLodCount - 1 levels of half the triangles of the one before and optimizes
+// every level.
+void processMesh(MeshData& mesh, uint32_t maxLodCount);
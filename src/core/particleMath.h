@@ -0,0 +1,156 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "core/particleSystem.h"
+#include "core/simd.h"
+
+// Scalar math and vertex writers shared by ParticleSystem and ParticlePool.
+
+static const uint32_t PARTICLE_RANDOM_STEP = 0x9e3779b9;
+static const float PARTICLE_SORT_KEY_MAX = 65535.0f;
+
+// lowbias32 by Chris Wellons, a cheap integer hash with very little bias. Hashing a counter
+// gives random numbers without any state to carry from one particle or thread to the next.
+static inline uint32_t hashScalar(uint32_t x)
+{
+   x ^= x >> 16;
+   x *= 0x7feb352d;
+   x ^= x >> 15;
+   x *= 0x846ca68b;
+   x ^= x >> 16;
+   return x;
+}
+
+static inline float toUnitFloat(uint32_t random)
+{
+   return (float)(random >> 8) * (1.0f / 16777216.0f);
+}
+
+// sin(2 pi turns) for turns in [-0.5, 0.5].
+static inline float sinTurns(float turns)
+{
+   const float y = 8.0f * turns - 16.0f * turns * fabsf(turns);
+   return 0.225f * (y * fabsf(y) - y) + y;
+}
+
+// Uniform in a ball of radius speed, without trig or cube roots, which the SIMD paths don't have:
+//  - the direction is a uniform z and an angle around it, whose sine comes from a parabola
+//    fit within 0.001 of the real one.
+//  - the speed is the largest of three uniform numbers, which is distributed like the cube
+//    root of one, so particles fill the ball evenly instead of bunching up at its center.
+// random holds five unit floats.
+static inline glm::vec3 getBallVelocity(const float* random, float speed)
+{
+   const float z = random[0] * 2.0f - 1.0f;
+   const float turns = random[1] - 0.5f;
+   const float cosTurns = turns + 0.25f >= 0.5f ? turns - 0.75f : turns + 0.25f;
+   const float length = speed * std::max(std::max(random[2], random[3]), random[4]);
+   const float ring = sqrtf(std::max(0.0f, 1.0f - z * z)) * length;
+
+   return glm::vec3(ring * sinTurns(cosTurns), ring * sinTurns(turns), z * length);
+}
+
+// value is already scaled to [-32767, 32767], anything outside is clamped.
+static inline int16_t quantizeSnorm16(float value)
+{
+   value = std::min(std::max(value, -32767.0f), 32767.0f);
+   return (int16_t)(value + (value >= 0.0f ? 0.5f : -0.5f));
+}
+
+// Writes count particles from the position and lifetime streams to outVertices, positions
+// relative to center times posScale and lifetime times lifetimeScale.
+static inline void writeParticleVertices(const float* posX, const float* posY, const float* posZ, const float* timeLeft, uint32_t count,
+   const glm::vec3& center, const glm::vec3& posScale, float lifetimeScale, const uint8_t color[4], ParticleVertex* outVertices)
+{
+   uint32_t i = 0;
+
+#if SIMD_SSE2
+   // Four vertices are three 16 byte words: x and y, z and lifetime, then color. They are
+   // built in registers and interleaved so every byte of outVertices is written exactly once.
+   const __m128 centerX = _mm_set1_ps(center.x);
+   const __m128 centerY = _mm_set1_ps(center.y);
+   const __m128 centerZ = _mm_set1_ps(center.z);
+   const __m128 scaleX = _mm_set1_ps(posScale.x);
+   const __m128 scaleY = _mm_set1_ps(posScale.y);
+   const __m128 scaleZ = _mm_set1_ps(posScale.z);
+   const __m128 lifetimeScaleSSE = _mm_set1_ps(lifetimeScale);
+   const __m128i lowMask = _mm_set1_epi32(0xffff);
+
+   uint32_t colorWord;
+   memcpy(&colorWord, color, sizeof(colorWord));
+   const __m128 colorSSE = _mm_castsi128_ps(_mm_set1_epi32((int)colorWord));
+
+   for (; i + 4 <= count; i += 4)
+   {
+      // packs saturates to [-32768, 32767], which still reads back as -1 for SHORT_NORM.
+      const __m128i x = _mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(posX + i), centerX), scaleX));
+      const __m128i y = _mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(posY + i), centerY), scaleY));
+      const __m128i z = _mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(posZ + i), centerZ), scaleZ));
+      const __m128 lifetime = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(timeLeft + i), lifetimeScaleSSE), _mm_set1_ps(0.5f));
+      const __m128i lifetimeByte = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(lifetime, _mm_setzero_ps()), _mm_set1_ps(255.0f)));
+
+      const __m128i xy = _mm_packs_epi32(x, y);
+      const __m128i zz = _mm_packs_epi32(z, z);
+      const __m128 a = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(_mm_unpacklo_epi16(xy, xy), lowMask), _mm_slli_epi32(_mm_unpackhi_epi16(xy, xy), 16)));
+      const __m128 b = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(_mm_unpacklo_epi16(zz, zz), lowMask), _mm_slli_epi32(lifetimeByte, 16)));
+
+      const __m128 abLow = _mm_unpacklo_ps(a, b);
+      const __m128 abHigh = _mm_unpackhi_ps(a, b);
+      const __m128 out0 = _mm_shuffle_ps(abLow, _mm_shuffle_ps(colorSSE, abLow, _MM_SHUFFLE(3, 2, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0));
+      const __m128 out1 = _mm_shuffle_ps(_mm_shuffle_ps(abLow, colorSSE, _MM_SHUFFLE(1, 1, 3, 3)), abHigh, _MM_SHUFFLE(1, 0, 2, 0));
+      const __m128 out2 = _mm_shuffle_ps(_mm_shuffle_ps(colorSSE, abHigh, _MM_SHUFFLE(3, 2, 2, 2)), _mm_shuffle_ps(abHigh, colorSSE, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+
+      float* out = (float*)(outVertices + i);
+      _mm_storeu_ps(out, out0);
+      _mm_storeu_ps(out + 4, out1);
+      _mm_storeu_ps(out + 8, out2);
+   }
+#endif
+
+   // Each vertex is built in full and stored once, outVertices is usually write combined.
+   for (; i < count; i++)
+   {
+      ParticleVertex vertex;
+      vertex.pos[0] = quantizeSnorm16((posX[i] - center.x) * posScale.x);
+      vertex.pos[1] = quantizeSnorm16((posY[i] - center.y) * posScale.y);
+      vertex.pos[2] = quantizeSnorm16((posZ[i] - center.z) * posScale.z);
+      vertex.lifetime = (uint8_t)std::min(std::max(timeLeft[i] * lifetimeScale + 0.5f, 0.0f), 255.0f);
+      vertex.padding = 0;
+      memcpy(vertex.color, color, sizeof(vertex.color));
+
+      outVertices[i] = vertex;
+   }
+}
+
+// Writes count keys of offset - dot(pos, dir) clamped to [0, PARTICLE_SORT_KEY_MAX].
+static inline void writeParticleSortKeys(const float* posX, const float* posY, const float* posZ, uint32_t count, float offset,
+   const glm::vec3& dir, uint32_t* outKeys)
+{
+   uint32_t i = 0;
+
+#if SIMD_SSE2
+   const __m128 offsetSSE = _mm_set1_ps(offset);
+   const __m128 dirX = _mm_set1_ps(dir.x);
+   const __m128 dirY = _mm_set1_ps(dir.y);
+   const __m128 dirZ = _mm_set1_ps(dir.z);
+   const __m128 keyMax = _mm_set1_ps(PARTICLE_SORT_KEY_MAX);
+
+   for (; i + 4 <= count; i += 4)
+   {
+      const __m128 depth = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(posX + i), dirX), _mm_mul_ps(_mm_loadu_ps(posY + i), dirY)),
+         _mm_mul_ps(_mm_loadu_ps(posZ + i), dirZ));
+      const __m128 key = _mm_min_ps(_mm_max_ps(_mm_sub_ps(offsetSSE, depth), _mm_setzero_ps()), keyMax);
+      _mm_storeu_si128((__m128i*)(outKeys + i), _mm_cvttps_epi32(key));
+   }
+#endif
+
+   for (; i < count; i++)
+   {
+      const float key = offset - (posX[i] * dir.x + posY[i] * dir.y + posZ[i] * dir.z);
+      outKeys[i] = (uint32_t)std::min(std::max(key, 0.0f), PARTICLE_SORT_KEY_MAX);
+   }
+}
@@ -0,0 +1,343 @@
+#include <string.h>
+#include <algorithm>
+#include "core/particleMath.h"
+#include "core/particlePool.h"
+
+static const uint32_t STREAM_COUNT = 7;
+static const uint32_t RANDOM_COUNT = 6;
+
+static_assert(ParticlePool::BLOCK_SIZE % ParticleSystem::CHUNK_SIZE == 0, "Blocks must be whole chunks");
+
+// Half size of the box an emitter's particles stay within.
+static inline glm::vec3 getEmitterExtents(const ParticleEmitterDesc& desc)
+{
+   return glm::vec3(desc.speed * desc.lifetimeMs / 1000.0f);
+}
+
+ParticlePool::ParticlePool() :
+   mBoundsMin(0.0f),
+   mBoundsMax(0.0f)
+{
+}
+
+void ParticlePool::setCapacity(uint32_t capacity)
+{
+   mBlockCount = (capacity + BLOCK_SIZE - 1) / BLOCK_SIZE;
+   const uint32_t slotCount = mBlockCount * BLOCK_SIZE;
+
+   // One extra cache line of slack to align the start of the first array.
+   std::vector<float> storage(slotCount * STREAM_COUNT + ParticleSystem::CHUNK_SIZE, 0.0f);
+   const uintptr_t alignMask = SIMD_CACHE_LINE_SIZE - 1;
+   float* base = (float*)(((uintptr_t)storage.data() + alignMask) & ~alignMask);
+
+   float** streams[STREAM_COUNT] = { &mPosX, &mPosY, &mPosZ, &mVelX, &mVelY, &mVelZ, &mTimeLeft };
+   for (uint32_t i = 0; i < STREAM_COUNT; i++)
+      *streams[i] = base + i * slotCount;
+
+   mStorage.swap(storage);
+
+   // Reversed, so blocks are handed out from the front of the pool.
+   mFreeBlocks.clear();
+   for (uint32_t block = mBlockCount; block-- > 0;)
+      mFreeBlocks.push_back(block);
+
+   for (Emitter& emitter : mEmitters)
+   {
+      emitter.blocks.clear();
+      emitter.aliveCount = 0;
+      emitter.spawnCount = 0;
+   }
+
+   mSimulatedEmitters.clear();
+   mDrawRanges.clear();
+   mDrawCount = 0;
+}
+
+uint32_t ParticlePool::addEmitter(const ParticleEmitterDesc& desc)
+{
+   const uint32_t index = (uint32_t)mEmitters.size();
+
+   Emitter emitter;
+   emitter.desc = desc;
+   emitter.key = hashScalar((index + 1) * PARTICLE_RANDOM_STEP);
+   emitter.spawnedCount = 0;
+   emitter.spawnRemainder = 0.0f;
+   emitter.aliveCount = 0;
+   emitter.spawnCount = 0;
+   mEmitters.push_back(emitter);
+
+   const glm::vec3 extents = getEmitterExtents(desc);
+   mBoundsMin = index == 0 ? desc.position - extents : glm::min(mBoundsMin, desc.position - extents);
+   mBoundsMax = index == 0 ? desc.position + extents : glm::max(mBoundsMax, desc.position + extents);
+
+   return index;
+}
+
+void ParticlePool::clearEmitters()
+{
+   for (Emitter& emitter : mEmitters)
+      mFreeBlocks.insert(mFreeBlocks.end(), emitter.blocks.begin(), emitter.blocks.end());
+
+   mEmitters.clear();
+   mBoundsMin = glm::vec3(0.0f);
+   mBoundsMax = glm::vec3(0.0f);
+
+   mSimulatedEmitters.clear();
+   mDrawRanges.clear();
+   mDrawCount = 0;
+}
+
+void ParticlePool::setSpawnRate(uint32_t emitter, float spawnRate)
+{
+   mEmitters[emitter].desc.spawnRate = spawnRate;
+}
+
+void ParticlePool::getBounds(glm::vec3& outCenter, glm::vec3& outExtents) const
+{
+   // Never zero, positions are divided by it.
+   outCenter = (mBoundsMin + mBoundsMax) * 0.5f;
+   outExtents = glm::max((mBoundsMax - mBoundsMin) * 0.5f, glm::vec3(0.001f));
+}
+
+uint32_t ParticlePool::getAliveCount() const
+{
+   uint32_t count = 0;
+   for (const Emitter& emitter : mEmitters)
+      count += emitter.aliveCount;
+
+   return count;
+}
+
+void ParticlePool::simulate(JobSystem& jobSystem, float dtMs, const Frustum& frustum)
+{
+   // Blocks are only handed out here, before the jobs start, so emitters never contend for
+   // the pool. Each gets enough for all of its spawns as if nothing expired this frame.
+   mSimulatedEmitters.clear();
+   for (uint32_t i = 0; i < (uint32_t)mEmitters.size(); i++)
+   {
+      Emitter& emitter = mEmitters[i];
+      if (!frustum.intersectsBox(emitter.desc.position, getEmitterExtents(emitter.desc)))
+         continue;
+
+      const float spawns = emitter.spawnRemainder + emitter.desc.spawnRate * dtMs / 1000.0f;
+      const uint32_t spawnCount = (uint32_t)spawns;
+      emitter.spawnRemainder = spawns - (float)spawnCount;
+
+      const uint32_t blocksNeeded = (emitter.aliveCount + spawnCount + BLOCK_SIZE - 1) / BLOCK_SIZE;
+      while (emitter.blocks.size() < blocksNeeded && !mFreeBlocks.empty())
+      {
+         emitter.blocks.push_back(mFreeBlocks.back());
+         mFreeBlocks.pop_back();
+      }
+
+      emitter.spawnCount = std::min(spawnCount, (uint32_t)emitter.blocks.size() * BLOCK_SIZE - emitter.aliveCount);
+      mSimulatedEmitters.push_back(i);
+   }
+
+   jobSystem.parallelFor((uint32_t)mSimulatedEmitters.size(), 1, [&](uint32_t start, uint32_t end, uint32_t threadIndex)
+   {
+      for (uint32_t i = start; i < end; i++)
+         _simulateEmitter(mEmitters[mSimulatedEmitters[i]], dtMs);
+   });
+
+   mDrawRanges.clear();
+   mDrawCount = 0;
+   for (uint32_t index : mSimulatedEmitters)
+   {
+      Emitter& emitter = mEmitters[index];
+      _releaseBlocks(emitter);
+
+      if (emitter.aliveCount == 0)
+         continue;
+
+      DrawRange range;
+      range.emitter = index;
+      range.firstVertex = mDrawCount;
+      mDrawRanges.push_back(range);
+      mDrawCount += emitter.aliveCount;
+   }
+}
+
+void ParticlePool::writeVertices(uint32_t start, uint32_t end, ParticleVertex* outVertices) const
+{
+   glm::vec3 center, extents;
+   getBounds(center, extents);
+   const glm::vec3 posScale = 32767.0f / extents;
+
+   _forEachDrawSpan(start, end, [&](const Emitter& emitter, uint32_t slot, uint32_t count, uint32_t vertex)
+   {
+      writeParticleVertices(mPosX + slot, mPosY + slot, mPosZ + slot, mTimeLeft + slot, count, center, posScale,
+         255.0f / emitter.desc.lifetimeMs, emitter.desc.color, outVertices + vertex);
+   });
+}
+
+void ParticlePool::writeSortKeys(uint32_t start, uint32_t end, const glm::vec3& viewPos, const glm::vec3& viewDir, float minDepth,
+   float maxDepth, uint32_t* outKeys) const
+{
+   const float scale = maxDepth > minDepth ? PARTICLE_SORT_KEY_MAX / (maxDepth - minDepth) : 0.0f;
+   const float offset = (maxDepth + glm::dot(viewPos, viewDir)) * scale;
+   const glm::vec3 dir = viewDir * scale;
+
+   _forEachDrawSpan(start, end, [&](const Emitter& emitter, uint32_t slot, uint32_t count, uint32_t vertex)
+   {
+      writeParticleSortKeys(mPosX + slot, mPosY + slot, mPosZ + slot, count, offset, dir, outKeys + vertex);
+   });
+}
+
+void ParticlePool::_releaseBlocks(Emitter& emitter)
+{
+   const uint32_t blocksUsed = (emitter.aliveCount + BLOCK_SIZE - 1) / BLOCK_SIZE;
+   while (emitter.blocks.size() > blocksUsed)
+   {
+      mFreeBlocks.push_back(emitter.blocks.back());
+      emitter.blocks.pop_back();
+   }
+}
+
+void ParticlePool::_simulateEmitter(Emitter& emitter, float dtMs)
+{
+   // Everything moves first, then expired particles are swapped out for the last live ones.
+   // Going the other way round would move particles into blocks that were already simulated.
+   bool expired = false;
+   for (uint32_t first = 0; first < emitter.aliveCount; first += BLOCK_SIZE)
+   {
+      const uint32_t slot = emitter.blocks[first / BLOCK_SIZE] * BLOCK_SIZE;
+      expired |= _integrate(slot, slot + std::min(emitter.aliveCount - first, (uint32_t)BLOCK_SIZE), dtMs);
+   }
+
+   if (expired)
+   {
+      float* streams[STREAM_COUNT] = { mPosX, mPosY, mPosZ, mVelX, mVelY, mVelZ, mTimeLeft };
+
+      for (uint32_t first = 0; first < emitter.aliveCount; first += BLOCK_SIZE)
+      {
+         const uint32_t base = emitter.blocks[first / BLOCK_SIZE] * BLOCK_SIZE;
+         uint32_t i = 0;
+         while (i < BLOCK_SIZE && first + i < emitter.aliveCount)
+         {
+            const uint32_t slot = base + i;
+
+#if SIMD_SSE2
+            // Only about one particle in a hundred expires per frame, skip groups of four without any.
+            if (i % 4 == 0 && first + i + 4 <= emitter.aliveCount &&
+               _mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(mTimeLeft + slot), _mm_setzero_ps())) == 0)
+            {
+               i += 4;
+               continue;
+            }
+#endif
+
+            if (mTimeLeft[slot] >= 0.0f)
+            {
+               i++;
+               continue;
+            }
+
+            // The last particle may have expired too, it is checked again at its new slot.
+            const uint32_t last = _getSlot(emitter, --emitter.aliveCount);
+            for (float* stream : streams)
+               stream[slot] = stream[last];
+         }
+      }
+   }
+
+   for (uint32_t i = 0; i < emitter.spawnCount; i++)
+      _spawn(emitter, _getSlot(emitter, emitter.aliveCount++));
+   emitter.spawnCount = 0;
+}
+
+bool ParticlePool::_integrate(uint32_t start, uint32_t end, float dtMs)
+{
+   const float dtSeconds = dtMs / 1000.0f;
+
+   // Locals, since the compiler can't tell the stores below leave the member pointers alone.
+   float* posX = mPosX;
+   float* posY = mPosY;
+   float* posZ = mPosZ;
+   const float* velX = mVelX;
+   const float* velY = mVelY;
+   const float* velZ = mVelZ;
+   float* timeLeft = mTimeLeft;
+
+   bool expired = false;
+   uint32_t i = start;
+
+#if SIMD_SSE2
+   const __m128 dtSecondsSSE = _mm_set1_ps(dtSeconds);
+   const __m128 dtMilliseconds = _mm_set1_ps(dtMs);
+   __m128 expiredMask = _mm_setzero_ps();
+
+   for (; i + 4 <= end; i += 4)
+   {
+      _mm_storeu_ps(posX + i, _mm_add_ps(_mm_loadu_ps(posX + i), _mm_mul_ps(_mm_loadu_ps(velX + i), dtSecondsSSE)));
+      _mm_storeu_ps(posY + i, _mm_add_ps(_mm_loadu_ps(posY + i), _mm_mul_ps(_mm_loadu_ps(velY + i), dtSecondsSSE)));
+      _mm_storeu_ps(posZ + i, _mm_add_ps(_mm_loadu_ps(posZ + i), _mm_mul_ps(_mm_loadu_ps(velZ + i), dtSecondsSSE)));
+
+      const __m128 time = _mm_sub_ps(_mm_loadu_ps(timeLeft + i), dtMilliseconds);
+      _mm_storeu_ps(timeLeft + i, time);
+      expiredMask = _mm_or_ps(expiredMask, _mm_cmplt_ps(time, _mm_setzero_ps()));
+   }
+
+   expired = _mm_movemask_ps(expiredMask) != 0;
+#endif
+
+   for (; i < end; i++)
+   {
+      posX[i] += velX[i] * dtSeconds;
+      posY[i] += velY[i] * dtSeconds;
+      posZ[i] += velZ[i] * dtSeconds;
+      timeLeft[i] -= dtMs;
+      expired |= timeLeft[i] < 0.0f;
+   }
+
+   return expired;
+}
+
+void ParticlePool::_spawn(Emitter& emitter, uint32_t slot)
+{
+   float random[RANDOM_COUNT];
+   uint32_t value = hashScalar(emitter.spawnedCount++ + emitter.key);
+   random[0] = toUnitFloat(value);
+   for (uint32_t i = 1; i < RANDOM_COUNT; i++)
+   {
+      value = hashScalar(value + PARTICLE_RANDOM_STEP);
+      random[i] = toUnitFloat(value);
+   }
+
+   const ParticleEmitterDesc& desc = emitter.desc;
+   const glm::vec3 velocity = getBallVelocity(random, desc.speed);
+
+   mPosX[slot] = desc.position.x;
+   mPosY[slot] = desc.position.y;
+   mPosZ[slot] = desc.position.z;
+   mVelX[slot] = velocity.x;
+   mVelY[slot] = velocity.y;
+   mVelZ[slot] = velocity.z;
+   mTimeLeft[slot] = desc.lifetimeMs * (0.5f + 0.5f * random[5]);
+}
+
+template<typename Func>
+void ParticlePool::_forEachDrawSpan(uint32_t start, uint32_t end, const Func& func) const
+{
+   end = std::min(end, mDrawCount);
+   if (start >= end)
+      return;
+
+   // Ranges are never empty, so the last one starting at or before start holds it.
+   std::vector<DrawRange>::const_iterator range = std::upper_bound(mDrawRanges.begin(), mDrawRanges.end(), start,
+      [](uint32_t vertex, const DrawRange& other) { return vertex < other.firstVertex; }) - 1;
+
+   // Spans are the particles of one block, contiguous in every stream.
+   for (uint32_t vertex = start; vertex < end; ++range)
+   {
+      const Emitter& emitter = mEmitters[range->emitter];
+      const uint32_t rangeEnd = std::min(end, range->firstVertex + emitter.aliveCount);
+      while (vertex < rangeEnd)
+      {
+         const uint32_t index = vertex - range->firstVertex;
+         const uint32_t count = std::min(BLOCK_SIZE - index % BLOCK_SIZE, rangeEnd - vertex);
+         func(emitter, _getSlot(emitter, index), count, vertex);
+         vertex += count;
+      }
+   }
+}
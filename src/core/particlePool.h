@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include "core/frustum.h"
+#include "core/jobSystem.h"
+#include "core/particleSystem.h"
+
+struct ParticleEmitterDesc
+{
+   glm::vec3 position = glm::vec3(0.0f);
+   float spawnRate = 1000.0f; // particles per second
+   float speed = 3.0f; // particles leave in any direction at up to this many units per second
+   float lifetimeMs = 1900.0f; // particles live between half and all of it
+   uint8_t color[4] = { 0, 255, 255, 255 };
+};
+
+// Emitters share one pool handed out in blocks and keep their live particles dense, so the
+// cost follows the live count. Emitters out of view are not simulated, spawned or drawn.
+class ParticlePool
+{
+public:
+   // Multiple of ParticleSystem::CHUNK_SIZE, so blocks never share a cache line.
+   static const uint32_t BLOCK_SIZE = 1024;
+
+   ParticlePool();
+   ParticlePool(const ParticlePool&) = delete;
+   ParticlePool& operator=(const ParticlePool&) = delete;
+
+   // Drops every live particle, emitters are kept.
+   void setCapacity(uint32_t capacity);
+   inline uint32_t getCapacity() const { return mBlockCount * BLOCK_SIZE; }
+
+   uint32_t addEmitter(const ParticleEmitterDesc& desc);
+   void clearEmitters();
+   void setSpawnRate(uint32_t emitter, float spawnRate);
+   inline uint32_t getEmitterCount() const { return (uint32_t)mEmitters.size(); }
+
+   void getBounds(glm::vec3& outCenter, glm::vec3& outExtents) const;
+
+   // One job per emitter in view. Spawns that don't fit in the pool are dropped.
+   void simulate(JobSystem& jobSystem, float dtMs, const Frustum& frustum);
+
+   // As of the last simulate().
+   inline uint32_t getSimulatedEmitterCount() const { return (uint32_t)mSimulatedEmitters.size(); }
+   inline uint32_t getDrawCount() const { return mDrawCount; }
+
+   uint32_t getAliveCount() const;
+
+   // Ranges of the getDrawCount() particles can be written from different threads.
+   void writeVertices(uint32_t start, uint32_t end, ParticleVertex* outVertices) const;
+
+   void writeSortKeys(uint32_t start, uint32_t end, const glm::vec3& viewPos, const glm::vec3& viewDir, float minDepth,
+      float maxDepth, uint32_t* outKeys) const;
+
+private:
+   struct Emitter
+   {
+      ParticleEmitterDesc desc;
+      uint32_t key;
+      uint32_t spawnedCount;
+      float spawnRemainder;
+
+      // Live particles are [0, aliveCount) across blocks, the rest of the last block is free.
+      std::vector<uint32_t> blocks;
+      uint32_t aliveCount;
+      uint32_t spawnCount;
+   };
+
+   struct DrawRange
+   {
+      uint32_t emitter;
+      uint32_t firstVertex;
+   };
+
+   inline uint32_t _getSlot(const Emitter& emitter, uint32_t index) const
+   {
+      return emitter.blocks[index / BLOCK_SIZE] * BLOCK_SIZE + index % BLOCK_SIZE;
+   }
+
+   void _releaseBlocks(Emitter& emitter);
+   void _simulateEmitter(Emitter& emitter, float dtMs);
+   bool _integrate(uint32_t start, uint32_t end, float dtMs);
+   void _spawn(Emitter& emitter, uint32_t slot);
+
+   template<typename Func>
+   void _forEachDrawSpan(uint32_t start, uint32_t end, const Func& func) const;
+
+   std::vector<float> mStorage;
+   uint32_t mBlockCount = 0;
+   std::vector<uint32_t> mFreeBlocks;
+
+   std::vector<Emitter> mEmitters;
+   glm::vec3 mBoundsMin;
+   glm::vec3 mBoundsMax;
+
+   std::vector<uint32_t> mSimulatedEmitters;
+   std::vector<DrawRange> mDrawRanges;
+   uint32_t mDrawCount = 0;
+
+   // Each points to a cache line aligned array in mStorage of getCapacity() particles.
+   float* mPosX = nullptr;
+   float* mPosY = nullptr;
+   float* mPosZ = nullptr;
+   float* mVelX = nullptr;
+   float* mVelY = nullptr;
+   float* mVelZ = nullptr;
+   float* mTimeLeft = nullptr;
+};
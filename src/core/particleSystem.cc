@@ -0,0 +1,413 @@
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "core/particleMath.h"
+#include "core/particleSystem.h"
+
+// Particles leave the origin at up to MAX_SPEED units per second and live 1 to 1.9 seconds.
+static const float MAX_SPEED = 3.0f;
+static const float LIFETIME_MAX_MS = 1900.0f;
+static const float LIFETIME_STEP_MS = 100.0f;
+static const uint8_t PARTICLE_COLOR[4] = { 0, 255, 255, 255 };
+
+static const uint32_t STREAM_COUNT = 7;
+static const uint32_t RANDOM_COUNT = 6;
+
+// Respawns use getBallVelocity(), the SIMD kernels below repeat its math lane by lane so every
+// kernel respawns the same particles. The AVX2 kernel is built with FMA and the compiler fuses
+// multiplies and adds, which round once instead of twice, so its velocities and positions can
+// differ from the scalar and SSE2 ones in the last bits.
+
+static inline uint32_t getFrameKey(uint32_t frame)
+{
+   return hashScalar(frame * PARTICLE_RANDOM_STEP);
+}
+
+#if SIMD_SSE2
+// SSE2 has no 32 bit low multiply, so multiply the even and odd lanes as 64 bit and interleave.
+static inline __m128i mulloSSE2(__m128i a, __m128i b)
+{
+   const __m128i even = _mm_mul_epu32(a, b);
+   const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+   return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static inline __m128i hashSSE2(__m128i x)
+{
+   x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+   x = mulloSSE2(x, _mm_set1_epi32(0x7feb352d));
+   x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+   x = mulloSSE2(x, _mm_set1_epi32((int)0x846ca68b));
+   x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+   return x;
+}
+
+static inline __m128 toUnitFloatSSE2(__m128i random)
+{
+   return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(random, 8)), _mm_set1_ps(1.0f / 16777216.0f));
+}
+
+static inline __m128 absSSE2(__m128 value)
+{
+   return _mm_andnot_ps(_mm_set1_ps(-0.0f), value);
+}
+
+static inline __m128 sinTurnsSSE2(__m128 turns)
+{
+   const __m128 y = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(8.0f), turns), _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(16.0f), turns), absSSE2(turns)));
+   return _mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.225f), _mm_sub_ps(_mm_mul_ps(y, absSSE2(y)), y)), y);
+}
+
+static inline __m128 selectSSE2(__m128 mask, __m128 a, __m128 b)
+{
+   return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+#endif
+
+#if SIMD_AVX2
+SIMD_TARGET_AVX2 static inline __m256i hashAVX2(__m256i x)
+{
+   x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+   x = _mm256_mullo_epi32(x, _mm256_set1_epi32(0x7feb352d));
+   x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 15));
+   x = _mm256_mullo_epi32(x, _mm256_set1_epi32((int)0x846ca68b));
+   x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+   return x;
+}
+
+SIMD_TARGET_AVX2 static inline __m256 toUnitFloatAVX2(__m256i random)
+{
+   return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(random, 8)), _mm256_set1_ps(1.0f / 16777216.0f));
+}
+
+SIMD_TARGET_AVX2 static inline __m256 absAVX2(__m256 value)
+{
+   return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), value);
+}
+
+SIMD_TARGET_AVX2 static inline __m256 sinTurnsAVX2(__m256 turns)
+{
+   const __m256 y = _mm256_sub_ps(_mm256_mul_ps(_mm256_set1_ps(8.0f), turns), _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(16.0f), turns), absAVX2(turns)));
+   return _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(0.225f), _mm256_sub_ps(_mm256_mul_ps(y, absAVX2(y)), y)), y);
+}
+#endif
+
+ParticleSystem::ParticleSystem()
+{
+   mKernel = getBestKernel();
+}
+
+void ParticleSystem::resize(uint32_t count)
+{
+   const uint32_t capacity = (count + CHUNK_SIZE - 1) / CHUNK_SIZE * CHUNK_SIZE;
+   const uint32_t keptCount = std::min(count, mCount);
+
+   // One extra cache line of slack to align the start of the first array.
+   std::vector<float> storage(capacity * STREAM_COUNT + CHUNK_SIZE, 0.0f);
+   const uintptr_t alignMask = SIMD_CACHE_LINE_SIZE - 1;
+   float* base = (float*)(((uintptr_t)storage.data() + alignMask) & ~alignMask);
+
+   float** streams[STREAM_COUNT] = { &mPosX, &mPosY, &mPosZ, &mVelX, &mVelY, &mVelZ, &mTimeLeft };
+   for (uint32_t i = 0; i < STREAM_COUNT; i++)
+   {
+      float* stream = base + i * capacity;
+      if (keptCount > 0)
+         memcpy(stream, *streams[i], keptCount * sizeof(float));
+
+      *streams[i] = stream;
+   }
+
+   mStorage.swap(storage);
+   mCount = count;
+
+   const uint32_t frameKey = getFrameKey(mFrame);
+   for (uint32_t i = keptCount; i < count; i++)
+      _respawn(i, frameKey);
+}
+
+void ParticleSystem::setKernel(ParticleKernel kernel)
+{
+   mKernel = isKernelSupported(kernel) ? kernel : ParticleKernel::SCALAR;
+}
+
+bool ParticleSystem::isKernelSupported(ParticleKernel kernel)
+{
+   switch (kernel)
+   {
+   case ParticleKernel::SCALAR:
+      return true;
+   case ParticleKernel::SSE2:
+      return SIMD_SSE2 != 0;
+   case ParticleKernel::AVX2:
+   {
+      static const bool avx2 = simdSupportsAvx2();
+      return avx2;
+   }
+   }
+
+   return false;
+}
+
+ParticleKernel ParticleSystem::getBestKernel()
+{
+   if (isKernelSupported(ParticleKernel::AVX2))
+      return ParticleKernel::AVX2;
+   if (isKernelSupported(ParticleKernel::SSE2))
+      return ParticleKernel::SSE2;
+   return ParticleKernel::SCALAR;
+}
+
+const char* ParticleSystem::getKernelString(ParticleKernel kernel)
+{
+   switch (kernel)
+   {
+   case ParticleKernel::SCALAR:
+      return "Scalar";
+   case ParticleKernel::SSE2:
+      return "SSE2";
+   case ParticleKernel::AVX2:
+      return "AVX2";
+   }
+
+   return "Unknown";
+}
+
+void ParticleSystem::getBounds(glm::vec3& outCenter, glm::vec3& outExtents) const
+{
+   outCenter = glm::vec3(0.0f);
+   outExtents = glm::vec3(MAX_SPEED * LIFETIME_MAX_MS / 1000.0f);
+}
+
+void ParticleSystem::simulate(float dtMs)
+{
+   simulateRange(0, mCount, dtMs);
+   nextFrame();
+}
+
+void ParticleSystem::simulateRange(uint32_t start, uint32_t end, float dtMs)
+{
+   end = std::min(end, mCount);
+   if (start >= end)
+      return;
+
+   const uint32_t frameKey = getFrameKey(mFrame);
+
+   switch (mKernel)
+   {
+   case ParticleKernel::SCALAR:
+      _simulateScalar(start, end, dtMs, frameKey);
+      break;
+   case ParticleKernel::SSE2:
+      _simulateSSE2(start, end, dtMs, frameKey);
+      break;
+   case ParticleKernel::AVX2:
+      _simulateAVX2(start, end, dtMs, frameKey);
+      break;
+   }
+}
+
+void ParticleSystem::writeVertices(uint32_t start, uint32_t end, ParticleVertex* outVertices) const
+{
+   end = std::min(end, mCount);
+   if (start >= end)
+      return;
+
+   glm::vec3 center, extents;
+   getBounds(center, extents);
+
+   writeParticleVertices(mPosX + start, mPosY + start, mPosZ + start, mTimeLeft + start, end - start, center, 32767.0f / extents,
+      255.0f / LIFETIME_MAX_MS, PARTICLE_COLOR, outVertices + start);
+}
+
+void ParticleSystem::writeSortKeys(uint32_t start, uint32_t end, const glm::vec3& viewPos, const glm::vec3& viewDir, float minDepth,
+   float maxDepth, uint32_t* outKeys) const
+{
+   end = std::min(end, mCount);
+   if (start >= end)
+      return;
+
+   // key = (maxDepth - depth) * scale with the camera position folded into the offset.
+   const float scale = maxDepth > minDepth ? PARTICLE_SORT_KEY_MAX / (maxDepth - minDepth) : 0.0f;
+   const float offset = (maxDepth + glm::dot(viewPos, viewDir)) * scale;
+
+   writeParticleSortKeys(mPosX + start, mPosY + start, mPosZ + start, end - start, offset, viewDir * scale, outKeys + start);
+}
+
+void ParticleSystem::_respawn(uint32_t index, uint32_t frameKey)
+{
+   float random[RANDOM_COUNT];
+   uint32_t value = hashScalar(index + frameKey);
+   random[0] = toUnitFloat(value);
+   for (uint32_t i = 1; i < RANDOM_COUNT; i++)
+   {
+      value = hashScalar(value + PARTICLE_RANDOM_STEP);
+      random[i] = toUnitFloat(value);
+   }
+
+   const glm::vec3 velocity = getBallVelocity(random, MAX_SPEED);
+
+   mPosX[index] = 0.0f;
+   mPosY[index] = 0.0f;
+   mPosZ[index] = 0.0f;
+   mVelX[index] = velocity.x;
+   mVelY[index] = velocity.y;
+   mVelZ[index] = velocity.z;
+   mTimeLeft[index] = LIFETIME_MAX_MS - (float)(int)(random[5] * 10.0f) * LIFETIME_STEP_MS;
+}
+
+void ParticleSystem::_simulateScalar(uint32_t start, uint32_t end, float dtMs, uint32_t frameKey)
+{
+   const float dtSeconds = dtMs / 1000.0f;
+
+   for (uint32_t i = start; i < end; i++)
+   {
+      mPosX[i] += mVelX[i] * dtSeconds;
+      mPosY[i] += mVelY[i] * dtSeconds;
+      mPosZ[i] += mVelZ[i] * dtSeconds;
+      mTimeLeft[i] -= dtMs;
+
+      if (mTimeLeft[i] < 0.0f)
+         _respawn(i, frameKey);
+   }
+}
+
+void ParticleSystem::_simulateSSE2(uint32_t start, uint32_t end, float dtMs, uint32_t frameKey)
+{
+#if SIMD_SSE2
+   const __m128 dtSeconds = _mm_set1_ps(dtMs / 1000.0f);
+   const __m128 dtMilliseconds = _mm_set1_ps(dtMs);
+   const __m128 zero = _mm_setzero_ps();
+   const __m128 one = _mm_set1_ps(1.0f);
+   const __m128 half = _mm_set1_ps(0.5f);
+   const __m128 quarter = _mm_set1_ps(0.25f);
+   const __m128i laneOffsets = _mm_setr_epi32(0, 1, 2, 3);
+   const __m128i randomStep = _mm_set1_epi32((int)PARTICLE_RANDOM_STEP);
+
+   // Locals, since the compiler can't tell the stores below leave the member pointers alone.
+   float* posX = mPosX;
+   float* posY = mPosY;
+   float* posZ = mPosZ;
+   float* velX = mVelX;
+   float* velY = mVelY;
+   float* velZ = mVelZ;
+   float* timeLeft = mTimeLeft;
+
+   uint32_t i = start;
+   for (; i + 4 <= end; i += 4)
+   {
+      __m128 x = _mm_add_ps(_mm_loadu_ps(posX + i), _mm_mul_ps(_mm_loadu_ps(velX + i), dtSeconds));
+      __m128 y = _mm_add_ps(_mm_loadu_ps(posY + i), _mm_mul_ps(_mm_loadu_ps(velY + i), dtSeconds));
+      __m128 z = _mm_add_ps(_mm_loadu_ps(posZ + i), _mm_mul_ps(_mm_loadu_ps(velZ + i), dtSeconds));
+      __m128 time = _mm_sub_ps(_mm_loadu_ps(timeLeft + i), dtMilliseconds);
+
+      // At 60 FPS about one particle in a hundred respawns per frame, so most groups skip this.
+      const __m128 respawn = _mm_cmplt_ps(time, zero);
+      if (_mm_movemask_ps(respawn) != 0)
+      {
+         __m128 random[RANDOM_COUNT];
+         __m128i value = hashSSE2(_mm_add_epi32(_mm_set1_epi32((int)(i + frameKey)), laneOffsets));
+         random[0] = toUnitFloatSSE2(value);
+         for (uint32_t r = 1; r < RANDOM_COUNT; r++)
+         {
+            value = hashSSE2(_mm_add_epi32(value, randomStep));
+            random[r] = toUnitFloatSSE2(value);
+         }
+
+         const __m128 dirZ = _mm_sub_ps(_mm_mul_ps(random[0], _mm_set1_ps(2.0f)), one);
+         const __m128 turns = _mm_sub_ps(random[1], half);
+         __m128 cosTurns = _mm_add_ps(turns, quarter);
+         cosTurns = _mm_sub_ps(cosTurns, _mm_and_ps(_mm_cmpge_ps(cosTurns, half), one));
+         const __m128 speed = _mm_mul_ps(_mm_set1_ps(MAX_SPEED), _mm_max_ps(_mm_max_ps(random[2], random[3]), random[4]));
+         const __m128 ring = _mm_mul_ps(_mm_sqrt_ps(_mm_max_ps(zero, _mm_sub_ps(one, _mm_mul_ps(dirZ, dirZ)))), speed);
+         const __m128 steps = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(random[5], _mm_set1_ps(10.0f))));
+
+         x = _mm_andnot_ps(respawn, x);
+         y = _mm_andnot_ps(respawn, y);
+         z = _mm_andnot_ps(respawn, z);
+         time = selectSSE2(respawn, _mm_sub_ps(_mm_set1_ps(LIFETIME_MAX_MS), _mm_mul_ps(steps, _mm_set1_ps(LIFETIME_STEP_MS))), time);
+         _mm_storeu_ps(velX + i, selectSSE2(respawn, _mm_mul_ps(ring, sinTurnsSSE2(cosTurns)), _mm_loadu_ps(velX + i)));
+         _mm_storeu_ps(velY + i, selectSSE2(respawn, _mm_mul_ps(ring, sinTurnsSSE2(turns)), _mm_loadu_ps(velY + i)));
+         _mm_storeu_ps(velZ + i, selectSSE2(respawn, _mm_mul_ps(dirZ, speed), _mm_loadu_ps(velZ + i)));
+      }
+
+      _mm_storeu_ps(posX + i, x);
+      _mm_storeu_ps(posY + i, y);
+      _mm_storeu_ps(posZ + i, z);
+      _mm_storeu_ps(timeLeft + i, time);
+   }
+
+   _simulateScalar(i, end, dtMs, frameKey);
+#else
+   _simulateScalar(start, end, dtMs, frameKey);
+#endif
+}
+
+SIMD_TARGET_AVX2 void ParticleSystem::_simulateAVX2(uint32_t start, uint32_t end, float dtMs, uint32_t frameKey)
+{
+#if SIMD_AVX2
+   const __m256 dtSeconds = _mm256_set1_ps(dtMs / 1000.0f);
+   const __m256 dtMilliseconds = _mm256_set1_ps(dtMs);
+   const __m256 zero = _mm256_setzero_ps();
+   const __m256 one = _mm256_set1_ps(1.0f);
+   const __m256 half = _mm256_set1_ps(0.5f);
+   const __m256 quarter = _mm256_set1_ps(0.25f);
+   const __m256i laneOffsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+   const __m256i randomStep = _mm256_set1_epi32((int)PARTICLE_RANDOM_STEP);
+
+   float* posX = mPosX;
+   float* posY = mPosY;
+   float* posZ = mPosZ;
+   float* velX = mVelX;
+   float* velY = mVelY;
+   float* velZ = mVelZ;
+   float* timeLeft = mTimeLeft;
+
+   uint32_t i = start;
+   for (; i + 8 <= end; i += 8)
+   {
+      __m256 x = _mm256_fmadd_ps(_mm256_loadu_ps(velX + i), dtSeconds, _mm256_loadu_ps(posX + i));
+      __m256 y = _mm256_fmadd_ps(_mm256_loadu_ps(velY + i), dtSeconds, _mm256_loadu_ps(posY + i));
+      __m256 z = _mm256_fmadd_ps(_mm256_loadu_ps(velZ + i), dtSeconds, _mm256_loadu_ps(posZ + i));
+      __m256 time = _mm256_sub_ps(_mm256_loadu_ps(timeLeft + i), dtMilliseconds);
+
+      const __m256 respawn = _mm256_cmp_ps(time, zero, _CMP_LT_OQ);
+      if (_mm256_movemask_ps(respawn) != 0)
+      {
+         __m256 random[RANDOM_COUNT];
+         __m256i value = hashAVX2(_mm256_add_epi32(_mm256_set1_epi32((int)(i + frameKey)), laneOffsets));
+         random[0] = toUnitFloatAVX2(value);
+         for (uint32_t r = 1; r < RANDOM_COUNT; r++)
+         {
+            value = hashAVX2(_mm256_add_epi32(value, randomStep));
+            random[r] = toUnitFloatAVX2(value);
+         }
+
+         const __m256 dirZ = _mm256_sub_ps(_mm256_mul_ps(random[0], _mm256_set1_ps(2.0f)), one);
+         const __m256 turns = _mm256_sub_ps(random[1], half);
+         __m256 cosTurns = _mm256_add_ps(turns, quarter);
+         cosTurns = _mm256_sub_ps(cosTurns, _mm256_and_ps(_mm256_cmp_ps(cosTurns, half, _CMP_GE_OQ), one));
+         const __m256 speed = _mm256_mul_ps(_mm256_set1_ps(MAX_SPEED), _mm256_max_ps(_mm256_max_ps(random[2], random[3]), random[4]));
+         const __m256 ring = _mm256_mul_ps(_mm256_sqrt_ps(_mm256_max_ps(zero, _mm256_sub_ps(one, _mm256_mul_ps(dirZ, dirZ)))), speed);
+         const __m256 steps = _mm256_cvtepi32_ps(_mm256_cvttps_epi32(_mm256_mul_ps(random[5], _mm256_set1_ps(10.0f))));
+         const __m256 lifetime = _mm256_sub_ps(_mm256_set1_ps(LIFETIME_MAX_MS), _mm256_mul_ps(steps, _mm256_set1_ps(LIFETIME_STEP_MS)));
+
+         x = _mm256_andnot_ps(respawn, x);
+         y = _mm256_andnot_ps(respawn, y);
+         z = _mm256_andnot_ps(respawn, z);
+         time = _mm256_blendv_ps(time, lifetime, respawn);
+         _mm256_storeu_ps(velX + i, _mm256_blendv_ps(_mm256_loadu_ps(velX + i), _mm256_mul_ps(ring, sinTurnsAVX2(cosTurns)), respawn));
+         _mm256_storeu_ps(velY + i, _mm256_blendv_ps(_mm256_loadu_ps(velY + i), _mm256_mul_ps(ring, sinTurnsAVX2(turns)), respawn));
+         _mm256_storeu_ps(velZ + i, _mm256_blendv_ps(_mm256_loadu_ps(velZ + i), _mm256_mul_ps(dirZ, speed), respawn));
+      }
+
+      _mm256_storeu_ps(posX + i, x);
+      _mm256_storeu_ps(posY + i, y);
+      _mm256_storeu_ps(posZ + i, z);
+      _mm256_storeu_ps(timeLeft + i, time);
+   }
+
+   _simulateSSE2(i, end, dtMs, frameKey);
+#else
+   _simulateScalar(start, end, dtMs, frameKey);
+#endif
+}
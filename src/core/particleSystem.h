@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include "core/simd.h"
+
+// 12 bytes instead of the 28 of float position and color.
+struct ParticleVertex
+{
+   int16_t pos[3]; // SHORT_NORM within ParticleSystem::getBounds()
+   uint8_t lifetime; // UNSIGNED_BYTE_NORM fraction of the longest lifetime left
+   uint8_t padding;
+   uint8_t color[4]; // UNSIGNED_BYTE_NORM RGBA
+};
+
+enum class ParticleKernel
+{
+   SCALAR,
+   SSE2,
+   AVX2
+};
+
+// Structure of arrays, simulated 4 (SSE2) or 8 (AVX2) at a time. Respawns are keyed on the
+// particle index and the frame, so any range can be simulated on its own.
+class ParticleSystem
+{
+public:
+   // Particles per cache line of each array.
+   static const uint32_t CHUNK_SIZE = SIMD_CACHE_LINE_SIZE / sizeof(float);
+
+   ParticleSystem();
+   ParticleSystem(const ParticleSystem&) = delete;
+   ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+   void resize(uint32_t count);
+   inline uint32_t getCount() const { return mCount; }
+
+   // Unsupported kernels fall back to scalar.
+   void setKernel(ParticleKernel kernel);
+   inline ParticleKernel getKernel() const { return mKernel; }
+
+   static bool isKernelSupported(ParticleKernel kernel);
+   static ParticleKernel getBestKernel();
+   static const char* getKernelString(ParticleKernel kernel);
+
+   // Vertex positions are stored relative to it.
+   void getBounds(glm::vec3& outCenter, glm::vec3& outExtents) const;
+
+   void simulate(float dtMs);
+
+   // Ranges starting on a multiple of CHUNK_SIZE can run on different threads, call
+   // nextFrame() once all are done.
+   void simulateRange(uint32_t start, uint32_t end, float dtMs);
+
+   inline void nextFrame() { mFrame++; }
+
+   void writeVertices(uint32_t start, uint32_t end, ParticleVertex* outVertices) const;
+
+   // Ascending keys put the farthest along viewDir first. Depth is quantized to 16 bits so
+   // RadixSort skips half its passes.
+   void writeSortKeys(uint32_t start, uint32_t end, const glm::vec3& viewPos, const glm::vec3& viewDir, float minDepth,
+      float maxDepth, uint32_t* outKeys) const;
+
+private:
+   void _respawn(uint32_t index, uint32_t frameKey);
+   void _simulateScalar(uint32_t start, uint32_t end, float dtMs, uint32_t frameKey);
+   void _simulateSSE2(uint32_t start, uint32_t end, float dtMs, uint32_t frameKey);
+   void _simulateAVX2(uint32_t start, uint32_t end, float dtMs, uint32_t frameKey);
+
+   std::vector<float> mStorage;
+   uint32_t mCount = 0;
+   uint32_t mFrame = 0;
+   ParticleKernel mKernel;
+
+   // Each points to a cache line aligned array in mStorage, padded to a multiple of CHUNK_SIZE.
+   float* mPosX = nullptr;
+   float* mPosY = nullptr;
+   float* mPosZ = nullptr;
+   float* mVelX = nullptr;
+   float* mVelY = nullptr;
+   float* mVelZ = nullptr;
+   float* mTimeLeft = nullptr;
+};
@@ -0,0 +1,422 @@
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include "core/profiler.h"
+
+namespace
+{
+   // Single producer (the owning thread), single consumer (newFrame under the registry lock).
+   struct ThreadBuffer
+   {
+      ProfileEvent events[Profiler::RING_SIZE];
+      std::atomic<uint32_t> head;
+      std::atomic<uint32_t> tail;
+      std::atomic<bool> released;
+      uint32_t index;
+      char name[Profiler::MAX_THREAD_NAME];
+   };
+
+   struct ThreadBufferOwner
+   {
+      ThreadBuffer* buffer = nullptr;
+
+      ~ThreadBufferOwner()
+      {
+         // Whatever is left in the ring is still drained, the buffer is reused once it's empty.
+         if (buffer)
+            buffer->released.store(true, std::memory_order_release);
+      }
+   };
+
+   struct ProfileFrame
+   {
+      uint64_t startNs;
+      uint64_t endNs;
+      std::vector<ProfileEvent> events;
+      std::vector<ProfileGpuFrame> gpuFrames;
+   };
+
+   struct BuildNode
+   {
+      const char* name;
+      uint64_t totalNs;
+      uint32_t calls;
+      std::vector<uint32_t> children;
+   };
+
+   struct ProfilerState
+   {
+      std::mutex mutex;
+      std::vector<std::unique_ptr<ThreadBuffer>> threads;
+      ThreadBuffer* gpuTrack = nullptr;
+      std::vector<ProfileEvent> gpuFrameEvents; // recordGpu() since the last recordGpuFrame()
+      std::vector<ProfileGpuFrame> gpuFrames; // landed since the last newFrame()
+
+      std::mutex nameMutex;
+      std::unordered_set<std::string> names;
+
+      std::deque<ProfileFrame> history;
+      uint32_t keptFrameCount = 0; // every frame ever pushed to the history
+      std::vector<ProfileNode> tree;
+      uint64_t frameStartNs = 0;
+      bool paused = false;
+      std::atomic<uint64_t> droppedEvents;
+
+      ProfilerState() : droppedEvents(0) {}
+   };
+
+   ProfilerState gProfiler;
+   thread_local ThreadBufferOwner tThreadBuffer;
+}
+
+thread_local uint32_t Profiler::sDepth = 0;
+
+// Expects gProfiler.mutex to be held.
+static ThreadBuffer* createThreadBuffer()
+{
+   gProfiler.threads.emplace_back(new ThreadBuffer);
+
+   ThreadBuffer* buffer = gProfiler.threads.back().get();
+   buffer->head = 0;
+   buffer->tail = 0;
+   buffer->released = false;
+   buffer->index = (uint32_t)gProfiler.threads.size() - 1;
+   return buffer;
+}
+
+static void pushEvent(ThreadBuffer* buffer, const char* name, uint64_t startNs, uint64_t endNs, uint32_t depth)
+{
+   const uint32_t head = buffer->head.load(std::memory_order_relaxed);
+   if (head - buffer->tail.load(std::memory_order_acquire) >= Profiler::RING_SIZE)
+   {
+      gProfiler.droppedEvents++;
+      return;
+   }
+
+   buffer->events[head % Profiler::RING_SIZE] = { name, startNs, endNs, depth, buffer->index };
+   buffer->head.store(head + 1, std::memory_order_release);
+}
+
+static ThreadBuffer* getThreadBuffer()
+{
+   if (tThreadBuffer.buffer)
+      return tThreadBuffer.buffer;
+
+   std::lock_guard<std::mutex> lock(gProfiler.mutex);
+
+   ThreadBuffer* buffer = nullptr;
+   for (const auto& thread : gProfiler.threads)
+   {
+      if (thread->released.load(std::memory_order_acquire) && thread->head.load() == thread->tail.load())
+      {
+         buffer = thread.get();
+         break;
+      }
+   }
+
+   if (!buffer)
+      buffer = createThreadBuffer();
+
+   buffer->released = false;
+   snprintf(buffer->name, sizeof(buffer->name), "Thread %u", buffer->index);
+
+   tThreadBuffer.buffer = buffer;
+   return buffer;
+}
+
+static void buildNodes(const std::vector<BuildNode>& nodes, uint32_t index, uint32_t depth, std::vector<ProfileNode>& outTree)
+{
+   const BuildNode& node = nodes[index];
+
+   const size_t position = outTree.size();
+   outTree.push_back({ node.name, node.totalNs / 1000000.0, node.calls, depth, 1 });
+
+   for (uint32_t child : node.children)
+      buildNodes(nodes, child, depth + 1, outTree);
+
+   outTree[position].subtreeSize = (uint32_t)(outTree.size() - position);
+}
+
+static void buildFrameTree(const ProfileFrame& frame, std::vector<ProfileNode>& outTree)
+{
+   std::vector<ProfileEvent> events = frame.events;
+   std::sort(events.begin(), events.end(), [](const ProfileEvent& a, const ProfileEvent& b)
+   {
+      if (a.threadIndex != b.threadIndex)
+         return a.threadIndex < b.threadIndex;
+      if (a.startNs != b.startNs)
+         return a.startNs < b.startNs;
+      return a.depth < b.depth;
+   });
+
+   outTree.clear();
+
+   std::vector<BuildNode> nodes;
+   std::vector<uint32_t> stack;
+   for (size_t i = 0; i < events.size();)
+   {
+      const uint32_t threadIndex = events[i].threadIndex;
+
+      nodes.clear();
+      nodes.push_back({ gProfiler.threads[threadIndex]->name, 0, 0, {} });
+      stack.assign(1, 0);
+
+      for (; i < events.size() && events[i].threadIndex == threadIndex; i++)
+      {
+         const ProfileEvent& event = events[i];
+
+         // The parent may have been dropped or started before the frame, then the event
+         // is attached to the closest ancestor that is known.
+         while (stack.size() > event.depth + 1)
+            stack.pop_back();
+
+         BuildNode& parent = nodes[stack.back()];
+         uint32_t child = 0;
+         for (uint32_t sibling : parent.children)
+         {
+            if (nodes[sibling].name == event.name || strcmp(nodes[sibling].name, event.name) == 0)
+            {
+               child = sibling;
+               break;
+            }
+         }
+
+         if (child == 0)
+         {
+            child = (uint32_t)nodes.size();
+            nodes[stack.back()].children.push_back(child);
+            nodes.push_back({ event.name, 0, 0, {} });
+         }
+
+         nodes[child].totalNs += event.endNs - event.startNs;
+         nodes[child].calls++;
+         if (stack.size() == 1)
+            nodes[0].totalNs += event.endNs - event.startNs;
+
+         stack.push_back(child);
+      }
+
+      buildNodes(nodes, 0, 0, outTree);
+   }
+}
+
+static void writeJsonString(FILE* file, const char* str)
+{
+   fputc('"', file);
+   for (; *str; str++)
+   {
+      if (*str == '"' || *str == '\\')
+         fputc('\\', file);
+      fputc(*str, file);
+   }
+   fputc('"', file);
+}
+
+uint64_t Profiler::now()
+{
+   return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::newFrame()
+{
+   const uint64_t frameEndNs = now();
+
+   ProfileFrame frame;
+   frame.startNs = gProfiler.frameStartNs;
+   frame.endNs = frameEndNs;
+   gProfiler.frameStartNs = frameEndNs;
+
+   std::lock_guard<std::mutex> lock(gProfiler.mutex);
+   for (const auto& thread : gProfiler.threads)
+   {
+      const uint32_t head = thread->head.load(std::memory_order_acquire);
+      const uint32_t tail = thread->tail.load(std::memory_order_relaxed);
+      for (uint32_t i = tail; i != head; i++)
+         frame.events.push_back(thread->events[i % RING_SIZE]);
+
+      thread->tail.store(head, std::memory_order_release);
+   }
+
+   frame.gpuFrames.swap(gProfiler.gpuFrames);
+   gProfiler.gpuFrames.clear();
+
+   if (gProfiler.paused || frame.startNs == 0)
+      return;
+
+   buildFrameTree(frame, gProfiler.tree);
+
+   gProfiler.history.push_back(std::move(frame));
+   gProfiler.keptFrameCount++;
+   if (gProfiler.history.size() > MAX_HISTORY_FRAMES)
+      gProfiler.history.pop_front();
+}
+
+void Profiler::setThreadName(const char* name)
+{
+   ThreadBuffer* buffer = getThreadBuffer();
+
+   std::lock_guard<std::mutex> lock(gProfiler.mutex);
+   snprintf(buffer->name, sizeof(buffer->name), "%s", name);
+}
+
+void Profiler::setPaused(bool paused)
+{
+   gProfiler.paused = paused;
+}
+
+bool Profiler::isPaused()
+{
+   return gProfiler.paused;
+}
+
+void Profiler::record(const char* name, uint64_t startNs, uint64_t endNs, uint32_t depth)
+{
+   pushEvent(getThreadBuffer(), name, startNs, endNs, depth);
+}
+
+void Profiler::recordGpu(const char* name, uint64_t startNs, uint64_t endNs, uint32_t depth)
+{
+   if (!gProfiler.gpuTrack)
+   {
+      std::lock_guard<std::mutex> lock(gProfiler.mutex);
+      gProfiler.gpuTrack = createThreadBuffer();
+      snprintf(gProfiler.gpuTrack->name, sizeof(gProfiler.gpuTrack->name), "GPU");
+   }
+
+   pushEvent(gProfiler.gpuTrack, name, startNs, endNs, depth);
+
+   // Also kept apart per GPU frame, a CPU frame may harvest several GPU frames at once.
+   if (gProfiler.gpuFrameEvents.size() < RING_SIZE)
+      gProfiler.gpuFrameEvents.push_back({ name, startNs, endNs, depth, gProfiler.gpuTrack->index });
+}
+
+void Profiler::recordGpuFrame(uint64_t startNs, uint64_t endNs)
+{
+   ProfileFrame gpuFrame;
+   gpuFrame.events.swap(gProfiler.gpuFrameEvents);
+
+   std::lock_guard<std::mutex> lock(gProfiler.mutex);
+
+   ProfileGpuFrame frame;
+   frame.frameMs = (std::max(startNs, endNs) - startNs) / 1000000.0;
+   buildFrameTree(gpuFrame, frame.tree);
+   gProfiler.gpuFrames.push_back(std::move(frame));
+}
+
+const char* Profiler::internName(const char* name)
+{
+   std::lock_guard<std::mutex> lock(gProfiler.nameMutex);
+   return gProfiler.names.insert(name).first->c_str();
+}
+
+const std::vector<ProfileNode>& Profiler::getFrameTree()
+{
+   return gProfiler.tree;
+}
+
+double Profiler::getFrameMs()
+{
+   if (gProfiler.history.empty())
+      return 0.0;
+
+   const ProfileFrame& frame = gProfiler.history.back();
+   return (frame.endNs - frame.startNs) / 1000000.0;
+}
+
+const std::vector<ProfileGpuFrame>& Profiler::getGpuFrames()
+{
+   static const std::vector<ProfileGpuFrame> empty;
+   if (gProfiler.history.empty())
+      return empty;
+
+   return gProfiler.history.back().gpuFrames;
+}
+
+uint32_t Profiler::getHistoryFrameCount()
+{
+   return (uint32_t)gProfiler.history.size();
+}
+
+uint32_t Profiler::getFirstHistoryFrame()
+{
+   return gProfiler.keptFrameCount - (uint32_t)gProfiler.history.size();
+}
+
+uint32_t Profiler::getLastHistoryFrame()
+{
+   return gProfiler.history.empty() ? 0 : gProfiler.keptFrameCount - 1;
+}
+
+uint64_t Profiler::getDroppedEventCount()
+{
+   return gProfiler.droppedEvents.load();
+}
+
+bool Profiler::exportChromeTrace(const char* fileName, uint32_t firstFrame, uint32_t lastFrame)
+{
+   if (gProfiler.history.empty())
+      return false;
+
+   const uint32_t historyFirstFrame = getFirstHistoryFrame();
+   firstFrame = std::max(firstFrame, historyFirstFrame);
+   lastFrame = std::min(lastFrame, getLastHistoryFrame());
+   if (firstFrame > lastFrame)
+      return false;
+
+   // History indices of the range
+   const size_t begin = firstFrame - historyFirstFrame;
+   const size_t end = lastFrame - historyFirstFrame + 1;
+
+   FILE* file = fopen(fileName, "w");
+   if (!file)
+      return false;
+
+   const uint64_t baseNs = gProfiler.history[begin].startNs;
+
+   fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+   {
+      std::lock_guard<std::mutex> lock(gProfiler.mutex);
+      for (const auto& thread : gProfiler.threads)
+      {
+         fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":", thread->index);
+         writeJsonString(file, thread->name);
+         fprintf(file, "}},\n");
+      }
+   }
+
+   for (size_t i = begin; i < end; i++)
+   {
+      const ProfileFrame& frame = gProfiler.history[i];
+
+      fprintf(file, "{\"name\":\"Frame %zu\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"ts\":%.3f},\n", historyFirstFrame + i, (frame.startNs - baseNs) / 1000.0);
+
+      for (const ProfileEvent& event : frame.events)
+      {
+         // Scopes of worker threads may have started before the first exported frame, GPU events
+         // arrive a few frames after they ran.
+         if (event.endNs < baseNs)
+            continue;
+
+         const uint64_t startNs = std::max(event.startNs, baseNs);
+         const uint64_t endNs = std::max(event.endNs, startNs);
+
+         fprintf(file, "{\"name\":");
+         writeJsonString(file, event.name);
+         fprintf(file, ",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f},\n", event.threadIndex, (startNs - baseNs) / 1000.0, (endNs - startNs) / 1000.0);
+      }
+   }
+
+   // Chrome's parser doesn't accept a trailing comma, close with a harmless metadata event.
+   fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"sandbox\"}}\n]}\n");
+   fclose(file);
+
+   return true;
+}
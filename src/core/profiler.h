@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+// Times the rest of the enclosing block, name must be a string literal.
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+struct ProfileEvent
+{
+   const char* name;
+   uint64_t startNs;
+   uint64_t endNs;
+   uint32_t depth;
+   uint32_t threadIndex;
+};
+
+// Stored depth first, scopes with the same name under the same parent are merged.
+struct ProfileNode
+{
+   const char* name;
+   double totalMs;
+   uint32_t calls;
+   uint32_t depth;
+   uint32_t subtreeSize; // this node and all of its descendants
+};
+
+// A device frame whose GPU results have landed, its tree holds only that frame's timers.
+struct ProfileGpuFrame
+{
+   double frameMs;
+   std::vector<ProfileNode> tree;
+};
+
+// Threads record into their own ring without locking, newFrame() drains them into a history.
+class Profiler
+{
+public:
+   enum
+   {
+      RING_SIZE = 16384,
+      MAX_HISTORY_FRAMES = 300,
+      MAX_THREAD_NAME = 32
+   };
+
+   static uint64_t now();
+
+   // Main thread only.
+   static void newFrame();
+
+   static void setThreadName(const char* name);
+
+   static void setPaused(bool paused);
+   static bool isPaused();
+
+   static void record(const char* name, uint64_t startNs, uint64_t endNs, uint32_t depth);
+
+   // Times on the now() clock. Always call from the same thread.
+   static void recordGpu(const char* name, uint64_t startNs, uint64_t endNs, uint32_t depth);
+
+   // After recording the frame's timers with recordGpu().
+   static void recordGpuFrame(uint64_t startNs, uint64_t endNs);
+
+   // For names that aren't literals.
+   static const char* internName(const char* name);
+
+   static const std::vector<ProfileNode>& getFrameTree();
+   static double getFrameMs();
+
+   // Usually one, none while the results are in flight.
+   static const std::vector<ProfileGpuFrame>& getGpuFrames();
+   static uint32_t getHistoryFrameCount();
+
+   // A number keeps pointing at the same frame while the history rolls.
+   static uint32_t getFirstHistoryFrame();
+   static uint32_t getLastHistoryFrame();
+   static uint64_t getDroppedEventCount();
+
+   // Returns false when none of the frames are still in the history.
+   static bool exportChromeTrace(const char* fileName, uint32_t firstFrame, uint32_t lastFrame);
+
+   static inline uint32_t enterScope() { return sDepth++; }
+   static inline void leaveScope() { sDepth--; }
+
+private:
+   static thread_local uint32_t sDepth;
+};
+
+class ProfileScope
+{
+public:
+   explicit ProfileScope(const char* name) : mName(name), mDepth(Profiler::enterScope()), mStart(Profiler::now()) {}
+
+   ~ProfileScope()
+   {
+      Profiler::record(mName, mStart, Profiler::now(), mDepth);
+      Profiler::leaveScope();
+   }
+
+private:
+   const char* mName;
+   uint32_t mDepth;
+   uint64_t mStart;
+};
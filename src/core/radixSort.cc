@@ -0,0 +1,141 @@
+#include <string.h>
+#include <algorithm>
+#include "core/radixSort.h"
+
+static const uint32_t RADIX_BITS = 8;
+static const uint32_t RADIX_SIZE = 1 << RADIX_BITS;
+static const uint32_t RADIX_MASK = RADIX_SIZE - 1;
+static const uint32_t PASS_COUNT = 32 / RADIX_BITS;
+
+// Sequential copies are cheap enough that smaller jobs only add overhead.
+static const uint32_t COPY_GRAIN_SIZE = 65536;
+
+void RadixSort::sort(JobSystem& jobSystem, const uint32_t* keys, uint32_t count, uint32_t* outIndices)
+{
+   if (count == 0)
+      return;
+
+   const uint32_t blockCount = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+   mItems[0].resize(count);
+   mItems[1].resize(count);
+   mCounts.resize(blockCount * PASS_COUNT * RADIX_SIZE);
+
+   uint32_t* counts = mCounts.data();
+
+   // A single read of the keys counts the digits of every pass, which is both what the first
+   // pass scatters with and how passes that wouldn't move anything are found.
+   jobSystem.parallelFor(blockCount, 1, [&](uint32_t startBlock, uint32_t endBlock, uint32_t threadIndex)
+   {
+      for (uint32_t block = startBlock; block < endBlock; block++)
+      {
+         uint32_t* blockCounts = counts + block * PASS_COUNT * RADIX_SIZE;
+         memset(blockCounts, 0, PASS_COUNT * RADIX_SIZE * sizeof(uint32_t));
+
+         const uint32_t end = std::min((block + 1) * BLOCK_SIZE, count);
+         for (uint32_t i = block * BLOCK_SIZE; i < end; i++)
+         {
+            const uint32_t key = keys[i];
+            blockCounts[key & RADIX_MASK]++;
+            blockCounts[RADIX_SIZE + ((key >> 8) & RADIX_MASK)]++;
+            blockCounts[RADIX_SIZE * 2 + ((key >> 16) & RADIX_MASK)]++;
+            blockCounts[RADIX_SIZE * 3 + (key >> 24)]++;
+         }
+      }
+   });
+
+   const uint64_t* srcItems = nullptr; // keys in their original order until the first pass runs
+   uint32_t target = 0;
+
+   for (uint32_t pass = 0; pass < PASS_COUNT; pass++)
+   {
+      const uint32_t shift = pass * RADIX_BITS;
+
+      // Totals don't change with the order of the keys, so the first counts still hold.
+      bool skip = false;
+      for (uint32_t digit = 0; digit < RADIX_SIZE && !skip; digit++)
+      {
+         uint32_t total = 0;
+         for (uint32_t block = 0; block < blockCount; block++)
+            total += counts[(block * PASS_COUNT + pass) * RADIX_SIZE + digit];
+         skip = total == count;
+      }
+      if (skip)
+         continue;
+
+      // Once keys have moved, the counts per block have to be taken again.
+      if (srcItems)
+      {
+         jobSystem.parallelFor(blockCount, 1, [&](uint32_t startBlock, uint32_t endBlock, uint32_t threadIndex)
+         {
+            for (uint32_t block = startBlock; block < endBlock; block++)
+            {
+               uint32_t* blockCounts = counts + (block * PASS_COUNT + pass) * RADIX_SIZE;
+               memset(blockCounts, 0, RADIX_SIZE * sizeof(uint32_t));
+
+               const uint32_t end = std::min((block + 1) * BLOCK_SIZE, count);
+               for (uint32_t i = block * BLOCK_SIZE; i < end; i++)
+                  blockCounts[(srcItems[i] >> (32 + shift)) & RADIX_MASK]++;
+            }
+         });
+      }
+
+      // Blocks of the same digit go in block order, which keeps the sort stable.
+      uint32_t offset = 0;
+      for (uint32_t digit = 0; digit < RADIX_SIZE; digit++)
+      {
+         for (uint32_t block = 0; block < blockCount; block++)
+         {
+            uint32_t& digitCount = counts[(block * PASS_COUNT + pass) * RADIX_SIZE + digit];
+            const uint32_t blockDigitCount = digitCount;
+            digitCount = offset;
+            offset += blockDigitCount;
+         }
+      }
+
+      uint64_t* dstItems = mItems[target].data();
+
+      jobSystem.parallelFor(blockCount, 1, [&](uint32_t startBlock, uint32_t endBlock, uint32_t threadIndex)
+      {
+         for (uint32_t block = startBlock; block < endBlock; block++)
+         {
+            uint32_t offsets[RADIX_SIZE];
+            memcpy(offsets, counts + (block * PASS_COUNT + pass) * RADIX_SIZE, sizeof(offsets));
+
+            const uint32_t end = std::min((block + 1) * BLOCK_SIZE, count);
+            if (srcItems)
+            {
+               for (uint32_t i = block * BLOCK_SIZE; i < end; i++)
+               {
+                  const uint64_t item = srcItems[i];
+                  dstItems[offsets[(item >> (32 + shift)) & RADIX_MASK]++] = item;
+               }
+            }
+            else
+            {
+               for (uint32_t i = block * BLOCK_SIZE; i < end; i++)
+               {
+                  const uint32_t key = keys[i];
+                  dstItems[offsets[(key >> shift) & RADIX_MASK]++] = (uint64_t)key << 32 | i;
+               }
+            }
+         }
+      });
+
+      srcItems = dstItems;
+      target ^= 1;
+   }
+
+   jobSystem.parallelFor(count, COPY_GRAIN_SIZE, [&](uint32_t start, uint32_t end, uint32_t threadIndex)
+   {
+      if (srcItems)
+      {
+         for (uint32_t i = start; i < end; i++)
+            outIndices[i] = (uint32_t)srcItems[i];
+      }
+      else
+      {
+         for (uint32_t i = start; i < end; i++)
+            outIndices[i] = i;
+      }
+   });
+}
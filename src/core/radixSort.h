@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "core/jobSystem.h"
+
+// Stable LSD radix sort of 32 bit keys, 8 bits per pass. Passes where every key has the same
+// digit are skipped.
+class RadixSort
+{
+public:
+   static const uint32_t BLOCK_SIZE = 16384;
+
+   // outIndices is written front to back, so it can be a mapped buffer.
+   void sort(JobSystem& jobSystem, const uint32_t* keys, uint32_t count, uint32_t* outIndices);
+
+private:
+   // Key in the upper half, index in the lower, so a pass scatters to a single array.
+   std::vector<uint64_t> mItems[2];
+
+   // Digit counts per block and pass, then the scatter offset of each.
+   std::vector<uint32_t> mCounts;
+};
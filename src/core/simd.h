@@ -0,0 +1,59 @@
+#pragma once
+
+// SSE2 is part of the x64 baseline, so anything built for x64 can use it
+// without extra compiler flags. arm64 (Apple Silicon) takes the scalar paths.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2 1
+#include <emmintrin.h>
+#else
+#define SIMD_SSE2 0
+#endif
+
+// AVX2 isn't part of any baseline we build for, so AVX2 code lives in functions marked
+// SIMD_TARGET_AVX2 and is only called after simdSupportsAvx2() said yes at runtime.
+#if SIMD_SSE2 && (defined(__GNUC__) || defined(_MSC_VER))
+#define SIMD_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define SIMD_TARGET_AVX2
+#else
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#else
+#define SIMD_AVX2 0
+#define SIMD_TARGET_AVX2
+#endif
+
+#if defined(_MSC_VER)
+#define SIMD_ALIGN(x) __declspec(align(x))
+#else
+#define SIMD_ALIGN(x) __attribute__((aligned(x)))
+#endif
+
+#define SIMD_CACHE_LINE_SIZE 64
+
+inline bool simdSupportsAvx2()
+{
+#if SIMD_AVX2 && defined(_MSC_VER) && !defined(__clang__)
+   int info[4];
+   __cpuid(info, 0);
+   if (info[0] < 7)
+      return false;
+
+   // The OS also has to save the upper halves of the ymm registers.
+   __cpuid(info, 1);
+   const bool osxsave = (info[2] & (1 << 27)) != 0;
+   const bool avx = (info[2] & (1 << 28)) != 0;
+   const bool fma = (info[2] & (1 << 12)) != 0;
+   if (!osxsave || !avx || !fma || (_xgetbv(0) & 6) != 6)
+      return false;
+
+   __cpuidex(info, 7, 0);
+   return (info[1] & (1 << 5)) != 0;
+#elif SIMD_AVX2
+   return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+   return false;
+#endif
+}
@@ -0,0 +1,545 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "gfx/Null/gfxNullDevice.h"
+
+GFXApi GFXNullDevice::getApi() const
+{
+   return GFXApi::Null;
+}
+
+const char* GFXNullDevice::getApiVersionString() const
+{
+   return "1.0";
+}
+
+const char* GFXNullDevice::getGFXDeviceRendererDesc() const
+{
+   return "Null";
+}
+
+const char* GFXNullDevice::getGFXDeviceVendorDesc() const
+{
+   return "None";
+}
+
+BufferHandle GFXNullDevice::createBuffer(const GFXBufferDesc& desc)
+{
+   NullBuffer buffer;
+   buffer.type = desc.type;
+   buffer.data.resize(desc.sizeInBytes);
+   if (desc.data)
+   {
+      memcpy(buffer.data.data(), desc.data, desc.sizeInBytes);
+      mCurrentFrameStats.bytesUploaded += desc.sizeInBytes;
+   }
+
+   _trackAllocation(getBufferMemoryCategory(buffer.type), buffer.data.size());
+
+   BufferHandle returnHandle = mBufferHandleCounter++;
+   mBuffers[returnHandle] = std::move(buffer);
+   return returnHandle;
+}
+
+void GFXNullDevice::deleteBuffer(BufferHandle handle)
+{
+   const auto& found = mBuffers.find(handle);
+   if (found != mBuffers.end())
+   {
+      _trackFree(getBufferMemoryCategory(found->second.type), found->second.data.size());
+      mBuffers.erase(found);
+   }
+#ifdef GFX_DEBUG
+   else
+   {
+      assert(false);
+   }
+#endif
+}
+
+PipelineHandle GFXNullDevice::createPipeline(const GFXPipelineDesc& desc)
+{
+   PipelineHandle returnHandle = mPipelineHandleCounter++;
+   mPipelines[returnHandle] = desc.primitiveType;
+   return returnHandle;
+}
+
+void GFXNullDevice::deletePipeline(PipelineHandle handle)
+{
+   mPipelines.erase(handle);
+}
+
+RenderPassHandle GFXNullDevice::createRenderPass(const GFXRenderPassDesc& desc)
+{
+   if (desc.colorAttachmentCount > MAX_COLOR_ATTACHMENTS)
+   {
+      // No more than 8 attachments!
+      abort();
+   }
+
+   auto trackRenderTarget = [this](TextureHandle handle)
+   {
+      const auto& found = mTextures.find(handle);
+      if (found != mTextures.end())
+         _trackRenderTarget(found->second.category, found->second.sizeInBytes);
+   };
+
+   for (uint32_t i = 0; i < desc.colorAttachmentCount; i++)
+      trackRenderTarget(desc.colorAttachments[i].texture);
+   if (desc.depthAttachmentEnabled)
+      trackRenderTarget(desc.depthAttachment.texture);
+   if (desc.stencilAttachmentEnabled)
+      trackRenderTarget(desc.stencilAttachment.texture);
+
+   mMemoryStats.renderPassCount++;
+
+   RenderPassHandle returnHandle = mRenderPassHandleCounter++;
+   mRenderPasses[returnHandle] = desc;
+   return returnHandle;
+}
+
+void GFXNullDevice::deleteRenderPass(RenderPassHandle handle)
+{
+   const auto& found = mRenderPasses.find(handle);
+   if (found != mRenderPasses.end())
+   {
+      mMemoryStats.renderPassCount--;
+      mRenderPasses.erase(found);
+   }
+#ifdef GFX_DEBUG
+   else
+   {
+      assert(false);
+   }
+#endif
+}
+
+StateBlockHandle GFXNullDevice::createRasterizerState(const GFXRasterizerStateDesc& desc)
+{
+   StateBlockHandle handle = mStateBlockHandleCounter++;
+   mRasterizerStates[handle] = desc;
+   return handle;
+}
+
+StateBlockHandle GFXNullDevice::createDepthStencilState(const GFXDepthStencilStateDesc& desc)
+{
+   StateBlockHandle handle = mStateBlockHandleCounter++;
+   mDepthStencilStates[handle] = desc;
+   return handle;
+}
+
+StateBlockHandle GFXNullDevice::createBlendState(const GFXBlendStateDesc& desc)
+{
+   StateBlockHandle handle = mStateBlockHandleCounter++;
+   mBlendStates[handle] = desc;
+   return handle;
+}
+
+void GFXNullDevice::deleteStateBlock(StateBlockHandle handle)
+{
+   mRasterizerStates.erase(handle);
+   mDepthStencilStates.erase(handle);
+   mBlendStates.erase(handle);
+}
+
+SamplerHandle GFXNullDevice::createSampler(const GFXSamplerStateDesc& desc)
+{
+   SamplerHandle samplerHandle = mSamplerHandleCounter++;
+   mSamplers[samplerHandle] = desc;
+   return samplerHandle;
+}
+
+void GFXNullDevice::deleteSampler(SamplerHandle handle)
+{
+   mSamplers.erase(handle);
+}
+
+TextureHandle GFXNullDevice::createTexture(const GFXTextureStateDesc& desc)
+{
+   int32_t levels = desc.levels;
+   if (levels <= 0)
+   {
+      int32_t largest = std::max(desc.width, desc.height);
+      if (desc.type == GFXTextureType::TEXTURE_3D)
+         largest = std::max(largest, desc.depth);
+
+      levels = 1;
+      while (largest > 1)
+      {
+         largest >>= 1;
+         levels++;
+      }
+   }
+
+   NullTexture texture;
+   texture.type = desc.type;
+   texture.format = desc.internalFormat;
+   texture.sizeInBytes = getTextureMemorySize(desc.type, desc.internalFormat, desc.width, desc.height, desc.depth, levels);
+   texture.category = GFXMemoryCategory::TEXTURE;
+   _trackAllocation(texture.category, texture.sizeInBytes);
+
+   if (desc.data)
+   {
+      const int32_t layers = desc.type == GFXTextureType::TEXTURE_CUBEMAP ? 6 : desc.depth;
+      mCurrentFrameStats.bytesUploaded += getTextureRegionSize(desc.internalFormat, desc.width, desc.height, layers);
+   }
+
+   TextureHandle returnHandle = mTextureHandleCounter++;
+   mTextures[returnHandle] = texture;
+   return returnHandle;
+}
+
+void GFXNullDevice::deleteTexture(TextureHandle handle)
+{
+   const auto& found = mTextures.find(handle);
+   if (found != mTextures.end())
+   {
+      _trackFree(found->second.category, found->second.sizeInBytes);
+      mTextures.erase(found);
+   }
+#ifdef GFX_DEBUG
+   else
+   {
+      assert(false);
+   }
+#endif
+}
+
+void GFXNullDevice::updateTexture(TextureHandle handle, const GFXTextureUpdateDesc& desc)
+{
+   const auto& found = mTextures.find(handle);
+   if (found == mTextures.end())
+   {
+#ifdef GFX_DEBUG
+      assert(false);
+#endif
+      return;
+   }
+
+   mCurrentFrameStats.bytesUploaded += getTextureRegionSize(found->second.format, desc.width, desc.height, desc.depth);
+}
+
+void* GFXNullDevice::mapBuffer(BufferHandle handle, uint32_t offset, uint32_t size)
+{
+   NullBuffer& buffer = mBuffers[handle];
+   mCurrentFrameStats.bytesMapped += size;
+   return buffer.data.data() + offset;
+}
+
+void GFXNullDevice::unmapBuffer(BufferHandle handle)
+{
+}
+
+void GFXNullDevice::readBuffer(BufferHandle handle, uint32_t offset, uint32_t size, void* outData)
+{
+   const NullBuffer& buffer = mBuffers[handle];
+   memcpy(outData, buffer.data.data() + offset, size);
+}
+
+FenceHandle GFXNullDevice::createFence()
+{
+   // Nothing runs behind executeCmdBuffers(), every fence is signaled already.
+   return mFenceHandleCounter++;
+}
+
+void GFXNullDevice::deleteFence(FenceHandle handle)
+{
+}
+
+bool GFXNullDevice::isFenceSignaled(FenceHandle handle)
+{
+   return true;
+}
+
+void GFXNullDevice::executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count)
+{
+   for (int i = 0; i < count; i++)
+   {
+      const GFXCmdBuffer* cmd = cmdBuffers[i];
+      const uint32_t* cmdBuffer = cmd->cmdBuffer;
+
+      size_t offset = 0;
+      for (;;)
+      {
+         const CommandType type = (CommandType)cmdBuffer[offset++];
+         mCurrentFrameStats.commandCounts[(int)type]++;
+
+         switch (type)
+         {
+         case CommandType::Viewport:
+         {
+            mState.viewport[0] = cmdBuffer[offset++];
+            mState.viewport[1] = cmdBuffer[offset++];
+            mState.viewport[2] = cmdBuffer[offset++];
+            mState.viewport[3] = cmdBuffer[offset++];
+            break;
+         }
+
+         case CommandType::Scissor:
+         {
+            mState.scissor[0] = cmdBuffer[offset++];
+            mState.scissor[1] = cmdBuffer[offset++];
+            mState.scissor[2] = cmdBuffer[offset++];
+            mState.scissor[3] = cmdBuffer[offset++];
+            break;
+         }
+
+         case CommandType::RasterizerState:
+         {
+            mState.rasterizerState = &mRasterizerStates[cmdBuffer[offset++]];
+            mCurrentFrameStats.stateBlockChanges++;
+            break;
+         }
+
+         case CommandType::DepthStencilState:
+         {
+            mState.depthStencilState = &mDepthStencilStates[cmdBuffer[offset++]];
+            mCurrentFrameStats.stateBlockChanges++;
+            break;
+         }
+
+         case CommandType::BlendState:
+         {
+            mState.blendState = &mBlendStates[cmdBuffer[offset++]];
+            mCurrentFrameStats.stateBlockChanges++;
+            break;
+         }
+
+         case CommandType::BindRenderPass:
+         {
+            mState.renderPass = &mRenderPasses[cmdBuffer[offset++]];
+            mCurrentFrameStats.renderPassBinds++;
+            break;
+         }
+
+         case CommandType::BindPipeline:
+         {
+            mState.primitiveType = mPipelines[cmdBuffer[offset++]];
+            mCurrentFrameStats.pipelineBinds++;
+            break;
+         }
+
+         case CommandType::BindPushConstants:
+         {
+            mState.pushConstants = cmd->pushConstantPool[cmdBuffer[offset++]].data;
+            break;
+         }
+
+         case CommandType::BindVertexBuffer:
+         {
+            const uint32_t bindingSlot = cmdBuffer[offset++];
+            const NullBuffer& buffer = mBuffers[cmdBuffer[offset++]];
+            offset++; // stride
+            const uint32_t bufferOffset = cmdBuffer[offset++];
+
+            mState.vertexBuffers[bindingSlot & 7] = buffer.data.data() + bufferOffset;
+            mCurrentFrameStats.bufferBinds++;
+            break;
+         }
+
+         case CommandType::BindVertexBuffers:
+         {
+            const uint32_t startBindingSlot = cmdBuffer[offset++];
+            const uint32_t bufferCount = cmdBuffer[offset++];
+
+            for (uint32_t j = 0; j < bufferCount; j++)
+            {
+               const NullBuffer& buffer = mBuffers[cmdBuffer[offset++]];
+               offset++; // stride
+               const uint32_t bufferOffset = cmdBuffer[offset++];
+
+               mState.vertexBuffers[(startBindingSlot + j) & 7] = buffer.data.data() + bufferOffset;
+            }
+
+            mCurrentFrameStats.bufferBinds += bufferCount;
+            break;
+         }
+
+         case CommandType::BindIndexBuffer:
+         {
+            const NullBuffer& buffer = mBuffers[cmdBuffer[offset++]];
+            offset++; // index type
+            const uint32_t bufferOffset = cmdBuffer[offset++];
+
+            mState.indexBuffer = buffer.data.data() + bufferOffset;
+            mCurrentFrameStats.bufferBinds++;
+            break;
+         }
+
+         case CommandType::BindConstantBuffer:
+         {
+            const uint32_t index = cmdBuffer[offset++];
+            const NullBuffer& buffer = mBuffers[cmdBuffer[offset++]];
+            const uint32_t bufferOffset = cmdBuffer[offset++];
+            offset++; // size
+
+            mState.constantBuffers[index & 15] = buffer.data.data() + bufferOffset;
+            mCurrentFrameStats.bufferBinds++;
+            break;
+         }
+
+         case CommandType::BindStorageBuffer:
+         {
+            const uint32_t index = cmdBuffer[offset++];
+            const NullBuffer& buffer = mBuffers[cmdBuffer[offset++]];
+            const uint32_t bufferOffset = cmdBuffer[offset++];
+            offset++; // size
+
+            mState.storageBuffers[index & 15] = buffer.data.data() + bufferOffset;
+            mCurrentFrameStats.bufferBinds++;
+            break;
+         }
+
+         case CommandType::BindTexture:
+         {
+            const uint32_t index = cmdBuffer[offset++];
+            mState.textures[index & 31] = &mTextures[cmdBuffer[offset++]];
+            mCurrentFrameStats.textureBinds++;
+            break;
+         }
+
+         case CommandType::BindTextures:
+         {
+            const uint32_t startingIndex = cmdBuffer[offset++];
+            const uint32_t textureCount = cmdBuffer[offset++];
+
+            for (uint32_t j = 0; j < textureCount; j++)
+               mState.textures[(startingIndex + j) & 31] = &mTextures[cmdBuffer[offset++]];
+
+            mCurrentFrameStats.textureBinds += textureCount;
+            break;
+         }
+
+         case CommandType::BindSampler:
+         {
+            const uint32_t index = cmdBuffer[offset++];
+            mState.samplers[index & 31] = &mSamplers[cmdBuffer[offset++]];
+            mCurrentFrameStats.samplerBinds++;
+            break;
+         }
+
+         case CommandType::BindSamplers:
+         {
+            const uint32_t startingIndex = cmdBuffer[offset++];
+            const uint32_t samplerCount = cmdBuffer[offset++];
+
+            for (uint32_t j = 0; j < samplerCount; j++)
+               mState.samplers[(startingIndex + j) & 31] = &mSamplers[cmdBuffer[offset++]];
+
+            mCurrentFrameStats.samplerBinds += samplerCount;
+            break;
+         }
+
+         case CommandType::BindImage:
+         {
+            const uint32_t index = cmdBuffer[offset++];
+            mState.images[index & 7] = &mTextures[cmdBuffer[offset++]];
+            offset += 2; // level, access
+            mCurrentFrameStats.textureBinds++;
+            break;
+         }
+
+         case CommandType::DrawPrimitives:
+         {
+            offset++; // vertex start
+            const uint32_t vertexCount = cmdBuffer[offset++];
+
+            _countDraw(mState.primitiveType, vertexCount, 1);
+            break;
+         }
+
+         case CommandType::DrawPrimitivesInstanced:
+         {
+            offset++; // vertex start
+            const uint32_t vertexCount = cmdBuffer[offset++];
+            const uint32_t instanceCount = cmdBuffer[offset++];
+
+            _countDraw(mState.primitiveType, vertexCount, instanceCount);
+            break;
+         }
+
+         case CommandType::DrawIndexedPrimitives:
+         {
+            const uint32_t vertexCount = cmdBuffer[offset++];
+            offset++; // index buffer offset
+
+            _countDraw(mState.primitiveType, vertexCount, 1);
+            break;
+         }
+
+         case CommandType::DrawIndexedPrimitivesInstanced:
+         {
+            const uint32_t vertexCount = cmdBuffer[offset++];
+            offset++; // index buffer offset
+            const uint32_t instanceCount = cmdBuffer[offset++];
+
+            _countDraw(mState.primitiveType, vertexCount, instanceCount);
+            break;
+         }
+
+         case CommandType::DrawPrimitivesIndirect:
+         {
+            const NullBuffer& buffer = mBuffers[cmdBuffer[offset++]];
+            const uint32_t argumentOffset = cmdBuffer[offset++];
+
+            mState.indirectBuffer = buffer.data.data() + argumentOffset;
+
+            _countIndirectDraw();
+            break;
+         }
+
+         case CommandType::MultiDrawIndexedPrimitivesIndirectCount:
+         {
+            const NullBuffer& buffer = mBuffers[cmdBuffer[offset++]];
+            const uint32_t argumentOffset = cmdBuffer[offset++];
+            offset += 3; // count buffer, count offset, max draw count
+
+            mState.indirectBuffer = buffer.data.data() + argumentOffset;
+
+            _countIndirectDraw();
+            break;
+         }
+
+         case CommandType::Dispatch:
+         {
+            offset += 3; // group counts
+            mCurrentFrameStats.dispatches++;
+            break;
+         }
+
+         case CommandType::MemoryBarrier:
+         case CommandType::BeginTimer:
+         {
+            offset++;
+            break;
+         }
+
+         case CommandType::EndTimer:
+         {
+            break;
+         }
+
+         case CommandType::End:
+         {
+            goto done;
+         }
+         }
+      }
+
+   done:
+      ;
+   }
+}
+
+void GFXNullDevice::present(RenderPassHandle handle, int width, int height, int sourceWidth, int sourceHeight)
+{
+   _endFrameStats();
+}
+
+bool GFXNullDevice::readPresentedImage(std::vector<uint8_t>& outPixels, int& outWidth, int& outHeight)
+{
+   // Nothing is ever rendered.
+   return false;
+}
+
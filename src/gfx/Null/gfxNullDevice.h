@@ -0,0 +1,108 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include "gfx/gfxDevice.h"
+#include "gfx/gfxCmdBuffer.h"
+
+// Decodes command buffers without doing any work, to measure recording and decoding alone.
+class GFXNullDevice : public GFXDevice
+{
+   struct NullBuffer
+   {
+      std::vector<uint8_t> data; // backs mapBuffer()
+      GFXBufferType type;
+   };
+
+   struct NullTexture
+   {
+      GFXTextureType type;
+      GFXTextureInternalFormat format;
+      size_t sizeInBytes;
+      GFXMemoryCategory category;
+   };
+
+   std::unordered_map<BufferHandle, NullBuffer> mBuffers;
+   int mBufferHandleCounter = 0;
+
+   std::unordered_map<PipelineHandle, GFXPrimitiveType> mPipelines;
+   int mPipelineHandleCounter = 0;
+
+   std::unordered_map<RenderPassHandle, GFXRenderPassDesc> mRenderPasses;
+   int mRenderPassHandleCounter = 0;
+
+   std::unordered_map<StateBlockHandle, GFXRasterizerStateDesc> mRasterizerStates;
+   std::unordered_map<StateBlockHandle, GFXDepthStencilStateDesc> mDepthStencilStates;
+   std::unordered_map<StateBlockHandle, GFXBlendStateDesc> mBlendStates;
+   int mStateBlockHandleCounter = 0;
+
+   std::unordered_map<SamplerHandle, GFXSamplerStateDesc> mSamplers;
+   int mSamplerHandleCounter = 0;
+
+   std::unordered_map<TextureHandle, NullTexture> mTextures;
+   int mTextureHandleCounter = 0;
+
+   int mFenceHandleCounter = 0;
+
+   // Whatever the last commands resolved, so decoding can't be optimized away.
+   struct
+   {
+      const GFXRenderPassDesc* renderPass = nullptr;
+      const GFXRasterizerStateDesc* rasterizerState = nullptr;
+      const GFXDepthStencilStateDesc* depthStencilState = nullptr;
+      const GFXBlendStateDesc* blendState = nullptr;
+      GFXPrimitiveType primitiveType = GFXPrimitiveType::TRIANGLE_LIST;
+      const uint8_t* vertexBuffers[8] = {};
+      const uint8_t* indexBuffer = nullptr;
+      const uint8_t* constantBuffers[16] = {};
+      const uint8_t* storageBuffers[16] = {};
+      const uint8_t* indirectBuffer = nullptr;
+      const NullTexture* textures[32] = {};
+      const NullTexture* images[8] = {};
+      const GFXSamplerStateDesc* samplers[32] = {};
+      const void* pushConstants = nullptr;
+      uint32_t viewport[4] = {};
+      uint32_t scissor[4] = {};
+   } mState;
+
+
+public:
+   virtual GFXApi getApi() const override;
+   virtual const char* getApiVersionString() const override;
+   virtual const char* getGFXDeviceRendererDesc() const override;
+   virtual const char* getGFXDeviceVendorDesc() const override;
+
+   virtual BufferHandle createBuffer(const GFXBufferDesc& desc) override;
+   virtual void deleteBuffer(BufferHandle handle) override;
+
+   virtual PipelineHandle createPipeline(const GFXPipelineDesc& desc) override;
+   virtual void deletePipeline(PipelineHandle handle) override;
+
+   virtual RenderPassHandle createRenderPass(const GFXRenderPassDesc& desc) override;
+   virtual void deleteRenderPass(RenderPassHandle handle) override;
+
+   virtual StateBlockHandle createRasterizerState(const GFXRasterizerStateDesc& desc) override;
+   virtual StateBlockHandle createDepthStencilState(const GFXDepthStencilStateDesc& desc) override;
+   virtual StateBlockHandle createBlendState(const GFXBlendStateDesc& desc) override;
+   virtual void deleteStateBlock(StateBlockHandle handle) override;
+
+   virtual SamplerHandle createSampler(const GFXSamplerStateDesc& desc) override;
+   virtual void deleteSampler(SamplerHandle handle) override;
+
+   virtual TextureHandle createTexture(const GFXTextureStateDesc& desc) override;
+   virtual void deleteTexture(TextureHandle handle) override;
+   virtual void updateTexture(TextureHandle handle, const GFXTextureUpdateDesc& desc) override;
+
+   virtual void* mapBuffer(BufferHandle handle, uint32_t offset, uint32_t size) override;
+   virtual void unmapBuffer(BufferHandle handle) override;
+   virtual void readBuffer(BufferHandle handle, uint32_t offset, uint32_t size, void* outData) override;
+
+   virtual FenceHandle createFence() override;
+   virtual void deleteFence(FenceHandle handle) override;
+   virtual bool isFenceSignaled(FenceHandle handle) override;
+
+   virtual void executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count) override;
+
+   virtual void present(RenderPassHandle handle, int width, int height, int sourceWidth = 0, int sourceHeight = 0) override;
+   virtual bool readPresentedImage(std::vector<uint8_t>& outPixels, int& outWidth, int& outHeight) override;
+};
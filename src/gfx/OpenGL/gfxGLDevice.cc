@@ -1,4 +1,8 @@
 #include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include "core/profiler.h"
 #include "gfx/OpenGL/gfxGLDevice.h"
 
 static inline void validateShaderCompilation(GLuint shader)
@@ -44,10 +48,22 @@ GFXGLDevice::GFXGLDevice()
 
    // enable scissor test by default
    glEnable(GL_SCISSOR_TEST);
+
+   // texture uploads are always tightly packed
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+   mCaps.hasBufferStorage = GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+   mCaps.hasIndirectCount = GLAD_GL_VERSION_4_6 || GLAD_GL_ARB_indirect_parameters;
+   mCaps.hasNvxMemoryInfo = GLAD_GL_NVX_gpu_memory_info;
+   mCaps.hasAtiMemoryInfo = GLAD_GL_ATI_meminfo;
+   _createStagingRing();
 }
 
 GFXGLDevice::~GFXGLDevice()
 {
+   _destroyStagingRing();
+   _destroyTimers();
+
    glBindVertexArray(0);
    glDeleteVertexArrays(1, &mState.globalVAO);
 }
@@ -97,8 +113,13 @@ BufferHandle GFXGLDevice::createBuffer(const GFXBufferDesc& desc)
    glBindBuffer(type, buffer);
    glBufferData(type, desc.sizeInBytes, desc.data, usage);
 
+   const GFXMemoryCategory category = getBufferMemoryCategory(desc.type);
+   _trackAllocation(category, desc.sizeInBytes);
+   if (desc.data)
+      mCurrentFrameStats.bytesUploaded += desc.sizeInBytes;
+
    BufferHandle returnHandle = mBufferHandleCounter++;
-   mBuffers[returnHandle] = { buffer, desc.usage, type };
+   mBuffers[returnHandle] = { buffer, desc.usage, type, desc.sizeInBytes, category };
 
    return returnHandle;
 }
@@ -109,6 +130,7 @@ void GFXGLDevice::deleteBuffer(BufferHandle handle)
    if (found != mBuffers.end())
    {
       glDeleteBuffers(1, &found->second.buffer);
+      _trackFree(found->second.category, found->second.sizeInBytes);
       mBuffers.erase(found);
    }
 #ifdef GFX_DEBUG
@@ -133,14 +155,15 @@ PipelineHandle GFXGLDevice::createPipeline(const GFXPipelineDesc& desc)
       GLuint slot = (GLuint)attribute.slot;
 
       glEnableVertexAttribArray(slot);
-      glVertexAttribFormat(slot, attribute.count, _getInputLayoutType(attribute.type), GL_FALSE, attribute.offset);
+      glVertexAttribFormat(slot, attribute.count, _getInputLayoutType(attribute.type), _getInputLayoutNormalized(attribute.type), attribute.offset);
       glVertexAttribBinding(slot, attribute.bufferBinding);
-      glVertexBindingDivisor(slot, attribute.divisor == GFXInputLayoutDivisor::PER_VERTEX ? 0 : 1);
+      glVertexBindingDivisor(attribute.bufferBinding, attribute.divisor == GFXInputLayoutDivisor::PER_VERTEX ? 0 : 1);
    }
 
    glBindVertexArray(mState.globalVAO);
 
    pipelineState.primitiveType = _getPrimitiveType(desc.primitiveType);
+   pipelineState.topology = desc.primitiveType;
    pipelineState.shader = _createShaderProgram(desc.shadersStages, desc.shaderStageCount); 
 
    PipelineHandle returnHandle = mPipelineHandleCounter++;
@@ -184,7 +207,10 @@ RenderPassHandle GFXGLDevice::createRenderPass(const GFXRenderPassDesc& desc)
    for (int i = 0; i < desc.colorAttachmentCount; i++)
    {
       GLuint colorAttachment = GL_COLOR_ATTACHMENT0 + i;
-      GLuint textureId = mTextures[desc.colorAttachments[i].texture].texture;
+      GLTexture* texture = _findTexture(desc.colorAttachments[i].texture);
+      GLuint textureId = texture ? texture->texture : 0;
+      if (texture)
+         _trackRenderTarget(texture->category, texture->sizeInBytes);
 
       glFramebufferTexture(GL_FRAMEBUFFER, colorAttachment, textureId, 0);
 
@@ -198,9 +224,19 @@ RenderPassHandle GFXGLDevice::createRenderPass(const GFXRenderPassDesc& desc)
       renderPass.colorTargets[i].clearColor[3] = desc.colorAttachments[i].clearColor[3];
    }
 
+   // Depth only passes have no color to draw to or read from.
+   if (desc.colorAttachmentCount == 0)
+   {
+      glDrawBuffer(GL_NONE);
+      glReadBuffer(GL_NONE);
+   }
+
    if (desc.depthAttachmentEnabled)
    {
-      GLuint textureId = mTextures[desc.depthAttachment.texture].texture;
+      GLTexture* texture = _findTexture(desc.depthAttachment.texture);
+      GLuint textureId = texture ? texture->texture : 0;
+      if (texture)
+         _trackRenderTarget(texture->category, texture->sizeInBytes);
       glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textureId, 0);
 
       renderPass.enableDepthAttachment = true;
@@ -211,7 +247,10 @@ RenderPassHandle GFXGLDevice::createRenderPass(const GFXRenderPassDesc& desc)
 
    if (desc.stencilAttachmentEnabled)
    {
-      GLuint textureId = mTextures[desc.stencilAttachment.texture].texture;
+      GLTexture* texture = _findTexture(desc.stencilAttachment.texture);
+      GLuint textureId = texture ? texture->texture : 0;
+      if (texture)
+         _trackRenderTarget(texture->category, texture->sizeInBytes);
       glFramebufferTexture(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, textureId, 0);
 
       renderPass.enableStencilAttachment = true;
@@ -225,6 +264,8 @@ RenderPassHandle GFXGLDevice::createRenderPass(const GFXRenderPassDesc& desc)
       abort();
    }
 
+   mMemoryStats.renderPassCount++;
+
    RenderPassHandle returnHandle = mRenderPassHandleCounter++;
    mRenderPasses[returnHandle] = std::move(renderPass);
    return returnHandle;
@@ -235,7 +276,8 @@ void GFXGLDevice::deleteRenderPass(RenderPassHandle handle)
    const auto& found = mRenderPasses.find(handle);
    if (found != mRenderPasses.end())
    {
-
+      glDeleteFramebuffers(1, &found->second.fbo);
+      mMemoryStats.renderPassCount--;
 
       mRenderPasses.erase(found);
    }
@@ -270,7 +312,7 @@ StateBlockHandle GFXGLDevice::createRasterizerState(const GFXRasterizerStateDesc
    state.polygonFillMode = desc.fillMode == GFXFillMode::SOLID ? GL_FILL : GL_LINE;
    state.enableDynamicPointSize = desc.enableDynamicPointSize;
 
-   StateBlockHandle handle = mRasterizerHandleCounter++;
+   StateBlockHandle handle = mStateBlockHandleCounter++;
    mRasterizerStates[handle] = std::move(state);
    return handle;
 }
@@ -279,6 +321,8 @@ StateBlockHandle GFXGLDevice::createDepthStencilState(const GFXDepthStencilState
 {
    GLDepthStencilState state;
    state.enableDepthTest = desc.enableDepthTest;
+   state.enableDepthWrite = desc.enableDepthWrite;
+   state.enableStencilTest = desc.enableStencilTest;
    state.depthCompareFunc = _getCompareFunc(desc.depthCompareFunc);
 
    state.frontFaceStencil.depthFailFunc = _getStencilFunc(desc.frontFaceStencil.depthFailFunc);
@@ -297,20 +341,38 @@ StateBlockHandle GFXGLDevice::createDepthStencilState(const GFXDepthStencilState
    state.backFaceStencil.stencilWriteMask = desc.backFaceStencil.stencilWriteMask;
    state.backFaceStencil.referenceValue = desc.backFaceStencil.referenceValue;
 
-   StateBlockHandle handle = mDepthStencilStateHandleCounter++;
+   StateBlockHandle handle = mStateBlockHandleCounter++;
    mDepthStencilStates[handle] = state;
    return handle;
 }
 
 StateBlockHandle GFXGLDevice::createBlendState(const GFXBlendStateDesc& desc)
 {
-   assert(false && "GFXGLDevice::createBlendState() is not implemented");
-   return 0;
+   GLBlendState state;
+   state.enableBlending = desc.enableBlending;
+   state.srcColorFactor = _getBlendFactor(desc.srcColorFactor);
+   state.dstColorFactor = _getBlendFactor(desc.dstColorFactor);
+   state.colorOp = _getBlendOp(desc.colorOp);
+   state.srcAlphaFactor = _getBlendFactor(desc.srcAlphaFactor);
+   state.dstAlphaFactor = _getBlendFactor(desc.dstAlphaFactor);
+   state.alphaOp = _getBlendOp(desc.alphaOp);
+
+   StateBlockHandle handle = mStateBlockHandleCounter++;
+   mBlendState[handle] = state;
+   return handle;
 }
 
 void GFXGLDevice::deleteStateBlock(StateBlockHandle handle)
 {
-   assert(false && "GFXGLDevice::deleteStateBlock() is not implemented");
+   // State blocks are only recorded here, there is no GL object behind them.
+   size_t erased = mRasterizerStates.erase(handle);
+   erased += mDepthStencilStates.erase(handle);
+   erased += mBlendState.erase(handle);
+
+#ifdef GFX_DEBUG
+   assert(erased == 1);
+#endif
+   (void)erased;
 }
 
 SamplerHandle GFXGLDevice::createSampler(const GFXSamplerStateDesc& desc)
@@ -364,10 +426,30 @@ TextureHandle GFXGLDevice::createTexture(const GFXTextureStateDesc& desc)
    GLTexture texture = {};
    texture.width = desc.width;
    texture.height = desc.height;
+   texture.depth = desc.depth;
    texture.levels = desc.levels;
+   texture.format = desc.internalFormat;
    texture.type = _getTextureType(desc.type);
    texture.internalFormat = _getTextureInternalFormat(desc.internalFormat);
 
+   if (texture.levels <= 0)
+   {
+      int32_t largest = std::max(texture.width, texture.height);
+      if (texture.type == GL_TEXTURE_3D)
+         largest = std::max(largest, texture.depth);
+
+      texture.levels = 1;
+      while (largest > 1)
+      {
+         largest >>= 1;
+         texture.levels++;
+      }
+   }
+
+   texture.sizeInBytes = getTextureMemorySize(desc.type, desc.internalFormat, texture.width, texture.height, texture.depth, texture.levels);
+   texture.category = GFXMemoryCategory::TEXTURE;
+   _trackAllocation(texture.category, texture.sizeInBytes);
+
    glGenTextures(1, &texture.texture);
    glBindTexture(texture.type, texture.texture);
    
@@ -379,12 +461,34 @@ TextureHandle GFXGLDevice::createTexture(const GFXTextureStateDesc& desc)
    case GL_TEXTURE_2D:
       glTexStorage2D(GL_TEXTURE_2D, texture.levels, texture.internalFormat, texture.width, texture.height);
       break;
+   case GL_TEXTURE_CUBE_MAP:
+      glTexStorage2D(GL_TEXTURE_CUBE_MAP, texture.levels, texture.internalFormat, texture.width, texture.height);
+      texture.depth = 6;
+      break;
+   case GL_TEXTURE_3D:
+   case GL_TEXTURE_2D_ARRAY:
+      glTexStorage3D(texture.type, texture.levels, texture.internalFormat, texture.width, texture.height, texture.depth);
+      break;
    default:
       abort();
    }
 
    TextureHandle textureHandle = mTextureHandleCounter++;
    mTextures[textureHandle] = std::move(texture);
+
+   if (desc.data)
+   {
+      const GLTexture& created = mTextures[textureHandle];
+
+      GFXTextureUpdateDesc region;
+      region.width = created.width;
+      region.height = created.type == GL_TEXTURE_1D ? 1 : created.height;
+      region.depth = created.type == GL_TEXTURE_1D || created.type == GL_TEXTURE_2D ? 1 : created.depth;
+      region.data = desc.data;
+
+      _submitTextureUpload(textureHandle, region, desc.generateMipmaps);
+   }
+
    return textureHandle;
 }
 
@@ -394,6 +498,7 @@ void GFXGLDevice::deleteTexture(TextureHandle handle)
    if (found != mTextures.end())
    {
       glDeleteTextures(1, &found->second.texture);
+      _trackFree(found->second.category, found->second.sizeInBytes);
 
       mTextures.erase(found);
    }
@@ -405,6 +510,11 @@ void GFXGLDevice::deleteTexture(TextureHandle handle)
 #endif
 }
 
+void GFXGLDevice::updateTexture(TextureHandle handle, const GFXTextureUpdateDesc& desc)
+{
+   _submitTextureUpload(handle, desc, false);
+}
+
 void* GFXGLDevice::mapBuffer(BufferHandle handle, uint32_t offset, uint32_t size)
 {
    // At the moment, this is a REALLY SLOW WAY TO UPDATE A BUFFER. We can do _A TON_ of optimizations here
@@ -424,6 +534,8 @@ void* GFXGLDevice::mapBuffer(BufferHandle handle, uint32_t offset, uint32_t size
    mState.currentMappedBuffer = buffer.buffer;
    mState.currentMappedBufferType = buffer.type;
 
+   mCurrentFrameStats.bytesMapped += size;
+
    return glMapBufferRange(buffer.type, offset, size, GL_MAP_WRITE_BIT);
 }
 
@@ -441,8 +553,49 @@ void GFXGLDevice::unmapBuffer(BufferHandle handle)
    mState.currentMappedBufferType = 0;
 }
 
+void GFXGLDevice::readBuffer(BufferHandle handle, uint32_t offset, uint32_t size, void* outData)
+{
+   const GLBuffer buffer = mBuffers[handle];
+   glBindBuffer(buffer.type, buffer.buffer);
+   glGetBufferSubData(buffer.type, offset, size, outData);
+}
+
+FenceHandle GFXGLDevice::createFence()
+{
+   FenceHandle handle = mFenceHandleCounter++;
+   mFences[handle] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+   return handle;
+}
+
+void GFXGLDevice::deleteFence(FenceHandle handle)
+{
+   const auto& found = mFences.find(handle);
+   if (found == mFences.end())
+      return;
+
+   glDeleteSync(found->second);
+   mFences.erase(found);
+}
+
+bool GFXGLDevice::isFenceSignaled(FenceHandle handle)
+{
+   // The flush makes sure the fence reaches the GPU, otherwise it could be polled forever.
+   const GLenum status = glClientWaitSync(mFences[handle], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+   return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+
 void GFXGLDevice::executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count)
 {
+   PROFILE_SCOPE("GFXGLDevice::executeCmdBuffers");
+
+   if (mTimers.frame.frameBeginQuery == 0)
+   {
+      mTimers.frame.frameBeginQuery = _allocTimerQuery();
+      glQueryCounter(mTimers.frame.frameBeginQuery, GL_TIMESTAMP);
+   }
+
+   _processTextureUploads();
+
    for (int i = 0; i < count; i++)
    {
       const GFXCmdBuffer* cmd = cmdBuffers[i];
@@ -451,7 +604,10 @@ void GFXGLDevice::executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count)
       size_t offset = 0;
       for (;;)
       {
-         switch ((CommandType)cmd->cmdBuffer[offset++])
+         const CommandType type = (CommandType)cmdBuffer[offset++];
+         mCurrentFrameStats.commandCounts[(int)type]++;
+
+         switch (type)
          {
          case CommandType::Viewport:
          {
@@ -477,6 +633,7 @@ void GFXGLDevice::executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count)
          {
             int handle = cmdBuffer[offset++];
             const GLRasterizerState& rasterState = mRasterizerStates[handle];
+            mCurrentFrameStats.stateBlockChanges++;
 
             if (rasterState.enableDynamicPointSize)
             {
@@ -507,6 +664,7 @@ void GFXGLDevice::executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count)
          {
             int handle = cmdBuffer[offset++];
             const GLDepthStencilState& depthStencil = mDepthStencilStates[handle];
+            mCurrentFrameStats.stateBlockChanges++;
 
             // Depth Settings
             if (depthStencil.enableDepthTest)
@@ -566,6 +724,21 @@ void GFXGLDevice::executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count)
 
          case CommandType::BlendState:
          {
+            int handle = cmdBuffer[offset++];
+            const GLBlendState& blendState = mBlendState[handle];
+            mCurrentFrameStats.stateBlockChanges++;
+
+            if (blendState.enableBlending)
+            {
+               glEnable(GL_BLEND);
+               glBlendFuncSeparate(blendState.srcColorFactor, blendState.dstColorFactor, blendState.srcAlphaFactor, blendState.dstAlphaFactor);
+               glBlendEquationSeparate(blendState.colorOp, blendState.alphaOp);
+            }
+            else
+            {
+               glDisable(GL_BLEND);
+            }
+
             break;
          }
 
@@ -573,6 +746,7 @@ void GFXGLDevice::executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count)
          {
             const RenderPassHandle handle = static_cast<RenderPassHandle>(cmdBuffer[offset++]);
             const GFXGLDevice::GLRenderPass& renderPass = mRenderPasses[handle];
+            mCurrentFrameStats.renderPassBinds++;
 
             glBindFramebuffer(GL_FRAMEBUFFER, renderPass.fbo);
             
@@ -621,6 +795,8 @@ void GFXGLDevice::executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count)
 
             mState.currentProgram = pipeline.shader;
             mState.primitiveType = pipeline.primitiveType;
+            mState.topology = pipeline.topology;
+            mCurrentFrameStats.pipelineBinds++;
             break;
          }
 
@@ -646,6 +822,7 @@ void GFXGLDevice::executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count)
             GLintptr bufferOffset = static_cast<GLintptr>(cmdBuffer[offset++]);
 
             glBindVertexBuffer(bindingSlot, buffer, bufferOffset, stride);
+            mCurrentFrameStats.bufferBinds++;
             break;
          }
 
@@ -677,6 +854,7 @@ void GFXGLDevice::executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count)
                }
             }
 
+            mCurrentFrameStats.bufferBinds += count;
             break;
          }
 
@@ -689,6 +867,7 @@ void GFXGLDevice::executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count)
 
             mState.indexBufferType = type == GFXIndexBufferType::BITS_16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+            mCurrentFrameStats.bufferBinds++;
             break;
          }
 
@@ -702,16 +881,65 @@ void GFXGLDevice::executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count)
             const GLuint buffer = mBuffers[handle].buffer;
 
             glBindBufferRange(GL_UNIFORM_BUFFER, index, buffer, bufferOffset, size);
+            mCurrentFrameStats.bufferBinds++;
+            break;
+         }
+
+         case CommandType::BindStorageBuffer:
+         {
+            const uint32_t index = cmdBuffer[offset++];
+            const BufferHandle handle = static_cast<BufferHandle>(cmdBuffer[offset++]);
+            const uint32_t bufferOffset = cmdBuffer[offset++];
+            const uint32_t size = cmdBuffer[offset++];
+
+            const GLuint buffer = mBuffers[handle].buffer;
+
+            glBindBufferRange(GL_SHADER_STORAGE_BUFFER, index, buffer, bufferOffset, size);
+            mCurrentFrameStats.bufferBinds++;
             break;
          }
 
          case CommandType::BindTexture:
          {
+            const uint32_t index = cmdBuffer[offset++];
+            const GLTexture* texture = _findTexture(static_cast<TextureHandle>(cmdBuffer[offset++]));
+
+            glActiveTexture(GL_TEXTURE0 + index);
+            if (texture)
+               glBindTexture(texture->type, texture->texture);
+            mCurrentFrameStats.textureBinds++;
             break;
          }
 
          case CommandType::BindTextures:
          {
+            const uint32_t startingIndex = cmdBuffer[offset++];
+            const uint32_t count = cmdBuffer[offset++];
+
+            if (mCaps.hasMultiBind)
+            {
+               GLuint textures[32];
+               for (uint32_t i = 0; i < count; ++i)
+               {
+                  // 0 unbinds every target of the unit
+                  const GLTexture* texture = _findTexture((TextureHandle)cmdBuffer[offset++]);
+                  textures[i] = texture ? texture->texture : 0;
+               }
+
+               glBindTextures(startingIndex, count, textures);
+            }
+            else
+            {
+               for (uint32_t i = 0; i < count; i++)
+               {
+                  const GLTexture* texture = _findTexture((TextureHandle)cmdBuffer[offset++]);
+                  glActiveTexture(GL_TEXTURE0 + startingIndex + i);
+                  if (texture)
+                     glBindTexture(texture->type, texture->texture);
+               }
+            }
+
+            mCurrentFrameStats.textureBinds += count;
             break;
          }
 
@@ -722,6 +950,7 @@ void GFXGLDevice::executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count)
             const GLuint sampler = mSamplers[handle].handle;
 
             glBindSampler(index, sampler);
+            mCurrentFrameStats.samplerBinds++;
             break;
          }
 
@@ -747,6 +976,20 @@ void GFXGLDevice::executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count)
                }
             }
 
+            mCurrentFrameStats.samplerBinds += count;
+            break;
+         }
+
+         case CommandType::BindImage:
+         {
+            const uint32_t index = cmdBuffer[offset++];
+            const GLTexture* texture = _findTexture(static_cast<TextureHandle>(cmdBuffer[offset++]));
+            const GLint level = cmdBuffer[offset++];
+            const GFXImageAccess access = (GFXImageAccess)cmdBuffer[offset++];
+
+            if (texture)
+               glBindImageTexture(index, texture->texture, level, GL_TRUE, 0, _getImageAccess(access), texture->internalFormat);
+            mCurrentFrameStats.textureBinds++;
             break;
          }
 
@@ -756,6 +999,7 @@ void GFXGLDevice::executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count)
             int vertexCount = cmdBuffer[offset++];
 
             glDrawArrays(mState.primitiveType, vertexStart, vertexCount);
+            _countDraw(mState.topology, vertexCount, 1);
             break;
          }
 
@@ -766,6 +1010,7 @@ void GFXGLDevice::executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count)
             int instanceCount = cmdBuffer[offset++];
 
             glDrawArraysInstanced(mState.primitiveType, vertexStart, vertexCount, instanceCount);
+            _countDraw(mState.topology, vertexCount, instanceCount);
             break;
          }
 
@@ -775,6 +1020,7 @@ void GFXGLDevice::executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count)
             GLuint indexBufferOffset = cmdBuffer[offset++];
 
             glDrawElements(mState.primitiveType, vertexCount, mState.indexBufferType, (void*)indexBufferOffset);
+            _countDraw(mState.topology, vertexCount, 1);
             break;
          }
 
@@ -785,6 +1031,75 @@ void GFXGLDevice::executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count)
             int instanceCount = cmdBuffer[offset++];
 
             glDrawElementsInstanced(mState.primitiveType, vertexCount, mState.indexBufferType, (void*)indexBufferOffset, instanceCount);
+            _countDraw(mState.topology, vertexCount, instanceCount);
+            break;
+         }
+
+         case CommandType::DrawPrimitivesIndirect:
+         {
+            const BufferHandle handle = static_cast<BufferHandle>(cmdBuffer[offset++]);
+            const uintptr_t argumentOffset = cmdBuffer[offset++];
+
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mBuffers[handle].buffer);
+            glDrawArraysIndirect(mState.primitiveType, (const void*)argumentOffset);
+            _countIndirectDraw();
+            break;
+         }
+
+         case CommandType::MultiDrawIndexedPrimitivesIndirectCount:
+         {
+            const BufferHandle argumentHandle = static_cast<BufferHandle>(cmdBuffer[offset++]);
+            const uintptr_t argumentOffset = cmdBuffer[offset++];
+            const BufferHandle countHandle = static_cast<BufferHandle>(cmdBuffer[offset++]);
+            const GLintptr countOffset = cmdBuffer[offset++];
+            const GLsizei maxDrawCount = cmdBuffer[offset++];
+
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mBuffers[argumentHandle].buffer);
+            if (mCaps.hasIndirectCount)
+            {
+               glBindBuffer(GL_PARAMETER_BUFFER, mBuffers[countHandle].buffer);
+               if (GLAD_GL_VERSION_4_6)
+                  glMultiDrawElementsIndirectCount(mState.primitiveType, mState.indexBufferType, (const void*)argumentOffset, countOffset, maxDrawCount, 0);
+               else
+                  glMultiDrawElementsIndirectCountARB(mState.primitiveType, mState.indexBufferType, (const void*)argumentOffset, countOffset, maxDrawCount, 0);
+            }
+            else
+            {
+               // Records past the count draw no instances.
+               glMultiDrawElementsIndirect(mState.primitiveType, mState.indexBufferType, (const void*)argumentOffset, maxDrawCount, 0);
+            }
+            _countIndirectDraw();
+            break;
+         }
+
+         case CommandType::Dispatch:
+         {
+            const GLuint groupCountX = cmdBuffer[offset++];
+            const GLuint groupCountY = cmdBuffer[offset++];
+            const GLuint groupCountZ = cmdBuffer[offset++];
+
+            glDispatchCompute(groupCountX, groupCountY, groupCountZ);
+            mCurrentFrameStats.dispatches++;
+            break;
+         }
+
+         case CommandType::MemoryBarrier:
+         {
+            GLbitfield barriers = _getMemoryBarrierBits(cmdBuffer[offset++]);
+            if (barriers != 0)
+               glMemoryBarrier(barriers);
+            break;
+         }
+
+         case CommandType::BeginTimer:
+         {
+            _beginTimer(cmd->timerNamePool[cmdBuffer[offset++]]);
+            break;
+         }
+
+         case CommandType::EndTimer:
+         {
+            _endTimer();
             break;
          }
 
@@ -800,17 +1115,30 @@ void GFXGLDevice::executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count)
    }
 }
 
-void GFXGLDevice::present(RenderPassHandle handle, int width, int height)
+void GFXGLDevice::present(RenderPassHandle handle, int width, int height, int sourceWidth, int sourceHeight)
 {
    const auto& renderPass = mRenderPasses[handle];
 
+   const int srcWidth = sourceWidth > 0 ? sourceWidth : width;
+   const int srcHeight = sourceHeight > 0 ? sourceHeight : height;
+   const bool scaled = srcWidth != width || srcHeight != height;
+
+   mPresented.renderPass = handle;
+   mPresented.width = srcWidth;
+   mPresented.height = srcHeight;
+
    GLuint flags = GL_NONE;
    if (renderPass.numColorAttachments > 0)
       flags |= GL_COLOR_BUFFER_BIT;
-   if (renderPass.enableDepthAttachment)
-      flags |= GL_DEPTH_BUFFER_BIT;
-   if (renderPass.enableStencilAttachment)
-      flags |= GL_STENCIL_BUFFER_BIT;
+
+   // Depth and stencil can't be filtered, an upscale only copies color.
+   if (!scaled)
+   {
+      if (renderPass.enableDepthAttachment)
+         flags |= GL_DEPTH_BUFFER_BIT;
+      if (renderPass.enableStencilAttachment)
+         flags |= GL_STENCIL_BUFFER_BIT;
+   }
 
    if (flags == GL_NONE)
    {
@@ -821,7 +1149,289 @@ void GFXGLDevice::present(RenderPassHandle handle, int width, int height)
    glBindFramebuffer(GL_FRAMEBUFFER, 0);
    glBindFramebuffer(GL_READ_FRAMEBUFFER, renderPass.fbo);
    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-   glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, flags, GL_NEAREST);
+
+   // blits are clipped by the scissor, which still holds whatever the last pass used
+   glDisable(GL_SCISSOR_TEST);
+   glBlitFramebuffer(0, 0, srcWidth, srcHeight, 0, 0, width, height, flags, scaled ? GL_LINEAR : GL_NEAREST);
+   glEnable(GL_SCISSOR_TEST);
+
+   // Fence off the staging memory written this frame so it can be recycled later.
+   if (mStaging.frameSize > 0)
+   {
+      GLStagingFence fence;
+      fence.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      fence.size = mStaging.frameSize;
+      mStaging.fences.push_back(fence);
+      mStaging.frameSize = 0;
+   }
+
+   mUploadedThisFrame = 0;
+
+   _resolveTimers();
+   _endFrameStats();
+}
+
+bool GFXGLDevice::readPresentedImage(std::vector<uint8_t>& outPixels, int& outWidth, int& outHeight)
+{
+   const auto& found = mRenderPasses.find(mPresented.renderPass);
+   if (mPresented.width <= 0 || found == mRenderPasses.end() || found->second.numColorAttachments == 0)
+      return false;
+
+   outWidth = mPresented.width;
+   outHeight = mPresented.height;
+   outPixels.resize((size_t)outWidth * outHeight * 4);
+
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+   glBindFramebuffer(GL_READ_FRAMEBUFFER, found->second.fbo);
+   glReadBuffer(GL_COLOR_ATTACHMENT0);
+   glPixelStorei(GL_PACK_ALIGNMENT, 1);
+   glReadPixels(0, 0, outWidth, outHeight, GL_RGBA, GL_UNSIGNED_BYTE, outPixels.data());
+   glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+   return true;
+}
+
+void GFXGLDevice::_createStagingRing()
+{
+   glGenBuffers(1, &mStaging.buffer);
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mStaging.buffer);
+
+   if (mCaps.hasBufferStorage)
+   {
+      const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+      glBufferStorage(GL_PIXEL_UNPACK_BUFFER, STAGING_RING_SIZE, NULL, flags);
+      mStaging.mapped = (uint8_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, STAGING_RING_SIZE, flags);
+   }
+   else
+   {
+      // No persistent mapping, each upload maps its range unsynchronized instead.
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, STAGING_RING_SIZE, NULL, GL_STREAM_DRAW);
+   }
+
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+   _trackAllocation(GFXMemoryCategory::STAGING, STAGING_RING_SIZE);
+}
+
+void GFXGLDevice::_destroyStagingRing()
+{
+   for (const GLStagingFence& fence : mStaging.fences)
+      glDeleteSync(fence.fence);
+   mStaging.fences.clear();
+
+   if (mStaging.mapped)
+   {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mStaging.buffer);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      mStaging.mapped = nullptr;
+   }
+
+   glDeleteBuffers(1, &mStaging.buffer);
+   mStaging.buffer = 0;
+   _trackFree(GFXMemoryCategory::STAGING, STAGING_RING_SIZE);
+}
+
+bool GFXGLDevice::_allocateStaging(size_t size, size_t& outOffset)
+{
+   size_t alignedSize = (size + STAGING_ALIGNMENT - 1) & ~((size_t)STAGING_ALIGNMENT - 1);
+   if (alignedSize > STAGING_RING_SIZE)
+      return false;
+
+   _retireStaging(false);
+
+   // Allocations never wrap, the tail end of the ring is skipped instead.
+   size_t skipped = mStaging.head + alignedSize > STAGING_RING_SIZE ? STAGING_RING_SIZE - mStaging.head : 0;
+   if (mStaging.used + skipped + alignedSize > STAGING_RING_SIZE)
+      return false;
+
+   outOffset = skipped ? 0 : mStaging.head;
+   mStaging.head = outOffset + alignedSize;
+   mStaging.used += skipped + alignedSize;
+   mStaging.frameSize += skipped + alignedSize;
+   return true;
+}
+
+void GFXGLDevice::_retireStaging(bool wait)
+{
+   while (!mStaging.fences.empty())
+   {
+      const GLStagingFence& fence = mStaging.fences.front();
+
+      GLenum status = glClientWaitSync(fence.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000 : 0);
+      if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+         break;
+
+      glDeleteSync(fence.fence);
+      mStaging.used -= fence.size;
+      mStaging.fences.pop_front();
+   }
+}
+
+GFXGLDevice::GLTexture* GFXGLDevice::_findTexture(TextureHandle handle)
+{
+   const auto& found = mTextures.find(handle);
+   if (found != mTextures.end())
+      return &found->second;
+
+#ifdef GFX_DEBUG
+   assert(false);
+#endif
+   return nullptr;
+}
+
+void GFXGLDevice::_submitTextureUpload(TextureHandle handle, const GFXTextureUpdateDesc& desc, bool generateMipmaps)
+{
+   const GLTexture* texture = _findTexture(handle);
+   if (!texture)
+      return;
+
+   // Anything already queued has to go first so updates to the same region land in order.
+   if (mPendingTextureUploads.empty() && _uploadTexture(handle, desc, generateMipmaps))
+      return;
+
+   const size_t size = getTextureRegionSize(texture->format, desc.width, desc.height, desc.depth);
+
+   GLPendingTextureUpload upload;
+   upload.texture = handle;
+   upload.region = desc;
+   upload.region.data = nullptr;
+   upload.data.assign((const uint8_t*)desc.data, (const uint8_t*)desc.data + size);
+   upload.generateMipmaps = generateMipmaps;
+
+   mPendingTextureUploads.push_back(std::move(upload));
+}
+
+bool GFXGLDevice::_uploadTexture(TextureHandle handle, const GFXTextureUpdateDesc& desc, bool generateMipmaps)
+{
+   const auto& found = mTextures.find(handle);
+   if (found == mTextures.end())
+   {
+      // Deleted before its upload got a chance to run
+      return true;
+   }
+
+   const GLTexture& texture = found->second;
+   const size_t size = getTextureRegionSize(texture.format, desc.width, desc.height, desc.depth);
+
+   // The first upload of a frame always goes through so a single upload larger than the budget can't starve.
+   if (mUploadedThisFrame > 0 && mUploadedThisFrame + size > mUploadBudget)
+      return false;
+
+   size_t stagingOffset;
+   if (size > STAGING_RING_SIZE)
+   {
+      // Too big to ever fit in the ring, let the driver copy it.
+      _uploadTextureRegion(texture, desc, desc.data);
+   }
+   else if (_allocateStaging(size, stagingOffset))
+   {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mStaging.buffer);
+
+      if (mStaging.mapped)
+      {
+         memcpy(mStaging.mapped + stagingOffset, desc.data, size);
+      }
+      else
+      {
+         void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, stagingOffset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+         memcpy(dst, desc.data, size);
+         glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      }
+
+      _uploadTextureRegion(texture, desc, (const void*)(uintptr_t)stagingOffset);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+   }
+   else
+   {
+      // Ring is full of data the GPU hasn't consumed yet
+      return false;
+   }
+
+   // Compressed formats can't be filtered by the driver, the encoder provides their mips.
+   if (generateMipmaps && !isCompressedFormat(texture.format))
+      glGenerateMipmap(texture.type);
+
+   mUploadedThisFrame += size;
+   mCurrentFrameStats.bytesUploaded += size;
+   return true;
+}
+
+void GFXGLDevice::_uploadTextureRegion(const GLTexture& texture, const GFXTextureUpdateDesc& desc, const void* pixels)
+{
+   glBindTexture(texture.type, texture.texture);
+
+   if (isCompressedFormat(texture.format))
+   {
+      const GLsizei size = (GLsizei)getTextureRegionSize(texture.format, desc.width, desc.height, desc.depth);
+
+      switch (texture.type)
+      {
+      case GL_TEXTURE_2D:
+         glCompressedTexSubImage2D(GL_TEXTURE_2D, desc.level, desc.x, desc.y, desc.width, desc.height, texture.internalFormat, size, pixels);
+         break;
+      case GL_TEXTURE_3D:
+      case GL_TEXTURE_2D_ARRAY:
+         glCompressedTexSubImage3D(texture.type, desc.level, desc.x, desc.y, desc.z, desc.width, desc.height, desc.depth, texture.internalFormat, size, pixels);
+         break;
+      case GL_TEXTURE_CUBE_MAP:
+      {
+         const GLsizei faceSize = size / desc.depth;
+         for (int32_t i = 0; i < desc.depth; i++)
+         {
+            const GLenum face = GL_TEXTURE_CUBE_MAP_POSITIVE_X + desc.z + i;
+            glCompressedTexSubImage2D(face, desc.level, desc.x, desc.y, desc.width, desc.height, texture.internalFormat, faceSize, (const uint8_t*)pixels + faceSize * i);
+         }
+         break;
+      }
+      default:
+         // No 1D block compression
+         abort();
+      }
+
+      return;
+   }
+
+   GLenum format, type;
+   _getTextureUploadFormat(texture.format, format, type);
+
+   switch (texture.type)
+   {
+   case GL_TEXTURE_1D:
+      glTexSubImage1D(GL_TEXTURE_1D, desc.level, desc.x, desc.width, format, type, pixels);
+      break;
+   case GL_TEXTURE_2D:
+      glTexSubImage2D(GL_TEXTURE_2D, desc.level, desc.x, desc.y, desc.width, desc.height, format, type, pixels);
+      break;
+   case GL_TEXTURE_3D:
+   case GL_TEXTURE_2D_ARRAY:
+      glTexSubImage3D(texture.type, desc.level, desc.x, desc.y, desc.z, desc.width, desc.height, desc.depth, format, type, pixels);
+      break;
+   case GL_TEXTURE_CUBE_MAP:
+   {
+      const size_t faceSize = getTextureRegionSize(texture.format, desc.width, desc.height, 1);
+      for (int32_t i = 0; i < desc.depth; i++)
+      {
+         const GLenum face = GL_TEXTURE_CUBE_MAP_POSITIVE_X + desc.z + i;
+         glTexSubImage2D(face, desc.level, desc.x, desc.y, desc.width, desc.height, format, type, (const uint8_t*)pixels + faceSize * i);
+      }
+      break;
+   }
+   default:
+      abort();
+   }
+}
+
+void GFXGLDevice::_processTextureUploads()
+{
+   while (!mPendingTextureUploads.empty())
+   {
+      GLPendingTextureUpload& upload = mPendingTextureUploads.front();
+      upload.region.data = upload.data.data();
+
+      if (!_uploadTexture(upload.texture, upload.region, upload.generateMipmaps))
+         break;
+
+      mPendingTextureUploads.pop_front();
+   }
 }
 
 GLenum GFXGLDevice::_getBufferUsage(GFXBufferUsageEnum usage) const
@@ -848,6 +1458,10 @@ GLenum GFXGLDevice::_getBufferType(GFXBufferType type) const
       return GL_ELEMENT_ARRAY_BUFFER;
    case GFXBufferType::CONSTANT_BUFFER:
       return GL_UNIFORM_BUFFER;
+   case GFXBufferType::STORAGE_BUFFER:
+      return GL_SHADER_STORAGE_BUFFER;
+   case GFXBufferType::INDIRECT_BUFFER:
+      return GL_DRAW_INDIRECT_BUFFER;
    }
 
    // error
@@ -926,6 +1540,56 @@ GLenum GFXGLDevice::_getCompareFunc(GFXCompareFunc func) const
    return 0;
 }
 
+GLenum GFXGLDevice::_getBlendFactor(GFXBlendFactor factor) const
+{
+   switch (factor)
+   {
+   case GFXBlendFactor::ZERO:
+      return GL_ZERO;
+   case GFXBlendFactor::ONE:
+      return GL_ONE;
+   case GFXBlendFactor::SRC_COLOR:
+      return GL_SRC_COLOR;
+   case GFXBlendFactor::ONE_MINUS_SRC_COLOR:
+      return GL_ONE_MINUS_SRC_COLOR;
+   case GFXBlendFactor::SRC_ALPHA:
+      return GL_SRC_ALPHA;
+   case GFXBlendFactor::ONE_MINUS_SRC_ALPHA:
+      return GL_ONE_MINUS_SRC_ALPHA;
+   case GFXBlendFactor::DST_COLOR:
+      return GL_DST_COLOR;
+   case GFXBlendFactor::ONE_MINUS_DST_COLOR:
+      return GL_ONE_MINUS_DST_COLOR;
+   case GFXBlendFactor::DST_ALPHA:
+      return GL_DST_ALPHA;
+   case GFXBlendFactor::ONE_MINUS_DST_ALPHA:
+      return GL_ONE_MINUS_DST_ALPHA;
+   }
+
+   // error
+   return 0;
+}
+
+GLenum GFXGLDevice::_getBlendOp(GFXBlendOp op) const
+{
+   switch (op)
+   {
+   case GFXBlendOp::ADD:
+      return GL_FUNC_ADD;
+   case GFXBlendOp::SUBTRACT:
+      return GL_FUNC_SUBTRACT;
+   case GFXBlendOp::REVERSE_SUBTRACT:
+      return GL_FUNC_REVERSE_SUBTRACT;
+   case GFXBlendOp::MIN:
+      return GL_MIN;
+   case GFXBlendOp::MAX:
+      return GL_MAX;
+   }
+
+   // error
+   return 0;
+}
+
 GLenum GFXGLDevice::_getShaderType(GFXShaderType type) const
 {
    switch (type)
@@ -934,6 +1598,8 @@ GLenum GFXGLDevice::_getShaderType(GFXShaderType type) const
       return GL_VERTEX_SHADER;
    case GFXShaderType::FRAGMENT:
       return GL_FRAGMENT_SHADER;
+   case GFXShaderType::COMPUTE:
+      return GL_COMPUTE_SHADER;
    }
 
    // error
@@ -952,12 +1618,21 @@ GLenum GFXGLDevice::_getInputLayoutType(GFXInputLayoutFormat format) const
       return GL_SHORT;
    case GFXInputLayoutFormat::INT:
       return GL_INT;
+   case GFXInputLayoutFormat::UNSIGNED_BYTE_NORM:
+      return GL_UNSIGNED_BYTE;
+   case GFXInputLayoutFormat::SHORT_NORM:
+      return GL_SHORT;
    }
 
    // error
    return 0;
 }
 
+GLboolean GFXGLDevice::_getInputLayoutNormalized(GFXInputLayoutFormat format) const
+{
+   return format == GFXInputLayoutFormat::UNSIGNED_BYTE_NORM || format == GFXInputLayoutFormat::SHORT_NORM ? GL_TRUE : GL_FALSE;
+}
+
 GLenum GFXGLDevice::_getSamplerWrapMode(GFXSamplerWrapMode mode) const
 {
    switch (mode)
@@ -1063,6 +1738,8 @@ GLenum GFXGLDevice::_getTextureType(GFXTextureType mode) const
       return GL_TEXTURE_3D;
    case GFXTextureType::TEXTURE_CUBEMAP:
       return GL_TEXTURE_CUBE_MAP;
+   case GFXTextureType::TEXTURE_2D_ARRAY:
+      return GL_TEXTURE_2D_ARRAY;
    }
 
    // error
@@ -1075,10 +1752,265 @@ GLenum GFXGLDevice::_getTextureInternalFormat(GFXTextureInternalFormat format) c
    {
    case GFXTextureInternalFormat::DEPTH_16:
       return GL_DEPTH_COMPONENT16;
+   case GFXTextureInternalFormat::DEPTH_32F:
+      return GL_DEPTH_COMPONENT32F;
    case GFXTextureInternalFormat::RGBA8:
       return GL_RGBA8;
+   case GFXTextureInternalFormat::RG16:
+      return GL_RG16;
+   case GFXTextureInternalFormat::R32F:
+      return GL_R32F;
+   case GFXTextureInternalFormat::BC1_RGB:
+      return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+   case GFXTextureInternalFormat::BC3_RGBA:
+      return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+   case GFXTextureInternalFormat::BC4_R:
+      return GL_COMPRESSED_RED_RGTC1;
+   case GFXTextureInternalFormat::BC5_RG:
+      return GL_COMPRESSED_RG_RGTC2;
+   case GFXTextureInternalFormat::BC7_RGBA:
+      return GL_COMPRESSED_RGBA_BPTC_UNORM;
+   case GFXTextureInternalFormat::ETC2_RGB8:
+      return GL_COMPRESSED_RGB8_ETC2;
+   case GFXTextureInternalFormat::ETC2_RGBA8:
+      return GL_COMPRESSED_RGBA8_ETC2_EAC;
+   }
+
+   // error
+   return 0;
+}
+
+void GFXGLDevice::_getTextureUploadFormat(GFXTextureInternalFormat format, GLenum& outFormat, GLenum& outType) const
+{
+   switch (format)
+   {
+   case GFXTextureInternalFormat::DEPTH_16:
+      outFormat = GL_DEPTH_COMPONENT;
+      outType = GL_UNSIGNED_SHORT;
+      break;
+   case GFXTextureInternalFormat::DEPTH_32F:
+      outFormat = GL_DEPTH_COMPONENT;
+      outType = GL_FLOAT;
+      break;
+   case GFXTextureInternalFormat::RGBA8:
+      outFormat = GL_RGBA;
+      outType = GL_UNSIGNED_BYTE;
+      break;
+   case GFXTextureInternalFormat::RG16:
+      outFormat = GL_RG;
+      outType = GL_UNSIGNED_SHORT;
+      break;
+   case GFXTextureInternalFormat::R32F:
+      outFormat = GL_RED;
+      outType = GL_FLOAT;
+      break;
+   default:
+      // compressed formats go through glCompressedTexSubImage and have no pixel format
+      outFormat = GL_NONE;
+      outType = GL_NONE;
+      break;
+   }
+}
+GLenum GFXGLDevice::_getImageAccess(GFXImageAccess access) const
+{
+   switch (access)
+   {
+   case GFXImageAccess::READ_ONLY:
+      return GL_READ_ONLY;
+   case GFXImageAccess::WRITE_ONLY:
+      return GL_WRITE_ONLY;
+   case GFXImageAccess::READ_WRITE:
+      return GL_READ_WRITE;
    }
 
    // error
    return 0;
-}
\ No newline at end of file
+}
+
+GLbitfield GFXGLDevice::_getMemoryBarrierBits(uint32_t barrierBits) const
+{
+   GLbitfield barriers = 0;
+   if (barrierBits & GFXBarrierBit::TEXTURE_FETCH_BARRIER_BIT)
+      barriers |= GL_TEXTURE_FETCH_BARRIER_BIT;
+   if (barrierBits & GFXBarrierBit::RENDER_TARGET_BARRIER_BIT)
+      barriers |= GL_FRAMEBUFFER_BARRIER_BIT;
+   if (barrierBits & GFXBarrierBit::SHADER_STORAGE_BARRIER_BIT)
+      barriers |= GL_SHADER_STORAGE_BARRIER_BIT;
+   if (barrierBits & GFXBarrierBit::VERTEX_BUFFER_BARRIER_BIT)
+      barriers |= GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT;
+   if (barrierBits & GFXBarrierBit::INDIRECT_BUFFER_BARRIER_BIT)
+      barriers |= GL_COMMAND_BARRIER_BIT;
+   if (barrierBits & GFXBarrierBit::BUFFER_UPDATE_BARRIER_BIT)
+      barriers |= GL_BUFFER_UPDATE_BARRIER_BIT;
+   if (barrierBits & GFXBarrierBit::SHADER_IMAGE_ACCESS_BARRIER_BIT)
+      barriers |= GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+
+   return barriers;
+}
+
+GFXMemoryStats GFXGLDevice::getMemoryStats() const
+{
+   GFXMemoryStats stats = mMemoryStats;
+
+   if (mCaps.hasNvxMemoryInfo)
+   {
+      GLint totalKB = 0;
+      GLint availableKB = 0;
+      glGetIntegerv(GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX, &totalKB);
+      glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &availableKB);
+
+      stats.deviceTotalBytes = (size_t)totalKB * 1024;
+      stats.deviceAvailableBytes = (size_t)availableKB * 1024;
+   }
+   else if (mCaps.hasAtiMemoryInfo)
+   {
+      // Free pool size, largest free block, free auxiliary size and largest auxiliary block, in KB.
+      // There is no total, only what is left.
+      GLint freeKB[4] = {};
+      glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, freeKB);
+
+      stats.deviceAvailableBytes = (size_t)freeKB[0] * 1024;
+   }
+
+   return stats;
+}
+
+GLuint GFXGLDevice::_allocTimerQuery()
+{
+   GLuint query;
+   if (mTimers.freeQueries.empty())
+   {
+      glGenQueries(1, &query);
+   }
+   else
+   {
+      query = mTimers.freeQueries.back();
+      mTimers.freeQueries.pop_back();
+   }
+
+   return query;
+}
+
+void GFXGLDevice::_beginTimer(const char* name)
+{
+   GLTimerQuery timer;
+   timer.name = Profiler::internName(name);
+   timer.beginQuery = _allocTimerQuery();
+   timer.endQuery = _allocTimerQuery();
+   timer.depth = (uint32_t)mTimers.openTimers.size();
+
+   glQueryCounter(timer.beginQuery, GL_TIMESTAMP);
+   mTimers.frame.lastQuery = timer.beginQuery;
+
+   mTimers.openTimers.push_back((uint32_t)mTimers.frame.timers.size());
+   mTimers.frame.timers.push_back(timer);
+}
+
+void GFXGLDevice::_endTimer()
+{
+   if (mTimers.openTimers.empty())
+      return;
+
+   const GLTimerQuery& timer = mTimers.frame.timers[mTimers.openTimers.back()];
+   mTimers.openTimers.pop_back();
+
+   glQueryCounter(timer.endQuery, GL_TIMESTAMP);
+   mTimers.frame.lastQuery = timer.endQuery;
+}
+
+void GFXGLDevice::_resolveTimers()
+{
+   // Every query of a pending frame must have been issued, close whatever was left open.
+   while (!mTimers.openTimers.empty())
+      _endTimer();
+
+   if (mTimers.frame.frameBeginQuery != 0)
+   {
+      mTimers.frame.frameEndQuery = _allocTimerQuery();
+      glQueryCounter(mTimers.frame.frameEndQuery, GL_TIMESTAMP);
+      mTimers.frame.lastQuery = mTimers.frame.frameEndQuery;
+   }
+
+   // Drain every frame that has landed, so a hitch doesn't leave the readback frames behind for good.
+   // getGpuTimers() keeps the newest of them, the profiler's GPU track gets all of them.
+   while (!mTimers.pending.empty())
+   {
+      const GLTimerFrame& frame = mTimers.pending.front();
+
+      GLint available = GL_FALSE;
+      glGetQueryObjectiv(frame.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+      if (!available)
+         break;
+
+      // Reading the GPU clock doesn't wait for queued work, it maps the timestamps onto the CPU clock.
+      GLint64 gpuNow;
+      glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+      const int64_t clockOffset = (int64_t)Profiler::now() - (int64_t)gpuNow;
+
+      mGpuTimers.clear();
+      for (const GLTimerQuery& timer : frame.timers)
+      {
+         GLuint64 begin, end;
+         glGetQueryObjectui64v(timer.beginQuery, GL_QUERY_RESULT, &begin);
+         glGetQueryObjectui64v(timer.endQuery, GL_QUERY_RESULT, &end);
+
+         GFXGpuTimer result;
+         result.name = timer.name;
+         result.startNs = (uint64_t)((int64_t)begin + clockOffset);
+         result.endNs = (uint64_t)((int64_t)std::max(begin, end) + clockOffset);
+         result.depth = timer.depth;
+         mGpuTimers.push_back(result);
+
+         Profiler::recordGpu(result.name, result.startNs, result.endNs, result.depth);
+      }
+
+      if (frame.frameBeginQuery != 0)
+      {
+         GLuint64 begin, end;
+         glGetQueryObjectui64v(frame.frameBeginQuery, GL_QUERY_RESULT, &begin);
+         glGetQueryObjectui64v(frame.frameEndQuery, GL_QUERY_RESULT, &end);
+         Profiler::recordGpuFrame((uint64_t)((int64_t)begin + clockOffset), (uint64_t)((int64_t)end + clockOffset));
+      }
+
+      _freeTimerFrame(frame);
+      mTimers.pending.pop_front();
+   }
+
+   if (mTimers.frame.lastQuery != 0)
+   {
+      if (mTimers.pending.size() < MAX_PENDING_TIMER_FRAMES)
+         mTimers.pending.push_back(std::move(mTimers.frame));
+      else
+         _freeTimerFrame(mTimers.frame);
+
+      mTimers.frame = GLTimerFrame();
+   }
+}
+
+void GFXGLDevice::_freeTimerFrame(const GLTimerFrame& frame)
+{
+   for (const GLTimerQuery& timer : frame.timers)
+   {
+      mTimers.freeQueries.push_back(timer.beginQuery);
+      mTimers.freeQueries.push_back(timer.endQuery);
+   }
+
+   if (frame.frameBeginQuery != 0)
+      mTimers.freeQueries.push_back(frame.frameBeginQuery);
+   if (frame.frameEndQuery != 0)
+      mTimers.freeQueries.push_back(frame.frameEndQuery);
+}
+
+void GFXGLDevice::_destroyTimers()
+{
+   for (const GLTimerFrame& frame : mTimers.pending)
+      _freeTimerFrame(frame);
+   _freeTimerFrame(mTimers.frame);
+
+   if (!mTimers.freeQueries.empty())
+      glDeleteQueries((GLsizei)mTimers.freeQueries.size(), mTimers.freeQueries.data());
+
+   mTimers.freeQueries.clear();
+   mTimers.pending.clear();
+   mTimers.frame = GLTimerFrame();
+}
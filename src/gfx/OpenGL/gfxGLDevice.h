@@ -1,6 +1,8 @@
 #pragma once
 
+#include <deque>
 #include <unordered_map>
+#include <vector>
 #include <glad/glad.h>
 #include "gfx/gfxDevice.h"
 #include "gfx/gfxCmdBuffer.h"
@@ -11,7 +13,14 @@ class GFXGLDevice : public GFXDevice
 
    enum
    {
-      PUSH_CONSTANT_STRIDE = 16
+      PUSH_CONSTANT_STRIDE = 16,
+
+      STAGING_RING_SIZE = 32 * 1024 * 1024,
+      STAGING_ALIGNMENT = 16,
+      DEFAULT_UPLOAD_BUDGET = 8 * 1024 * 1024,
+
+      // Frames of timer queries waiting on the GPU, past this new frames are not timed.
+      MAX_PENDING_TIMER_FRAMES = 8
    };
 
    struct GLBuffer
@@ -19,6 +28,8 @@ class GFXGLDevice : public GFXDevice
       GLuint buffer;
       GFXBufferUsageEnum usage;
       GLenum type;
+      size_t sizeInBytes;
+      GFXMemoryCategory category;
    };
 
    struct GLPipeline
@@ -26,6 +37,7 @@ class GFXGLDevice : public GFXDevice
       GLuint vaoHandle;
       GLuint shader;
       GLenum primitiveType;
+      GFXPrimitiveType topology;
    };
 
    struct GLRasterizerState
@@ -62,7 +74,13 @@ class GFXGLDevice : public GFXDevice
 
    struct GLBlendState
    {
-
+      bool enableBlending;
+      GLenum srcColorFactor;
+      GLenum dstColorFactor;
+      GLenum colorOp;
+      GLenum srcAlphaFactor;
+      GLenum dstAlphaFactor;
+      GLenum alphaOp;
    };
 
    struct GLTexture
@@ -70,14 +88,77 @@ class GFXGLDevice : public GFXDevice
       GLuint texture;
       GLenum type;
       GLenum internalFormat;
+      GFXTextureInternalFormat format;
       int32_t width;
       int32_t height;
+      int32_t depth;
       int32_t levels;
+      size_t sizeInBytes;
+      GFXMemoryCategory category;
+   };
+
+   // A texture update that didn't fit in this frame's budget or in the staging ring.
+   struct GLPendingTextureUpload
+   {
+      TextureHandle texture;
+      GFXTextureUpdateDesc region;
+      std::vector<uint8_t> data;
+      bool generateMipmaps;
    };
 
+   // Marks the staging bytes written during a frame so they can be reused once the GPU is done with them.
+   struct GLStagingFence
+   {
+      GLsync fence;
+      size_t size;
+   };
+
+   // One persistently mapped GL_PIXEL_UNPACK_BUFFER used as a ring.
+   struct
+   {
+      GLuint buffer = 0;
+      uint8_t* mapped = nullptr;
+      size_t head = 0;
+      size_t used = 0;
+      size_t frameSize = 0;
+      std::deque<GLStagingFence> fences;
+   } mStaging;
+
+   // A timer is a pair of GL_TIMESTAMP queries.
+   struct GLTimerQuery
+   {
+      const char* name;
+      GLuint beginQuery;
+      GLuint endQuery;
+      uint32_t depth;
+   };
+
+   struct GLTimerFrame
+   {
+      std::vector<GLTimerQuery> timers;
+      GLuint lastQuery = 0; // timestamps land in order, once this one is available all of them are
+
+      // Brackets the whole frame, from the first executed command buffer to present().
+      GLuint frameBeginQuery = 0;
+      GLuint frameEndQuery = 0;
+   };
+
+   struct
+   {
+      std::vector<GLuint> freeQueries;
+      std::vector<uint32_t> openTimers;
+      GLTimerFrame frame;
+      std::deque<GLTimerFrame> pending;
+   } mTimers;
+
+   std::deque<GLPendingTextureUpload> mPendingTextureUploads;
+   size_t mUploadBudget = DEFAULT_UPLOAD_BUDGET;
+   size_t mUploadedThisFrame = 0;
+
    struct
    {
       GLuint primitiveType = 0;
+      GFXPrimitiveType topology = GFXPrimitiveType::TRIANGLE_LIST;
       GLuint currentProgram = 0;
       GLenum indexBufferType = 0;
       GLuint pushConstantLocation = 0;
@@ -129,6 +210,10 @@ class GFXGLDevice : public GFXDevice
    struct
    {
       bool hasMultiBind = true;
+      bool hasBufferStorage = false;
+      bool hasIndirectCount = false;
+      bool hasNvxMemoryInfo = false;
+      bool hasAtiMemoryInfo = false;
    } mCaps;
 
    std::unordered_map<BufferHandle, GLBuffer> mBuffers;
@@ -137,14 +222,12 @@ class GFXGLDevice : public GFXDevice
    std::unordered_map<PipelineHandle, GLPipeline> mPipelines;
    int mPipelineHandleCounter = 0;
 
+   // State blocks of every kind share one handle counter, so deleteStateBlock() knows which
+   // map a handle lives in.
    std::unordered_map<StateBlockHandle, GLRasterizerState> mRasterizerStates;
-   int mRasterizerHandleCounter = 0;
-
    std::unordered_map<StateBlockHandle, GLDepthStencilState> mDepthStencilStates;
-   int mDepthStencilStateHandleCounter = 0;
-
    std::unordered_map<StateBlockHandle, GLBlendState> mBlendState;
-   int mBlendStateHandleCounter = 0;
+   int mStateBlockHandleCounter = 0;
 
    std::unordered_map<SamplerHandle, GLSampler> mSamplers;
    int mSamplerHandleCounter = 0;
@@ -155,6 +238,9 @@ class GFXGLDevice : public GFXDevice
    std::unordered_map<TextureHandle, GLTexture> mTextures;
    int mTextureHandleCounter = 0;
 
+   std::unordered_map<FenceHandle, GLsync> mFences;
+   int mFenceHandleCounter = 0;
+
 public:
    GFXGLDevice();
    virtual ~GFXGLDevice();
@@ -184,20 +270,39 @@ public:
    virtual TextureHandle createTexture(const GFXTextureStateDesc& desc) override;
    virtual void deleteTexture(TextureHandle handle) override;
 
+   // Staged through a ring buffer, anything over the per frame budget streams in over the
+   // following frames.
+   virtual void updateTexture(TextureHandle handle, const GFXTextureUpdateDesc& desc) override;
+
+   void setTextureUploadBudget(size_t bytesPerFrame) { mUploadBudget = bytesPerFrame; }
+   size_t getPendingTextureUploadCount() const { return mPendingTextureUploads.size(); }
+
    virtual void* mapBuffer(BufferHandle handle, uint32_t offset, uint32_t size) override;
    virtual void unmapBuffer(BufferHandle handle) override;
+   virtual void readBuffer(BufferHandle handle, uint32_t offset, uint32_t size, void* outData) override;
+
+   virtual FenceHandle createFence() override;
+   virtual void deleteFence(FenceHandle handle) override;
+   virtual bool isFenceSignaled(FenceHandle handle) override;
 
    virtual void executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count) override;
 
-   virtual void present(RenderPassHandle handle, int width, int height);
+   virtual void present(RenderPassHandle handle, int width, int height, int sourceWidth = 0, int sourceHeight = 0) override;
+   virtual bool readPresentedImage(std::vector<uint8_t>& outPixels, int& outWidth, int& outHeight) override;
+
+   // Driver numbers come from GL_NVX_gpu_memory_info or GL_ATI_meminfo.
+   virtual GFXMemoryStats getMemoryStats() const override;
 private:
    GLenum _getBufferUsage(GFXBufferUsageEnum usage) const;
    GLenum _getBufferType(GFXBufferType type) const;
    GLenum _getPrimitiveType(GFXPrimitiveType primitiveType) const;
    GLenum _getStencilFunc(GFXStencilFunc func) const;
    GLenum _getCompareFunc(GFXCompareFunc func) const;
+   GLenum _getBlendFactor(GFXBlendFactor factor) const;
+   GLenum _getBlendOp(GFXBlendOp op) const;
    GLenum _getShaderType(GFXShaderType shaderType) const;
    GLenum _getInputLayoutType(GFXInputLayoutFormat format) const;
+   GLboolean _getInputLayoutNormalized(GFXInputLayoutFormat format) const;
    GLuint _createShaderProgram(const GFXShaderDesc* shader, uint32_t count);
 
    GLenum _getSamplerWrapMode(GFXSamplerWrapMode mode) const;
@@ -207,4 +312,24 @@ private:
 
    GLenum _getTextureType(GFXTextureType mode) const;
    GLenum _getTextureInternalFormat(GFXTextureInternalFormat format) const;
+   void _getTextureUploadFormat(GFXTextureInternalFormat format, GLenum& outFormat, GLenum& outType) const;
+   GLenum _getImageAccess(GFXImageAccess access) const;
+   GLbitfield _getMemoryBarrierBits(uint32_t barrierBits) const;
+
+   void _createStagingRing();
+   void _destroyStagingRing();
+   bool _allocateStaging(size_t size, size_t& outOffset);
+   void _retireStaging(bool wait);
+   GLTexture* _findTexture(TextureHandle handle);
+   void _submitTextureUpload(TextureHandle handle, const GFXTextureUpdateDesc& desc, bool generateMipmaps);
+   bool _uploadTexture(TextureHandle handle, const GFXTextureUpdateDesc& desc, bool generateMipmaps);
+   void _uploadTextureRegion(const GLTexture& texture, const GFXTextureUpdateDesc& desc, const void* pixels);
+   void _processTextureUploads();
+
+   GLuint _allocTimerQuery();
+   void _beginTimer(const char* name);
+   void _endTimer();
+   void _resolveTimers();
+   void _freeTimerFrame(const GLTimerFrame& frame);
+   void _destroyTimers();
 };
\ No newline at end of file
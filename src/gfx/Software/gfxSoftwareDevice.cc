@@ -0,0 +1,1780 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include "core/profiler.h"
+#include "core/simd.h"
+#include "gfx/Software/gfxSoftwareDevice.h"
+
+#ifdef GFX_OPENGL
+#include <glad/glad.h>
+#endif
+
+static inline uint32_t packColor(const glm::vec4& color)
+{
+   glm::vec4 c = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+   return ((uint32_t)c.r) | ((uint32_t)c.g << 8) | ((uint32_t)c.b << 16) | ((uint32_t)c.a << 24);
+}
+
+static inline glm::vec4 unpackColor(uint32_t color)
+{
+   return glm::vec4(color & 0xFF, (color >> 8) & 0xFF, (color >> 16) & 0xFF, color >> 24) * (1.0f / 255.0f);
+}
+
+static inline glm::vec4 blendFactor(GFXBlendFactor factor, const glm::vec4& src, const glm::vec4& dst)
+{
+   switch (factor)
+   {
+   case GFXBlendFactor::ZERO:
+      return glm::vec4(0.0f);
+   case GFXBlendFactor::ONE:
+      return glm::vec4(1.0f);
+   case GFXBlendFactor::SRC_COLOR:
+      return src;
+   case GFXBlendFactor::ONE_MINUS_SRC_COLOR:
+      return 1.0f - src;
+   case GFXBlendFactor::SRC_ALPHA:
+      return glm::vec4(src.a);
+   case GFXBlendFactor::ONE_MINUS_SRC_ALPHA:
+      return glm::vec4(1.0f - src.a);
+   case GFXBlendFactor::DST_COLOR:
+      return dst;
+   case GFXBlendFactor::ONE_MINUS_DST_COLOR:
+      return 1.0f - dst;
+   case GFXBlendFactor::DST_ALPHA:
+      return glm::vec4(dst.a);
+   case GFXBlendFactor::ONE_MINUS_DST_ALPHA:
+      return glm::vec4(1.0f - dst.a);
+   }
+
+   return glm::vec4(1.0f);
+}
+
+static inline glm::vec4 blendOp(GFXBlendOp op, const glm::vec4& src, const glm::vec4& dst)
+{
+   switch (op)
+   {
+   case GFXBlendOp::ADD:
+      return src + dst;
+   case GFXBlendOp::SUBTRACT:
+      return src - dst;
+   case GFXBlendOp::REVERSE_SUBTRACT:
+      return dst - src;
+   case GFXBlendOp::MIN:
+      return glm::min(src, dst);
+   case GFXBlendOp::MAX:
+      return glm::max(src, dst);
+   }
+
+   return src;
+}
+
+static glm::vec4 blendColor(const GFXBlendStateDesc& desc, const glm::vec4& src, const glm::vec4& dst)
+{
+   // MIN and MAX ignore the factors, same as GL.
+   glm::vec4 srcColor = src;
+   glm::vec4 dstColor = dst;
+   if (desc.colorOp != GFXBlendOp::MIN && desc.colorOp != GFXBlendOp::MAX)
+   {
+      srcColor *= blendFactor(desc.srcColorFactor, src, dst);
+      dstColor *= blendFactor(desc.dstColorFactor, src, dst);
+   }
+
+   float srcAlpha = src.a;
+   float dstAlpha = dst.a;
+   if (desc.alphaOp != GFXBlendOp::MIN && desc.alphaOp != GFXBlendOp::MAX)
+   {
+      srcAlpha *= blendFactor(desc.srcAlphaFactor, src, dst).a;
+      dstAlpha *= blendFactor(desc.dstAlphaFactor, src, dst).a;
+   }
+
+   glm::vec4 color = blendOp(desc.colorOp, srcColor, dstColor);
+   color.a = blendOp(desc.alphaOp, glm::vec4(srcAlpha), glm::vec4(dstAlpha)).a;
+   return color;
+}
+
+static inline bool depthCompare(GFXCompareFunc func, float incoming, float stored)
+{
+   switch (func)
+   {
+   case GFXCompareFunc::EQUAL:
+      return incoming == stored;
+   case GFXCompareFunc::NEQUAL:
+      return incoming != stored;
+   case GFXCompareFunc::LESS:
+      return incoming < stored;
+   case GFXCompareFunc::GREATER:
+      return incoming > stored;
+   case GFXCompareFunc::LEQUAL:
+      return incoming <= stored;
+   case GFXCompareFunc::GEQUAL:
+      return incoming >= stored;
+   case GFXCompareFunc::NEVER:
+      return false;
+   case GFXCompareFunc::ALWAYS:
+      return true;
+   }
+
+   return false;
+}
+
+static inline float decodeComponent(const uint8_t* data, GFXInputLayoutFormat format, uint32_t component)
+{
+   switch (format)
+   {
+   case GFXInputLayoutFormat::FLOAT:
+      return ((const float*)data)[component];
+   case GFXInputLayoutFormat::BYTE:
+      return (float)((const int8_t*)data)[component];
+   case GFXInputLayoutFormat::SHORT:
+      return (float)((const int16_t*)data)[component];
+   case GFXInputLayoutFormat::INT:
+      return (float)((const int32_t*)data)[component];
+   case GFXInputLayoutFormat::UNSIGNED_BYTE_NORM:
+      return (float)data[component] * (1.0f / 255.0f);
+   case GFXInputLayoutFormat::SHORT_NORM:
+      return std::max((float)((const int16_t*)data)[component] * (1.0f / 32767.0f), -1.0f);
+   }
+
+   return 0.0f;
+}
+
+GFXSoftwareDevice::GFXSoftwareDevice(uint32_t threadCount, bool presentToWindow) :
+   mJobSystem(threadCount),
+   mPresentToWindow(presentToWindow)
+{
+   mThreadStats.resize(mJobSystem.getThreadCount());
+}
+
+GFXSoftwareDevice::~GFXSoftwareDevice()
+{
+#ifdef GFX_OPENGL
+   if (mPresentTexture)
+   {
+      glDeleteFramebuffers(1, &mPresentFramebuffer);
+      glDeleteTextures(1, &mPresentTexture);
+   }
+#endif
+}
+
+GFXApi GFXSoftwareDevice::getApi() const
+{
+   return GFXApi::Software;
+}
+
+const char* GFXSoftwareDevice::getApiVersionString() const
+{
+#if SIMD_SSE2
+   return "1.0 (SSE2)";
+#else
+   return "1.0 (Scalar)";
+#endif
+}
+
+const char* GFXSoftwareDevice::getGFXDeviceRendererDesc() const
+{
+   static char rendererString[64];
+
+   memset(rendererString, 0, sizeof(rendererString));
+   snprintf(rendererString, sizeof(rendererString), "Tiled Rasterizer (%u threads)", getThreadCount());
+
+   return rendererString;
+}
+
+const char* GFXSoftwareDevice::getGFXDeviceVendorDesc() const
+{
+   return "CPU";
+}
+
+void GFXSoftwareDevice::setThreadCount(uint32_t threadCount)
+{
+   mJobSystem.setThreadCount(threadCount);
+   mThreadStats.resize(mJobSystem.getThreadCount());
+}
+
+BufferHandle GFXSoftwareDevice::createBuffer(const GFXBufferDesc& desc)
+{
+   SWBuffer buffer;
+   buffer.type = desc.type;
+   buffer.data.resize(desc.sizeInBytes);
+   if (desc.data)
+   {
+      memcpy(buffer.data.data(), desc.data, desc.sizeInBytes);
+      mCurrentFrameStats.bytesUploaded += desc.sizeInBytes;
+   }
+
+   _trackAllocation(getBufferMemoryCategory(buffer.type), buffer.data.size());
+
+   BufferHandle returnHandle = mBufferHandleCounter++;
+   mBuffers[returnHandle] = std::move(buffer);
+   return returnHandle;
+}
+
+void GFXSoftwareDevice::deleteBuffer(BufferHandle handle)
+{
+   const auto& found = mBuffers.find(handle);
+   if (found != mBuffers.end())
+   {
+      _trackFree(getBufferMemoryCategory(found->second.type), found->second.data.size());
+      mBuffers.erase(found);
+   }
+#ifdef GFX_DEBUG
+   else
+   {
+      assert(false);
+   }
+#endif
+}
+
+PipelineHandle GFXSoftwareDevice::createPipeline(const GFXPipelineDesc& desc)
+{
+   SWPipeline pipeline;
+   pipeline.primitiveType = desc.primitiveType;
+
+   for (uint32_t i = 0; i < desc.inputLayout.count; i++)
+   {
+      const GFXInputLayoutElementDesc& element = desc.inputLayout.descs[i];
+      if (element.slot >= SW_MAX_VERTEX_ATTRIBUTES || element.bufferBinding >= SW_MAX_VERTEX_BUFFERS)
+         abort();
+
+      SWInputAttribute attribute;
+      attribute.slot = element.slot;
+      attribute.type = element.type;
+      attribute.bufferBinding = element.bufferBinding;
+      attribute.offset = element.offset;
+      attribute.count = element.count;
+      attribute.perInstance = element.divisor == GFXInputLayoutDivisor::PER_INSTANCE;
+      pipeline.attributes.push_back(attribute);
+   }
+
+   PipelineHandle returnHandle = mPipelineHandleCounter++;
+   mPipelines[returnHandle] = std::move(pipeline);
+   return returnHandle;
+}
+
+void GFXSoftwareDevice::setPipelineShaders(PipelineHandle handle, const GFXSoftwareShaderDesc& desc)
+{
+   if (desc.varyingCount > SW_MAX_VARYINGS)
+      abort();
+
+   SWPipeline& pipeline = mPipelines[handle];
+   pipeline.shaders = desc;
+   pipeline.hasShaders = desc.vertexShader && desc.fragmentShader;
+}
+
+void GFXSoftwareDevice::deletePipeline(PipelineHandle handle)
+{
+   const auto& found = mPipelines.find(handle);
+   if (found != mPipelines.end())
+   {
+      mPipelines.erase(found);
+   }
+#ifdef GFX_DEBUG
+   else
+   {
+      assert(false);
+   }
+#endif
+}
+
+RenderPassHandle GFXSoftwareDevice::createRenderPass(const GFXRenderPassDesc& desc)
+{
+   if (desc.colorAttachmentCount > MAX_COLOR_ATTACHMENTS)
+   {
+      // No more than 8 attachments!
+      abort();
+   }
+
+   auto trackRenderTarget = [this](TextureHandle handle)
+   {
+      const auto& found = mTextures.find(handle);
+      if (found != mTextures.end())
+         _trackRenderTarget(found->second.category, found->second.data.size());
+   };
+
+   for (uint32_t i = 0; i < desc.colorAttachmentCount; i++)
+      trackRenderTarget(desc.colorAttachments[i].texture);
+   if (desc.depthAttachmentEnabled)
+      trackRenderTarget(desc.depthAttachment.texture);
+   if (desc.stencilAttachmentEnabled)
+      trackRenderTarget(desc.stencilAttachment.texture);
+
+   mMemoryStats.renderPassCount++;
+
+   RenderPassHandle returnHandle = mRenderPassHandleCounter++;
+   mRenderPasses[returnHandle] = desc;
+   return returnHandle;
+}
+
+void GFXSoftwareDevice::deleteRenderPass(RenderPassHandle handle)
+{
+   const auto& found = mRenderPasses.find(handle);
+   if (found != mRenderPasses.end())
+   {
+      mMemoryStats.renderPassCount--;
+      mRenderPasses.erase(found);
+   }
+#ifdef GFX_DEBUG
+   else
+   {
+      assert(false);
+   }
+#endif
+}
+
+StateBlockHandle GFXSoftwareDevice::createRasterizerState(const GFXRasterizerStateDesc& desc)
+{
+   SWRasterizerState state;
+   state.cullMode = desc.cullMode;
+   state.windingMode = desc.windingMode;
+   state.enableDynamicPointSize = desc.enableDynamicPointSize;
+
+   StateBlockHandle handle = mStateBlockHandleCounter++;
+   mRasterizerStates[handle] = state;
+   return handle;
+}
+
+StateBlockHandle GFXSoftwareDevice::createDepthStencilState(const GFXDepthStencilStateDesc& desc)
+{
+   // Stencil isn't supported by the software rasterizer.
+   SWDepthStencilState state;
+   state.depthCompareFunc = desc.depthCompareFunc;
+   state.enableDepthTest = desc.enableDepthTest;
+   state.enableDepthWrite = desc.enableDepthWrite;
+
+   StateBlockHandle handle = mStateBlockHandleCounter++;
+   mDepthStencilStates[handle] = state;
+   return handle;
+}
+
+StateBlockHandle GFXSoftwareDevice::createBlendState(const GFXBlendStateDesc& desc)
+{
+   StateBlockHandle handle = mStateBlockHandleCounter++;
+   mBlendStates[handle] = desc;
+   return handle;
+}
+
+void GFXSoftwareDevice::deleteStateBlock(StateBlockHandle handle)
+{
+   mRasterizerStates.erase(handle);
+   mDepthStencilStates.erase(handle);
+   mBlendStates.erase(handle);
+}
+
+SamplerHandle GFXSoftwareDevice::createSampler(const GFXSamplerStateDesc& desc)
+{
+   SamplerHandle samplerHandle = mSamplerHandleCounter++;
+   mSamplers[samplerHandle] = desc;
+   return samplerHandle;
+}
+
+void GFXSoftwareDevice::deleteSampler(SamplerHandle handle)
+{
+   const auto& found = mSamplers.find(handle);
+   if (found != mSamplers.end())
+   {
+      mSamplers.erase(found);
+   }
+#ifdef GFX_DEBUG
+   else
+   {
+      assert(false);
+   }
+#endif
+}
+
+TextureHandle GFXSoftwareDevice::createTexture(const GFXTextureStateDesc& desc)
+{
+   SWTexture texture;
+   texture.type = desc.type;
+   texture.internalFormat = desc.internalFormat;
+   texture.width = desc.width;
+   texture.height = desc.type == GFXTextureType::TEXTURE_1D ? 1 : desc.height;
+   texture.levels = desc.levels;
+
+   switch (texture.type)
+   {
+   case GFXTextureType::TEXTURE_1D:
+   case GFXTextureType::TEXTURE_2D:
+      texture.depth = 1;
+      break;
+   case GFXTextureType::TEXTURE_CUBEMAP:
+      texture.depth = 6;
+      break;
+   case GFXTextureType::TEXTURE_3D:
+   case GFXTextureType::TEXTURE_2D_ARRAY:
+      texture.depth = desc.depth;
+      break;
+   }
+
+   if (texture.levels <= 0)
+   {
+      int32_t largest = std::max(texture.width, texture.height);
+      if (texture.type == GFXTextureType::TEXTURE_3D)
+         largest = std::max(largest, texture.depth);
+
+      texture.levels = 1;
+      while (largest > 1)
+      {
+         largest >>= 1;
+         texture.levels++;
+      }
+   }
+
+   // Levels are stored back to back, level 0 first so render targets can use the start of the data.
+   const uint32_t blockDimension = getFormatBlockDimension(texture.internalFormat);
+   const uint32_t blockSize = _getTextureBlockSize(texture.internalFormat);
+   size_t size = 0;
+   for (int32_t level = 0; level < texture.levels; level++)
+   {
+      int32_t width, height, depth;
+      _getTextureLevelSize(texture, level, width, height, depth);
+
+      size_t blocksX = (width + blockDimension - 1) / blockDimension;
+      size_t blocksY = (height + blockDimension - 1) / blockDimension;
+
+      texture.levelOffsets.push_back(size);
+      size += blocksX * blocksY * depth * blockSize;
+   }
+   texture.data.resize(size);
+   texture.category = GFXMemoryCategory::TEXTURE;
+   _trackAllocation(texture.category, size);
+
+   if (desc.data)
+   {
+      size_t levelSize = texture.levels > 1 ? texture.levelOffsets[1] : size;
+      memcpy(texture.data.data(), desc.data, levelSize);
+      mCurrentFrameStats.bytesUploaded += levelSize;
+
+      if (desc.generateMipmaps)
+         _generateMipmaps(texture);
+   }
+
+   TextureHandle textureHandle = mTextureHandleCounter++;
+   mTextures[textureHandle] = std::move(texture);
+   return textureHandle;
+}
+
+void GFXSoftwareDevice::deleteTexture(TextureHandle handle)
+{
+   const auto& found = mTextures.find(handle);
+   if (found != mTextures.end())
+   {
+      _trackFree(found->second.category, found->second.data.size());
+      mTextures.erase(found);
+   }
+#ifdef GFX_DEBUG
+   else
+   {
+      assert(false);
+   }
+#endif
+}
+
+void GFXSoftwareDevice::updateTexture(TextureHandle handle, const GFXTextureUpdateDesc& desc)
+{
+   const auto& found = mTextures.find(handle);
+   if (found == mTextures.end())
+   {
+#ifdef GFX_DEBUG
+      assert(false);
+#endif
+      return;
+   }
+
+   // Nothing is in flight outside of executeCmdBuffers(), so the copy can happen right away.
+   SWTexture& texture = found->second;
+   const uint32_t blockDimension = getFormatBlockDimension(texture.internalFormat);
+   const size_t blockSize = _getTextureBlockSize(texture.internalFormat);
+
+   int32_t levelWidth, levelHeight, levelDepth;
+   _getTextureLevelSize(texture, desc.level, levelWidth, levelHeight, levelDepth);
+
+   // Copies rows of blocks, which are rows of texels for uncompressed formats.
+   const int32_t levelBlocksX = (levelWidth + blockDimension - 1) / blockDimension;
+   const int32_t levelBlocksY = (levelHeight + blockDimension - 1) / blockDimension;
+   const int32_t blockX = desc.x / blockDimension;
+   const int32_t blockY = desc.y / blockDimension;
+   const int32_t blocksX = (desc.width + blockDimension - 1) / blockDimension;
+   const int32_t blocksY = (desc.height + blockDimension - 1) / blockDimension;
+
+   const uint8_t* src = (const uint8_t*)desc.data;
+   uint8_t* dst = texture.data.data() + texture.levelOffsets[desc.level];
+   const size_t rowSize = blocksX * blockSize;
+
+   for (int32_t z = 0; z < desc.depth; z++)
+   {
+      for (int32_t y = 0; y < blocksY; y++)
+      {
+         size_t dstBlock = ((size_t)(desc.z + z) * levelBlocksY + (blockY + y)) * levelBlocksX + blockX;
+         memcpy(dst + dstBlock * blockSize, src, rowSize);
+         src += rowSize;
+      }
+   }
+
+   mCurrentFrameStats.bytesUploaded += rowSize * blocksY * desc.depth;
+}
+
+bool GFXSoftwareDevice::readPresentedImage(std::vector<uint8_t>& outPixels, int& outWidth, int& outHeight)
+{
+   const auto& pass = mRenderPasses.find(mPresented.renderPass);
+   if (mPresented.width <= 0 || pass == mRenderPasses.end() || pass->second.colorAttachmentCount == 0)
+      return false;
+
+   const auto& found = mTextures.find(pass->second.colorAttachments[0].texture);
+   if (found == mTextures.end())
+      return false;
+
+   // Color targets already are RGBA8 rows, bottom row first.
+   const SWTexture& texture = found->second;
+   outWidth = std::min(mPresented.width, texture.width);
+   outHeight = std::min(mPresented.height, texture.height);
+   outPixels.resize((size_t)outWidth * outHeight * 4);
+
+   for (int y = 0; y < outHeight; y++)
+      memcpy(&outPixels[(size_t)y * outWidth * 4], &texture.data[(size_t)y * texture.width * 4], (size_t)outWidth * 4);
+
+   return true;
+}
+
+const void* GFXSoftwareDevice::getTextureData(TextureHandle handle) const
+{
+   const auto& found = mTextures.find(handle);
+   if (found == mTextures.end())
+      return nullptr;
+
+   return found->second.data.data();
+}
+
+void* GFXSoftwareDevice::mapBuffer(BufferHandle handle, uint32_t offset, uint32_t size)
+{
+   // Command buffers are fully consumed by executeCmdBuffers(), so nothing can be
+   // reading from the buffer while the caller writes to it.
+   SWBuffer& buffer = mBuffers[handle];
+   mCurrentFrameStats.bytesMapped += size;
+   return buffer.data.data() + offset;
+}
+
+void GFXSoftwareDevice::unmapBuffer(BufferHandle handle)
+{
+}
+
+void GFXSoftwareDevice::readBuffer(BufferHandle handle, uint32_t offset, uint32_t size, void* outData)
+{
+   const SWBuffer& buffer = mBuffers[handle];
+   memcpy(outData, buffer.data.data() + offset, size);
+}
+
+FenceHandle GFXSoftwareDevice::createFence()
+{
+   // Commands are done by the time executeCmdBuffers() returns, so every fence is signaled already.
+   return mFenceHandleCounter++;
+}
+
+void GFXSoftwareDevice::deleteFence(FenceHandle handle)
+{
+}
+
+bool GFXSoftwareDevice::isFenceSignaled(FenceHandle handle)
+{
+   return true;
+}
+
+void GFXSoftwareDevice::executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count)
+{
+   PROFILE_SCOPE("GFXSoftwareDevice::executeCmdBuffers");
+
+   if (mFrameStartNs == 0)
+      mFrameStartNs = Profiler::now();
+
+   auto startTime = std::chrono::steady_clock::now();
+
+   for (int i = 0; i < count; i++)
+   {
+      const GFXCmdBuffer* cmd = cmdBuffers[i];
+      const uint32_t* cmdBuffer = cmd->cmdBuffer;
+
+      size_t offset = 0;
+      for (;;)
+      {
+         const CommandType type = (CommandType)cmdBuffer[offset++];
+         mCurrentFrameStats.commandCounts[(int)type]++;
+
+         switch (type)
+         {
+         case CommandType::Viewport:
+         {
+            mState.viewport[0] = cmdBuffer[offset++];
+            mState.viewport[1] = cmdBuffer[offset++];
+            mState.viewport[2] = cmdBuffer[offset++];
+            mState.viewport[3] = cmdBuffer[offset++];
+            break;
+         }
+
+         case CommandType::Scissor:
+         {
+            mState.scissor[0] = cmdBuffer[offset++];
+            mState.scissor[1] = cmdBuffer[offset++];
+            mState.scissor[2] = cmdBuffer[offset++];
+            mState.scissor[3] = cmdBuffer[offset++];
+            mState.scissorSet = true;
+            break;
+         }
+
+         case CommandType::RasterizerState:
+         {
+            mState.rasterizerState = mRasterizerStates[cmdBuffer[offset++]];
+            mCurrentFrameStats.stateBlockChanges++;
+            break;
+         }
+
+         case CommandType::DepthStencilState:
+         {
+            mState.depthStencilState = mDepthStencilStates[cmdBuffer[offset++]];
+            mCurrentFrameStats.stateBlockChanges++;
+            break;
+         }
+
+         case CommandType::BlendState:
+         {
+            mState.blendState = mBlendStates[cmdBuffer[offset++]];
+            mCurrentFrameStats.stateBlockChanges++;
+            break;
+         }
+
+         case CommandType::BindRenderPass:
+         {
+            const RenderPassHandle handle = static_cast<RenderPassHandle>(cmdBuffer[offset++]);
+
+            _flushRenderPass();
+            _beginRenderPass(mRenderPasses[handle]);
+            mCurrentFrameStats.renderPassBinds++;
+            break;
+         }
+
+         case CommandType::BindPipeline:
+         {
+            const PipelineHandle handle = static_cast<PipelineHandle>(cmdBuffer[offset++]);
+            mState.pipeline = &mPipelines[handle];
+            mCurrentFrameStats.pipelineBinds++;
+            break;
+         }
+
+         case CommandType::BindPushConstants:
+         {
+            const int pushConstantLookupId = cmdBuffer[offset++];
+            mState.uniforms.pushConstants = (const uint8_t*)cmd->pushConstantPool[pushConstantLookupId].data;
+            break;
+         }
+
+         case CommandType::BindVertexBuffer:
+         {
+            uint32_t bindingSlot = cmdBuffer[offset++];
+            SWBuffer& buffer = mBuffers[cmdBuffer[offset++]];
+            uint32_t stride = cmdBuffer[offset++];
+            uint32_t bufferOffset = cmdBuffer[offset++];
+
+            mState.vertexBindings[bindingSlot].data = buffer.data.data() + bufferOffset;
+            mState.vertexBindings[bindingSlot].stride = stride;
+            mCurrentFrameStats.bufferBinds++;
+            break;
+         }
+
+         case CommandType::BindVertexBuffers:
+         {
+            uint32_t startBindingSlot = cmdBuffer[offset++];
+            uint32_t count = cmdBuffer[offset++];
+
+            for (uint32_t i = 0; i < count; i++)
+            {
+               SWBuffer& buffer = mBuffers[cmdBuffer[offset++]];
+               uint32_t stride = cmdBuffer[offset++];
+               uint32_t bufferOffset = cmdBuffer[offset++];
+
+               mState.vertexBindings[startBindingSlot + i].data = buffer.data.data() + bufferOffset;
+               mState.vertexBindings[startBindingSlot + i].stride = stride;
+            }
+
+            mCurrentFrameStats.bufferBinds += count;
+            break;
+         }
+
+         case CommandType::BindIndexBuffer:
+         {
+            SWBuffer& buffer = mBuffers[cmdBuffer[offset++]];
+            mState.indexBufferType = (GFXIndexBufferType)cmdBuffer[offset++];
+            uint32_t bufferOffset = cmdBuffer[offset++];
+
+            mState.indexBuffer = buffer.data.data() + bufferOffset;
+            mCurrentFrameStats.bufferBinds++;
+            break;
+         }
+
+         case CommandType::BindConstantBuffer:
+         {
+            const uint32_t index = cmdBuffer[offset++];
+            SWBuffer& buffer = mBuffers[cmdBuffer[offset++]];
+            const uint32_t bufferOffset = cmdBuffer[offset++];
+            offset++; // size
+
+            if (index < SW_MAX_CONSTANT_BUFFERS)
+               mState.uniforms.constantBuffers[index] = buffer.data.data() + bufferOffset;
+            mCurrentFrameStats.bufferBinds++;
+            break;
+         }
+
+         case CommandType::BindStorageBuffer:
+         {
+            // Only compute shaders read storage buffers and those aren't emulated.
+            offset += 4;
+            mCurrentFrameStats.bufferBinds++;
+            break;
+         }
+
+         case CommandType::BindImage:
+         {
+            // Images are only accessed from compute shaders, same as storage buffers.
+            offset += 4;
+            mCurrentFrameStats.textureBinds++;
+            break;
+         }
+
+         case CommandType::BindTexture:
+         case CommandType::BindSampler:
+         {
+            // Software shaders are plain functions with no way to sample, so the bind can't be honored.
+            _warnUnsupported(UNSUPPORTED_TEXTURE_SAMPLING, "texture and sampler binds");
+            offset += 2;
+            if (type == CommandType::BindTexture)
+               mCurrentFrameStats.textureBinds++;
+            else
+               mCurrentFrameStats.samplerBinds++;
+            break;
+         }
+
+         case CommandType::BindTextures:
+         case CommandType::BindSamplers:
+         {
+            _warnUnsupported(UNSUPPORTED_TEXTURE_SAMPLING, "texture and sampler binds");
+            offset++;
+            const uint32_t count = cmdBuffer[offset++];
+            offset += count;
+            if (type == CommandType::BindTextures)
+               mCurrentFrameStats.textureBinds += count;
+            else
+               mCurrentFrameStats.samplerBinds += count;
+            break;
+         }
+
+         case CommandType::DrawPrimitives:
+         {
+            uint32_t vertexStart = cmdBuffer[offset++];
+            uint32_t vertexCount = cmdBuffer[offset++];
+
+            _draw(vertexStart, vertexCount, 1, 0, false, 0, 0);
+            break;
+         }
+
+         case CommandType::DrawPrimitivesInstanced:
+         {
+            uint32_t vertexStart = cmdBuffer[offset++];
+            uint32_t vertexCount = cmdBuffer[offset++];
+            uint32_t instanceCount = cmdBuffer[offset++];
+
+            _draw(vertexStart, vertexCount, instanceCount, 0, false, 0, 0);
+            break;
+         }
+
+         case CommandType::DrawIndexedPrimitives:
+         {
+            uint32_t vertexCount = cmdBuffer[offset++];
+            uint32_t indexBufferOffset = cmdBuffer[offset++];
+
+            _draw(0, vertexCount, 1, 0, true, indexBufferOffset, 0);
+            break;
+         }
+
+         case CommandType::DrawIndexedPrimitivesInstanced:
+         {
+            uint32_t vertexCount = cmdBuffer[offset++];
+            uint32_t indexBufferOffset = cmdBuffer[offset++];
+            uint32_t instanceCount = cmdBuffer[offset++];
+
+            _draw(0, vertexCount, instanceCount, 0, true, indexBufferOffset, 0);
+            break;
+         }
+
+         case CommandType::DrawPrimitivesIndirect:
+         {
+            const SWBuffer& buffer = mBuffers[cmdBuffer[offset++]];
+            const uint32_t argumentOffset = cmdBuffer[offset++];
+
+            GFXDrawPrimitivesIndirectArgs args;
+            memcpy(&args, buffer.data.data() + argumentOffset, sizeof(args));
+
+            _draw(args.vertexStart, args.vertexCount, args.instanceCount, args.baseInstance, false, 0, 0);
+            mCurrentFrameStats.indirectDraws++;
+            break;
+         }
+
+         case CommandType::MultiDrawIndexedPrimitivesIndirectCount:
+         {
+            const SWBuffer& argumentBuffer = mBuffers[cmdBuffer[offset++]];
+            const uint32_t argumentOffset = cmdBuffer[offset++];
+            const SWBuffer& countBuffer = mBuffers[cmdBuffer[offset++]];
+            const uint32_t countOffset = cmdBuffer[offset++];
+            const uint32_t maxDrawCount = cmdBuffer[offset++];
+
+            uint32_t drawCount;
+            memcpy(&drawCount, countBuffer.data.data() + countOffset, sizeof(drawCount));
+
+            const uint32_t indexSize = mState.indexBufferType == GFXIndexBufferType::BITS_16 ? 2 : 4;
+            for (uint32_t i = 0; i < std::min(drawCount, maxDrawCount); i++)
+            {
+               GFXDrawIndexedPrimitivesIndirectArgs args;
+               memcpy(&args, argumentBuffer.data.data() + argumentOffset + i * sizeof(args), sizeof(args));
+
+               _draw(0, args.indexCount, args.instanceCount, args.baseInstance, true, args.firstIndex * indexSize, args.baseVertex);
+            }
+            mCurrentFrameStats.indirectDraws++;
+            break;
+         }
+
+         case CommandType::Dispatch:
+         {
+            offset += 3; // group counts
+            _warnUnsupported(UNSUPPORTED_COMPUTE, "compute dispatches");
+            mCurrentFrameStats.dispatches++;
+            break;
+         }
+
+         case CommandType::MemoryBarrier:
+         {
+            // Draws finish before the next command is read, nothing to wait on.
+            offset++;
+            break;
+         }
+
+         case CommandType::BeginTimer:
+         {
+            GFXGpuTimer timer;
+            timer.name = Profiler::internName(cmd->timerNamePool[cmdBuffer[offset++]]);
+            timer.startNs = Profiler::now();
+            timer.endNs = timer.startNs;
+            timer.depth = (uint32_t)mOpenTimers.size();
+
+            mOpenTimers.push_back((uint32_t)mTimerFrame.size());
+            mTimerFrame.push_back(timer);
+            break;
+         }
+
+         case CommandType::EndTimer:
+         {
+            if (!mOpenTimers.empty())
+            {
+               mTimerFrame[mOpenTimers.back()].endNs = Profiler::now();
+               mOpenTimers.pop_back();
+            }
+            break;
+         }
+
+         case CommandType::End:
+         {
+            goto done;
+         }
+         }
+      }
+
+   done:
+      ;
+   }
+
+   _flushRenderPass();
+
+   std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+   mFrameStats.rasterTimeMs += elapsed.count();
+}
+
+void GFXSoftwareDevice::present(RenderPassHandle handle, int width, int height, int sourceWidth, int sourceHeight)
+{
+   mFrameStats.threadCount = getThreadCount();
+   if (mFrameStats.rasterTimeMs > 0.0)
+   {
+      double coreSeconds = (mFrameStats.rasterTimeMs / 1000.0) * mFrameStats.threadCount;
+      mFrameStats.pixelsPerSecondPerCore = (double)mFrameStats.pixels / coreSeconds;
+      mFrameStats.primitivesPerSecondPerCore = (double)(mFrameStats.triangles + mFrameStats.points) / coreSeconds;
+   }
+   mLastFrameStats = mFrameStats;
+   mFrameStats = GFXSoftwareStats();
+   _endFrameStats();
+
+   // Results are ready right away, there is nothing to wait on.
+   const uint64_t frameEndNs = Profiler::now();
+   for (uint32_t index : mOpenTimers)
+      mTimerFrame[index].endNs = frameEndNs;
+   mOpenTimers.clear();
+
+   mGpuTimers.swap(mTimerFrame);
+   mTimerFrame.clear();
+   for (const GFXGpuTimer& timer : mGpuTimers)
+      Profiler::recordGpu(timer.name, timer.startNs, timer.endNs, timer.depth);
+
+   if (mFrameStartNs != 0)
+   {
+      Profiler::recordGpuFrame(mFrameStartNs, frameEndNs);
+      mFrameStartNs = 0;
+   }
+
+   const int srcWidth = sourceWidth > 0 ? sourceWidth : width;
+   const int srcHeight = sourceHeight > 0 ? sourceHeight : height;
+   mPresented.renderPass = handle;
+   mPresented.width = srcWidth;
+   mPresented.height = srcHeight;
+
+#ifdef GFX_OPENGL
+   if (!mPresentToWindow)
+      return;
+
+   // Push the color target through a texture so it can be shown in the window like any other device.
+   const auto& found = mRenderPasses.find(handle);
+   if (found == mRenderPasses.end() || found->second.colorAttachmentCount == 0)
+      return;
+
+   const SWTexture& texture = mTextures[found->second.colorAttachments[0].texture];
+
+   if (mPresentTexture == 0)
+   {
+      glGenTextures(1, &mPresentTexture);
+      glGenFramebuffers(1, &mPresentFramebuffer);
+   }
+
+   glBindTexture(GL_TEXTURE_2D, mPresentTexture);
+   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, texture.width, texture.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture.data.data());
+
+   glBindFramebuffer(GL_READ_FRAMEBUFFER, mPresentFramebuffer);
+   glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mPresentTexture, 0);
+   glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+   const bool scaled = srcWidth != width || srcHeight != height;
+
+   glDisable(GL_SCISSOR_TEST);
+   glBlitFramebuffer(0, 0, srcWidth, srcHeight, 0, 0, width, height, GL_COLOR_BUFFER_BIT, scaled ? GL_LINEAR : GL_NEAREST);
+   glBindFramebuffer(GL_FRAMEBUFFER, 0);
+#endif
+}
+
+void GFXSoftwareDevice::_beginRenderPass(const GFXRenderPassDesc& desc)
+{
+   mState.renderPass = desc;
+   mState.hasRenderPass = true;
+   mState.clearPending = false;
+   mState.target = SWRenderTarget();
+
+   if (desc.colorAttachmentCount > 0)
+   {
+      // Only the first color attachment is written to.
+      SWTexture& texture = mTextures[desc.colorAttachments[0].texture];
+      mState.target.color = (uint32_t*)texture.data.data();
+      mState.target.width = texture.width;
+      mState.target.height = texture.height;
+      mState.clearPending |= desc.colorAttachments[0].loadAction == GFXLoadAttachmentAction::CLEAR;
+   }
+
+   if (desc.depthAttachmentEnabled)
+   {
+      SWTexture& texture = mTextures[desc.depthAttachment.texture];
+      mState.target.depth = (float*)texture.data.data();
+      mState.target.width = texture.width;
+      mState.target.height = texture.height;
+      mState.clearPending |= desc.depthAttachment.loadAction == GFXLoadAttachmentAction::CLEAR;
+   }
+
+   mState.clearRect[0] = 0;
+   mState.clearRect[1] = 0;
+   mState.clearRect[2] = mState.target.width;
+   mState.clearRect[3] = mState.target.height;
+   if (mState.scissorSet)
+   {
+      mState.clearRect[0] = std::max(0, mState.scissor[0]);
+      mState.clearRect[1] = std::max(0, mState.scissor[1]);
+      mState.clearRect[2] = std::min(mState.target.width, mState.scissor[0] + mState.scissor[2]);
+      mState.clearRect[3] = std::min(mState.target.height, mState.scissor[1] + mState.scissor[3]);
+   }
+
+   mTilesX = (mState.target.width + TILE_SIZE - 1) / TILE_SIZE;
+   mTilesY = (mState.target.height + TILE_SIZE - 1) / TILE_SIZE;
+   mTileBins.resize(mTilesX * mTilesY);
+   for (std::vector<uint32_t>& bin : mTileBins)
+      bin.clear();
+}
+
+void GFXSoftwareDevice::_flushRenderPass()
+{
+   if (!mState.hasRenderPass)
+      return;
+
+   if (!mPrimitives.empty() || mState.clearPending)
+   {
+      for (SWThreadStats& stats : mThreadStats)
+         stats.pixels = 0;
+
+      mJobSystem.parallelFor((uint32_t)(mTilesX * mTilesY), 1, [this](uint32_t start, uint32_t end, uint32_t threadIndex)
+      {
+         for (uint32_t tile = start; tile < end; tile++)
+            _rasterizeTile(tile, threadIndex);
+      });
+
+      for (const SWThreadStats& stats : mThreadStats)
+         mFrameStats.pixels += stats.pixels;
+   }
+
+   mState.clearPending = false;
+   mState.hasRenderPass = false;
+
+   mDrawStates.clear();
+   mDrawVertices.clear();
+   mClipVertices.clear();
+   mPrimitives.clear();
+   for (std::vector<uint32_t>& bin : mTileBins)
+      bin.clear();
+}
+
+void GFXSoftwareDevice::_rasterizeTile(uint32_t tileIndex, uint32_t threadIndex)
+{
+   int32_t x0 = (tileIndex % mTilesX) * TILE_SIZE;
+   int32_t y0 = (tileIndex / mTilesX) * TILE_SIZE;
+   int32_t x1 = std::min(x0 + (int32_t)TILE_SIZE, mState.target.width);
+   int32_t y1 = std::min(y0 + (int32_t)TILE_SIZE, mState.target.height);
+
+   if (mState.clearPending)
+   {
+      const int32_t clearX0 = std::max(x0, mState.clearRect[0]);
+      const int32_t clearY0 = std::max(y0, mState.clearRect[1]);
+      const int32_t clearX1 = std::min(x1, mState.clearRect[2]);
+      const int32_t clearY1 = std::min(y1, mState.clearRect[3]);
+      if (clearX0 < clearX1 && clearY0 < clearY1)
+         _clearTile(clearX0, clearY0, clearX1, clearY1);
+   }
+
+   for (uint32_t primitiveIndex : mTileBins[tileIndex])
+   {
+      const SWPrimitive& prim = mPrimitives[primitiveIndex];
+      const SWDrawState& draw = mDrawStates[prim.drawIndex];
+
+      if (prim.isPoint)
+         _rasterizePoint(prim, draw, x0, y0, x1, y1, threadIndex);
+      else
+         _rasterizeTriangle(prim, draw, x0, y0, x1, y1, threadIndex);
+   }
+}
+
+void GFXSoftwareDevice::_clearTile(int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+{
+   const GFXRenderPassDesc& desc = mState.renderPass;
+   const int32_t width = mState.target.width;
+
+   if (mState.target.color && desc.colorAttachments[0].loadAction == GFXLoadAttachmentAction::CLEAR)
+   {
+      const float* c = desc.colorAttachments[0].clearColor;
+      uint32_t clearColor = packColor(glm::vec4(c[0], c[1], c[2], c[3]));
+
+      for (int32_t y = y0; y < y1; y++)
+         std::fill(mState.target.color + y * width + x0, mState.target.color + y * width + x1, clearColor);
+   }
+
+   if (mState.target.depth && desc.depthAttachment.loadAction == GFXLoadAttachmentAction::CLEAR)
+   {
+      for (int32_t y = y0; y < y1; y++)
+         std::fill(mState.target.depth + y * width + x0, mState.target.depth + y * width + x1, desc.depthAttachment.clearDepth);
+   }
+}
+
+void GFXSoftwareDevice::_draw(uint32_t vertexStart, uint32_t vertexCount, uint32_t instanceCount, uint32_t baseInstance, bool indexed, uint32_t indexByteOffset, int32_t baseVertex)
+{
+   const SWPipeline* pipeline = mState.pipeline;
+   if (pipeline)
+      _countDraw(pipeline->primitiveType, vertexCount, instanceCount);
+
+   if (!mState.hasRenderPass || !pipeline || !pipeline->hasShaders || vertexCount == 0 || instanceCount == 0)
+      return;
+
+   // Fetch indices up front so the range of vertices that has to be shaded is known.
+   std::vector<uint32_t> indices;
+   uint32_t firstVertex = vertexStart;
+   uint32_t uniqueVertexCount = vertexCount;
+
+   if (indexed)
+   {
+      if (!mState.indexBuffer)
+         return;
+
+      indices.resize(vertexCount);
+      const uint8_t* indexData = mState.indexBuffer + indexByteOffset;
+      for (uint32_t i = 0; i < vertexCount; i++)
+      {
+         indices[i] = mState.indexBufferType == GFXIndexBufferType::BITS_16 ?
+            ((const uint16_t*)indexData)[i] :
+            ((const uint32_t*)indexData)[i];
+         indices[i] += baseVertex;
+      }
+
+      auto range = std::minmax_element(indices.begin(), indices.end());
+      firstVertex = *range.first;
+      uniqueVertexCount = *range.second - *range.first + 1;
+   }
+
+   SWDrawState draw;
+   draw.pipeline = pipeline;
+   draw.rasterizerState = mState.rasterizerState;
+   draw.depthStencilState = mState.depthStencilState;
+   draw.blendState = mState.blendState;
+   draw.uniforms = mState.uniforms;
+
+   // Scissor, viewport and render target bounds, as inclusive pixel ranges
+   int32_t minX = std::max(0, mState.viewport[0]);
+   int32_t minY = std::max(0, mState.viewport[1]);
+   int32_t maxX = std::min(mState.target.width, mState.viewport[0] + mState.viewport[2]) - 1;
+   int32_t maxY = std::min(mState.target.height, mState.viewport[1] + mState.viewport[3]) - 1;
+   if (mState.scissorSet)
+   {
+      minX = std::max(minX, mState.scissor[0]);
+      minY = std::max(minY, mState.scissor[1]);
+      maxX = std::min(maxX, mState.scissor[0] + mState.scissor[2] - 1);
+      maxY = std::min(maxY, mState.scissor[1] + mState.scissor[3] - 1);
+   }
+
+   if (minX > maxX || minY > maxY)
+      return;
+
+   draw.scissor[0] = minX;
+   draw.scissor[1] = minY;
+   draw.scissor[2] = maxX;
+   draw.scissor[3] = maxY;
+
+   const uint32_t drawIndex = (uint32_t)mDrawStates.size();
+   mDrawStates.push_back(draw);
+
+   mDrawVertices.emplace_back((size_t)uniqueVertexCount * instanceCount);
+   GFXSoftwareVertexOutput* outputs = mDrawVertices.back().data();
+   _shadeVertices(*pipeline, firstVertex, uniqueVertexCount, instanceCount, baseInstance, outputs);
+
+   auto vertexAt = [&](uint32_t instance, uint32_t i) -> const GFXSoftwareVertexOutput*
+   {
+      uint32_t vertex = indexed ? indices[i] : vertexStart + i;
+      return &outputs[(size_t)instance * uniqueVertexCount + (vertex - firstVertex)];
+   };
+
+   switch (pipeline->primitiveType)
+   {
+   case GFXPrimitiveType::POINT_LIST:
+   {
+      // Points never need clipping, so setup runs in parallel into a preallocated range.
+      const uint32_t pointCount = vertexCount * instanceCount;
+      const size_t base = mPrimitives.size();
+      mPrimitives.resize(base + pointCount);
+
+      mJobSystem.parallelFor(pointCount, POINT_GRAIN_SIZE, [&](uint32_t start, uint32_t end, uint32_t threadIndex)
+      {
+         for (uint32_t i = start; i < end; i++)
+         {
+            SWPrimitive& prim = mPrimitives[base + i];
+            prim.valid = _setupPoint(vertexAt(i / vertexCount, i % vertexCount), drawIndex, prim);
+         }
+      });
+
+      size_t write = base;
+      for (size_t i = base; i < base + pointCount; i++)
+      {
+         if (mPrimitives[i].valid)
+            mPrimitives[write++] = mPrimitives[i];
+      }
+      mPrimitives.resize(write);
+
+      for (size_t i = base; i < write; i++)
+         _binPrimitive((uint32_t)i);
+
+      mFrameStats.points += write - base;
+      break;
+   }
+
+   case GFXPrimitiveType::TRIANGLE_LIST:
+   {
+      for (uint32_t instance = 0; instance < instanceCount; instance++)
+      {
+         for (uint32_t i = 0; i + 2 < vertexCount; i += 3)
+            _setupTriangle(vertexAt(instance, i), vertexAt(instance, i + 1), vertexAt(instance, i + 2), drawIndex);
+      }
+      break;
+   }
+
+   case GFXPrimitiveType::TRIANGLE_STRIP:
+   {
+      for (uint32_t instance = 0; instance < instanceCount; instance++)
+      {
+         for (uint32_t i = 0; i + 2 < vertexCount; i++)
+         {
+            // Odd triangles swap their first two vertices to keep a consistent winding.
+            if (i & 1)
+               _setupTriangle(vertexAt(instance, i + 1), vertexAt(instance, i), vertexAt(instance, i + 2), drawIndex);
+            else
+               _setupTriangle(vertexAt(instance, i), vertexAt(instance, i + 1), vertexAt(instance, i + 2), drawIndex);
+         }
+      }
+      break;
+   }
+
+   case GFXPrimitiveType::LINE_LIST:
+   case GFXPrimitiveType::LINE_STRIP:
+      _warnUnsupported(UNSUPPORTED_LINES, "line primitives");
+      break;
+   }
+}
+
+void GFXSoftwareDevice::_shadeVertices(const SWPipeline& pipeline, uint32_t firstVertex, uint32_t vertexCount, uint32_t instanceCount, uint32_t baseInstance, GFXSoftwareVertexOutput* outputs)
+{
+   const uint32_t total = vertexCount * instanceCount;
+
+   mJobSystem.parallelFor(total, VERTEX_GRAIN_SIZE, [&](uint32_t start, uint32_t end, uint32_t threadIndex)
+   {
+      GFXSoftwareVertexInput input;
+      input.uniforms = &mState.uniforms;
+
+      for (uint32_t n = start; n < end; n++)
+      {
+         input.instanceId = n / vertexCount;
+         input.vertexId = firstVertex + (n % vertexCount);
+
+         for (const SWInputAttribute& attribute : pipeline.attributes)
+         {
+            const SWVertexBinding& binding = mState.vertexBindings[attribute.bufferBinding];
+            glm::vec4 value(0.0f, 0.0f, 0.0f, 1.0f);
+
+            if (binding.data)
+            {
+               uint32_t element = attribute.perInstance ? baseInstance + input.instanceId : input.vertexId;
+               const uint8_t* data = binding.data + (size_t)element * binding.stride + attribute.offset;
+               for (uint32_t c = 0; c < attribute.count && c < 4; c++)
+                  value[c] = decodeComponent(data, attribute.type, c);
+            }
+
+            input.attributes[attribute.slot] = value;
+         }
+
+         GFXSoftwareVertexOutput& output = outputs[n];
+         output.pointSize = 1.0f;
+         pipeline.shaders.vertexShader(input, output);
+      }
+   });
+}
+
+void GFXSoftwareDevice::_setupTriangle(const GFXSoftwareVertexOutput* v0, const GFXSoftwareVertexOutput* v1, const GFXSoftwareVertexOutput* v2, uint32_t drawIndex)
+{
+   enum { PLANE_COUNT = 6, MAX_POLYGON = 3 + PLANE_COUNT };
+
+   const float guardX = (float)GUARD_BAND_PIXELS / std::max(1.0f, mState.viewport[2] * 0.5f);
+   const float guardY = (float)GUARD_BAND_PIXELS / std::max(1.0f, mState.viewport[3] * 0.5f);
+
+   // Signed distance to the near plane, the guard band and a tiny positive w.
+   auto planeDistance = [&](int plane, const glm::vec4& p) -> float
+   {
+      switch (plane)
+      {
+      case 0: return p.z + p.w;
+      case 1: return guardX * p.w - p.x;
+      case 2: return guardX * p.w + p.x;
+      case 3: return guardY * p.w - p.y;
+      case 4: return guardY * p.w + p.y;
+      default: return p.w - 1e-6f;
+      }
+   };
+
+   bool needsClipping = false;
+   for (int plane = 0; plane < PLANE_COUNT; plane++)
+   {
+      bool in0 = planeDistance(plane, v0->position) >= 0.0f;
+      bool in1 = planeDistance(plane, v1->position) >= 0.0f;
+      bool in2 = planeDistance(plane, v2->position) >= 0.0f;
+
+      if (!in0 && !in1 && !in2)
+         return;
+
+      needsClipping |= !(in0 && in1 && in2);
+   }
+
+   if (!needsClipping)
+   {
+      _setupClippedTriangle(v0, v1, v2, drawIndex);
+      return;
+   }
+
+   const uint32_t varyingCount = mDrawStates[drawIndex].pipeline->shaders.varyingCount;
+
+   const GFXSoftwareVertexOutput* polygon[MAX_POLYGON] = { v0, v1, v2 };
+   const GFXSoftwareVertexOutput* clipped[MAX_POLYGON];
+   int count = 3;
+
+   for (int plane = 0; plane < PLANE_COUNT && count >= 3; plane++)
+   {
+      int clippedCount = 0;
+      for (int i = 0; i < count; i++)
+      {
+         const GFXSoftwareVertexOutput* a = polygon[i];
+         const GFXSoftwareVertexOutput* b = polygon[(i + 1) % count];
+         float da = planeDistance(plane, a->position);
+         float db = planeDistance(plane, b->position);
+
+         if (da >= 0.0f)
+            clipped[clippedCount++] = a;
+
+         if ((da >= 0.0f) != (db >= 0.0f))
+         {
+            float t = da / (da - db);
+
+            mClipVertices.emplace_back();
+            GFXSoftwareVertexOutput& v = mClipVertices.back();
+            v.position = glm::mix(a->position, b->position, t);
+            v.pointSize = a->pointSize;
+            for (uint32_t k = 0; k < varyingCount; k++)
+               v.varyings[k] = a->varyings[k] + (b->varyings[k] - a->varyings[k]) * t;
+
+            clipped[clippedCount++] = &v;
+         }
+      }
+
+      count = clippedCount;
+      memcpy(polygon, clipped, sizeof(polygon[0]) * count);
+   }
+
+   for (int i = 1; i + 1 < count; i++)
+      _setupClippedTriangle(polygon[0], polygon[i], polygon[i + 1], drawIndex);
+}
+
+void GFXSoftwareDevice::_setupClippedTriangle(const GFXSoftwareVertexOutput* v0, const GFXSoftwareVertexOutput* v1, const GFXSoftwareVertexOutput* v2, uint32_t drawIndex)
+{
+   const SWDrawState& draw = mDrawStates[drawIndex];
+   const GFXSoftwareVertexOutput* vertices[3] = { v0, v1, v2 };
+
+   SWPrimitive prim;
+   prim.isPoint = false;
+   prim.valid = true;
+   prim.drawIndex = drawIndex;
+
+   for (int i = 0; i < 3; i++)
+   {
+      const glm::vec4& p = vertices[i]->position;
+      float invW = 1.0f / p.w;
+
+      float windowX = (p.x * invW * 0.5f + 0.5f) * mState.viewport[2] + mState.viewport[0];
+      float windowY = (p.y * invW * 0.5f + 0.5f) * mState.viewport[3] + mState.viewport[1];
+
+      prim.x[i] = (int32_t)lroundf(windowX * SUBPIXEL_SCALE);
+      prim.y[i] = (int32_t)lroundf(windowY * SUBPIXEL_SCALE);
+      prim.z[i] = p.z * invW * 0.5f + 0.5f;
+      prim.invW[i] = invW;
+      prim.vertices[i] = vertices[i];
+   }
+
+   int64_t area2 = (int64_t)(prim.x[1] - prim.x[0]) * (prim.y[2] - prim.y[0]) -
+                   (int64_t)(prim.x[2] - prim.x[0]) * (prim.y[1] - prim.y[0]);
+   if (area2 == 0)
+      return;
+
+   // Window space has y going up like OpenGL, so a positive area is counter clockwise.
+   bool isCounterClockwise = area2 > 0;
+   bool isFrontFacing = isCounterClockwise == (draw.rasterizerState.windingMode == GFXWindingMode::COUNTER_CLOCKWISE);
+
+   if (draw.rasterizerState.cullMode == GFXCullMode::CULL_BACK && !isFrontFacing)
+      return;
+   if (draw.rasterizerState.cullMode == GFXCullMode::CULL_FRONT && isFrontFacing)
+      return;
+
+   // The rasterizer expects counter clockwise triangles.
+   if (!isCounterClockwise)
+   {
+      std::swap(prim.x[1], prim.x[2]);
+      std::swap(prim.y[1], prim.y[2]);
+      std::swap(prim.z[1], prim.z[2]);
+      std::swap(prim.invW[1], prim.invW[2]);
+      std::swap(prim.vertices[1], prim.vertices[2]);
+      area2 = -area2;
+   }
+
+   prim.minX = std::max(draw.scissor[0], std::min({ prim.x[0], prim.x[1], prim.x[2] }) >> SUBPIXEL_BITS);
+   prim.minY = std::max(draw.scissor[1], std::min({ prim.y[0], prim.y[1], prim.y[2] }) >> SUBPIXEL_BITS);
+   prim.maxX = std::min(draw.scissor[2], std::max({ prim.x[0], prim.x[1], prim.x[2] }) >> SUBPIXEL_BITS);
+   prim.maxY = std::min(draw.scissor[3], std::max({ prim.y[0], prim.y[1], prim.y[2] }) >> SUBPIXEL_BITS);
+
+   if (prim.minX > prim.maxX || prim.minY > prim.maxY)
+      return;
+
+   const float scale = 1.0f / SUBPIXEL_SCALE;
+   const float x0 = prim.x[0] * scale, y0 = prim.y[0] * scale;
+   const float x1 = prim.x[1] * scale, y1 = prim.y[1] * scale;
+   const float x2 = prim.x[2] * scale, y2 = prim.y[2] * scale;
+   const float invDet = 1.0f / ((float)area2 * scale * scale);
+
+   prim.l1dx = (y2 - y0) * invDet;
+   prim.l1dy = (x0 - x2) * invDet;
+   prim.l2dx = (y0 - y1) * invDet;
+   prim.l2dy = (x1 - x0) * invDet;
+
+   mPrimitives.push_back(prim);
+   _binPrimitive((uint32_t)mPrimitives.size() - 1);
+
+   mFrameStats.triangles++;
+}
+
+bool GFXSoftwareDevice::_setupPoint(const GFXSoftwareVertexOutput* v, uint32_t drawIndex, SWPrimitive& prim) const
+{
+   const SWDrawState& draw = mDrawStates[drawIndex];
+   const glm::vec4& p = v->position;
+
+   if (p.w <= 0.0f || p.z < -p.w || p.z > p.w)
+      return false;
+
+   float invW = 1.0f / p.w;
+   float centerX = (p.x * invW * 0.5f + 0.5f) * mState.viewport[2] + mState.viewport[0];
+   float centerY = (p.y * invW * 0.5f + 0.5f) * mState.viewport[3] + mState.viewport[1];
+   float halfSize = (draw.rasterizerState.enableDynamicPointSize ? std::max(v->pointSize, 1.0f) : 1.0f) * 0.5f;
+
+   // Pixels whose centers fall inside the square
+   prim.minX = std::max(draw.scissor[0], (int32_t)ceilf(centerX - halfSize - 0.5f));
+   prim.minY = std::max(draw.scissor[1], (int32_t)ceilf(centerY - halfSize - 0.5f));
+   prim.maxX = std::min(draw.scissor[2], (int32_t)ceilf(centerX + halfSize - 0.5f) - 1);
+   prim.maxY = std::min(draw.scissor[3], (int32_t)ceilf(centerY + halfSize - 0.5f) - 1);
+
+   if (prim.minX > prim.maxX || prim.minY > prim.maxY)
+      return false;
+
+   prim.isPoint = true;
+   prim.drawIndex = drawIndex;
+   prim.z[0] = p.z * invW * 0.5f + 0.5f;
+   prim.invW[0] = invW;
+   prim.vertices[0] = v;
+   return true;
+}
+
+void GFXSoftwareDevice::_binPrimitive(uint32_t primitiveIndex)
+{
+   const SWPrimitive& prim = mPrimitives[primitiveIndex];
+
+   int32_t tileX0 = prim.minX / TILE_SIZE;
+   int32_t tileY0 = prim.minY / TILE_SIZE;
+   int32_t tileX1 = std::min(prim.maxX / TILE_SIZE, mTilesX - 1);
+   int32_t tileY1 = std::min(prim.maxY / TILE_SIZE, mTilesY - 1);
+
+   for (int32_t ty = tileY0; ty <= tileY1; ty++)
+   {
+      for (int32_t tx = tileX0; tx <= tileX1; tx++)
+         mTileBins[ty * mTilesX + tx].push_back(primitiveIndex);
+   }
+}
+
+void GFXSoftwareDevice::_rasterizeTriangle(const SWPrimitive& prim, const SWDrawState& draw, int32_t tileX0, int32_t tileY0, int32_t tileX1, int32_t tileY1, uint32_t threadIndex)
+{
+   const int32_t rx0 = std::max(tileX0, prim.minX);
+   const int32_t ry0 = std::max(tileY0, prim.minY);
+   const int32_t rx1 = std::min(tileX1 - 1, prim.maxX);
+   const int32_t ry1 = std::min(tileY1 - 1, prim.maxY);
+
+   if (rx0 > rx1 || ry0 > ry1)
+      return;
+
+   // Sample positions (pixel centers) of the rectangle's corners in fixed point
+   const int64_t sx0 = ((int64_t)rx0 << SUBPIXEL_BITS) + SUBPIXEL_SCALE / 2;
+   const int64_t sy0 = ((int64_t)ry0 << SUBPIXEL_BITS) + SUBPIXEL_SCALE / 2;
+   const int64_t sx1 = ((int64_t)rx1 << SUBPIXEL_BITS) + SUBPIXEL_SCALE / 2;
+   const int64_t sy1 = ((int64_t)ry1 << SUBPIXEL_BITS) + SUBPIXEL_SCALE / 2;
+
+   // Edge functions for edges 0->1, 1->2 and 2->0. An edge that covers the whole rectangle
+   // is left at zero so it never rejects anything; otherwise the value at the corner is
+   // small enough to step through the rectangle in 32 bits.
+   int32_t edgeRow[3];
+   int32_t edgeStepX[3];
+   int32_t edgeStepY[3];
+
+   for (int e = 0; e < 3; e++)
+   {
+      int i = e;
+      int j = (e + 1) % 3;
+
+      int64_t a = (int64_t)prim.y[i] - prim.y[j];
+      int64_t b = (int64_t)prim.x[j] - prim.x[i];
+      int64_t c = -(a * prim.x[i] + b * prim.y[i]);
+
+      // Top-left fill rule: pixels exactly on a right or bottom edge belong to the neighbour.
+      bool isTopLeft = a > 0 || (a == 0 && b < 0);
+      if (!isTopLeft)
+         c -= 1;
+
+      int64_t e00 = a * sx0 + b * sy0 + c;
+      int64_t e10 = a * sx1 + b * sy0 + c;
+      int64_t e01 = a * sx0 + b * sy1 + c;
+      int64_t e11 = a * sx1 + b * sy1 + c;
+
+      if (e00 < 0 && e10 < 0 && e01 < 0 && e11 < 0)
+         return;
+
+      if (e00 >= 0 && e10 >= 0 && e01 >= 0 && e11 >= 0)
+      {
+         edgeRow[e] = 0;
+         edgeStepX[e] = 0;
+         edgeStepY[e] = 0;
+      }
+      else
+      {
+         edgeRow[e] = (int32_t)e00;
+         edgeStepX[e] = (int32_t)(a * SUBPIXEL_SCALE);
+         edgeStepY[e] = (int32_t)(b * SUBPIXEL_SCALE);
+      }
+   }
+
+   const float originX = prim.x[0] * (1.0f / SUBPIXEL_SCALE);
+   const float originY = prim.y[0] * (1.0f / SUBPIXEL_SCALE);
+   const float dz1 = prim.z[1] - prim.z[0];
+   const float dz2 = prim.z[2] - prim.z[0];
+
+   const SWDepthStencilState& depthState = draw.depthStencilState;
+   float* depthBuffer = depthState.enableDepthTest ? mState.target.depth : nullptr;
+   const int32_t width = mState.target.width;
+   uint64_t pixels = 0;
+
+   auto processPixel = [&](int32_t x, int32_t y, float l1, float l2)
+   {
+      float z = prim.z[0] + l1 * dz1 + l2 * dz2;
+      if (z < 0.0f || z > 1.0f)
+         return;
+
+      if (depthBuffer)
+      {
+         float& stored = depthBuffer[y * width + x];
+         if (!depthCompare(depthState.depthCompareFunc, z, stored))
+            return;
+
+         if (depthState.enableDepthWrite)
+            stored = z;
+      }
+
+      _shadePixel(prim, draw, x, y, l1, l2, z);
+      pixels++;
+   };
+
+   for (int32_t y = ry0; y <= ry1; y++)
+   {
+      const float dy = (y + 0.5f) - originY;
+      const float rowL1 = prim.l1dy * dy;
+      const float rowL2 = prim.l2dy * dy;
+
+#if SIMD_SSE2
+      const __m128i stepX0 = _mm_setr_epi32(0, edgeStepX[0], edgeStepX[0] * 2, edgeStepX[0] * 3);
+      const __m128i stepX1 = _mm_setr_epi32(0, edgeStepX[1], edgeStepX[1] * 2, edgeStepX[1] * 3);
+      const __m128i stepX2 = _mm_setr_epi32(0, edgeStepX[2], edgeStepX[2] * 2, edgeStepX[2] * 3);
+      const __m128i step4X0 = _mm_set1_epi32(edgeStepX[0] * 4);
+      const __m128i step4X1 = _mm_set1_epi32(edgeStepX[1] * 4);
+      const __m128i step4X2 = _mm_set1_epi32(edgeStepX[2] * 4);
+
+      __m128i e0 = _mm_add_epi32(_mm_set1_epi32(edgeRow[0]), stepX0);
+      __m128i e1 = _mm_add_epi32(_mm_set1_epi32(edgeRow[1]), stepX1);
+      __m128i e2 = _mm_add_epi32(_mm_set1_epi32(edgeRow[2]), stepX2);
+
+      for (int32_t x = rx0; x <= rx1; x += 4)
+      {
+         // A lane is outside as soon as one of its edge values has the sign bit set.
+         __m128i outside = _mm_or_si128(_mm_or_si128(e0, e1), e2);
+         int coverage = ~_mm_movemask_ps(_mm_castsi128_ps(outside)) & 0xF;
+
+         if (rx1 - x < 3)
+            coverage &= (1 << (rx1 - x + 1)) - 1;
+
+         while (coverage)
+         {
+            int lane = 0;
+            while (!(coverage & (1 << lane)))
+               lane++;
+            coverage &= ~(1 << lane);
+
+            const float dx = (x + lane + 0.5f) - originX;
+            processPixel(x + lane, y, prim.l1dx * dx + rowL1, prim.l2dx * dx + rowL2);
+         }
+
+         e0 = _mm_add_epi32(e0, step4X0);
+         e1 = _mm_add_epi32(e1, step4X1);
+         e2 = _mm_add_epi32(e2, step4X2);
+      }
+#else
+      int32_t e0 = edgeRow[0];
+      int32_t e1 = edgeRow[1];
+      int32_t e2 = edgeRow[2];
+
+      for (int32_t x = rx0; x <= rx1; x++)
+      {
+         if ((e0 | e1 | e2) >= 0)
+         {
+            const float dx = (x + 0.5f) - originX;
+            processPixel(x, y, prim.l1dx * dx + rowL1, prim.l2dx * dx + rowL2);
+         }
+
+         e0 += edgeStepX[0];
+         e1 += edgeStepX[1];
+         e2 += edgeStepX[2];
+      }
+#endif
+
+      edgeRow[0] += edgeStepY[0];
+      edgeRow[1] += edgeStepY[1];
+      edgeRow[2] += edgeStepY[2];
+   }
+
+   mThreadStats[threadIndex].pixels += pixels;
+}
+
+void GFXSoftwareDevice::_rasterizePoint(const SWPrimitive& prim, const SWDrawState& draw, int32_t tileX0, int32_t tileY0, int32_t tileX1, int32_t tileY1, uint32_t threadIndex)
+{
+   const int32_t rx0 = std::max(tileX0, prim.minX);
+   const int32_t ry0 = std::max(tileY0, prim.minY);
+   const int32_t rx1 = std::min(tileX1 - 1, prim.maxX);
+   const int32_t ry1 = std::min(tileY1 - 1, prim.maxY);
+
+   const SWDepthStencilState& depthState = draw.depthStencilState;
+   float* depthBuffer = depthState.enableDepthTest ? mState.target.depth : nullptr;
+   const int32_t width = mState.target.width;
+   const float z = prim.z[0];
+   uint64_t pixels = 0;
+
+   for (int32_t y = ry0; y <= ry1; y++)
+   {
+      for (int32_t x = rx0; x <= rx1; x++)
+      {
+         if (depthBuffer)
+         {
+            float& stored = depthBuffer[y * width + x];
+            if (!depthCompare(depthState.depthCompareFunc, z, stored))
+               continue;
+
+            if (depthState.enableDepthWrite)
+               stored = z;
+         }
+
+         _shadePixel(prim, draw, x, y, 0.0f, 0.0f, z);
+         pixels++;
+      }
+   }
+
+   mThreadStats[threadIndex].pixels += pixels;
+}
+
+void GFXSoftwareDevice::_shadePixel(const SWPrimitive& prim, const SWDrawState& draw, int32_t x, int32_t y, float l1, float l2, float z)
+{
+   const GFXSoftwareShaderDesc& shaders = draw.pipeline->shaders;
+
+   float varyings[SW_MAX_VARYINGS];
+   const float* interpolated = prim.vertices[0]->varyings;
+
+   if (!prim.isPoint && shaders.varyingCount > 0)
+   {
+      // Perspective correct weights from the screen space barycentrics
+      float w1 = l1 * prim.invW[1];
+      float w2 = l2 * prim.invW[2];
+      float w0 = (1.0f - l1 - l2) * prim.invW[0];
+      float invSum = 1.0f / (w0 + w1 + w2);
+      w1 *= invSum;
+      w2 *= invSum;
+
+      const float* a = prim.vertices[0]->varyings;
+      const float* b = prim.vertices[1]->varyings;
+      const float* c = prim.vertices[2]->varyings;
+      for (uint32_t i = 0; i < shaders.varyingCount; i++)
+         varyings[i] = a[i] + (b[i] - a[i]) * w1 + (c[i] - a[i]) * w2;
+
+      interpolated = varyings;
+   }
+
+   GFXSoftwareFragmentInput input;
+   input.fragCoord = glm::vec2(x + 0.5f, y + 0.5f);
+   input.depth = z;
+   input.varyings = interpolated;
+   input.uniforms = &draw.uniforms;
+
+   glm::vec4 color = shaders.fragmentShader(input);
+
+   if (mState.target.color)
+   {
+      // Tiles draw their primitives in submission order, so reading the target back here is safe.
+      uint32_t& target = mState.target.color[y * mState.target.width + x];
+      if (draw.blendState.enableBlending)
+         color = blendColor(draw.blendState, glm::clamp(color, 0.0f, 1.0f), unpackColor(target));
+
+      target = packColor(color);
+   }
+}
+
+void GFXSoftwareDevice::_warnUnsupported(uint32_t feature, const char* description)
+{
+   if (mUnsupportedWarnings & feature)
+      return;
+
+   mUnsupportedWarnings |= feature;
+   printf("Software Rasterizer: %s are not supported and will be ignored.\n", description);
+}
+
+uint32_t GFXSoftwareDevice::_getTextureBlockSize(GFXTextureInternalFormat format) const
+{
+   // depth is always kept as float
+   if (format == GFXTextureInternalFormat::DEPTH_16 || format == GFXTextureInternalFormat::DEPTH_32F)
+      return sizeof(float);
+
+   return getFormatBlockSize(format);
+}
+
+void GFXSoftwareDevice::_getTextureLevelSize(const SWTexture& texture, int32_t level, int32_t& outWidth, int32_t& outHeight, int32_t& outDepth) const
+{
+   outWidth = std::max(texture.width >> level, 1);
+   outHeight = std::max(texture.height >> level, 1);
+   outDepth = texture.type == GFXTextureType::TEXTURE_3D ? std::max(texture.depth >> level, 1) : texture.depth;
+}
+
+void GFXSoftwareDevice::_generateMipmaps(SWTexture& texture)
+{
+   // Box filter, only color textures can be filtered.
+   if (texture.internalFormat != GFXTextureInternalFormat::RGBA8)
+      return;
+
+   for (int32_t level = 1; level < texture.levels; level++)
+   {
+      int32_t srcWidth, srcHeight, srcDepth;
+      int32_t dstWidth, dstHeight, dstDepth;
+      _getTextureLevelSize(texture, level - 1, srcWidth, srcHeight, srcDepth);
+      _getTextureLevelSize(texture, level, dstWidth, dstHeight, dstDepth);
+
+      const uint8_t* src = texture.data.data() + texture.levelOffsets[level - 1];
+      uint8_t* dst = texture.data.data() + texture.levelOffsets[level];
+
+      for (int32_t z = 0; z < dstDepth; z++)
+      {
+         // 3D textures halve in depth as well, the odd slice is dropped
+         int32_t srcZ = texture.type == GFXTextureType::TEXTURE_3D ? std::min(z * 2, srcDepth - 1) : z;
+
+         for (int32_t y = 0; y < dstHeight; y++)
+         {
+            int32_t y0 = std::min(y * 2, srcHeight - 1);
+            int32_t y1 = std::min(y * 2 + 1, srcHeight - 1);
+
+            for (int32_t x = 0; x < dstWidth; x++)
+            {
+               int32_t x0 = std::min(x * 2, srcWidth - 1);
+               int32_t x1 = std::min(x * 2 + 1, srcWidth - 1);
+
+               const uint8_t* row0 = src + ((size_t)srcZ * srcHeight + y0) * srcWidth * 4;
+               const uint8_t* row1 = src + ((size_t)srcZ * srcHeight + y1) * srcWidth * 4;
+               uint8_t* out = dst + (((size_t)z * dstHeight + y) * dstWidth + x) * 4;
+
+               for (int c = 0; c < 4; c++)
+                  out[c] = (uint8_t)((row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c] + 2) / 4);
+            }
+         }
+      }
+   }
+}
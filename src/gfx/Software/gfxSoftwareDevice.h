@@ -0,0 +1,351 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "core/jobSystem.h"
+#include "gfx/gfxDevice.h"
+#include "gfx/gfxCmdBuffer.h"
+
+enum
+{
+   SW_MAX_VERTEX_ATTRIBUTES = 8,
+   SW_MAX_VERTEX_BUFFERS = 8,
+   SW_MAX_CONSTANT_BUFFERS = 16,
+   SW_MAX_VARYINGS = 16
+};
+
+struct GFXSoftwareUniforms
+{
+   const uint8_t* constantBuffers[SW_MAX_CONSTANT_BUFFERS];
+   const uint8_t* pushConstants;
+
+   template<typename T>
+   inline const T& constantBuffer(uint32_t index) const
+   {
+      return *reinterpret_cast<const T*>(constantBuffers[index]);
+   }
+};
+
+struct GFXSoftwareVertexInput
+{
+   // Decoded from the pipeline's input layout, indexed by attribute slot.
+   glm::vec4 attributes[SW_MAX_VERTEX_ATTRIBUTES];
+   uint32_t vertexId; // includes baseVertex
+   uint32_t instanceId; // excludes baseInstance like gl_InstanceID, per-instance attributes start at it
+   const GFXSoftwareUniforms* uniforms;
+};
+
+struct GFXSoftwareVertexOutput
+{
+   glm::vec4 position; // clip space, same conventions as gl_Position
+   float pointSize;
+   float varyings[SW_MAX_VARYINGS];
+};
+
+struct GFXSoftwareFragmentInput
+{
+   glm::vec2 fragCoord;
+   float depth;
+   const float* varyings; // perspective correct
+   const GFXSoftwareUniforms* uniforms;
+};
+
+typedef std::function<void(const GFXSoftwareVertexInput& in, GFXSoftwareVertexOutput& out)> GFXSoftwareVertexShader;
+typedef std::function<glm::vec4(const GFXSoftwareFragmentInput& in)> GFXSoftwareFragmentShader;
+
+// C++ stand-ins for a pipeline's GLSL, called from worker threads.
+struct GFXSoftwareShaderDesc
+{
+   GFXSoftwareVertexShader vertexShader;
+   GFXSoftwareFragmentShader fragmentShader;
+   uint32_t varyingCount = 0;
+};
+
+struct GFXSoftwareStats
+{
+   uint64_t triangles = 0;
+   uint64_t points = 0;
+   uint64_t pixels = 0;
+   double rasterTimeMs = 0.0;
+   uint32_t threadCount = 1;
+
+   double pixelsPerSecondPerCore = 0.0;
+   double primitivesPerSecondPerCore = 0.0;
+};
+
+// Bins primitives into screen tiles rasterized in parallel, in submission order within a tile,
+// so output doesn't depend on the thread count.
+class GFXSoftwareDevice : public GFXDevice
+{
+   enum
+   {
+      TILE_SIZE = 64,
+      SUBPIXEL_BITS = 4,
+      SUBPIXEL_SCALE = 1 << SUBPIXEL_BITS,
+
+      // Triangles are clipped to this many pixels around the viewport center, which
+      // keeps the fixed point edge functions inside 32 bits when stepping a tile.
+      GUARD_BAND_PIXELS = 8192,
+
+      VERTEX_GRAIN_SIZE = 256,
+      POINT_GRAIN_SIZE = 1024
+   };
+
+   struct SWBuffer
+   {
+      std::vector<uint8_t> data;
+      GFXBufferType type;
+   };
+
+   struct SWInputAttribute
+   {
+      uint32_t slot;
+      GFXInputLayoutFormat type;
+      uint32_t bufferBinding;
+      uint32_t offset;
+      uint32_t count;
+      bool perInstance;
+   };
+
+   struct SWPipeline
+   {
+      std::vector<SWInputAttribute> attributes;
+      GFXPrimitiveType primitiveType;
+      GFXSoftwareShaderDesc shaders;
+      bool hasShaders = false;
+   };
+
+   struct SWRasterizerState
+   {
+      GFXCullMode cullMode = GFXCullMode::CULL_NONE;
+      GFXWindingMode windingMode = GFXWindingMode::COUNTER_CLOCKWISE;
+      bool enableDynamicPointSize = false;
+   };
+
+   struct SWDepthStencilState
+   {
+      GFXCompareFunc depthCompareFunc = GFXCompareFunc::LESS;
+      bool enableDepthTest = false;
+      bool enableDepthWrite = false;
+   };
+
+   struct SWTexture
+   {
+      std::vector<uint8_t> data;
+      std::vector<size_t> levelOffsets;
+      GFXTextureType type;
+      GFXTextureInternalFormat internalFormat;
+      int32_t width;
+      int32_t height;
+      int32_t depth; // slices for 3D, layers for arrays, 6 for cubemaps
+      int32_t levels;
+      GFXMemoryCategory category;
+   };
+
+   struct SWVertexBinding
+   {
+      const uint8_t* data = nullptr;
+      uint32_t stride = 0;
+   };
+
+   // Everything a primitive needs once it has been binned.
+   struct SWDrawState
+   {
+      const SWPipeline* pipeline;
+      SWRasterizerState rasterizerState;
+      SWDepthStencilState depthStencilState;
+      GFXBlendStateDesc blendState;
+      GFXSoftwareUniforms uniforms;
+      int32_t scissor[4];
+   };
+
+   struct SWPrimitive
+   {
+      // Fixed point window coordinates, only used by triangles
+      int32_t x[3];
+      int32_t y[3];
+      float z[3];
+      float invW[3];
+      const GFXSoftwareVertexOutput* vertices[3];
+
+      // Plane equations for the barycentrics of vertex 1 and 2, in pixels from vertex 0
+      float l1dx, l1dy;
+      float l2dx, l2dy;
+
+      int32_t minX, minY, maxX, maxY; // inclusive pixel bounds, already clipped to the scissor
+      uint32_t drawIndex;
+      bool isPoint;
+      bool valid;
+   };
+
+   struct SWRenderTarget
+   {
+      uint32_t* color = nullptr;
+      float* depth = nullptr;
+      int32_t width = 0;
+      int32_t height = 0;
+   };
+
+   struct SWThreadStats
+   {
+      uint64_t pixels;
+      char pad[64 - sizeof(uint64_t)];
+   };
+
+   struct
+   {
+      GFXRenderPassDesc renderPass;
+      bool hasRenderPass = false;
+      bool clearPending = false;
+      int32_t clearRect[4] = {}; // the scissor when the pass began, like glClear: x0, y0, x1, y1 exclusive
+      SWRenderTarget target;
+
+      const SWPipeline* pipeline = nullptr;
+      SWRasterizerState rasterizerState;
+      SWDepthStencilState depthStencilState;
+      GFXBlendStateDesc blendState;
+      GFXSoftwareUniforms uniforms = {};
+      SWVertexBinding vertexBindings[SW_MAX_VERTEX_BUFFERS];
+
+      const uint8_t* indexBuffer = nullptr;
+      GFXIndexBufferType indexBufferType = GFXIndexBufferType::BITS_16;
+
+      int32_t viewport[4] = {};
+      int32_t scissor[4] = {};
+      bool scissorSet = false;
+   } mState;
+
+   std::unordered_map<BufferHandle, SWBuffer> mBuffers;
+   int mBufferHandleCounter = 0;
+
+   std::unordered_map<PipelineHandle, SWPipeline> mPipelines;
+   int mPipelineHandleCounter = 0;
+
+   // All state blocks share one counter so deleteStateBlock() knows which table to look in.
+   std::unordered_map<StateBlockHandle, SWRasterizerState> mRasterizerStates;
+   std::unordered_map<StateBlockHandle, SWDepthStencilState> mDepthStencilStates;
+   std::unordered_map<StateBlockHandle, GFXBlendStateDesc> mBlendStates;
+   int mStateBlockHandleCounter = 0;
+
+   std::unordered_map<SamplerHandle, GFXSamplerStateDesc> mSamplers;
+   int mSamplerHandleCounter = 0;
+
+   std::unordered_map<RenderPassHandle, GFXRenderPassDesc> mRenderPasses;
+   int mRenderPassHandleCounter = 0;
+
+   std::unordered_map<TextureHandle, SWTexture> mTextures;
+   int mTextureHandleCounter = 0;
+
+   int mFenceHandleCounter = 0;
+
+   // Per render pass work, released on flush
+   std::vector<SWDrawState> mDrawStates;
+   std::deque<std::vector<GFXSoftwareVertexOutput>> mDrawVertices;
+   std::deque<GFXSoftwareVertexOutput> mClipVertices;
+   std::vector<SWPrimitive> mPrimitives;
+   std::vector<std::vector<uint32_t>> mTileBins;
+   int32_t mTilesX = 0;
+   int32_t mTilesY = 0;
+
+   JobSystem mJobSystem;
+   std::vector<SWThreadStats> mThreadStats;
+   GFXSoftwareStats mFrameStats;
+   GFXSoftwareStats mLastFrameStats;
+
+   // Timers are stamped on the CPU while commands are decoded, so the rasterization of a pass
+   // lands in whichever timer is open when the pass is flushed.
+   std::vector<GFXGpuTimer> mTimerFrame;
+   std::vector<uint32_t> mOpenTimers;
+   uint64_t mFrameStartNs = 0; // first executeCmdBuffers() of the frame, 0 before it
+
+   // Features the rasterizer can't honor are reported once each instead of silently dropped.
+   enum
+   {
+      UNSUPPORTED_LINES = 1 << 0,
+      UNSUPPORTED_TEXTURE_SAMPLING = 1 << 1,
+      UNSUPPORTED_COMPUTE = 1 << 2
+   };
+   uint32_t mUnsupportedWarnings = 0;
+
+   bool mPresentToWindow;
+   uint32_t mPresentTexture = 0;
+   uint32_t mPresentFramebuffer = 0;
+
+public:
+   // Without presentToWindow nothing touches GL, frames are only read back with readPresentedImage().
+   explicit GFXSoftwareDevice(uint32_t threadCount = 0, bool presentToWindow = true);
+   virtual ~GFXSoftwareDevice();
+
+   virtual GFXApi getApi() const override;
+   virtual const char* getApiVersionString() const override;
+   virtual const char* getGFXDeviceRendererDesc() const override;
+   virtual const char* getGFXDeviceVendorDesc() const override;
+
+   virtual BufferHandle createBuffer(const GFXBufferDesc& desc) override;
+   virtual void deleteBuffer(BufferHandle handle) override;
+
+   virtual PipelineHandle createPipeline(const GFXPipelineDesc& desc) override;
+   virtual void deletePipeline(PipelineHandle handle) override;
+
+   virtual RenderPassHandle createRenderPass(const GFXRenderPassDesc& desc) override;
+   virtual void deleteRenderPass(RenderPassHandle handle) override;
+
+   virtual StateBlockHandle createRasterizerState(const GFXRasterizerStateDesc& desc) override;
+   virtual StateBlockHandle createDepthStencilState(const GFXDepthStencilStateDesc& desc) override;
+   virtual StateBlockHandle createBlendState(const GFXBlendStateDesc& desc) override;
+   virtual void deleteStateBlock(StateBlockHandle handle) override;
+
+   virtual SamplerHandle createSampler(const GFXSamplerStateDesc& desc) override;
+   virtual void deleteSampler(SamplerHandle handle) override;
+
+   virtual TextureHandle createTexture(const GFXTextureStateDesc& desc) override;
+   virtual void deleteTexture(TextureHandle handle) override;
+   virtual void updateTexture(TextureHandle handle, const GFXTextureUpdateDesc& desc) override;
+
+   virtual void* mapBuffer(BufferHandle handle, uint32_t offset, uint32_t size) override;
+   virtual void unmapBuffer(BufferHandle handle) override;
+   virtual void readBuffer(BufferHandle handle, uint32_t offset, uint32_t size, void* outData) override;
+
+   virtual FenceHandle createFence() override;
+   virtual void deleteFence(FenceHandle handle) override;
+   virtual bool isFenceSignaled(FenceHandle handle) override;
+
+   virtual void executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count) override;
+   virtual void present(RenderPassHandle handle, int width, int height, int sourceWidth = 0, int sourceHeight = 0) override;
+   virtual bool readPresentedImage(std::vector<uint8_t>& outPixels, int& outWidth, int& outHeight) override;
+
+   void setPipelineShaders(PipelineHandle handle, const GFXSoftwareShaderDesc& desc);
+
+   void setThreadCount(uint32_t threadCount);
+   inline uint32_t getThreadCount() const { return mJobSystem.getThreadCount(); }
+
+   inline const GFXSoftwareStats& getStats() const { return mLastFrameStats; }
+
+   // Level 0, bottom row first. Depth targets are floats.
+   const void* getTextureData(TextureHandle handle) const;
+
+private:
+   void _beginRenderPass(const GFXRenderPassDesc& desc);
+   void _flushRenderPass();
+   void _rasterizeTile(uint32_t tileIndex, uint32_t threadIndex);
+   void _clearTile(int32_t x0, int32_t y0, int32_t x1, int32_t y1);
+
+   void _draw(uint32_t vertexStart, uint32_t vertexCount, uint32_t instanceCount, uint32_t baseInstance, bool indexed, uint32_t indexByteOffset, int32_t baseVertex);
+   void _shadeVertices(const SWPipeline& pipeline, uint32_t firstVertex, uint32_t vertexCount, uint32_t instanceCount, uint32_t baseInstance, GFXSoftwareVertexOutput* outputs);
+   void _setupTriangle(const GFXSoftwareVertexOutput* v0, const GFXSoftwareVertexOutput* v1, const GFXSoftwareVertexOutput* v2, uint32_t drawIndex);
+   void _setupClippedTriangle(const GFXSoftwareVertexOutput* v0, const GFXSoftwareVertexOutput* v1, const GFXSoftwareVertexOutput* v2, uint32_t drawIndex);
+   bool _setupPoint(const GFXSoftwareVertexOutput* v, uint32_t drawIndex, SWPrimitive& prim) const;
+   void _binPrimitive(uint32_t primitiveIndex);
+
+   void _rasterizeTriangle(const SWPrimitive& prim, const SWDrawState& draw, int32_t tileX0, int32_t tileY0, int32_t tileX1, int32_t tileY1, uint32_t threadIndex);
+   void _rasterizePoint(const SWPrimitive& prim, const SWDrawState& draw, int32_t tileX0, int32_t tileY0, int32_t tileX1, int32_t tileY1, uint32_t threadIndex);
+   void _shadePixel(const SWPrimitive& prim, const SWDrawState& draw, int32_t x, int32_t y, float l1, float l2, float z);
+   void _warnUnsupported(uint32_t feature, const char* description);
+
+   uint32_t _getTextureBlockSize(GFXTextureInternalFormat format) const;
+   void _getTextureLevelSize(const SWTexture& texture, int32_t level, int32_t& outWidth, int32_t& outHeight, int32_t& outDepth) const;
+   void _generateMipmaps(SWTexture& texture);
+};
@@ -5,6 +5,7 @@ void GFXCmdBuffer::begin()
     memset(cmdBuffer, 0, COMMAND_BUFFER_SIZE);
     offset = 0;
     pushConstantOffset = 0;
+    timerNamePool.clear();
 }
 
 void GFXCmdBuffer::end()
@@ -130,6 +131,17 @@ void GFXCmdBuffer::bindConstantBuffer(uint32_t index, BufferHandle buffer, uint3
    cmdBuffer[offset++] = size;
 }
 
+void GFXCmdBuffer::bindStorageBuffer(uint32_t index, BufferHandle buffer, uint32_t bufferOffset, uint32_t size)
+{
+   int type = (int)CommandType::BindStorageBuffer;
+   cmdBuffer[offset++] = type;
+
+   cmdBuffer[offset++] = index;
+   cmdBuffer[offset++] = buffer;
+   cmdBuffer[offset++] = bufferOffset;
+   cmdBuffer[offset++] = size;
+}
+
 void GFXCmdBuffer::bindTexture(uint32_t index, TextureHandle texture)
 {
    int type = (int)CommandType::BindTexture;
@@ -174,6 +186,17 @@ void GFXCmdBuffer::bindSamplers(uint32_t startIndex, uint32_t count, SamplerHand
    }
 }
 
+void GFXCmdBuffer::bindImage(uint32_t index, TextureHandle texture, uint32_t level, GFXImageAccess access)
+{
+   int type = (int)CommandType::BindImage;
+   cmdBuffer[offset++] = type;
+
+   cmdBuffer[offset++] = index;
+   cmdBuffer[offset++] = texture;
+   cmdBuffer[offset++] = level;
+   cmdBuffer[offset++] = (uint32_t)access;
+}
+
 void GFXCmdBuffer::drawPrimitives(int vertexStart, int vertexCount)
 {
     int type = (int)CommandType::DrawPrimitives;
@@ -211,3 +234,57 @@ void GFXCmdBuffer::drawIndexedPrimitivesInstanced(int vertexCount,  int indexBuf
     cmdBuffer[offset++] = indexBufferOffset;
     cmdBuffer[offset++] = instanceCount;
 }
+
+void GFXCmdBuffer::drawPrimitivesIndirect(BufferHandle argumentBuffer, uint32_t argumentOffset)
+{
+   int type = (int)CommandType::DrawPrimitivesIndirect;
+   cmdBuffer[offset++] = type;
+
+   cmdBuffer[offset++] = argumentBuffer;
+   cmdBuffer[offset++] = argumentOffset;
+}
+
+void GFXCmdBuffer::multiDrawIndexedPrimitivesIndirectCount(BufferHandle argumentBuffer, uint32_t argumentOffset, BufferHandle countBuffer, uint32_t countOffset, uint32_t maxDrawCount)
+{
+   int type = (int)CommandType::MultiDrawIndexedPrimitivesIndirectCount;
+   cmdBuffer[offset++] = type;
+
+   cmdBuffer[offset++] = argumentBuffer;
+   cmdBuffer[offset++] = argumentOffset;
+   cmdBuffer[offset++] = countBuffer;
+   cmdBuffer[offset++] = countOffset;
+   cmdBuffer[offset++] = maxDrawCount;
+}
+
+void GFXCmdBuffer::dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
+{
+   int type = (int)CommandType::Dispatch;
+   cmdBuffer[offset++] = type;
+
+   cmdBuffer[offset++] = groupCountX;
+   cmdBuffer[offset++] = groupCountY;
+   cmdBuffer[offset++] = groupCountZ;
+}
+
+void GFXCmdBuffer::memoryBarrier(uint32_t barrierBits)
+{
+   int type = (int)CommandType::MemoryBarrier;
+   cmdBuffer[offset++] = type;
+
+   cmdBuffer[offset++] = barrierBits;
+}
+
+void GFXCmdBuffer::beginTimer(const char* name)
+{
+   int type = (int)CommandType::BeginTimer;
+   cmdBuffer[offset++] = type;
+
+   cmdBuffer[offset++] = (uint32_t)timerNamePool.size();
+   timerNamePool.push_back(name);
+}
+
+void GFXCmdBuffer::endTimer()
+{
+   int type = (int)CommandType::EndTimer;
+   cmdBuffer[offset++] = type;
+}
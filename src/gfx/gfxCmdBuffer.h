@@ -1,6 +1,8 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <vector>
 
 #include "gfx/gfxTypes.h"
@@ -22,15 +24,26 @@ enum class CommandType
    BindVertexBuffers,
    BindIndexBuffer,
    BindConstantBuffer,
+   BindStorageBuffer,
    BindTexture,
    BindTextures,
    BindSampler,
    BindSamplers,
+   BindImage,
 
    DrawPrimitives,
    DrawPrimitivesInstanced,
    DrawIndexedPrimitives,
    DrawIndexedPrimitivesInstanced,
+   DrawPrimitivesIndirect,
+   MultiDrawIndexedPrimitivesIndirectCount,
+
+   Dispatch,
+
+   MemoryBarrier,
+
+   BeginTimer,
+   EndTimer,
 
    End
 };
@@ -40,6 +53,8 @@ class GFXCmdBuffer
    friend class GFXDevice;
    friend class GFXGLDevice;
    friend class GFXMetalDevice;
+   friend class GFXNullDevice;
+   friend class GFXSoftwareDevice;
 private:
     enum
     {
@@ -96,6 +111,9 @@ private:
         return pushConstantOffset++;
     }
 
+    // Names of the timers in this buffer, looked up by index when it is executed.
+    std::vector<const char*> timerNamePool;
+
     uint32_t cmdBuffer[COMMAND_BUFFER_SIZE];
     size_t offset;
     
@@ -117,13 +135,31 @@ public:
     void bindVertexBuffers(uint32_t startBindingSlot, uint32_t count, const BufferHandle *buffers, const uint32_t* strides, const uint32_t* offsets);
     void bindIndexBuffer(BufferHandle buffer, GFXIndexBufferType indexType, uint32_t offset);
     void bindConstantBuffer(uint32_t index, BufferHandle buffer, uint32_t offset, uint32_t size);
+    void bindStorageBuffer(uint32_t index, BufferHandle buffer, uint32_t offset, uint32_t size);
     void bindTexture(uint32_t index, TextureHandle texture);
     void bindTextures(uint32_t startIndex, uint32_t count, TextureHandle* textures);
     void bindSampler(uint32_t index, SamplerHandle sampler);
     void bindSamplers(uint32_t startIndex, uint32_t count, SamplerHandle* samplers);
 
+    void bindImage(uint32_t index, TextureHandle texture, uint32_t level, GFXImageAccess access);
+
     void drawPrimitives(int vertexStart, int vertexCount);
     void drawPrimitivesInstanced(int vertexStart, int vertexCount, int instanceCount);
     void drawIndexedPrimitives(int vertexCount, int indexBufferOffset);
     void drawIndexedPrimitivesInstanced( int vertexCount, int indexBufferOffset, int instanceCount);
+
+    // Arguments are read from an INDIRECT_BUFFER.
+    void drawPrimitivesIndirect(BufferHandle argumentBuffer, uint32_t argumentOffset);
+
+    // Draw count is the uint at countOffset, at most maxDrawCount. Where the count can't be read
+    // on the GPU all maxDrawCount draws are issued, so records past it need an instanceCount of 0.
+    void multiDrawIndexedPrimitivesIndirectCount(BufferHandle argumentBuffer, uint32_t argumentOffset, BufferHandle countBuffer, uint32_t countOffset, uint32_t maxDrawCount);
+
+    void dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ);
+
+    void memoryBarrier(uint32_t barrierBits); // GFXBarrierBit flags
+
+    // Timers can nest and span command buffers of a frame, name must outlive execution.
+    void beginTimer(const char* name);
+    void endTimer();
 };
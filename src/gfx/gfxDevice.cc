@@ -0,0 +1,131 @@
+#include <assert.h>
+#include <string.h>
+#include "gfx/gfxDevice.h"
+
+void GFXDevice::resetMemoryPeaks()
+{
+   for (int i = 0; i < (int)GFXMemoryCategory::COUNT; i++)
+      mMemoryStats.categories[i].peakBytes = mMemoryStats.categories[i].allocatedBytes;
+
+   mMemoryStats.peakBytes = mMemoryStats.totalBytes;
+}
+
+double GFXDevice::getGpuTimerMs(const char* name) const
+{
+   uint64_t totalNs = 0;
+   for (const GFXGpuTimer& timer : mGpuTimers)
+   {
+      if (strcmp(timer.name, name) == 0)
+         totalNs += timer.endNs - timer.startNs;
+   }
+
+   return totalNs / 1000000.0;
+}
+
+const char* GFXDevice::getCommandTypeString(CommandType type)
+{
+   switch (type)
+   {
+   case CommandType::Viewport:
+      return "Viewport";
+   case CommandType::Scissor:
+      return "Scissor";
+   case CommandType::RasterizerState:
+      return "RasterizerState";
+   case CommandType::DepthStencilState:
+      return "DepthStencilState";
+   case CommandType::BlendState:
+      return "BlendState";
+   case CommandType::BindRenderPass:
+      return "BindRenderPass";
+   case CommandType::BindPipeline:
+      return "BindPipeline";
+   case CommandType::BindPushConstants:
+      return "BindPushConstants";
+   case CommandType::BindVertexBuffer:
+      return "BindVertexBuffer";
+   case CommandType::BindVertexBuffers:
+      return "BindVertexBuffers";
+   case CommandType::BindIndexBuffer:
+      return "BindIndexBuffer";
+   case CommandType::BindConstantBuffer:
+      return "BindConstantBuffer";
+   case CommandType::BindStorageBuffer:
+      return "BindStorageBuffer";
+   case CommandType::BindTexture:
+      return "BindTexture";
+   case CommandType::BindTextures:
+      return "BindTextures";
+   case CommandType::BindSampler:
+      return "BindSampler";
+   case CommandType::BindSamplers:
+      return "BindSamplers";
+   case CommandType::BindImage:
+      return "BindImage";
+   case CommandType::DrawPrimitives:
+      return "DrawPrimitives";
+   case CommandType::DrawPrimitivesInstanced:
+      return "DrawPrimitivesInstanced";
+   case CommandType::DrawIndexedPrimitives:
+      return "DrawIndexedPrimitives";
+   case CommandType::DrawIndexedPrimitivesInstanced:
+      return "DrawIndexedPrimitivesInstanced";
+   case CommandType::DrawPrimitivesIndirect:
+      return "DrawPrimitivesIndirect";
+   case CommandType::MultiDrawIndexedPrimitivesIndirectCount:
+      return "MultiDrawIndexedPrimitivesIndirectCount";
+   case CommandType::Dispatch:
+      return "Dispatch";
+   case CommandType::MemoryBarrier:
+      return "MemoryBarrier";
+   case CommandType::BeginTimer:
+      return "BeginTimer";
+   case CommandType::EndTimer:
+      return "EndTimer";
+   case CommandType::End:
+      return "End";
+   }
+
+   return "";
+}
+
+void GFXDevice::_endFrameStats()
+{
+   mCompletedFrameStats = mCurrentFrameStats;
+   mCurrentFrameStats = {};
+}
+
+void GFXDevice::_trackAllocation(GFXMemoryCategory category, size_t size)
+{
+   GFXMemoryCategoryStats& stats = mMemoryStats.categories[(int)category];
+   stats.allocatedBytes += size;
+   stats.allocationCount++;
+   if (stats.allocatedBytes > stats.peakBytes)
+      stats.peakBytes = stats.allocatedBytes;
+
+   mMemoryStats.totalBytes += size;
+   if (mMemoryStats.totalBytes > mMemoryStats.peakBytes)
+      mMemoryStats.peakBytes = mMemoryStats.totalBytes;
+}
+
+void GFXDevice::_trackFree(GFXMemoryCategory category, size_t size)
+{
+   GFXMemoryCategoryStats& stats = mMemoryStats.categories[(int)category];
+#ifdef GFX_DEBUG
+   assert(stats.allocatedBytes >= size && stats.allocationCount > 0);
+#endif
+
+   stats.allocatedBytes -= size;
+   stats.allocationCount--;
+   mMemoryStats.totalBytes -= size;
+}
+
+void GFXDevice::_trackRenderTarget(GFXMemoryCategory& category, size_t size)
+{
+   if (category == GFXMemoryCategory::RENDER_TARGET)
+      return;
+
+   _trackFree(category, size);
+   category = GFXMemoryCategory::RENDER_TARGET;
+   _trackAllocation(category, size);
+}
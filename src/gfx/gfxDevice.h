@@ -1,8 +1,27 @@
 #pragma once
 
+#include <vector>
+#include "gfx/gfxCmdBuffer.h"
 #include "gfx/gfxTypes.h"
 
-class GFXCmdBuffer;
+// Counted as command buffers execute, multi-bind commands count every resource they bind.
+struct GFXFrameStats
+{
+   uint32_t drawCalls;
+   uint32_t indirectDraws; // also counted in drawCalls, their primitives aren't known on the CPU
+   uint32_t dispatches;
+   uint64_t instances;
+   uint64_t primitives;
+   uint32_t renderPassBinds;
+   uint32_t pipelineBinds;
+   uint32_t stateBlockChanges;
+   uint32_t bufferBinds; // vertex, index, constant and storage buffers
+   uint32_t textureBinds;
+   uint32_t samplerBinds;
+   uint64_t bytesMapped;
+   uint64_t bytesUploaded; // buffer and texture contents copied from the CPU
+   uint32_t commandCounts[(int)CommandType::End + 1];
+};
 
 class GFXDevice
 {
@@ -33,12 +52,40 @@ public:
 
    virtual TextureHandle createTexture(const GFXTextureStateDesc& desc) = 0;
    virtual void deleteTexture(TextureHandle handle) = 0;
+   virtual void updateTexture(TextureHandle handle, const GFXTextureUpdateDesc& desc) = 0;
 
    virtual void* mapBuffer(BufferHandle handle, uint32_t offset, uint32_t size) = 0;
    virtual void unmapBuffer(BufferHandle handle) = 0;
 
+   // Waits for every command writing the buffer.
+   virtual void readBuffer(BufferHandle handle, uint32_t offset, uint32_t size, void* outData) = 0;
+
+   // isFenceSignaled() never waits, poll it before a readBuffer() that must not stall.
+   virtual FenceHandle createFence() = 0;
+   virtual void deleteFence(FenceHandle handle) = 0;
+   virtual bool isFenceSignaled(FenceHandle handle) = 0;
+
    virtual void executeCmdBuffers(const GFXCmdBuffer** cmdBuffers, int count) = 0;
-   virtual void present(RenderPassHandle handle, int width, int height) = 0;
+
+   // Stretches sourceWidth x sourceHeight of color attachment 0 over the window, 0 means no scaling.
+   virtual void present(RenderPassHandle handle, int width, int height, int sourceWidth = 0, int sourceHeight = 0) = 0;
+
+   // RGBA8 copy of the rendered area of the last present(), bottom row first like glReadPixels.
+   virtual bool readPresentedImage(std::vector<uint8_t>& outPixels, int& outWidth, int& outHeight) = 0;
+
+   virtual GFXMemoryStats getMemoryStats() const { return mMemoryStats; }
+
+   void resetMemoryPeaks();
+
+   // From the latest frame whose results landed, a few frames behind.
+   inline const std::vector<GFXGpuTimer>& getGpuTimers() const { return mGpuTimers; }
+
+   double getGpuTimerMs(const char* name) const;
+
+   inline const GFXFrameStats& getFrameStats() const { return mCompletedFrameStats; }
+
+   inline void setMemoryBudget(size_t bytes) { mMemoryStats.budgetBytes = bytes; }
+   inline bool isOverMemoryBudget() const { return mMemoryStats.budgetBytes != 0 && mMemoryStats.totalBytes > mMemoryStats.budgetBytes; }
 
    inline const char* getApiString()
    {
@@ -48,8 +95,196 @@ public:
          return "OpenGL";
       case GFXApi::Metal:
          return "Metal";
+      case GFXApi::Software:
+         return "Software";
+      case GFXApi::Null:
+         return "Null";
       }
 
       return "";
    }
+
+   static inline bool isCompressedFormat(GFXTextureInternalFormat format)
+   {
+      return getFormatBlockDimension(format) > 1;
+   }
+
+   // In texels, 1 for uncompressed formats.
+   static inline uint32_t getFormatBlockDimension(GFXTextureInternalFormat format)
+   {
+      switch (format)
+      {
+      case GFXTextureInternalFormat::RGBA8:
+      case GFXTextureInternalFormat::RG16:
+      case GFXTextureInternalFormat::R32F:
+      case GFXTextureInternalFormat::DEPTH_16:
+      case GFXTextureInternalFormat::DEPTH_32F:
+         return 1;
+      default:
+         return 4;
+      }
+   }
+
+   static inline uint32_t getFormatBlockSize(GFXTextureInternalFormat format)
+   {
+      switch (format)
+      {
+      case GFXTextureInternalFormat::RGBA8:
+      case GFXTextureInternalFormat::RG16:
+      case GFXTextureInternalFormat::R32F:
+      case GFXTextureInternalFormat::DEPTH_32F:
+         return 4;
+      case GFXTextureInternalFormat::DEPTH_16:
+         return 2;
+      case GFXTextureInternalFormat::BC1_RGB:
+      case GFXTextureInternalFormat::BC4_R:
+      case GFXTextureInternalFormat::ETC2_RGB8:
+         return 8;
+      case GFXTextureInternalFormat::BC3_RGBA:
+      case GFXTextureInternalFormat::BC5_RG:
+      case GFXTextureInternalFormat::BC7_RGBA:
+      case GFXTextureInternalFormat::ETC2_RGBA8:
+         return 16;
+      }
+
+      return 0;
+   }
+
+   static inline size_t getTextureRegionSize(GFXTextureInternalFormat format, int32_t width, int32_t height, int32_t depth)
+   {
+      const uint32_t blockDimension = getFormatBlockDimension(format);
+      const size_t blocksX = (width + blockDimension - 1) / blockDimension;
+      const size_t blocksY = (height + blockDimension - 1) / blockDimension;
+      return blocksX * blocksY * depth * getFormatBlockSize(format);
+   }
+
+   // depth is the slice count of 3D textures and the layer count of arrays.
+   static inline size_t getTextureMemorySize(GFXTextureType type, GFXTextureInternalFormat format, int32_t width, int32_t height, int32_t depth, int32_t levels)
+   {
+      size_t size = 0;
+      for (int32_t level = 0; level < levels; level++)
+      {
+         const int32_t levelWidth = width >> level > 1 ? width >> level : 1;
+         const int32_t levelHeight = height >> level > 1 ? height >> level : 1;
+
+         switch (type)
+         {
+         case GFXTextureType::TEXTURE_1D:
+            size += getTextureRegionSize(format, levelWidth, 1, 1);
+            break;
+         case GFXTextureType::TEXTURE_2D:
+            size += getTextureRegionSize(format, levelWidth, levelHeight, 1);
+            break;
+         case GFXTextureType::TEXTURE_CUBEMAP:
+            size += getTextureRegionSize(format, levelWidth, levelHeight, 6);
+            break;
+         case GFXTextureType::TEXTURE_3D:
+            size += getTextureRegionSize(format, levelWidth, levelHeight, depth >> level > 1 ? depth >> level : 1);
+            break;
+         case GFXTextureType::TEXTURE_2D_ARRAY:
+            size += getTextureRegionSize(format, levelWidth, levelHeight, depth);
+            break;
+         }
+      }
+
+      return size;
+   }
+
+   static inline uint32_t getPrimitiveCount(GFXPrimitiveType type, uint32_t vertexCount)
+   {
+      switch (type)
+      {
+      case GFXPrimitiveType::TRIANGLE_LIST:
+         return vertexCount / 3;
+      case GFXPrimitiveType::TRIANGLE_STRIP:
+         return vertexCount >= 3 ? vertexCount - 2 : 0;
+      case GFXPrimitiveType::POINT_LIST:
+         return vertexCount;
+      case GFXPrimitiveType::LINE_LIST:
+         return vertexCount / 2;
+      case GFXPrimitiveType::LINE_STRIP:
+         return vertexCount >= 2 ? vertexCount - 1 : 0;
+      }
+
+      return 0;
+   }
+
+   static const char* getCommandTypeString(CommandType type);
+
+   static inline GFXMemoryCategory getBufferMemoryCategory(GFXBufferType type)
+   {
+      switch (type)
+      {
+      case GFXBufferType::VERTEX_BUFFER:
+         return GFXMemoryCategory::VERTEX_BUFFER;
+      case GFXBufferType::INDEX_BUFFER:
+         return GFXMemoryCategory::INDEX_BUFFER;
+      case GFXBufferType::CONSTANT_BUFFER:
+         return GFXMemoryCategory::CONSTANT_BUFFER;
+      case GFXBufferType::STORAGE_BUFFER:
+      case GFXBufferType::INDIRECT_BUFFER:
+         return GFXMemoryCategory::STORAGE_BUFFER;
+      }
+
+      return GFXMemoryCategory::VERTEX_BUFFER;
+   }
+
+   static inline const char* getMemoryCategoryString(GFXMemoryCategory category)
+   {
+      switch (category)
+      {
+      case GFXMemoryCategory::VERTEX_BUFFER:
+         return "Vertex Buffers";
+      case GFXMemoryCategory::INDEX_BUFFER:
+         return "Index Buffers";
+      case GFXMemoryCategory::CONSTANT_BUFFER:
+         return "Constant Buffers";
+      case GFXMemoryCategory::STORAGE_BUFFER:
+         return "Storage Buffers";
+      case GFXMemoryCategory::TEXTURE:
+         return "Textures";
+      case GFXMemoryCategory::RENDER_TARGET:
+         return "Render Targets";
+      case GFXMemoryCategory::STAGING:
+         return "Staging";
+      default:
+         return "";
+      }
+   }
+
+protected:
+   void _trackAllocation(GFXMemoryCategory category, size_t size);
+   void _trackFree(GFXMemoryCategory category, size_t size);
+
+   // Moves a texture attached to a render pass over to RENDER_TARGET, the first time only.
+   void _trackRenderTarget(GFXMemoryCategory& category, size_t size);
+
+   inline void _countDraw(GFXPrimitiveType type, uint32_t vertexCount, uint32_t instanceCount)
+   {
+      mCurrentFrameStats.drawCalls++;
+      mCurrentFrameStats.instances += instanceCount;
+      mCurrentFrameStats.primitives += (uint64_t)getPrimitiveCount(type, vertexCount) * instanceCount;
+   }
+
+   inline void _countIndirectDraw()
+   {
+      mCurrentFrameStats.drawCalls++;
+      mCurrentFrameStats.indirectDraws++;
+   }
+
+   void _endFrameStats();
+
+   GFXMemoryStats mMemoryStats = {};
+
+   // Set by present() for readPresentedImage()
+   struct
+   {
+      RenderPassHandle renderPass = 0;
+      int width = 0;
+      int height = 0;
+   } mPresented;
+   std::vector<GFXGpuTimer> mGpuTimers;
+
+   GFXFrameStats mCurrentFrameStats = {};
+   GFXFrameStats mCompletedFrameStats = {};
 };
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include <math.h>
+#include <algorithm>
+#include "gfx/gfxDynamicResolution.h"
+
+// Aim a little under the budget so small spikes don't drop a frame.
+static const float BUDGET_HEADROOM = 0.9f;
+
+// Inside this band around the goal the scale is left alone, which stops it hunting.
+static const float DEAD_BAND = 0.05f;
+
+// The GPU timings arrive a few frames late, so each frame only moves part of the way
+// towards the scale that would have hit the goal, otherwise the scale keeps overshooting.
+static const float CORRECTION_RATE = 0.15f;
+static const float MAX_SCALE_STEP = 0.05f;
+static const float SMOOTHING = 0.1f;
+
+GFXDynamicResolution::GFXDynamicResolution() :
+   mMaxWidth(1),
+   mMaxHeight(1),
+   mTargetFrameTimeMs(1000.0f / 60.0f),
+   mMinScale(0.5f),
+   mMaxScale(1.0f),
+   mScale(1.0f),
+   mSmoothedFrameTimeMs(0.0f),
+   mEnabled(true)
+{
+}
+
+void GFXDynamicResolution::setMaxSize(int32_t width, int32_t height)
+{
+   mMaxWidth = std::max(width, 1);
+   mMaxHeight = std::max(height, 1);
+}
+
+void GFXDynamicResolution::setTargetFrameTime(float milliseconds)
+{
+   mTargetFrameTimeMs = milliseconds;
+}
+
+void GFXDynamicResolution::setScaleLimits(float minScale, float maxScale)
+{
+   mMinScale = minScale;
+   mMaxScale = maxScale;
+   mScale = std::min(std::max(mScale, mMinScale), mMaxScale);
+}
+
+void GFXDynamicResolution::setEnabled(bool enabled)
+{
+   mEnabled = enabled;
+   if (!mEnabled)
+      mScale = mMaxScale;
+}
+
+void GFXDynamicResolution::update(float gpuFrameTimeMs)
+{
+   if (gpuFrameTimeMs <= 0.0f)
+      return;
+
+   if (mSmoothedFrameTimeMs <= 0.0f)
+      mSmoothedFrameTimeMs = gpuFrameTimeMs;
+   else
+      mSmoothedFrameTimeMs += (gpuFrameTimeMs - mSmoothedFrameTimeMs) * SMOOTHING;
+
+   if (!mEnabled)
+      return;
+
+   const float goal = mTargetFrameTimeMs * BUDGET_HEADROOM;
+   const float ratio = goal / gpuFrameTimeMs;
+   if (fabsf(ratio - 1.0f) < DEAD_BAND)
+      return;
+
+   // GPU time scales with the pixel count, which is the square of the scale.
+   const float desired = mScale * sqrtf(ratio);
+   const float step = std::min(std::max((desired - mScale) * CORRECTION_RATE, -MAX_SCALE_STEP), MAX_SCALE_STEP);
+
+   mScale = std::min(std::max(mScale + step, mMinScale), mMaxScale);
+}
+
+int32_t GFXDynamicResolution::getRenderWidth() const
+{
+   return std::max((int32_t)(mMaxWidth * mScale + 0.5f), 1);
+}
+
+int32_t GFXDynamicResolution::getRenderHeight() const
+{
+   return std::max((int32_t)(mMaxHeight * mScale + 0.5f), 1);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+
+// Scales the rendered area to keep GPU frame time under a budget. Render targets stay
+// allocated at the maximum size and present() stretches the area over the window.
+class GFXDynamicResolution
+{
+public:
+   GFXDynamicResolution();
+
+   void setMaxSize(int32_t width, int32_t height);
+   void setTargetFrameTime(float milliseconds);
+   void setScaleLimits(float minScale, float maxScale);
+
+   void setEnabled(bool enabled);
+   inline bool isEnabled() const { return mEnabled; }
+
+   void update(float gpuFrameTimeMs);
+
+   inline float getScale() const { return mScale; }
+   inline float getTargetFrameTime() const { return mTargetFrameTimeMs; }
+   inline float getSmoothedFrameTime() const { return mSmoothedFrameTimeMs; }
+   inline int32_t getMaxWidth() const { return mMaxWidth; }
+   inline int32_t getMaxHeight() const { return mMaxHeight; }
+   int32_t getRenderWidth() const;
+   int32_t getRenderHeight() const;
+
+private:
+   int32_t mMaxWidth;
+   int32_t mMaxHeight;
+
+   float mTargetFrameTimeMs;
+   float mMinScale;
+   float mMaxScale;
+   float mScale;
+   float mSmoothedFrameTimeMs;
+   bool mEnabled;
+};
@@ -0,0 +1,548 @@
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "gfx/gfxCmdBuffer.h"
+#include "gfx/gfxDevice.h"
+#include "gfx/gfxFrameGraph.h"
+
+static bool isSameRenderPass(const GFXRenderPassDesc& a, const GFXRenderPassDesc& b)
+{
+   if (a.colorAttachmentCount != b.colorAttachmentCount || a.depthAttachmentEnabled != b.depthAttachmentEnabled)
+      return false;
+
+   for (uint32_t i = 0; i < a.colorAttachmentCount; i++)
+   {
+      const GFXColorRenderPassAttachment& colorA = a.colorAttachments[i];
+      const GFXColorRenderPassAttachment& colorB = b.colorAttachments[i];
+
+      if (colorA.texture != colorB.texture || colorA.loadAction != colorB.loadAction)
+         return false;
+      if (memcmp(colorA.clearColor, colorB.clearColor, sizeof(colorA.clearColor)) != 0)
+         return false;
+   }
+
+   if (a.depthAttachmentEnabled)
+   {
+      if (a.depthAttachment.texture != b.depthAttachment.texture || a.depthAttachment.loadAction != b.depthAttachment.loadAction)
+         return false;
+      if (a.depthAttachment.clearDepth != b.depthAttachment.clearDepth)
+         return false;
+   }
+
+   return true;
+}
+
+static bool usesTexture(const GFXRenderPassDesc& desc, TextureHandle texture)
+{
+   for (uint32_t i = 0; i < desc.colorAttachmentCount; i++)
+   {
+      if (desc.colorAttachments[i].texture == texture)
+         return true;
+   }
+
+   return desc.depthAttachmentEnabled && desc.depthAttachment.texture == texture;
+}
+
+FrameGraphResource FrameGraphBuilder::createTexture(const char* name, const FrameGraphTextureDesc& desc)
+{
+   GFXFrameGraph::VirtualTexture texture = {};
+   texture.name = name;
+   texture.desc = desc;
+   texture.imported = false;
+   texture.physicalIndex = GFXFrameGraph::NO_TEXTURE;
+   texture.firstPass = GFXFrameGraph::NO_PASS;
+
+   mGraph->mTextures.push_back(std::move(texture));
+   return mGraph->_createNode((uint32_t)mGraph->mTextures.size() - 1, 0, GFXFrameGraph::NO_PASS);
+}
+
+FrameGraphResource FrameGraphBuilder::read(FrameGraphResource resource)
+{
+   mGraph->mPasses[mPassIndex].reads.push_back(resource);
+   return resource;
+}
+
+FrameGraphResource FrameGraphBuilder::writeColor(uint32_t index, FrameGraphResource resource, GFXLoadAttachmentAction loadAction, const float clearColor[4])
+{
+   if (index >= MAX_COLOR_ATTACHMENTS)
+      abort();
+
+   FrameGraphResource written = _write(resource, loadAction);
+
+   GFXFrameGraph::Pass& pass = mGraph->mPasses[mPassIndex];
+   pass.colorAttachments[index] = written;
+   pass.renderPassDesc.colorAttachments[index].loadAction = loadAction;
+   if (clearColor != nullptr)
+      memcpy(pass.renderPassDesc.colorAttachments[index].clearColor, clearColor, sizeof(float) * 4);
+   pass.renderPassDesc.colorAttachmentCount = std::max(pass.renderPassDesc.colorAttachmentCount, index + 1);
+
+   return written;
+}
+
+FrameGraphResource FrameGraphBuilder::writeDepth(FrameGraphResource resource, GFXLoadAttachmentAction loadAction, float clearDepth)
+{
+   FrameGraphResource written = _write(resource, loadAction);
+
+   GFXFrameGraph::Pass& pass = mGraph->mPasses[mPassIndex];
+   pass.depthAttachment = written;
+   pass.renderPassDesc.depthAttachmentEnabled = true;
+   pass.renderPassDesc.depthAttachment.loadAction = loadAction;
+   pass.renderPassDesc.depthAttachment.clearDepth = clearDepth;
+
+   return written;
+}
+
+void FrameGraphBuilder::setRenderArea(int32_t width, int32_t height)
+{
+   GFXFrameGraph::Pass& pass = mGraph->mPasses[mPassIndex];
+   pass.renderAreaWidth = width;
+   pass.renderAreaHeight = height;
+}
+
+void FrameGraphBuilder::setSideEffect()
+{
+   mGraph->mPasses[mPassIndex].sideEffect = true;
+}
+
+FrameGraphResource FrameGraphBuilder::_write(FrameGraphResource resource, GFXLoadAttachmentAction loadAction)
+{
+   const uint32_t textureIndex = mGraph->mNodes[resource].texture;
+   GFXFrameGraph::VirtualTexture& texture = mGraph->mTextures[textureIndex];
+
+   // Only the newest version of a resource can be written, otherwise passes could not be ordered.
+   if (mGraph->mNodes[resource].version != texture.version)
+      abort();
+
+   if (loadAction == GFXLoadAttachmentAction::LOAD)
+      mGraph->mPasses[mPassIndex].loads.push_back(resource);
+
+   texture.version++;
+   FrameGraphResource written = mGraph->_createNode(textureIndex, texture.version, mPassIndex);
+   mGraph->mPasses[mPassIndex].writes.push_back(written);
+
+   return written;
+}
+
+GFXFrameGraph::GFXFrameGraph(GFXDevice* device) :
+   mDevice(device),
+   mFrame(0)
+{
+   mStats = {};
+}
+
+GFXFrameGraph::~GFXFrameGraph()
+{
+   for (const CachedRenderPass& cached : mRenderPassCache)
+      mDevice->deleteRenderPass(cached.renderPass);
+
+   for (const PhysicalTexture& physical : mTexturePool)
+      mDevice->deleteTexture(physical.texture);
+}
+
+void GFXFrameGraph::reset()
+{
+   mTextures.clear();
+   mNodes.clear();
+   mPasses.clear();
+
+   mFrame++;
+   _retireUnusedResources();
+
+   for (PhysicalTexture& physical : mTexturePool)
+      physical.inUse = false;
+}
+
+FrameGraphResource GFXFrameGraph::importTexture(const char* name, TextureHandle texture, const FrameGraphTextureDesc& desc)
+{
+   VirtualTexture imported = {};
+   imported.name = name;
+   imported.desc = desc;
+   imported.imported = true;
+   imported.texture = texture;
+   imported.physicalIndex = NO_TEXTURE;
+   imported.firstPass = NO_PASS;
+
+   mTextures.push_back(std::move(imported));
+   return _createNode((uint32_t)mTextures.size() - 1, 0, NO_PASS);
+}
+
+void GFXFrameGraph::addPass(const char* name, const SetupFunc& setup, const ExecuteFunc& execute)
+{
+   Pass pass;
+   pass.name = name;
+   pass.execute = execute;
+   for (uint32_t i = 0; i < MAX_COLOR_ATTACHMENTS; i++)
+      pass.colorAttachments[i] = INVALID_FRAME_GRAPH_RESOURCE;
+   pass.depthAttachment = INVALID_FRAME_GRAPH_RESOURCE;
+   pass.renderPass = 0;
+   pass.width = 0;
+   pass.height = 0;
+   pass.renderAreaWidth = 0;
+   pass.renderAreaHeight = 0;
+   pass.refCount = 0;
+   pass.sideEffect = false;
+   pass.culled = false;
+
+   mPasses.push_back(std::move(pass));
+
+   FrameGraphBuilder builder(this, (uint32_t)mPasses.size() - 1);
+   setup(builder);
+}
+
+void GFXFrameGraph::markOutput(FrameGraphResource resource)
+{
+   mNodes[resource].refCount++;
+   mTextures[mNodes[resource].texture].output = true;
+}
+
+void GFXFrameGraph::compile()
+{
+   _cullPasses();
+   _computeLifetimes();
+   _allocateTextures();
+   _resolveRenderPasses();
+
+   mStats.passCount = (uint32_t)mPasses.size();
+   mStats.culledPassCount = 0;
+   for (const Pass& pass : mPasses)
+   {
+      if (pass.culled)
+         mStats.culledPassCount++;
+   }
+
+   mStats.transientTextureCount = 0;
+   mStats.unaliasedRenderTargetBytes = 0;
+   for (const VirtualTexture& texture : mTextures)
+   {
+      if (!texture.imported && texture.firstPass != NO_PASS)
+      {
+         mStats.transientTextureCount++;
+         mStats.unaliasedRenderTargetBytes += GFXDevice::getTextureRegionSize(texture.desc.format, texture.desc.width, texture.desc.height, 1);
+      }
+   }
+
+   mStats.physicalTextureCount = 0;
+   mStats.pooledRenderTargetBytes = 0;
+   for (const PhysicalTexture& physical : mTexturePool)
+   {
+      if (physical.lastUsedFrame == mFrame)
+         mStats.physicalTextureCount++;
+      mStats.pooledRenderTargetBytes += physical.sizeInBytes;
+   }
+
+   mStats.renderPassCacheSize = (uint32_t)mRenderPassCache.size();
+}
+
+void GFXFrameGraph::execute(GFXCmdBuffer* cmdBuffer)
+{
+   for (const Pass& pass : mPasses)
+   {
+      if (pass.culled)
+         continue;
+
+      cmdBuffer->beginTimer(pass.name.c_str());
+
+      if (pass.renderPassDesc.colorAttachmentCount > 0 || pass.renderPassDesc.depthAttachmentEnabled)
+      {
+         // Clears happen when the render pass is bound and are clipped by the scissor.
+         cmdBuffer->setViewport(0, 0, pass.width, pass.height);
+         cmdBuffer->setScissor(0, 0, pass.width, pass.height);
+         cmdBuffer->bindRenderPass(pass.renderPass);
+      }
+
+      pass.execute(cmdBuffer, *this);
+
+      cmdBuffer->endTimer();
+   }
+}
+
+TextureHandle GFXFrameGraph::getTexture(FrameGraphResource resource) const
+{
+   return mTextures[mNodes[resource].texture].texture;
+}
+
+RenderPassHandle GFXFrameGraph::getRenderPass(FrameGraphResource resource) const
+{
+   const uint32_t producer = mNodes[resource].producer;
+   if (producer == NO_PASS)
+      abort();
+
+   return mPasses[producer].renderPass;
+}
+
+FrameGraphResource GFXFrameGraph::_createNode(uint32_t texture, uint32_t version, uint32_t producer)
+{
+   ResourceNode node;
+   node.texture = texture;
+   node.version = version;
+   node.producer = producer;
+   node.refCount = 0;
+
+   mNodes.push_back(node);
+   return (FrameGraphResource)mNodes.size() - 1;
+}
+
+void GFXFrameGraph::_cullPasses()
+{
+   for (Pass& pass : mPasses)
+   {
+      pass.refCount = (uint32_t)pass.writes.size();
+
+      for (FrameGraphResource resource : pass.reads)
+         mNodes[resource].refCount++;
+      for (FrameGraphResource resource : pass.loads)
+         mNodes[resource].refCount++;
+   }
+
+   std::vector<FrameGraphResource> unreferenced;
+   for (uint32_t i = 0; i < mNodes.size(); i++)
+   {
+      if (mNodes[i].refCount == 0)
+         unreferenced.push_back(i);
+   }
+
+   auto cullPass = [&](Pass& pass)
+   {
+      pass.culled = true;
+
+      for (FrameGraphResource resource : pass.reads)
+      {
+         if (--mNodes[resource].refCount == 0)
+            unreferenced.push_back(resource);
+      }
+      for (FrameGraphResource resource : pass.loads)
+      {
+         if (--mNodes[resource].refCount == 0)
+            unreferenced.push_back(resource);
+      }
+   };
+
+   // Passes that write nothing can only be kept by a side effect.
+   for (Pass& pass : mPasses)
+   {
+      if (pass.refCount == 0 && !pass.sideEffect)
+         cullPass(pass);
+   }
+
+   while (!unreferenced.empty())
+   {
+      const ResourceNode& node = mNodes[unreferenced.back()];
+      unreferenced.pop_back();
+
+      if (node.producer == NO_PASS)
+         continue;
+
+      Pass& producer = mPasses[node.producer];
+      if (producer.sideEffect || producer.culled)
+         continue;
+
+      if (--producer.refCount == 0)
+         cullPass(producer);
+   }
+}
+
+void GFXFrameGraph::_computeLifetimes()
+{
+   for (uint32_t i = 0; i < mPasses.size(); i++)
+   {
+      const Pass& pass = mPasses[i];
+      if (pass.culled)
+         continue;
+
+      auto touch = [&](FrameGraphResource resource)
+      {
+         VirtualTexture& texture = mTextures[mNodes[resource].texture];
+         if (texture.firstPass == NO_PASS)
+            texture.firstPass = i;
+         texture.lastPass = i;
+      };
+
+      for (FrameGraphResource resource : pass.reads)
+         touch(resource);
+      for (FrameGraphResource resource : pass.loads)
+         touch(resource);
+      for (FrameGraphResource resource : pass.writes)
+         touch(resource);
+   }
+
+   for (uint32_t i = 0; i < mTextures.size(); i++)
+   {
+      const VirtualTexture& texture = mTextures[i];
+      if (texture.imported || texture.firstPass == NO_PASS)
+         continue;
+
+      mPasses[texture.firstPass].acquires.push_back(i);
+
+      // Outputs are still needed after the last pass (to present), so they are never handed back.
+      if (!texture.output)
+         mPasses[texture.lastPass].releases.push_back(i);
+   }
+}
+
+void GFXFrameGraph::_allocateTextures()
+{
+   size_t liveBytes = 0;
+   mStats.peakRenderTargetBytes = 0;
+
+   for (Pass& pass : mPasses)
+   {
+      if (pass.culled)
+         continue;
+
+      for (uint32_t index : pass.acquires)
+      {
+         VirtualTexture& texture = mTextures[index];
+         texture.physicalIndex = _acquirePhysicalTexture(texture.desc);
+
+         const PhysicalTexture& physical = mTexturePool[texture.physicalIndex];
+         texture.texture = physical.texture;
+
+         liveBytes += physical.sizeInBytes;
+      }
+
+      mStats.peakRenderTargetBytes = std::max(mStats.peakRenderTargetBytes, liveBytes);
+
+      // Released textures can be picked up by the very next pass.
+      for (uint32_t index : pass.releases)
+      {
+         const VirtualTexture& texture = mTextures[index];
+         PhysicalTexture& physical = mTexturePool[texture.physicalIndex];
+         physical.inUse = false;
+
+         liveBytes -= physical.sizeInBytes;
+      }
+   }
+}
+
+void GFXFrameGraph::_resolveRenderPasses()
+{
+   for (Pass& pass : mPasses)
+   {
+      if (pass.culled)
+         continue;
+
+      GFXRenderPassDesc& desc = pass.renderPassDesc;
+      if (desc.colorAttachmentCount == 0 && !desc.depthAttachmentEnabled)
+         continue;
+
+      const FrameGraphTextureDesc* size = nullptr;
+      for (uint32_t i = 0; i < desc.colorAttachmentCount; i++)
+      {
+         // Attachment slots have to be filled in without gaps.
+         if (pass.colorAttachments[i] == INVALID_FRAME_GRAPH_RESOURCE)
+            abort();
+
+         const VirtualTexture& texture = mTextures[mNodes[pass.colorAttachments[i]].texture];
+         desc.colorAttachments[i].texture = texture.texture;
+         size = &texture.desc;
+      }
+
+      if (desc.depthAttachmentEnabled)
+      {
+         const VirtualTexture& texture = mTextures[mNodes[pass.depthAttachment].texture];
+         desc.depthAttachment.texture = texture.texture;
+         size = &texture.desc;
+      }
+
+      pass.width = pass.renderAreaWidth > 0 ? std::min(pass.renderAreaWidth, size->width) : size->width;
+      pass.height = pass.renderAreaHeight > 0 ? std::min(pass.renderAreaHeight, size->height) : size->height;
+      pass.renderPass = _getCachedRenderPass(desc);
+   }
+}
+
+uint32_t GFXFrameGraph::_acquirePhysicalTexture(const FrameGraphTextureDesc& desc)
+{
+   for (uint32_t i = 0; i < mTexturePool.size(); i++)
+   {
+      PhysicalTexture& physical = mTexturePool[i];
+      if (physical.inUse)
+         continue;
+
+      if (physical.desc.format == desc.format && physical.desc.width == desc.width && physical.desc.height == desc.height)
+      {
+         physical.inUse = true;
+         physical.lastUsedFrame = mFrame;
+         return i;
+      }
+   }
+
+   GFXTextureStateDesc textureDesc = {};
+   textureDesc.type = GFXTextureType::TEXTURE_2D;
+   textureDesc.internalFormat = desc.format;
+   textureDesc.levels = 1;
+   textureDesc.width = desc.width;
+   textureDesc.height = desc.height;
+
+   PhysicalTexture physical;
+   physical.desc = desc;
+   physical.texture = mDevice->createTexture(textureDesc);
+   physical.sizeInBytes = GFXDevice::getTextureRegionSize(desc.format, desc.width, desc.height, 1);
+   physical.lastUsedFrame = mFrame;
+   physical.inUse = true;
+
+   mTexturePool.push_back(physical);
+   return (uint32_t)mTexturePool.size() - 1;
+}
+
+RenderPassHandle GFXFrameGraph::_getCachedRenderPass(const GFXRenderPassDesc& desc)
+{
+   for (CachedRenderPass& cached : mRenderPassCache)
+   {
+      if (isSameRenderPass(cached.desc, desc))
+      {
+         cached.lastUsedFrame = mFrame;
+         return cached.renderPass;
+      }
+   }
+
+   CachedRenderPass cached;
+   cached.desc = desc;
+   cached.renderPass = mDevice->createRenderPass(desc);
+   cached.lastUsedFrame = mFrame;
+
+   mRenderPassCache.push_back(cached);
+   return cached.renderPass;
+}
+
+void GFXFrameGraph::_retireUnusedResources()
+{
+   for (size_t i = 0; i < mRenderPassCache.size();)
+   {
+      if (mFrame - mRenderPassCache[i].lastUsedFrame > POOL_RETIRE_FRAMES)
+      {
+         mDevice->deleteRenderPass(mRenderPassCache[i].renderPass);
+         mRenderPassCache.erase(mRenderPassCache.begin() + i);
+      }
+      else
+      {
+         i++;
+      }
+   }
+
+   for (size_t i = 0; i < mTexturePool.size();)
+   {
+      if (mFrame - mTexturePool[i].lastUsedFrame <= POOL_RETIRE_FRAMES)
+      {
+         i++;
+         continue;
+      }
+
+      // Any render pass still pointing at the texture goes with it.
+      const TextureHandle texture = mTexturePool[i].texture;
+      for (size_t j = 0; j < mRenderPassCache.size();)
+      {
+         if (usesTexture(mRenderPassCache[j].desc, texture))
+         {
+            mDevice->deleteRenderPass(mRenderPassCache[j].renderPass);
+            mRenderPassCache.erase(mRenderPassCache.begin() + j);
+         }
+         else
+         {
+            j++;
+         }
+      }
+
+      mDevice->deleteTexture(texture);
+      mTexturePool.erase(mTexturePool.begin() + i);
+   }
+}
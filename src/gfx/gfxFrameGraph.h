@@ -0,0 +1,192 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include "gfx/gfxTypes.h"
+
+class GFXCmdBuffer;
+class GFXDevice;
+class GFXFrameGraph;
+
+typedef uint32_t FrameGraphResource;
+
+#define INVALID_FRAME_GRAPH_RESOURCE 0xFFFFFFFF
+
+struct FrameGraphTextureDesc
+{
+   GFXTextureInternalFormat format;
+   int32_t width;
+   int32_t height;
+};
+
+struct FrameGraphStats
+{
+   uint32_t passCount;
+   uint32_t culledPassCount;
+   uint32_t transientTextureCount;
+   uint32_t physicalTextureCount; // textures actually backing the transient ones this frame
+   uint32_t renderPassCacheSize;
+
+   // Largest amount of transient render target memory alive at any point of the frame,
+   // against what it would take if every transient texture had its own allocation.
+   size_t peakRenderTargetBytes;
+   size_t unaliasedRenderTargetBytes;
+   size_t pooledRenderTargetBytes;
+};
+
+// Writing a resource returns a new version, later passes use it to be ordered after the write.
+class FrameGraphBuilder
+{
+   friend class GFXFrameGraph;
+public:
+   FrameGraphResource createTexture(const char* name, const FrameGraphTextureDesc& desc);
+
+   FrameGraphResource read(FrameGraphResource resource);
+
+   // LOAD also depends on the pass that wrote the previous contents.
+   FrameGraphResource writeColor(uint32_t index, FrameGraphResource resource, GFXLoadAttachmentAction loadAction, const float clearColor[4] = nullptr);
+   FrameGraphResource writeDepth(FrameGraphResource resource, GFXLoadAttachmentAction loadAction, float clearDepth = 1.0f);
+
+   // Limits viewport, scissor and clears to the bottom left of the attachments.
+   void setRenderArea(int32_t width, int32_t height);
+
+   // Never culled.
+   void setSideEffect();
+
+private:
+   FrameGraphBuilder(GFXFrameGraph* graph, uint32_t passIndex) : mGraph(graph), mPassIndex(passIndex) {}
+
+   FrameGraphResource _write(FrameGraphResource resource, GFXLoadAttachmentAction loadAction);
+
+   GFXFrameGraph* mGraph;
+   uint32_t mPassIndex;
+};
+
+// Rebuilt every frame. Compiling culls unused passes and pools transient textures with
+// non overlapping lifetimes. No barriers are issued, GL orders framebuffer writes before
+// later sampling, only image stores need one.
+class GFXFrameGraph
+{
+   friend class FrameGraphBuilder;
+public:
+   typedef std::function<void(FrameGraphBuilder& builder)> SetupFunc;
+   typedef std::function<void(GFXCmdBuffer* cmdBuffer, const GFXFrameGraph& graph)> ExecuteFunc;
+
+   explicit GFXFrameGraph(GFXDevice* device);
+   ~GFXFrameGraph();
+
+   // Frees pooled textures unused for a few frames.
+   void reset();
+
+   FrameGraphResource importTexture(const char* name, TextureHandle texture, const FrameGraphTextureDesc& desc);
+   void addPass(const char* name, const SetupFunc& setup, const ExecuteFunc& execute);
+
+   void markOutput(FrameGraphResource resource);
+
+   void compile();
+
+   // Every pass is wrapped in a GPU timer named after it.
+   void execute(GFXCmdBuffer* cmdBuffer);
+
+   TextureHandle getTexture(FrameGraphResource resource) const;
+
+   // For presenting.
+   RenderPassHandle getRenderPass(FrameGraphResource resource) const;
+
+   inline const FrameGraphStats& getStats() const { return mStats; }
+
+private:
+   enum
+   {
+      POOL_RETIRE_FRAMES = 8,
+      NO_PASS = 0xFFFFFFFF,
+      NO_TEXTURE = 0xFFFFFFFF
+   };
+
+   struct VirtualTexture
+   {
+      std::string name;
+      FrameGraphTextureDesc desc;
+      bool imported;
+      TextureHandle texture;
+      uint32_t physicalIndex;
+      uint32_t version;
+      bool output;
+      uint32_t firstPass;
+      uint32_t lastPass;
+   };
+
+   struct ResourceNode
+   {
+      uint32_t texture;
+      uint32_t version;
+      uint32_t producer;
+      uint32_t refCount;
+   };
+
+   struct Pass
+   {
+      std::string name;
+      ExecuteFunc execute;
+
+      std::vector<FrameGraphResource> reads; // sampled
+      std::vector<FrameGraphResource> loads; // previous contents of attachments kept
+      std::vector<FrameGraphResource> writes;
+
+      FrameGraphResource colorAttachments[MAX_COLOR_ATTACHMENTS];
+      FrameGraphResource depthAttachment;
+      GFXRenderPassDesc renderPassDesc;
+      RenderPassHandle renderPass;
+      int32_t width;
+      int32_t height;
+      int32_t renderAreaWidth;
+      int32_t renderAreaHeight;
+
+      uint32_t refCount;
+      bool sideEffect;
+      bool culled;
+
+      std::vector<uint32_t> acquires;
+      std::vector<uint32_t> releases;
+   };
+
+   struct PhysicalTexture
+   {
+      FrameGraphTextureDesc desc;
+      TextureHandle texture;
+      size_t sizeInBytes;
+      uint64_t lastUsedFrame;
+      bool inUse;
+   };
+
+   struct CachedRenderPass
+   {
+      GFXRenderPassDesc desc;
+      RenderPassHandle renderPass;
+      uint64_t lastUsedFrame;
+   };
+
+   FrameGraphResource _createNode(uint32_t texture, uint32_t version, uint32_t producer);
+   void _cullPasses();
+   void _computeLifetimes();
+   void _allocateTextures();
+   void _resolveRenderPasses();
+
+   uint32_t _acquirePhysicalTexture(const FrameGraphTextureDesc& desc);
+   RenderPassHandle _getCachedRenderPass(const GFXRenderPassDesc& desc);
+   void _retireUnusedResources();
+
+   GFXDevice* mDevice;
+   uint64_t mFrame;
+
+   std::vector<VirtualTexture> mTextures;
+   std::vector<ResourceNode> mNodes;
+   std::vector<Pass> mPasses;
+
+   std::vector<PhysicalTexture> mTexturePool;
+   std::vector<CachedRenderPass> mRenderPassCache;
+
+   FrameGraphStats mStats;
+};
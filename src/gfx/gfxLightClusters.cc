@@ -0,0 +1,227 @@
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "gfx/gfxLightClusters.h"
+
+static const uint32_t TILES_PER_SLICE = GFXLightClusters::TILE_COUNT_X * GFXLightClusters::TILE_COUNT_Y;
+
+// Keeps slopes finite for lights reaching behind the camera.
+static const float MIN_DEPTH = 0.0001f;
+
+// Slices are widened by this fraction, shaders compute the slice of a fragment with a log that
+// may round the other way right at a boundary.
+static const float SLICE_PADDING = 0.001f;
+
+// Tiles a box of center +- radius along one view axis covers between nearDepth and farDepth.
+// Its slope over depth is steepest at the near depth when that side points outwards and at the
+// far depth when it points inwards.
+static bool getTileRange(float center, float radius, float nearDepth, float farDepth, float projectionScale, uint32_t tileCount,
+   uint8_t& outFirst, uint8_t& outLast)
+{
+   const float low = center - radius;
+   const float high = center + radius;
+   const float minNdc = low / (low < 0.0f ? nearDepth : farDepth) * projectionScale;
+   const float maxNdc = high / (high > 0.0f ? nearDepth : farDepth) * projectionScale;
+   if (maxNdc < -1.0f || minNdc > 1.0f)
+      return false;
+
+   const float tileScale = tileCount * 0.5f;
+   const float lastTile = (float)(tileCount - 1);
+   outFirst = (uint8_t)std::min(std::max((minNdc + 1.0f) * tileScale, 0.0f), lastTile);
+   outLast = (uint8_t)std::min(std::max((maxNdc + 1.0f) * tileScale, 0.0f), lastTile);
+   return true;
+}
+
+GFXLightClusters::GFXLightClusters() :
+   mProjectionScale(1.0f),
+   mNearDistance(1.0f),
+   mFarDistance(100.0f),
+   mSliceScale(1.0f),
+   mSliceBias(0.0f),
+   mIndexCount(0)
+{
+   memset(mSliceOffsets, 0, sizeof(mSliceOffsets));
+   memset(mSliceLightOffsets, 0, sizeof(mSliceLightOffsets));
+   for (std::vector<uint32_t>& clusters : mSliceClusters)
+      clusters.assign(TILES_PER_SLICE * 2, 0);
+}
+
+void GFXLightClusters::setProjection(const glm::mat4& projMatrix, float nearDistance, float farDistance)
+{
+   mProjectionScale = glm::vec2(projMatrix[0][0], projMatrix[1][1]);
+   mNearDistance = nearDistance;
+   mFarDistance = std::max(farDistance, nearDistance * 2.0f);
+
+   // Slice 1 + floor(log(depth) * scale + bias) for depths past the first slice.
+   mSliceScale = (SLICE_COUNT - 1) / logf(mFarDistance / mNearDistance);
+   mSliceBias = -logf(mNearDistance) * mSliceScale;
+}
+
+void GFXLightClusters::build(JobSystem& jobSystem, const glm::mat4& viewMatrix, const glm::vec4* spheres, uint32_t count)
+{
+   mViewSpheres.resize(count);
+   mLightSlices.resize(count);
+
+   // Bucket the lights by the slices their depth range reaches, so each slice job only tests
+   // the few lights near it. Lights entirely behind the camera or past the far distance reach
+   // none, first slice > last slice.
+   uint32_t sliceCounts[SLICE_COUNT] = {};
+   for (uint32_t i = 0; i < count; i++)
+   {
+      const glm::vec4 sphere = glm::vec4(glm::vec3(viewMatrix * glm::vec4(glm::vec3(spheres[i]), 1.0f)), spheres[i].w);
+      mViewSpheres[i] = sphere;
+
+      const float depth = -sphere.z;
+      uint32_t firstSlice = 1;
+      uint32_t lastSlice = 0;
+      if (depth + sphere.w > 0.0f && depth - sphere.w < mFarDistance)
+      {
+         firstSlice = _getSlice((depth - sphere.w) * (1.0f - SLICE_PADDING * 2.0f));
+         lastSlice = _getSlice((depth + sphere.w) * (1.0f + SLICE_PADDING * 2.0f));
+         for (uint32_t slice = firstSlice; slice <= lastSlice; slice++)
+            sliceCounts[slice]++;
+      }
+
+      mLightSlices[i] = firstSlice | (lastSlice << 16);
+   }
+
+   uint32_t sliceLightCount = 0;
+   for (uint32_t slice = 0; slice < SLICE_COUNT; slice++)
+   {
+      mSliceLightOffsets[slice] = sliceLightCount;
+      sliceLightCount += sliceCounts[slice];
+      sliceCounts[slice] = mSliceLightOffsets[slice];
+   }
+   mSliceLightOffsets[SLICE_COUNT] = sliceLightCount;
+
+   mSliceLights.resize(sliceLightCount);
+   for (uint32_t i = 0; i < count; i++)
+   {
+      const uint32_t lastSlice = mLightSlices[i] >> 16;
+      for (uint32_t slice = mLightSlices[i] & 0xffff; slice <= lastSlice; slice++)
+         mSliceLights[sliceCounts[slice]++] = i;
+   }
+
+   jobSystem.parallelFor(SLICE_COUNT, 1, [&](uint32_t start, uint32_t end, uint32_t threadIndex)
+   {
+      for (uint32_t slice = start; slice < end; slice++)
+         _buildSlice(slice);
+   });
+
+   mIndexCount = 0;
+   for (uint32_t slice = 0; slice < SLICE_COUNT; slice++)
+   {
+      mSliceOffsets[slice] = mIndexCount;
+      mIndexCount += (uint32_t)mSliceIndices[slice].size();
+   }
+}
+
+void GFXLightClusters::writeClusters(uint32_t* outClusters) const
+{
+   for (uint32_t slice = 0; slice < SLICE_COUNT; slice++)
+   {
+      const std::vector<uint32_t>& clusters = mSliceClusters[slice];
+      uint32_t* out = outClusters + slice * TILES_PER_SLICE * 2;
+      for (uint32_t i = 0; i < TILES_PER_SLICE; i++)
+      {
+         out[i * 2] = mSliceOffsets[slice] + clusters[i * 2];
+         out[i * 2 + 1] = clusters[i * 2 + 1];
+      }
+   }
+}
+
+void GFXLightClusters::writeIndices(uint32_t* outIndices) const
+{
+   for (uint32_t slice = 0; slice < SLICE_COUNT; slice++)
+   {
+      const std::vector<uint32_t>& indices = mSliceIndices[slice];
+      if (!indices.empty())
+         memcpy(outIndices + mSliceOffsets[slice], indices.data(), indices.size() * sizeof(uint32_t));
+   }
+}
+
+GFXLightClusterParams GFXLightClusters::getParams(int32_t renderWidth, int32_t renderHeight) const
+{
+   GFXLightClusterParams params;
+   params.tileSlice = glm::vec4((float)TILE_COUNT_X / std::max(renderWidth, 1), (float)TILE_COUNT_Y / std::max(renderHeight, 1),
+      mSliceScale, mSliceBias);
+   params.projection = glm::vec4(mProjectionScale, mNearDistance, mFarDistance);
+   return params;
+}
+
+void GFXLightClusters::_buildSlice(uint32_t slice)
+{
+   const float sliceStart = _getSliceStart(slice) * (1.0f - SLICE_PADDING);
+   const float sliceEnd = _getSliceStart(slice + 1) * (1.0f + SLICE_PADDING);
+
+   std::vector<LightRect>& rects = mSliceRects[slice];
+   std::vector<uint32_t>& clusters = mSliceClusters[slice];
+   std::vector<uint32_t>& indices = mSliceIndices[slice];
+   rects.clear();
+   clusters.assign(TILES_PER_SLICE * 2, 0);
+
+   // Count the lights of every cluster first, clusters[i * 2 + 1].
+   for (uint32_t lightIndex = mSliceLightOffsets[slice]; lightIndex < mSliceLightOffsets[slice + 1]; lightIndex++)
+   {
+      const uint32_t light = mSliceLights[lightIndex];
+      const glm::vec4& sphere = mViewSpheres[light];
+      const float depth = -sphere.z;
+      const float nearDepth = std::max(std::max(depth - sphere.w, sliceStart), MIN_DEPTH);
+      const float farDepth = std::min(depth + sphere.w, sliceEnd);
+      if (nearDepth > farDepth)
+         continue;
+
+      LightRect rect;
+      rect.light = light;
+      if (!getTileRange(sphere.x, sphere.w, nearDepth, farDepth, mProjectionScale.x, TILE_COUNT_X, rect.firstTileX, rect.lastTileX) ||
+         !getTileRange(sphere.y, sphere.w, nearDepth, farDepth, mProjectionScale.y, TILE_COUNT_Y, rect.firstTileY, rect.lastTileY))
+         continue;
+
+      rects.push_back(rect);
+      for (uint32_t y = rect.firstTileY; y <= rect.lastTileY; y++)
+         for (uint32_t x = rect.firstTileX; x <= rect.lastTileX; x++)
+            clusters[(y * TILE_COUNT_X + x) * 2 + 1]++;
+   }
+
+   // Then hand out offsets and use the counts as fill cursors.
+   uint32_t offset = 0;
+   for (uint32_t i = 0; i < TILES_PER_SLICE; i++)
+   {
+      const uint32_t count = std::min(clusters[i * 2 + 1], MAX_LIGHTS_PER_CLUSTER);
+      clusters[i * 2] = offset;
+      clusters[i * 2 + 1] = 0;
+      offset += count;
+   }
+
+   indices.resize(offset);
+   for (const LightRect& rect : rects)
+   {
+      for (uint32_t y = rect.firstTileY; y <= rect.lastTileY; y++)
+      {
+         for (uint32_t x = rect.firstTileX; x <= rect.lastTileX; x++)
+         {
+            uint32_t* cluster = &clusters[(y * TILE_COUNT_X + x) * 2];
+            if (cluster[1] < MAX_LIGHTS_PER_CLUSTER)
+               indices[cluster[0] + cluster[1]++] = rect.light;
+         }
+      }
+   }
+}
+
+uint32_t GFXLightClusters::_getSlice(float depth) const
+{
+   if (depth < mNearDistance)
+      return 0;
+
+   return std::min(1 + (uint32_t)std::max(logf(depth) * mSliceScale + mSliceBias, 0.0f), SLICE_COUNT - 1);
+}
+
+float GFXLightClusters::_getSliceStart(uint32_t slice) const
+{
+   if (slice == 0)
+      return 0.0f;
+   if (slice >= SLICE_COUNT)
+      return mFarDistance;
+
+   return mNearDistance * powf(mFarDistance / mNearDistance, (float)(slice - 1) / (SLICE_COUNT - 1));
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <glm/glm.hpp>
+#include "core/jobSystem.h"
+
+// Matches ClusterParams in the shaders, std140.
+struct GFXLightClusterParams
+{
+   glm::vec4 tileSlice; // tiles per pixel in x and y, slice scale and bias applied to log(depth)
+   glm::vec4 projection; // projection x and y scale, first slice end, last slice end
+};
+
+// Bins light spheres into screen tiles times exponential depth slices, one job per slice.
+class GFXLightClusters
+{
+public:
+   static const uint32_t TILE_COUNT_X = 16;
+   static const uint32_t TILE_COUNT_Y = 9;
+   static const uint32_t SLICE_COUNT = 24;
+   static const uint32_t CLUSTER_COUNT = TILE_COUNT_X * TILE_COUNT_Y * SLICE_COUNT;
+
+   // Lights past this many in one cluster are dropped.
+   static const uint32_t MAX_LIGHTS_PER_CLUSTER = 256;
+
+   GFXLightClusters();
+
+   // projMatrix must be a symmetric perspective projection.
+   void setProjection(const glm::mat4& projMatrix, float nearDistance, float farDistance);
+
+   // World space position in xyz and radius in w. Conservative.
+   void build(JobSystem& jobSystem, const glm::mat4& viewMatrix, const glm::vec4* spheres, uint32_t count);
+
+   inline uint32_t getIndexCount() const { return mIndexCount; }
+
+   // Index list offset and light count per cluster, x first, then y, then slice.
+   void writeClusters(uint32_t* outClusters) const;
+
+   void writeIndices(uint32_t* outIndices) const;
+
+   GFXLightClusterParams getParams(int32_t renderWidth, int32_t renderHeight) const;
+
+private:
+   struct LightRect
+   {
+      uint32_t light;
+      uint8_t firstTileX;
+      uint8_t lastTileX;
+      uint8_t firstTileY;
+      uint8_t lastTileY;
+   };
+
+   void _buildSlice(uint32_t slice);
+   uint32_t _getSlice(float depth) const;
+   float _getSliceStart(uint32_t slice) const;
+
+   glm::vec2 mProjectionScale;
+   float mNearDistance;
+   float mFarDistance;
+   float mSliceScale;
+   float mSliceBias;
+
+   // View space centers and radii of the lights being binned, and which of them reach each
+   // slice: mSliceLights[mSliceLightOffsets[slice], mSliceLightOffsets[slice + 1]).
+   std::vector<glm::vec4> mViewSpheres;
+   std::vector<uint32_t> mLightSlices;
+   std::vector<uint32_t> mSliceLights;
+   uint32_t mSliceLightOffsets[SLICE_COUNT + 1];
+
+   // Per slice, the tiles each light covers, the cluster offsets and counts local to the slice
+   // and the indices they point to.
+   std::vector<LightRect> mSliceRects[SLICE_COUNT];
+   std::vector<uint32_t> mSliceClusters[SLICE_COUNT];
+   std::vector<uint32_t> mSliceIndices[SLICE_COUNT];
+   uint32_t mSliceOffsets[SLICE_COUNT];
+   uint32_t mIndexCount;
+};
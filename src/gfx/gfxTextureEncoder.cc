@@ -0,0 +1,1175 @@
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "core/simd.h"
+#include "gfx/gfxDevice.h"
+#include "gfx/gfxTextureEncoder.h"
+
+// One 4x4 block in structure of arrays layout, texels in row major order.
+struct SIMD_ALIGN(16) EncoderBlock
+{
+   float r[16];
+   float g[16];
+   float b[16];
+   float a[16];
+};
+
+static const float CHANNEL_WEIGHTS_R[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+static const float CHANNEL_WEIGHTS_RGB[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+static const float CHANNEL_WEIGHTS_RGBA[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+static const int BC7_INDEX_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Small and large modifier of each ETC1 table codeword.
+static const int ETC_MODIFIERS[8][2] =
+{
+   { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+static const int EAC_MODIFIERS[16][8] =
+{
+   { -3, -6, -9, -15, 2, 5, 8, 14 }, { -3, -7, -10, -13, 2, 6, 9, 12 },
+   { -2, -5, -8, -13, 1, 4, 7, 12 }, { -2, -4, -6, -13, 1, 3, 5, 12 },
+   { -3, -6, -8, -12, 2, 5, 7, 11 }, { -3, -7, -9, -11, 2, 6, 8, 10 },
+   { -4, -7, -8, -11, 3, 6, 7, 10 }, { -3, -5, -8, -11, 2, 4, 7, 10 },
+   { -2, -6, -8, -10, 1, 5, 7, 9 }, { -2, -5, -8, -10, 1, 4, 7, 9 },
+   { -2, -4, -8, -10, 1, 3, 7, 9 }, { -2, -5, -7, -10, 1, 4, 6, 9 },
+   { -3, -4, -7, -10, 2, 3, 6, 9 }, { -1, -2, -3, -10, 0, 1, 2, 9 },
+   { -4, -6, -8, -9, 3, 5, 7, 8 }, { -3, -5, -7, -9, 2, 4, 6, 8 }
+};
+
+static inline int clampByte(int value)
+{
+   return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+static inline float clampColor(float value)
+{
+   return value < 0.0f ? 0.0f : (value > 255.0f ? 255.0f : value);
+}
+
+// Picks the closest palette entry for every texel and returns the summed squared error.
+// texelCount must be a multiple of 4 and the channel arrays 16 byte aligned.
+static float findNearest(const float* r, const float* g, const float* b, const float* a, int texelCount,
+                         const float (*palette)[4], int paletteCount, const float weights[4], uint8_t* indices)
+{
+   float totalError = 0.0f;
+
+#if SIMD_SSE2
+   const __m128 weightR = _mm_set1_ps(weights[0]);
+   const __m128 weightG = _mm_set1_ps(weights[1]);
+   const __m128 weightB = _mm_set1_ps(weights[2]);
+   const __m128 weightA = _mm_set1_ps(weights[3]);
+
+   for (int i = 0; i < texelCount; i += 4)
+   {
+      const __m128 texelR = _mm_load_ps(r + i);
+      const __m128 texelG = _mm_load_ps(g + i);
+      const __m128 texelB = _mm_load_ps(b + i);
+      const __m128 texelA = _mm_load_ps(a + i);
+
+      __m128 bestError = _mm_set1_ps(FLT_MAX);
+      __m128i bestIndex = _mm_setzero_si128();
+
+      for (int k = 0; k < paletteCount; k++)
+      {
+         __m128 dr = _mm_sub_ps(texelR, _mm_set1_ps(palette[k][0]));
+         __m128 dg = _mm_sub_ps(texelG, _mm_set1_ps(palette[k][1]));
+         __m128 db = _mm_sub_ps(texelB, _mm_set1_ps(palette[k][2]));
+         __m128 da = _mm_sub_ps(texelA, _mm_set1_ps(palette[k][3]));
+
+         __m128 error = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(_mm_mul_ps(dr, dr), weightR), _mm_mul_ps(_mm_mul_ps(dg, dg), weightG)),
+            _mm_add_ps(_mm_mul_ps(_mm_mul_ps(db, db), weightB), _mm_mul_ps(_mm_mul_ps(da, da), weightA)));
+
+         __m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+         bestError = _mm_min_ps(error, bestError);
+         bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(k)), _mm_andnot_si128(closer, bestIndex));
+      }
+
+      SIMD_ALIGN(16) float errors[4];
+      SIMD_ALIGN(16) int32_t closest[4];
+      _mm_store_ps(errors, bestError);
+      _mm_store_si128((__m128i*)closest, bestIndex);
+
+      for (int j = 0; j < 4; j++)
+      {
+         indices[i + j] = (uint8_t)closest[j];
+         totalError += errors[j];
+      }
+   }
+#else
+   for (int i = 0; i < texelCount; i++)
+   {
+      float bestError = FLT_MAX;
+      for (int k = 0; k < paletteCount; k++)
+      {
+         float dr = r[i] - palette[k][0];
+         float dg = g[i] - palette[k][1];
+         float db = b[i] - palette[k][2];
+         float da = a[i] - palette[k][3];
+         float error = dr * dr * weights[0] + dg * dg * weights[1] + db * db * weights[2] + da * da * weights[3];
+
+         if (error < bestError)
+         {
+            bestError = error;
+            indices[i] = (uint8_t)k;
+         }
+      }
+      totalError += bestError;
+   }
+#endif
+
+   return totalError;
+}
+
+// Fits a line through the block's colors and returns the extent of the texels along it.
+static void computePrincipalEndpoints(const EncoderBlock& block, int channels, float outStart[4], float outEnd[4])
+{
+   const float* data[4] = { block.r, block.g, block.b, block.a };
+
+   float mean[4] = {};
+   for (int c = 0; c < channels; c++)
+   {
+      for (int i = 0; i < 16; i++)
+         mean[c] += data[c][i];
+      mean[c] /= 16.0f;
+   }
+
+   float covariance[4][4] = {};
+   for (int i = 0; i < 16; i++)
+   {
+      for (int x = 0; x < channels; x++)
+      {
+         for (int y = 0; y < channels; y++)
+            covariance[x][y] += (data[x][i] - mean[x]) * (data[y][i] - mean[y]);
+      }
+   }
+
+   // Power iteration, seeded with the row of the channel that varies the most.
+   int seed = 0;
+   for (int c = 1; c < channels; c++)
+   {
+      if (covariance[c][c] > covariance[seed][seed])
+         seed = c;
+   }
+
+   float axis[4] = {};
+   for (int c = 0; c < channels; c++)
+      axis[c] = covariance[seed][c];
+
+   for (int iteration = 0; iteration < 8; iteration++)
+   {
+      float next[4] = {};
+      float largest = 0.0f;
+      for (int x = 0; x < channels; x++)
+      {
+         for (int y = 0; y < channels; y++)
+            next[x] += covariance[x][y] * axis[y];
+         largest = std::max(largest, fabsf(next[x]));
+      }
+
+      if (largest == 0.0f)
+         break;
+
+      for (int c = 0; c < channels; c++)
+         axis[c] = next[c] / largest;
+   }
+
+   float length = 0.0f;
+   for (int c = 0; c < channels; c++)
+      length += axis[c] * axis[c];
+   length = sqrtf(length);
+
+   float minProjection = 0.0f;
+   float maxProjection = 0.0f;
+   if (length > 0.0f)
+   {
+      for (int c = 0; c < channels; c++)
+         axis[c] /= length;
+
+      minProjection = FLT_MAX;
+      maxProjection = -FLT_MAX;
+      for (int i = 0; i < 16; i++)
+      {
+         float projection = 0.0f;
+         for (int c = 0; c < channels; c++)
+            projection += (data[c][i] - mean[c]) * axis[c];
+
+         minProjection = std::min(minProjection, projection);
+         maxProjection = std::max(maxProjection, projection);
+      }
+   }
+
+   for (int c = 0; c < 4; c++)
+   {
+      outStart[c] = c < channels ? clampColor(mean[c] + axis[c] * minProjection) : 255.0f;
+      outEnd[c] = c < channels ? clampColor(mean[c] + axis[c] * maxProjection) : 255.0f;
+   }
+}
+
+// Least squares endpoints for a fixed set of indices, where each index interpolates
+// start and end by indexWeights[index].
+static bool refineEndpoints(const float* const* data, int channels, const uint8_t* indices, const float* indexWeights, float outStart[4], float outEnd[4])
+{
+   float a00 = 0.0f, a01 = 0.0f, a11 = 0.0f;
+   float b0[4] = {};
+   float b1[4] = {};
+
+   for (int i = 0; i < 16; i++)
+   {
+      const float w = indexWeights[indices[i]];
+      a00 += (1.0f - w) * (1.0f - w);
+      a01 += (1.0f - w) * w;
+      a11 += w * w;
+
+      for (int c = 0; c < channels; c++)
+      {
+         b0[c] += (1.0f - w) * data[c][i];
+         b1[c] += w * data[c][i];
+      }
+   }
+
+   const float determinant = a00 * a11 - a01 * a01;
+   if (fabsf(determinant) < 1e-6f)
+      return false;
+
+   for (int c = 0; c < 4; c++)
+   {
+      outStart[c] = c < channels ? clampColor((a11 * b0[c] - a01 * b1[c]) / determinant) : 255.0f;
+      outEnd[c] = c < channels ? clampColor((a00 * b1[c] - a01 * b0[c]) / determinant) : 255.0f;
+   }
+
+   return true;
+}
+
+static inline uint16_t packRGB565(const float color[4])
+{
+   int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+   int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+   int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+   return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static inline void unpackRGB565(uint16_t value, int out[3])
+{
+   int r = value >> 11;
+   int g = (value >> 5) & 63;
+   int b = value & 31;
+   out[0] = (r << 3) | (r >> 2);
+   out[1] = (g << 2) | (g >> 4);
+   out[2] = (b << 3) | (b >> 2);
+}
+
+static float evaluateBC1(const EncoderBlock& block, uint16_t color0, uint16_t color1, uint8_t indices[16])
+{
+   int c0[3], c1[3];
+   unpackRGB565(color0, c0);
+   unpackRGB565(color1, c1);
+
+   float palette[4][4];
+   for (int c = 0; c < 3; c++)
+   {
+      palette[0][c] = (float)c0[c];
+      palette[1][c] = (float)c1[c];
+      palette[2][c] = (float)((2 * c0[c] + c1[c]) / 3);
+      palette[3][c] = (float)((c0[c] + 2 * c1[c]) / 3);
+   }
+   for (int k = 0; k < 4; k++)
+      palette[k][3] = 255.0f;
+
+   return findNearest(block.r, block.g, block.b, block.a, 16, palette, 4, CHANNEL_WEIGHTS_RGB, indices);
+}
+
+// Always writes the opaque four color mode, which is also what BC3 expects.
+static void encodeBC1Block(const EncoderBlock& block, uint8_t* out)
+{
+   static const float BC1_INDEX_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+   const float* data[4] = { block.r, block.g, block.b, block.a };
+
+   float start[4], end[4];
+   computePrincipalEndpoints(block, 3, start, end);
+
+   uint16_t color0 = packRGB565(end);
+   uint16_t color1 = packRGB565(start);
+   uint8_t indices[16];
+   float error = evaluateBC1(block, color0, color1, indices);
+
+   float refinedStart[4], refinedEnd[4];
+   if (refineEndpoints(data, 3, indices, BC1_INDEX_WEIGHTS, refinedStart, refinedEnd))
+   {
+      uint16_t refined0 = packRGB565(refinedStart);
+      uint16_t refined1 = packRGB565(refinedEnd);
+      uint8_t refinedIndices[16];
+      float refinedError = evaluateBC1(block, refined0, refined1, refinedIndices);
+
+      if (refinedError < error)
+      {
+         color0 = refined0;
+         color1 = refined1;
+         memcpy(indices, refinedIndices, sizeof(indices));
+      }
+   }
+
+   // color0 > color1 selects four color mode, swapping the endpoints flips indices 0/1 and 2/3.
+   if (color0 < color1)
+   {
+      std::swap(color0, color1);
+      for (int i = 0; i < 16; i++)
+         indices[i] ^= 1;
+   }
+   else if (color0 == color1)
+   {
+      memset(indices, 0, sizeof(indices));
+   }
+
+   uint32_t packedIndices = 0;
+   for (int i = 0; i < 16; i++)
+      packedIndices |= (uint32_t)indices[i] << (i * 2);
+
+   out[0] = color0 & 0xFF;
+   out[1] = color0 >> 8;
+   out[2] = color1 & 0xFF;
+   out[3] = color1 >> 8;
+   out[4] = packedIndices & 0xFF;
+   out[5] = (packedIndices >> 8) & 0xFF;
+   out[6] = (packedIndices >> 16) & 0xFF;
+   out[7] = packedIndices >> 24;
+}
+
+static float evaluateBC4(const float* values, int endpoint0, int endpoint1, uint8_t indices[16])
+{
+   float palette[8][4] = {};
+   palette[0][0] = (float)endpoint0;
+   palette[1][0] = (float)endpoint1;
+   for (int i = 2; i < 8; i++)
+      palette[i][0] = (float)(((8 - i) * endpoint0 + (i - 1) * endpoint1) / 7);
+
+   return findNearest(values, values, values, values, 16, palette, 8, CHANNEL_WEIGHTS_R, indices);
+}
+
+// Single channel block in the eight value mode. values must be 16 byte aligned.
+static void encodeBC4Block(const float* values, uint8_t* out)
+{
+   static const float BC4_INDEX_WEIGHTS[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+
+   float minValue = values[0];
+   float maxValue = values[0];
+   for (int i = 1; i < 16; i++)
+   {
+      minValue = std::min(minValue, values[i]);
+      maxValue = std::max(maxValue, values[i]);
+   }
+
+   int endpoint0 = (int)(maxValue + 0.5f);
+   int endpoint1 = (int)(minValue + 0.5f);
+   uint8_t indices[16] = {};
+
+   if (endpoint0 != endpoint1)
+   {
+      float error = evaluateBC4(values, endpoint0, endpoint1, indices);
+
+      float refinedStart[4], refinedEnd[4];
+      if (refineEndpoints(&values, 1, indices, BC4_INDEX_WEIGHTS, refinedStart, refinedEnd))
+      {
+         int refined0 = (int)(refinedStart[0] + 0.5f);
+         int refined1 = (int)(refinedEnd[0] + 0.5f);
+
+         if (refined0 > refined1)
+         {
+            uint8_t refinedIndices[16];
+            float refinedError = evaluateBC4(values, refined0, refined1, refinedIndices);
+            if (refinedError < error)
+            {
+               endpoint0 = refined0;
+               endpoint1 = refined1;
+               memcpy(indices, refinedIndices, sizeof(indices));
+            }
+         }
+      }
+   }
+
+   uint64_t packedIndices = 0;
+   for (int i = 0; i < 16; i++)
+      packedIndices |= (uint64_t)indices[i] << (i * 3);
+
+   out[0] = (uint8_t)endpoint0;
+   out[1] = (uint8_t)endpoint1;
+   for (int i = 0; i < 6; i++)
+      out[2 + i] = (uint8_t)(packedIndices >> (i * 8));
+}
+
+// Picks the shared p-bit that lands the 7 bit endpoint closest to the 8 bit color.
+static void quantizeBC7Endpoint(const float color[4], uint8_t outQuantized[4], int& outPBit)
+{
+   float bestError = FLT_MAX;
+   for (int pBit = 0; pBit < 2; pBit++)
+   {
+      uint8_t quantized[4];
+      float error = 0.0f;
+      for (int c = 0; c < 4; c++)
+      {
+         int q = (int)((color[c] - pBit) * 0.5f + 0.5f);
+         q = q < 0 ? 0 : (q > 127 ? 127 : q);
+         quantized[c] = (uint8_t)q;
+
+         float difference = (float)((q << 1) | pBit) - color[c];
+         error += difference * difference;
+      }
+
+      if (error < bestError)
+      {
+         bestError = error;
+         outPBit = pBit;
+         memcpy(outQuantized, quantized, 4);
+      }
+   }
+}
+
+static float evaluateBC7(const EncoderBlock& block, const uint8_t quantized0[4], int pBit0, const uint8_t quantized1[4], int pBit1, uint8_t indices[16])
+{
+   float palette[16][4];
+   for (int c = 0; c < 4; c++)
+   {
+      int e0 = (quantized0[c] << 1) | pBit0;
+      int e1 = (quantized1[c] << 1) | pBit1;
+      for (int i = 0; i < 16; i++)
+         palette[i][c] = (float)(((64 - BC7_INDEX_WEIGHTS[i]) * e0 + BC7_INDEX_WEIGHTS[i] * e1 + 32) >> 6);
+   }
+
+   return findNearest(block.r, block.g, block.b, block.a, 16, palette, 16, CHANNEL_WEIGHTS_RGBA, indices);
+}
+
+struct BitWriter
+{
+   uint8_t* out;
+   uint32_t position;
+
+   void write(uint32_t value, uint32_t count)
+   {
+      for (uint32_t i = 0; i < count; i++, position++)
+      {
+         if ((value >> i) & 1)
+            out[position >> 3] |= (uint8_t)(1 << (position & 7));
+      }
+   }
+};
+
+// Mode 6: one subset, RGBA 7.7.7.7 endpoints with unique p-bits and 4 bit indices.
+static void encodeBC7Block(const EncoderBlock& block, uint8_t* out)
+{
+   float indexWeights[16];
+   for (int i = 0; i < 16; i++)
+      indexWeights[i] = BC7_INDEX_WEIGHTS[i] / 64.0f;
+
+   const float* data[4] = { block.r, block.g, block.b, block.a };
+
+   float start[4], end[4];
+   computePrincipalEndpoints(block, 4, start, end);
+
+   uint8_t quantized0[4], quantized1[4];
+   int pBit0, pBit1;
+   quantizeBC7Endpoint(start, quantized0, pBit0);
+   quantizeBC7Endpoint(end, quantized1, pBit1);
+
+   uint8_t indices[16];
+   float error = evaluateBC7(block, quantized0, pBit0, quantized1, pBit1, indices);
+
+   float refinedStart[4], refinedEnd[4];
+   if (refineEndpoints(data, 4, indices, indexWeights, refinedStart, refinedEnd))
+   {
+      uint8_t refined0[4], refined1[4];
+      int refinedPBit0, refinedPBit1;
+      quantizeBC7Endpoint(refinedStart, refined0, refinedPBit0);
+      quantizeBC7Endpoint(refinedEnd, refined1, refinedPBit1);
+
+      uint8_t refinedIndices[16];
+      float refinedError = evaluateBC7(block, refined0, refinedPBit0, refined1, refinedPBit1, refinedIndices);
+      if (refinedError < error)
+      {
+         memcpy(quantized0, refined0, 4);
+         memcpy(quantized1, refined1, 4);
+         pBit0 = refinedPBit0;
+         pBit1 = refinedPBit1;
+         memcpy(indices, refinedIndices, sizeof(indices));
+      }
+   }
+
+   // The anchor index only has 3 bits, so its top bit has to be 0.
+   if (indices[0] & 8)
+   {
+      std::swap(quantized0, quantized1);
+      std::swap(pBit0, pBit1);
+      for (int i = 0; i < 16; i++)
+         indices[i] = 15 - indices[i];
+   }
+
+   memset(out, 0, 16);
+   BitWriter writer = { out, 0 };
+   writer.write(1 << 6, 7);
+   for (int c = 0; c < 4; c++)
+   {
+      writer.write(quantized0[c], 7);
+      writer.write(quantized1[c], 7);
+   }
+   writer.write(pBit0, 1);
+   writer.write(pBit1, 1);
+   writer.write(indices[0], 3);
+   for (int i = 1; i < 16; i++)
+      writer.write(indices[i], 4);
+}
+
+// r, g and b hold the 8 texels of one sub-block. Returns the error of the best table.
+static float encodeETCSubblock(const float* r, const float* g, const float* b, const int base[3], int& outTable, uint8_t outIndices[8])
+{
+   float bestError = FLT_MAX;
+   for (int table = 0; table < 8; table++)
+   {
+      const int modifiers[4] = { ETC_MODIFIERS[table][0], ETC_MODIFIERS[table][1], -ETC_MODIFIERS[table][0], -ETC_MODIFIERS[table][1] };
+
+      float palette[4][4];
+      for (int k = 0; k < 4; k++)
+      {
+         for (int c = 0; c < 3; c++)
+            palette[k][c] = (float)clampByte(base[c] + modifiers[k]);
+         palette[k][3] = 0.0f;
+      }
+
+      uint8_t indices[8];
+      float error = findNearest(r, g, b, r, 8, palette, 4, CHANNEL_WEIGHTS_RGB, indices);
+      if (error < bestError)
+      {
+         bestError = error;
+         outTable = table;
+         memcpy(outIndices, indices, sizeof(indices));
+      }
+   }
+
+   return bestError;
+}
+
+// ETC1 compatible individual and differential modes, which are valid ETC2 as long as
+// the differential colors don't overflow.
+static void encodeETC2RGBBlock(const EncoderBlock& block, uint8_t* out)
+{
+   float bestError = FLT_MAX;
+   uint64_t bestBits = 0;
+
+   for (int flip = 0; flip < 2; flip++)
+   {
+      // flip 0 splits the block into 2x4 left/right halves, flip 1 into 4x2 top/bottom halves.
+      SIMD_ALIGN(16) float r[2][8];
+      SIMD_ALIGN(16) float g[2][8];
+      SIMD_ALIGN(16) float b[2][8];
+      int texelIndex[2][8];
+      int counts[2] = {};
+
+      for (int y = 0; y < 4; y++)
+      {
+         for (int x = 0; x < 4; x++)
+         {
+            int subblock = flip ? (y >= 2) : (x >= 2);
+            int i = y * 4 + x;
+            int n = counts[subblock]++;
+
+            r[subblock][n] = block.r[i];
+            g[subblock][n] = block.g[i];
+            b[subblock][n] = block.b[i];
+            texelIndex[subblock][n] = x * 4 + y;
+         }
+      }
+
+      float average[2][3] = {};
+      for (int s = 0; s < 2; s++)
+      {
+         for (int n = 0; n < 8; n++)
+         {
+            average[s][0] += r[s][n];
+            average[s][1] += g[s][n];
+            average[s][2] += b[s][n];
+         }
+         for (int c = 0; c < 3; c++)
+            average[s][c] /= 8.0f;
+      }
+
+      int base5[2][3];
+      bool canUseDifferential = true;
+      for (int c = 0; c < 3; c++)
+      {
+         base5[0][c] = (int)(average[0][c] * 31.0f / 255.0f + 0.5f);
+         base5[1][c] = (int)(average[1][c] * 31.0f / 255.0f + 0.5f);
+
+         int delta = base5[1][c] - base5[0][c];
+         canUseDifferential &= delta >= -4 && delta <= 3;
+      }
+
+      for (int differential = canUseDifferential ? 1 : 0; differential >= 0; differential--)
+      {
+         int quantized[2][3];
+         int base[2][3];
+         for (int s = 0; s < 2; s++)
+         {
+            for (int c = 0; c < 3; c++)
+            {
+               if (differential)
+               {
+                  quantized[s][c] = base5[s][c];
+                  base[s][c] = (quantized[s][c] << 3) | (quantized[s][c] >> 2);
+               }
+               else
+               {
+                  quantized[s][c] = (int)(average[s][c] * 15.0f / 255.0f + 0.5f);
+                  base[s][c] = quantized[s][c] * 17;
+               }
+            }
+         }
+
+         int tables[2];
+         uint8_t indices[2][8];
+         float error = encodeETCSubblock(r[0], g[0], b[0], base[0], tables[0], indices[0]) +
+                       encodeETCSubblock(r[1], g[1], b[1], base[1], tables[1], indices[1]);
+
+         if (error >= bestError)
+            continue;
+
+         uint64_t bits = 0;
+         if (differential)
+         {
+            bits |= (uint64_t)quantized[0][0] << 59 | (uint64_t)((quantized[1][0] - quantized[0][0]) & 7) << 56;
+            bits |= (uint64_t)quantized[0][1] << 51 | (uint64_t)((quantized[1][1] - quantized[0][1]) & 7) << 48;
+            bits |= (uint64_t)quantized[0][2] << 43 | (uint64_t)((quantized[1][2] - quantized[0][2]) & 7) << 40;
+            bits |= 1ull << 33;
+         }
+         else
+         {
+            bits |= (uint64_t)quantized[0][0] << 60 | (uint64_t)quantized[1][0] << 56;
+            bits |= (uint64_t)quantized[0][1] << 52 | (uint64_t)quantized[1][1] << 48;
+            bits |= (uint64_t)quantized[0][2] << 44 | (uint64_t)quantized[1][2] << 40;
+         }
+
+         bits |= (uint64_t)tables[0] << 37 | (uint64_t)tables[1] << 34 | (uint64_t)flip << 32;
+
+         // Texels are stored column major, most significant index bits in the upper half.
+         for (int s = 0; s < 2; s++)
+         {
+            for (int n = 0; n < 8; n++)
+            {
+               int j = texelIndex[s][n];
+               bits |= (uint64_t)(indices[s][n] >> 1) << (16 + j);
+               bits |= (uint64_t)(indices[s][n] & 1) << j;
+            }
+         }
+
+         bestError = error;
+         bestBits = bits;
+      }
+   }
+
+   for (int i = 0; i < 8; i++)
+      out[i] = (uint8_t)(bestBits >> (56 - i * 8));
+}
+
+static void encodeEACBlock(const float* alpha, uint8_t* out)
+{
+   float minValue = alpha[0];
+   float maxValue = alpha[0];
+   for (int i = 1; i < 16; i++)
+   {
+      minValue = std::min(minValue, alpha[i]);
+      maxValue = std::max(maxValue, alpha[i]);
+   }
+
+   // Table 13 has a zero modifier, which covers solid blocks exactly.
+   int bestBase = (int)(minValue + 0.5f);
+   int bestMultiplier = 1;
+   int bestTable = 13;
+   uint8_t bestIndices[16];
+   memset(bestIndices, 4, sizeof(bestIndices));
+
+   if (maxValue > minValue)
+   {
+      float bestError = FLT_MAX;
+      for (int table = 0; table < 16; table++)
+      {
+         int tableMin = *std::min_element(EAC_MODIFIERS[table], EAC_MODIFIERS[table] + 8);
+         int tableMax = *std::max_element(EAC_MODIFIERS[table], EAC_MODIFIERS[table] + 8);
+         int estimate = (int)((maxValue - minValue) / (tableMax - tableMin) + 0.5f);
+
+         for (int multiplier = std::max(estimate - 1, 1); multiplier <= std::min(estimate + 1, 15); multiplier++)
+         {
+            int base = clampByte((int)(minValue - tableMin * multiplier + 0.5f));
+
+            float palette[8][4] = {};
+            for (int k = 0; k < 8; k++)
+               palette[k][0] = (float)clampByte(base + EAC_MODIFIERS[table][k] * multiplier);
+
+            uint8_t indices[16];
+            float error = findNearest(alpha, alpha, alpha, alpha, 16, palette, 8, CHANNEL_WEIGHTS_R, indices);
+            if (error < bestError)
+            {
+               bestError = error;
+               bestBase = base;
+               bestMultiplier = multiplier;
+               bestTable = table;
+               memcpy(bestIndices, indices, sizeof(indices));
+            }
+         }
+      }
+   }
+
+   uint64_t bits = (uint64_t)bestBase << 56 | (uint64_t)bestMultiplier << 52 | (uint64_t)bestTable << 48;
+   for (int y = 0; y < 4; y++)
+   {
+      for (int x = 0; x < 4; x++)
+      {
+         int j = x * 4 + y;
+         bits |= (uint64_t)bestIndices[y * 4 + x] << (45 - j * 3);
+      }
+   }
+
+   for (int i = 0; i < 8; i++)
+      out[i] = (uint8_t)(bits >> (56 - i * 8));
+}
+
+static void fetchBlock(const uint8_t* rgba, int32_t width, int32_t height, int32_t blockX, int32_t blockY, EncoderBlock& block)
+{
+   // Texels past the edge of the image repeat the last row/column.
+   for (int y = 0; y < 4; y++)
+   {
+      int32_t sourceY = std::min(blockY * 4 + y, height - 1);
+      for (int x = 0; x < 4; x++)
+      {
+         int32_t sourceX = std::min(blockX * 4 + x, width - 1);
+         const uint8_t* texel = rgba + ((size_t)sourceY * width + sourceX) * 4;
+
+         block.r[y * 4 + x] = texel[0];
+         block.g[y * 4 + x] = texel[1];
+         block.b[y * 4 + x] = texel[2];
+         block.a[y * 4 + x] = texel[3];
+      }
+   }
+}
+
+static void downsample(const uint8_t* source, int32_t width, int32_t height, uint8_t* destination)
+{
+   const int32_t destinationWidth = std::max(width / 2, 1);
+   const int32_t destinationHeight = std::max(height / 2, 1);
+
+   for (int32_t y = 0; y < destinationHeight; y++)
+   {
+      const uint8_t* row0 = source + (size_t)std::min(y * 2, height - 1) * width * 4;
+      const uint8_t* row1 = source + (size_t)std::min(y * 2 + 1, height - 1) * width * 4;
+
+      for (int32_t x = 0; x < destinationWidth; x++)
+      {
+         int32_t x0 = std::min(x * 2, width - 1) * 4;
+         int32_t x1 = std::min(x * 2 + 1, width - 1) * 4;
+         uint8_t* out = destination + ((size_t)y * destinationWidth + x) * 4;
+
+         for (int c = 0; c < 4; c++)
+            out[c] = (uint8_t)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+      }
+   }
+}
+
+GFXTextureEncoder::GFXTextureEncoder(uint32_t threadCount) :
+   mJobSystem(threadCount)
+{
+}
+
+void GFXTextureEncoder::setThreadCount(uint32_t threadCount)
+{
+   mJobSystem.setThreadCount(threadCount);
+}
+
+void GFXTextureEncoder::encode(GFXTextureInternalFormat format, const uint8_t* rgba, int32_t width, int32_t height, uint8_t* output)
+{
+   if (!GFXDevice::isCompressedFormat(format))
+      abort();
+
+   const int32_t blocksX = (width + 3) / 4;
+   const int32_t blocksY = (height + 3) / 4;
+   const size_t blockSize = GFXDevice::getFormatBlockSize(format);
+
+   mJobSystem.parallelFor(blocksY, 1, [&](uint32_t start, uint32_t end, uint32_t threadIndex)
+   {
+      EncoderBlock block;
+
+      for (uint32_t blockY = start; blockY < end; blockY++)
+      {
+         for (int32_t blockX = 0; blockX < blocksX; blockX++)
+         {
+            fetchBlock(rgba, width, height, blockX, blockY, block);
+            uint8_t* out = output + ((size_t)blockY * blocksX + blockX) * blockSize;
+
+            switch (format)
+            {
+            case GFXTextureInternalFormat::BC1_RGB:
+               encodeBC1Block(block, out);
+               break;
+            case GFXTextureInternalFormat::BC3_RGBA:
+               encodeBC4Block(block.a, out);
+               encodeBC1Block(block, out + 8);
+               break;
+            case GFXTextureInternalFormat::BC4_R:
+               encodeBC4Block(block.r, out);
+               break;
+            case GFXTextureInternalFormat::BC5_RG:
+               encodeBC4Block(block.r, out);
+               encodeBC4Block(block.g, out + 8);
+               break;
+            case GFXTextureInternalFormat::BC7_RGBA:
+               encodeBC7Block(block, out);
+               break;
+            case GFXTextureInternalFormat::ETC2_RGB8:
+               encodeETC2RGBBlock(block, out);
+               break;
+            case GFXTextureInternalFormat::ETC2_RGBA8:
+               encodeEACBlock(block.a, out);
+               encodeETC2RGBBlock(block, out + 8);
+               break;
+            default:
+               break;
+            }
+         }
+      }
+   });
+}
+
+GFXEncodedTexture GFXTextureEncoder::encodeMipChain(GFXTextureInternalFormat format, const uint8_t* rgba, int32_t width, int32_t height)
+{
+   GFXEncodedTexture texture;
+   texture.format = format;
+   texture.width = width;
+   texture.height = height;
+   texture.levels = 1;
+
+   int32_t largest = std::max(width, height);
+   while (largest > 1)
+   {
+      largest >>= 1;
+      texture.levels++;
+   }
+
+   size_t size = 0;
+   for (int32_t level = 0; level < texture.levels; level++)
+   {
+      texture.levelOffsets.push_back(size);
+      size += GFXDevice::getTextureRegionSize(format, std::max(width >> level, 1), std::max(height >> level, 1), 1);
+   }
+   texture.data.resize(size);
+
+   std::vector<uint8_t> current;
+   std::vector<uint8_t> next;
+   const uint8_t* source = rgba;
+
+   for (int32_t level = 0; level < texture.levels; level++)
+   {
+      const int32_t levelWidth = std::max(width >> level, 1);
+      const int32_t levelHeight = std::max(height >> level, 1);
+
+      encode(format, source, levelWidth, levelHeight, texture.data.data() + texture.levelOffsets[level]);
+
+      if (level + 1 < texture.levels)
+      {
+         next.resize((size_t)std::max(levelWidth / 2, 1) * std::max(levelHeight / 2, 1) * 4);
+         downsample(source, levelWidth, levelHeight, next.data());
+
+         current.swap(next);
+         source = current.data();
+      }
+   }
+
+   return texture;
+}
+
+static void decodeBC1Block(const uint8_t* block, uint8_t out[16][4], bool alwaysFourColors)
+{
+   uint16_t color0 = block[0] | (block[1] << 8);
+   uint16_t color1 = block[2] | (block[3] << 8);
+
+   int c0[3], c1[3];
+   unpackRGB565(color0, c0);
+   unpackRGB565(color1, c1);
+
+   int palette[4][4];
+   for (int c = 0; c < 3; c++)
+   {
+      palette[0][c] = c0[c];
+      palette[1][c] = c1[c];
+
+      if (color0 > color1 || alwaysFourColors)
+      {
+         palette[2][c] = (2 * c0[c] + c1[c]) / 3;
+         palette[3][c] = (c0[c] + 2 * c1[c]) / 3;
+      }
+      else
+      {
+         palette[2][c] = (c0[c] + c1[c]) / 2;
+         palette[3][c] = 0;
+      }
+   }
+   for (int k = 0; k < 4; k++)
+      palette[k][3] = 255;
+
+   uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+   for (int i = 0; i < 16; i++)
+   {
+      int index = (indices >> (i * 2)) & 3;
+      for (int c = 0; c < 4; c++)
+         out[i][c] = (uint8_t)palette[index][c];
+   }
+}
+
+static void decodeBC4Block(const uint8_t* block, uint8_t out[16][4], int channel)
+{
+   int endpoint0 = block[0];
+   int endpoint1 = block[1];
+
+   int palette[8];
+   palette[0] = endpoint0;
+   palette[1] = endpoint1;
+   if (endpoint0 > endpoint1)
+   {
+      for (int i = 2; i < 8; i++)
+         palette[i] = ((8 - i) * endpoint0 + (i - 1) * endpoint1) / 7;
+   }
+   else
+   {
+      for (int i = 2; i < 6; i++)
+         palette[i] = ((6 - i) * endpoint0 + (i - 1) * endpoint1) / 5;
+      palette[6] = 0;
+      palette[7] = 255;
+   }
+
+   uint64_t indices = 0;
+   for (int i = 0; i < 6; i++)
+      indices |= (uint64_t)block[2 + i] << (i * 8);
+
+   for (int i = 0; i < 16; i++)
+      out[i][channel] = (uint8_t)palette[(indices >> (i * 3)) & 7];
+}
+
+static void decodeBC7Block(const uint8_t* block, uint8_t out[16][4])
+{
+   auto readBits = [block](uint32_t& position, uint32_t count) -> uint32_t
+   {
+      uint32_t value = 0;
+      for (uint32_t i = 0; i < count; i++, position++)
+         value |= ((block[position >> 3] >> (position & 7)) & 1) << i;
+      return value;
+   };
+
+   uint32_t position = 0;
+   if (readBits(position, 7) != (1 << 6))
+   {
+      for (int i = 0; i < 16; i++)
+      {
+         out[i][0] = 255; out[i][1] = 0; out[i][2] = 255; out[i][3] = 255;
+      }
+      return;
+   }
+
+   int endpoints[2][4];
+   for (int c = 0; c < 4; c++)
+   {
+      endpoints[0][c] = readBits(position, 7);
+      endpoints[1][c] = readBits(position, 7);
+   }
+
+   int pBit0 = readBits(position, 1);
+   int pBit1 = readBits(position, 1);
+   for (int c = 0; c < 4; c++)
+   {
+      endpoints[0][c] = (endpoints[0][c] << 1) | pBit0;
+      endpoints[1][c] = (endpoints[1][c] << 1) | pBit1;
+   }
+
+   for (int i = 0; i < 16; i++)
+   {
+      int index = readBits(position, i == 0 ? 3 : 4);
+      int weight = BC7_INDEX_WEIGHTS[index];
+      for (int c = 0; c < 4; c++)
+         out[i][c] = (uint8_t)(((64 - weight) * endpoints[0][c] + weight * endpoints[1][c] + 32) >> 6);
+   }
+}
+
+static void decodeETC2RGBBlock(const uint8_t* block, uint8_t out[16][4])
+{
+   uint64_t bits = 0;
+   for (int i = 0; i < 8; i++)
+      bits = (bits << 8) | block[i];
+
+   const bool differential = (bits >> 33) & 1;
+   const bool flip = (bits >> 32) & 1;
+
+   int base[2][3];
+   for (int c = 0; c < 3; c++)
+   {
+      if (differential)
+      {
+         int value = (bits >> (59 - c * 8)) & 31;
+         int delta = (bits >> (56 - c * 8)) & 7;
+         delta = delta >= 4 ? delta - 8 : delta;
+
+         if (value + delta < 0 || value + delta > 31)
+         {
+            // T, H and planar modes are never written by the encoder
+            for (int i = 0; i < 16; i++)
+            {
+               out[i][0] = 255; out[i][1] = 0; out[i][2] = 255; out[i][3] = 255;
+            }
+            return;
+         }
+
+         base[0][c] = (value << 3) | (value >> 2);
+         base[1][c] = ((value + delta) << 3) | ((value + delta) >> 2);
+      }
+      else
+      {
+         base[0][c] = ((bits >> (60 - c * 8)) & 15) * 17;
+         base[1][c] = ((bits >> (56 - c * 8)) & 15) * 17;
+      }
+   }
+
+   const int tables[2] = { (int)((bits >> 37) & 7), (int)((bits >> 34) & 7) };
+
+   for (int y = 0; y < 4; y++)
+   {
+      for (int x = 0; x < 4; x++)
+      {
+         int j = x * 4 + y;
+         int subblock = flip ? (y >= 2) : (x >= 2);
+         int index = (int)(((bits >> (16 + j)) & 1) << 1 | ((bits >> j) & 1));
+
+         int modifier = ETC_MODIFIERS[tables[subblock]][index & 1];
+         if (index & 2)
+            modifier = -modifier;
+
+         for (int c = 0; c < 3; c++)
+            out[y * 4 + x][c] = (uint8_t)clampByte(base[subblock][c] + modifier);
+         out[y * 4 + x][3] = 255;
+      }
+   }
+}
+
+static void decodeEACBlock(const uint8_t* block, uint8_t out[16][4])
+{
+   uint64_t bits = 0;
+   for (int i = 0; i < 8; i++)
+      bits = (bits << 8) | block[i];
+
+   const int base = (int)(bits >> 56);
+   const int multiplier = (int)((bits >> 52) & 15);
+   const int table = (int)((bits >> 48) & 15);
+
+   for (int y = 0; y < 4; y++)
+   {
+      for (int x = 0; x < 4; x++)
+      {
+         int j = x * 4 + y;
+         int index = (int)((bits >> (45 - j * 3)) & 7);
+         out[y * 4 + x][3] = (uint8_t)clampByte(base + EAC_MODIFIERS[table][index] * multiplier);
+      }
+   }
+}
+
+void GFXTextureEncoder::decode(GFXTextureInternalFormat format, const uint8_t* blocks, int32_t width, int32_t height, uint8_t* rgba)
+{
+   const int32_t blocksX = (width + 3) / 4;
+   const int32_t blocksY = (height + 3) / 4;
+   const size_t blockSize = GFXDevice::getFormatBlockSize(format);
+
+   for (int32_t blockY = 0; blockY < blocksY; blockY++)
+   {
+      for (int32_t blockX = 0; blockX < blocksX; blockX++)
+      {
+         const uint8_t* block = blocks + ((size_t)blockY * blocksX + blockX) * blockSize;
+
+         uint8_t texels[16][4];
+         for (int i = 0; i < 16; i++)
+         {
+            texels[i][0] = 0;
+            texels[i][1] = 0;
+            texels[i][2] = 0;
+            texels[i][3] = 255;
+         }
+
+         switch (format)
+         {
+         case GFXTextureInternalFormat::BC1_RGB:
+            decodeBC1Block(block, texels, false);
+            break;
+         case GFXTextureInternalFormat::BC3_RGBA:
+            decodeBC1Block(block + 8, texels, true);
+            decodeBC4Block(block, texels, 3);
+            break;
+         case GFXTextureInternalFormat::BC4_R:
+            decodeBC4Block(block, texels, 0);
+            break;
+         case GFXTextureInternalFormat::BC5_RG:
+            decodeBC4Block(block, texels, 0);
+            decodeBC4Block(block + 8, texels, 1);
+            break;
+         case GFXTextureInternalFormat::BC7_RGBA:
+            decodeBC7Block(block, texels);
+            break;
+         case GFXTextureInternalFormat::ETC2_RGB8:
+            decodeETC2RGBBlock(block, texels);
+            break;
+         case GFXTextureInternalFormat::ETC2_RGBA8:
+            decodeETC2RGBBlock(block + 8, texels);
+            decodeEACBlock(block, texels);
+            break;
+         default:
+            abort();
+         }
+
+         for (int y = 0; y < 4 && blockY * 4 + y < height; y++)
+         {
+            for (int x = 0; x < 4 && blockX * 4 + x < width; x++)
+               memcpy(rgba + ((size_t)(blockY * 4 + y) * width + blockX * 4 + x) * 4, texels[y * 4 + x], 4);
+         }
+      }
+   }
+}
+
+double GFXTextureEncoder::computePSNR(GFXTextureInternalFormat format, const uint8_t* original, const uint8_t* decoded, int32_t width, int32_t height)
+{
+   int channels;
+   switch (format)
+   {
+   case GFXTextureInternalFormat::BC4_R:
+      channels = 1;
+      break;
+   case GFXTextureInternalFormat::BC5_RG:
+      channels = 2;
+      break;
+   case GFXTextureInternalFormat::BC1_RGB:
+   case GFXTextureInternalFormat::ETC2_RGB8:
+      channels = 3;
+      break;
+   default:
+      channels = 4;
+      break;
+   }
+
+   double squaredError = 0.0;
+   const size_t texelCount = (size_t)width * height;
+   for (size_t i = 0; i < texelCount; i++)
+   {
+      for (int c = 0; c < channels; c++)
+      {
+         double difference = (double)original[i * 4 + c] - (double)decoded[i * 4 + c];
+         squaredError += difference * difference;
+      }
+   }
+
+   const double meanSquaredError = squaredError / (double)(texelCount * channels);
+   if (meanSquaredError == 0.0)
+      return INFINITY;
+
+   return 10.0 * log10(255.0 * 255.0 / meanSquaredError);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "core/jobSystem.h"
+#include "gfx/gfxTypes.h"
+
+struct GFXEncodedTexture
+{
+   GFXTextureInternalFormat format;
+   int32_t width;
+   int32_t height;
+   int32_t levels;
+
+   // Every level back to back, ready to be passed to GFXDevice::updateTexture() one level at a time.
+   std::vector<uint8_t> data;
+   std::vector<size_t> levelOffsets;
+};
+
+// BC7 only writes mode 6 and ETC2 only the ETC1 individual and differential modes plus EAC,
+// fast enough to run at load time.
+class GFXTextureEncoder
+{
+public:
+   // 0 uses every hardware thread.
+   explicit GFXTextureEncoder(uint32_t threadCount = 0);
+
+   void setThreadCount(uint32_t threadCount);
+   inline uint32_t getThreadCount() const { return mJobSystem.getThreadCount(); }
+
+   // Block compressed formats only.
+   void encode(GFXTextureInternalFormat format, const uint8_t* rgba, int32_t width, int32_t height, uint8_t* output);
+
+   GFXEncodedTexture encodeMipChain(GFXTextureInternalFormat format, const uint8_t* rgba, int32_t width, int32_t height);
+
+   // Block modes the encoder never writes decode to magenta.
+   static void decode(GFXTextureInternalFormat format, const uint8_t* blocks, int32_t width, int32_t height, uint8_t* rgba);
+
+   // Over the channels the format stores.
+   static double computePSNR(GFXTextureInternalFormat format, const uint8_t* original, const uint8_t* decoded, int32_t width, int32_t height);
+
+private:
+   JobSystem mJobSystem;
+};
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
 typedef unsigned int BufferHandle;
 typedef unsigned int PipelineHandle;
 typedef unsigned int StateBlockHandle;
@@ -7,11 +10,14 @@ typedef unsigned int TextureHandle;
 typedef unsigned int SamplerHandle;
 typedef unsigned int ResourceHandle;
 typedef unsigned int RenderPassHandle;
+typedef unsigned int FenceHandle;
 
 enum class GFXApi
 {
    OpenGL,
-   Metal
+   Metal,
+   Software,
+   Null
 };
 
 enum
@@ -29,7 +35,9 @@ enum class GFXBufferType
 {
    VERTEX_BUFFER,
    INDEX_BUFFER,
-   CONSTANT_BUFFER
+   CONSTANT_BUFFER,
+   STORAGE_BUFFER, // read and written by shaders, can also be bound as a vertex buffer
+   INDIRECT_BUFFER // draw arguments, usually written by a compute shader
 };
 
 enum class GFXIndexBufferType
@@ -57,19 +65,105 @@ enum class GFXInputLayoutFormat
    FLOAT,
    BYTE,
    SHORT,
-   INT
+   INT,
+   UNSIGNED_BYTE_NORM, // read as [0, 1]
+   SHORT_NORM // read as [-1, 1]
 };
 
 enum class GFXShaderType
 {
    VERTEX,
-   FRAGMENT
+   FRAGMENT,
+   COMPUTE
 };
 
 enum GFXShaderStageBit
 {
    VERTEX_BIT = 1,
-   FRAGMENT_BIT = 1 << VERTEX_BIT
+   FRAGMENT_BIT = 1 << VERTEX_BIT,
+   COMPUTE_BIT = 1 << 2
+};
+
+// Which kinds of access must see writes made before a memory barrier.
+enum GFXBarrierBit
+{
+   TEXTURE_FETCH_BARRIER_BIT = 1,
+   RENDER_TARGET_BARRIER_BIT = 1 << 1,
+   SHADER_STORAGE_BARRIER_BIT = 1 << 2,
+   VERTEX_BUFFER_BARRIER_BIT = 1 << 3,
+   INDIRECT_BUFFER_BARRIER_BIT = 1 << 4,
+   BUFFER_UPDATE_BARRIER_BIT = 1 << 5,
+   SHADER_IMAGE_ACCESS_BARRIER_BIT = 1 << 6
+};
+
+// How a compute shader accesses an image bound with GFXCmdBuffer::bindImage.
+enum class GFXImageAccess
+{
+   READ_ONLY,
+   WRITE_ONLY,
+   READ_WRITE
+};
+
+enum class GFXMemoryCategory
+{
+   VERTEX_BUFFER,
+   INDEX_BUFFER,
+   CONSTANT_BUFFER,
+   STORAGE_BUFFER, // storage and indirect buffers
+   TEXTURE,
+   RENDER_TARGET, // textures attached to a render pass
+   STAGING, // the device's own upload buffers
+   COUNT
+};
+
+struct GFXMemoryCategoryStats
+{
+   size_t allocatedBytes;
+   size_t peakBytes;
+   uint32_t allocationCount;
+};
+
+struct GFXMemoryStats
+{
+   GFXMemoryCategoryStats categories[(int)GFXMemoryCategory::COUNT];
+   size_t totalBytes;
+   size_t peakBytes;
+   size_t budgetBytes; // 0 when no budget is set
+   uint32_t renderPassCount;
+
+   // Reported by the driver through vendor extensions, 0 when unknown.
+   size_t deviceTotalBytes;
+   size_t deviceAvailableBytes;
+};
+
+// A resolved GFXCmdBuffer::beginTimer/endTimer pair, times are on the Profiler::now() clock.
+struct GFXGpuTimer
+{
+   const char* name;
+   uint64_t startNs;
+   uint64_t endNs;
+   uint32_t depth;
+};
+
+// One drawPrimitivesIndirect() draw as it is laid out in the argument buffer, the same in GL,
+// Vulkan and Metal.
+struct GFXDrawPrimitivesIndirectArgs
+{
+   uint32_t vertexCount;
+   uint32_t instanceCount;
+   uint32_t vertexStart;
+   uint32_t baseInstance;
+};
+
+// One multiDrawIndexedPrimitivesIndirectCount() draw as it is laid out in the argument buffer,
+// the same in GL, Vulkan and Metal.
+struct GFXDrawIndexedPrimitivesIndirectArgs
+{
+   uint32_t indexCount;
+   uint32_t instanceCount;
+   uint32_t firstIndex;
+   int32_t baseVertex;
+   uint32_t baseInstance;
 };
 
 enum class GFXInputLayoutDivisor
@@ -90,6 +184,29 @@ enum class GFXCompareFunc
    ALWAYS
 };
 
+enum class GFXBlendFactor
+{
+   ZERO,
+   ONE,
+   SRC_COLOR,
+   ONE_MINUS_SRC_COLOR,
+   SRC_ALPHA,
+   ONE_MINUS_SRC_ALPHA,
+   DST_COLOR,
+   ONE_MINUS_DST_COLOR,
+   DST_ALPHA,
+   ONE_MINUS_DST_ALPHA
+};
+
+enum class GFXBlendOp
+{
+   ADD,
+   SUBTRACT,
+   REVERSE_SUBTRACT,
+   MIN,
+   MAX
+};
+
 enum class GFXStencilFunc
 {
    KEEP,
@@ -155,13 +272,26 @@ enum class GFXTextureType
    TEXTURE_1D,
    TEXTURE_2D,
    TEXTURE_3D,
-   TEXTURE_CUBEMAP
+   TEXTURE_CUBEMAP,
+   TEXTURE_2D_ARRAY
 };
 
 enum class GFXTextureInternalFormat
 {
    RGBA8,
-   DEPTH_16
+   RG16, // unsigned normalized
+   R32F,
+   DEPTH_16,
+   DEPTH_32F,
+
+   // Block compressed, 4x4 texels per block
+   BC1_RGB,
+   BC3_RGBA,
+   BC4_R,
+   BC5_RG,
+   BC7_RGBA,
+   ETC2_RGB8,
+   ETC2_RGBA8
 };
 
 // devices
@@ -175,9 +305,16 @@ struct GFXBufferDesc
    void* data;
 };
 
+// Defaults write the source unchanged, result = src * srcFactor op dst * dstFactor.
 struct GFXBlendStateDesc
 {
-
+   bool enableBlending = false;
+   GFXBlendFactor srcColorFactor = GFXBlendFactor::ONE;
+   GFXBlendFactor dstColorFactor = GFXBlendFactor::ZERO;
+   GFXBlendOp colorOp = GFXBlendOp::ADD;
+   GFXBlendFactor srcAlphaFactor = GFXBlendFactor::ONE;
+   GFXBlendFactor dstAlphaFactor = GFXBlendFactor::ZERO;
+   GFXBlendOp alphaOp = GFXBlendOp::ADD;
 };
 
 // Uses OpenGL defaults
@@ -202,9 +339,29 @@ struct GFXTextureStateDesc
 {
    GFXTextureType type;
    GFXTextureInternalFormat internalFormat;
-   int32_t levels;
+   int32_t levels; // 0 allocates the full mip chain
    int32_t width;
    int32_t height;
+   int32_t depth = 1; // depth for 3D textures, layer count for arrays
+
+   // Optional tightly packed level 0 for every layer/face/slice. Cubemap faces
+   // are in +X, -X, +Y, -Y, +Z, -Z order.
+   const void* data = nullptr;
+   bool generateMipmaps = false;
+};
+
+struct GFXTextureUpdateDesc
+{
+   int32_t level = 0;
+   int32_t x = 0;
+   int32_t y = 0;
+   int32_t z = 0; // slice, array layer or cubemap face
+   int32_t width;
+   int32_t height = 1;
+   int32_t depth = 1;
+
+   // Tightly packed texels. Only needs to stay valid for the duration of the call.
+   const void* data;
 };
 
 struct GFXDepthStencilStateDesc
@@ -261,6 +418,7 @@ struct GFXShaderDesc
    uint32_t codeLength;
 };
 
+// A compute pipeline has a single COMPUTE stage and no input layout.
 struct GFXPipelineDesc
 {
    GFXShaderDesc* shadersStages;
@@ -280,8 +438,9 @@ enum class GFXStoreAttachmentAction
 
 enum class GFXLoadAttachmentAction
 {
-   DONT_CARE, // don't clear, just write new pixels
+   DONT_CARE, // previous contents are undefined, every pixel will be written
    CLEAR, // clear it with a default value
+   LOAD, // keep the previous contents
 };
 
 struct GFXColorRenderPassAttachment
@@ -1,10 +1,21 @@
 #include "app.h"
 #include "apps/main/mainApp.h"
+#include "benchmark.h"
 
 Application* gApplication;
 
 int main(int argc, char *argv[])
 {
+   if (argc > 1)
+   {
+      BenchmarkOptions options;
+      if (!BenchmarkRunner::parseArgs(argc, argv, options))
+         return 1;
+
+      BenchmarkRunner runner(options);
+      return runner.run();
+   }
+
    gApplication = new MainApplication;
    gApplication->init();
    
@@ -13,4 +24,3 @@ int main(int argc, char *argv[])
    gApplication->destroy();
    return 0;
 }
-